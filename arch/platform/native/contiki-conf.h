@@ -61,6 +61,10 @@ typedef unsigned int uip_stats_t;
 #define UIP_CONF_BYTE_ORDER      UIP_LITTLE_ENDIAN
 #endif
 
+#ifndef AES_128_CONF
+#define AES_128_CONF aes_128_ttable_driver
+#endif /* AES_128_CONF */
+
 #if NETSTACK_CONF_WITH_IPV6
 
 #ifndef NETSTACK_CONF_NETWORK
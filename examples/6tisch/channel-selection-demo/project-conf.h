@@ -89,6 +89,14 @@ extern bool tsch_cs_process(void);
 /* The coordinator will update the network nodes with new hopping sequences */
 #define TSCH_PACKET_CONF_EB_WITH_HOPPING_SEQUENCE 1
 
+#if WITH_NETWORK_WIDE_CS
+/* The coordinator distributes a channel blacklist rather than a new
+ * hopping sequence, which all nodes switch to at the same ASN */
+#define TSCH_CS_CONF_NETWORK_WIDE 1
+#define TSCH_CONF_WITH_CHANNEL_MAP 1
+#define TSCH_STATS_CONF_CHANNEL_TX 1
+#endif /* WITH_NETWORK_WIDE_CS */
+
 /* Reduce the EB period in order to update the network nodes with more agility */
 #define TSCH_CONF_EB_PERIOD     (4 * CLOCK_SECOND)
 #define TSCH_CONF_MAX_EB_PERIOD (4 * CLOCK_SECOND)
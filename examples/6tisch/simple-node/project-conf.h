@@ -69,6 +69,11 @@
 /************* Other system configuration **************/
 /*******************************************************/
 
+#ifdef WITH_ENERGEST
+/* Energest type used by TSCH slot operation to account for Rx slots */
+#define ENERGEST_CONF_ADDITIONS ENERGEST_TYPE_CUSTOM_LISTEN
+#endif /* WITH_ENERGEST */
+
 /* Logging */
 #define LOG_CONF_LEVEL_RPL                         LOG_LEVEL_WARN
 #define LOG_CONF_LEVEL_TCPIP                       LOG_LEVEL_WARN
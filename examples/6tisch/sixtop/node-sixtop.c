@@ -45,7 +45,11 @@
 #include "net/mac/tsch/sixtop/sixtop.h"
 #include "net/routing/routing.h"
 
+#if BUILD_WITH_SF_ADAPTIVE
+#include "services/sf-adaptive/sf-adaptive.h"
+#else
 #include "sf-simple.h"
+#endif
 
 #define DEBUG DEBUG_PRINT
 #include "net/ipv6/uip-debug.h"
@@ -58,9 +62,11 @@ AUTOSTART_PROCESSES(&node_process);
 PROCESS_THREAD(node_process, ev, data)
 {
   static int is_coordinator;
+#if !BUILD_WITH_SF_ADAPTIVE
   static int added_num_of_links = 0;
   static struct etimer et;
   struct tsch_neighbor *n;
+#endif
 
   PROCESS_BEGIN();
 
@@ -75,6 +81,10 @@ PROCESS_THREAD(node_process, ev, data)
   }
 
   NETSTACK_MAC.on();
+#if BUILD_WITH_SF_ADAPTIVE
+  /* Cells are negotiated automatically, following the traffic */
+  sixtop_add_sf(&sf_adaptive_driver);
+#else
   sixtop_add_sf(&sf_simple_driver);
 
   etimer_set(&et, CLOCK_SECOND * 30);
@@ -96,6 +106,7 @@ PROCESS_THREAD(node_process, ev, data)
       added_num_of_links++;
     }
   }
+#endif /* BUILD_WITH_SF_ADAPTIVE */
 
   PROCESS_END();
 }
@@ -54,6 +54,11 @@
 /* Enable Sixtop Implementation */
 #define TSCH_CONF_WITH_SIXTOP 1
 
+#if BUILD_WITH_SF_ADAPTIVE
+/* Per-cell statistics, for the SF to relocate cells that suffer collisions */
+#define TSCH_STATS_CONF_PER_CELL 1
+#endif /* BUILD_WITH_SF_ADAPTIVE */
+
 /*******************************************************/
 /******************* Configure TSCH ********************/
 /*******************************************************/
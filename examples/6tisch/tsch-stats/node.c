@@ -43,10 +43,17 @@
 #include "net/ipv6/uip-sr.h"
 #include "net/mac/tsch/tsch.h"
 #include "net/routing/routing.h"
+#if WITH_COAP
+#include "coap-engine.h"
+#endif /* WITH_COAP */
 
 #define DEBUG DEBUG_PRINT
 #include "net/ipv6/uip-debug.h"
 
+#if WITH_COAP
+extern coap_resource_t res_tsch_stats;
+#endif /* WITH_COAP */
+
 /*---------------------------------------------------------------------------*/
 PROCESS(node_process, "RPL Node");
 AUTOSTART_PROCESSES(&node_process);
@@ -69,6 +76,10 @@ PROCESS_THREAD(node_process, ev, data)
   }
   NETSTACK_MAC.on();
 
+#if WITH_COAP
+  coap_activate_resource(&res_tsch_stats, "tsch/stats");
+#endif /* WITH_COAP */
+
 #if WITH_PERIODIC_ROUTES_PRINT
   {
     static struct etimer et;
@@ -46,6 +46,12 @@
 #define SICSLOWPAN_CONF_FRAG 0
 #define UIP_CONF_BUFFER_SIZE 160
 
+#if WITH_COAP
+/* Fit CoAP messages in the IPv6 buffer, and in a frame as fragmentation is
+ * off. Larger snapshots are transferred blockwise */
+#define COAP_MAX_CHUNK_SIZE 32
+#endif /* WITH_COAP */
+
 /*******************************************************/
 /******************* Configure TSCH ********************/
 /*******************************************************/
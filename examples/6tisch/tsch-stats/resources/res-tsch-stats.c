@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2018, University of Bristol - http://www.bristol.ac.uk
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *      Observable resource exporting the binary TSCH statistics snapshot.
+ *
+ *      Every representation starts with a 3-byte header: type (0: full
+ *      snapshot, 1: delta), sequence number of the snapshot, and sequence
+ *      number of the snapshot the delta applies to (equal to the former
+ *      for a full snapshot). GET always returns the latest full snapshot,
+ *      blockwise if needed. Notifications carry the delta from the
+ *      previous snapshot when it is smaller, and a full snapshot every
+ *      TSCH_STATS_RES_FULL_INTERVAL notifications, so that an observer
+ *      that missed one resynchronizes. See tsch-stats.h for the formats.
+ */
+
+#include <string.h>
+#include "coap-engine.h"
+#include "net/mac/tsch/tsch.h"
+
+#ifdef TSCH_STATS_RES_CONF_PERIOD
+#define TSCH_STATS_RES_PERIOD TSCH_STATS_RES_CONF_PERIOD
+#else
+#define TSCH_STATS_RES_PERIOD (30 * CLOCK_SECOND)
+#endif
+
+#ifdef TSCH_STATS_RES_CONF_FULL_INTERVAL
+#define TSCH_STATS_RES_FULL_INTERVAL TSCH_STATS_RES_CONF_FULL_INTERVAL
+#else
+#define TSCH_STATS_RES_FULL_INTERVAL 10
+#endif
+
+#define HEADER_LEN  3
+#define TYPE_FULL   0
+#define TYPE_DELTA  1
+
+static void res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset);
+static void res_periodic_handler(void);
+
+PERIODIC_RESOURCE(res_tsch_stats,
+                  "title=\"TSCH statistics\";rt=\"tsch-stats\";ct=42;obs",
+                  res_get_handler,
+                  NULL,
+                  NULL,
+                  NULL,
+                  TSCH_STATS_RES_PERIOD,
+                  res_periodic_handler);
+
+static uint8_t snapshot[TSCH_STATS_SNAPSHOT_MAX_LEN];
+static int snapshot_len;
+static uint8_t seqno;
+/* Delta from the previous snapshot, valid if delta_len > 0 */
+static uint8_t delta[COAP_MAX_CHUNK_SIZE - HEADER_LEN];
+static int delta_len;
+/* Set while notifying observers, as notifications go through the GET handler */
+static uint8_t notifying;
+static uint8_t notifications_since_full;
+
+/*---------------------------------------------------------------------------*/
+static void
+take_snapshot(void)
+{
+  static uint8_t previous[TSCH_STATS_SNAPSHOT_MAX_LEN];
+  int previous_len = snapshot_len;
+  int len;
+
+  memcpy(previous, snapshot, previous_len);
+  len = tsch_stats_snapshot(snapshot, sizeof(snapshot));
+  if(len < 0) {
+    /* Cannot happen as the buffer has the maximum size, but keep it sane */
+    len = 0;
+  }
+  snapshot_len = len;
+  seqno++;
+
+  delta_len = -1;
+  if(previous_len > 0) {
+    delta_len = tsch_stats_snapshot_delta(previous, previous_len,
+                                          snapshot, snapshot_len,
+                                          delta, sizeof(delta));
+    if(delta_len >= snapshot_len) {
+      /* Not worth it */
+      delta_len = -1;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+res_get_handler(coap_message_t *request, coap_message_t *response, uint8_t *buffer, uint16_t preferred_size, int32_t *offset)
+{
+  int32_t total;
+  int32_t pos;
+  int len = 0;
+
+  if(snapshot_len == 0) {
+    take_snapshot();
+  }
+
+  coap_set_header_content_format(response, APPLICATION_OCTET_STREAM);
+  coap_set_header_max_age(response, TSCH_STATS_RES_PERIOD / CLOCK_SECOND);
+
+  if(notifying && delta_len >= 0
+     && notifications_since_full < TSCH_STATS_RES_FULL_INTERVAL) {
+    buffer[0] = TYPE_DELTA;
+    buffer[1] = seqno;
+    buffer[2] = seqno - 1;
+    memcpy(buffer + HEADER_LEN, delta, delta_len);
+    coap_set_payload(response, buffer, HEADER_LEN + delta_len);
+    return;
+  }
+
+  /* Full snapshot, split in blocks if needed */
+  total = HEADER_LEN + snapshot_len;
+  if(*offset >= total) {
+    coap_set_status_code(response, BAD_OPTION_4_02);
+    coap_set_payload(response, "BlockOutOfScope", 15);
+    return;
+  }
+  for(pos = *offset; pos < total && len < preferred_size; pos++, len++) {
+    if(pos == 0) {
+      buffer[len] = TYPE_FULL;
+    } else if(pos < HEADER_LEN) {
+      buffer[len] = seqno;
+    } else {
+      buffer[len] = snapshot[pos - HEADER_LEN];
+    }
+  }
+  coap_set_payload(response, buffer, len);
+
+  if(*offset == 0 && pos >= total) {
+    /* Fits in a single message */
+    return;
+  }
+  *offset = pos >= total ? -1 : pos;
+}
+/*---------------------------------------------------------------------------*/
+static void
+res_periodic_handler(void)
+{
+  int send_full;
+
+  take_snapshot();
+
+  send_full = delta_len < 0
+    || notifications_since_full >= TSCH_STATS_RES_FULL_INTERVAL;
+
+  notifying = 1;
+  coap_notify_observers(&res_tsch_stats);
+  notifying = 0;
+
+  notifications_since_full = send_full ? 0 : notifications_since_full + 1;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,120 @@
+/**
+ * \file
+ *         Native benchmark of the software AES-128 drivers and of CCM*,
+ *         in CPU cycles per byte (time stamp counter on x86, nanoseconds
+ *         elsewhere).
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "lib/ccm-star.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "cycles"
+#else
+#define BENCH_UNIT "ns"
+#endif
+
+/* Number of iterations of every measurement */
+#define BENCH_ITERATIONS 20000
+/* Largest 802.15.4 frame, with a typical TSCH data frame header */
+#define BENCH_FRAME_LEN 127
+#define BENCH_HDR_LEN 23
+#define BENCH_MIC_LEN 4
+
+#define BENCH_STRINGIFY_(x) #x
+#define BENCH_STRINGIFY(x) BENCH_STRINGIFY_(x)
+
+PROCESS(ccm_star_bench_process, "CCM* benchmark");
+AUTOSTART_PROCESSES(&ccm_star_bench_process);
+
+static const uint8_t key[AES_128_KEY_LENGTH] = {
+  0x36, 0x54, 0x69, 0x53, 0x43, 0x48, 0x20, 0x6d,
+  0x69, 0x6e, 0x69, 0x6d, 0x61, 0x6c, 0x31, 0x35
+};
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_aes(const char *name, const struct aes_128_driver *driver)
+{
+  uint8_t block[AES_128_BLOCK_SIZE];
+  uint64_t start;
+  uint64_t duration;
+  int i;
+
+  memset(block, 0, sizeof(block));
+  driver->set_key(key);
+  start = now();
+  for(i = 0; i < BENCH_ITERATIONS; i++) {
+    driver->encrypt(block);
+  }
+  duration = now() - start;
+  printf("%-22s %6.1f %s/byte\n", name,
+         (double)duration / ((double)BENCH_ITERATIONS * AES_128_BLOCK_SIZE),
+         BENCH_UNIT);
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_ccm_star(const char *name, int with_encryption)
+{
+  uint8_t frame[BENCH_FRAME_LEN];
+  uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+  uint8_t m_len = BENCH_FRAME_LEN - BENCH_HDR_LEN - BENCH_MIC_LEN;
+  uint64_t start;
+  uint64_t duration;
+  int i;
+
+  memset(frame, 0x5a, sizeof(frame));
+  memset(nonce, 0, sizeof(nonce));
+  start = now();
+  for(i = 0; i < BENCH_ITERATIONS; i++) {
+    /* As TSCH does, set the key for every frame, with a new nonce */
+    nonce[CCM_STAR_NONCE_LENGTH - 1] = i;
+    CCM_STAR.set_key(key);
+    if(with_encryption) {
+      CCM_STAR.aead(nonce, frame + BENCH_HDR_LEN, m_len, frame, BENCH_HDR_LEN,
+                    frame + BENCH_FRAME_LEN - BENCH_MIC_LEN, BENCH_MIC_LEN, 1);
+    } else {
+      CCM_STAR.aead(nonce, NULL, 0, frame, BENCH_HDR_LEN + m_len,
+                    frame + BENCH_FRAME_LEN - BENCH_MIC_LEN, BENCH_MIC_LEN, 1);
+    }
+  }
+  duration = now() - start;
+  printf("%-22s %6.1f %s/byte\n", name,
+         (double)duration / ((double)BENCH_ITERATIONS * BENCH_FRAME_LEN),
+         BENCH_UNIT);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ccm_star_bench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("AES-128, %u blocks\n", BENCH_ITERATIONS);
+  bench_aes("byte-oriented", &aes_128_driver);
+  bench_aes("table-based", &aes_128_ttable_driver);
+
+  printf("CCM* on %s, %u frames of %u bytes\n",
+         BENCH_STRINGIFY(AES_128), BENCH_ITERATIONS, BENCH_FRAME_LEN);
+  bench_ccm_star("MIC-32", 0);
+  bench_ccm_star("ENC-MIC-32", 1);
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
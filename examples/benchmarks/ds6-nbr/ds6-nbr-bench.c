@@ -0,0 +1,116 @@
+/**
+ * \file
+ *         Native benchmark of the IPv6 neighbor cache (uip-ds6-nbr.c): CPU
+ *         cycles per lookup by IPv6 and by link-layer address (time stamp
+ *         counter on x86, nanoseconds elsewhere), for a growing number of
+ *         neighbors.
+ */
+
+#include "contiki.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "cycles"
+#else
+#define BENCH_UNIT "ns"
+#endif
+
+/* Number of lookups per neighbor */
+#define BENCH_ROUNDS 1000
+
+PROCESS(ds6_nbr_bench_process, "Neighbor cache benchmark");
+AUTOSTART_PROCESSES(&ds6_nbr_bench_process);
+
+static const int num_neighbors[] = { 8, 16, 50, 200 };
+
+static uip_ipaddr_t ipaddrs[NBR_TABLE_MAX_NEIGHBORS];
+static uip_lladdr_t lladdrs[NBR_TABLE_MAX_NEIGHBORS];
+
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench(int neighbors)
+{
+  uint64_t start;
+  uint64_t ip_duration;
+  uint64_t ll_duration;
+  unsigned missing = 0;
+  int round;
+  int i;
+
+  nbr_table_clear();
+  for(i = 0; i < neighbors; i++) {
+    uip_ds6_nbr_add(&ipaddrs[i], &lladdrs[i], 0, NBR_REACHABLE,
+                    NBR_TABLE_REASON_IPV6_ND, NULL);
+  }
+
+  start = now();
+  for(round = 0; round < BENCH_ROUNDS; round++) {
+    for(i = 0; i < neighbors; i++) {
+      if(uip_ds6_nbr_lookup(&ipaddrs[i]) == NULL) {
+        missing++;
+      }
+    }
+  }
+  ip_duration = now() - start;
+
+  start = now();
+  for(round = 0; round < BENCH_ROUNDS; round++) {
+    for(i = 0; i < neighbors; i++) {
+      if(uip_ds6_nbr_ll_lookup(&lladdrs[i]) == NULL) {
+        missing++;
+      }
+    }
+  }
+  ll_duration = now() - start;
+
+  printf("%4d neighbors: %7.1f %s/IPv6 lookup, %7.1f %s/link-layer lookup%s\n",
+         neighbors,
+         (double)ip_duration / ((double)BENCH_ROUNDS * neighbors), BENCH_UNIT,
+         (double)ll_duration / ((double)BENCH_ROUNDS * neighbors), BENCH_UNIT,
+         missing ? " (neighbors missing)" : "");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ds6_nbr_bench_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  /* Global addresses of nodes of the same vendor */
+  for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS; i++) {
+    memset(&lladdrs[i], 0, sizeof(lladdrs[i]));
+    lladdrs[i].addr[0] = 0x00;
+    lladdrs[i].addr[1] = 0x12;
+    lladdrs[i].addr[2] = 0x4b;
+    lladdrs[i].addr[UIP_LLADDR_LEN - 2] = i >> 8;
+    lladdrs[i].addr[UIP_LLADDR_LEN - 1] = i;
+    uip_ip6addr(&ipaddrs[i], UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0, 0, 0);
+    uip_ds6_set_addr_iid(&ipaddrs[i], &lladdrs[i]);
+  }
+
+  for(i = 0; i < sizeof(num_neighbors) / sizeof(num_neighbors[0]); i++) {
+    bench(num_neighbors[i]);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,7 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* As many neighbors as a large border router */
+#define NBR_TABLE_CONF_MAX_NEIGHBORS 200
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,134 @@
+/**
+ * \file
+ *         Native benchmark of the IPv6 routing table (uip-ds6-route.c): CPU
+ *         cycles per longest-prefix match (time stamp counter on x86,
+ *         nanoseconds elsewhere), for a growing number of routes.
+ */
+
+#include "contiki.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "cycles"
+#else
+#define BENCH_UNIT "ns"
+#endif
+
+/* Number of lookups per route */
+#define BENCH_ROUNDS 200
+#define NUM_NEXTHOPS 8
+
+PROCESS(ds6_route_bench_process, "Routing table benchmark");
+AUTOSTART_PROCESSES(&ds6_route_bench_process);
+
+static const int num_routes[] = { 50, 200, 1000 };
+
+static uip_ipaddr_t nexthops[NUM_NEXTHOPS];
+static uip_ipaddr_t dests[UIP_DS6_ROUTE_NB];
+/* Random order of the destinations */
+static uint16_t order[BENCH_ROUNDS][UIP_DS6_ROUTE_NB];
+
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench(int routes)
+{
+  uint64_t start;
+  uint64_t random_duration;
+  uint64_t repeat_duration;
+  unsigned missing = 0;
+  uip_ds6_route_t *r;
+  int round;
+  int i;
+
+  while((r = uip_ds6_route_head()) != NULL) {
+    uip_ds6_route_rm(r);
+  }
+  for(i = 0; i < routes; i++) {
+    uip_ds6_route_add(&dests[i], 128, &nexthops[i % NUM_NEXTHOPS]);
+  }
+  if(uip_ds6_route_num_routes() != routes) {
+    missing++;
+  }
+
+  start = now();
+  for(round = 0; round < BENCH_ROUNDS; round++) {
+    for(i = 0; i < routes; i++) {
+      if(uip_ds6_route_lookup(&dests[order[round][i] % routes]) == NULL) {
+        missing++;
+      }
+    }
+  }
+  random_duration = now() - start;
+
+  start = now();
+  for(round = 0; round < BENCH_ROUNDS; round++) {
+    for(i = 0; i < routes; i++) {
+      if(uip_ds6_route_lookup(&dests[0]) == NULL) {
+        missing++;
+      }
+    }
+  }
+  repeat_duration = now() - start;
+
+  printf("%4d routes: %7.1f %s/random lookup, %7.1f %s/repeated lookup%s\n",
+         routes,
+         (double)random_duration / ((double)BENCH_ROUNDS * routes), BENCH_UNIT,
+         (double)repeat_duration / ((double)BENCH_ROUNDS * routes), BENCH_UNIT,
+         missing ? " (routes missing)" : "");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(ds6_route_bench_process, ev, data)
+{
+  uip_lladdr_t lladdr;
+  int round;
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < NUM_NEXTHOPS; i++) {
+    memset(&lladdr, 0, sizeof(lladdr));
+    lladdr.addr[UIP_LLADDR_LEN - 1] = i + 1;
+    uip_ip6addr(&nexthops[i], 0xfe80, 0, 0, 0, 0, 0, 0, i + 1);
+    uip_ds6_nbr_add(&nexthops[i], &lladdr, 1, NBR_REACHABLE,
+                    NBR_TABLE_REASON_IPV6_ND, NULL);
+  }
+
+  /* Global addresses of nodes of the same vendor */
+  for(i = 0; i < UIP_DS6_ROUTE_NB; i++) {
+    uip_ip6addr(&dests[i], UIP_DS6_DEFAULT_PREFIX, 0, 0, 0,
+                0x0212, 0x4b00, 0x0600, 0x1000 + i);
+  }
+  srand(1);
+  for(round = 0; round < BENCH_ROUNDS; round++) {
+    for(i = 0; i < UIP_DS6_ROUTE_NB; i++) {
+      order[round][i] = rand();
+    }
+  }
+
+  for(i = 0; i < sizeof(num_routes) / sizeof(num_routes[0]); i++) {
+    bench(num_routes[i]);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
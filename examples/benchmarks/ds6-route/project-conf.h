@@ -0,0 +1,7 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* As many routes as a large storing-mode root */
+#define UIP_CONF_MAX_ROUTES 1000
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,115 @@
+/**
+ * \file
+ *         Native benchmark of MAC duplicate detection (mac-sequence.c): CPU
+ *         cycles per received frame (time stamp counter on x86, nanoseconds
+ *         elsewhere) and share of duplicates not detected, for a growing
+ *         number of senders.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/mac/mac-sequence.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_UNIT "cycles"
+#else
+#define BENCH_UNIT "ns"
+#endif
+
+/* Number of frames per sender */
+#define BENCH_ROUNDS 200
+
+PROCESS(mac_sequence_bench_process, "MAC sequence benchmark");
+AUTOSTART_PROCESSES(&mac_sequence_bench_process);
+
+static const int num_senders[] = { 8, 16, 50, 200 };
+
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_frame(int base, int sender, uint8_t seqno)
+{
+  linkaddr_t addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.u8[0] = base;
+  addr.u8[LINKADDR_SIZE - 2] = sender >> 8;
+  addr.u8[LINKADDR_SIZE - 1] = sender;
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &addr);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, seqno);
+}
+/*---------------------------------------------------------------------------*/
+/* Input of a frame, as done by the MAC layer */
+static int
+frame_input(void)
+{
+  if(mac_sequence_is_duplicate()) {
+    return 1;
+  }
+  mac_sequence_register_seqno();
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench(int base, int senders)
+{
+  uint64_t start;
+  uint64_t duration = 0;
+  unsigned leaked = 0;
+  int round;
+  int i;
+
+  for(round = 0; round < BENCH_ROUNDS; round++) {
+    /* Every sender sends a new frame... */
+    start = now();
+    for(i = 0; i < senders; i++) {
+      set_frame(base, i, round);
+      frame_input();
+    }
+    duration += now() - start;
+    /* ...then retransmits it, as if its ACK was lost */
+    for(i = 0; i < senders; i++) {
+      set_frame(base, i, round);
+      if(!frame_input()) {
+        leaked++;
+      }
+    }
+  }
+  printf("%4d senders: %7.1f %s/frame, %5.1f%% duplicates leaked\n", senders,
+         (double)duration / ((double)BENCH_ROUNDS * senders), BENCH_UNIT,
+         100.0 * leaked / ((double)BENCH_ROUNDS * senders));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(mac_sequence_bench_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  mac_sequence_init();
+  packetbuf_clear();
+  for(i = 0; i < sizeof(num_senders) / sizeof(num_senders[0]); i++) {
+    /* Distinct addresses for every run */
+    bench(i + 1, num_senders[i]);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,8 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* 6LoWPAN over a MAC layer that only counts the frames */
+#define NETSTACK_CONF_NETWORK sicslowpan_driver
+#define NETSTACK_CONF_MAC bench_mac_driver
+
+#endif /* PROJECT_CONF_H_ */
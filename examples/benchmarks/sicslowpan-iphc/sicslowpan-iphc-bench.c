@@ -0,0 +1,184 @@
+/**
+ * \file
+ *         Native benchmark of the 6LoWPAN header compression (sicslowpan.c):
+ *         packets compressed per second for link-local, context-based and
+ *         uncompressed addresses, over a MAC layer that drops all frames.
+ */
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/tcpip.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Number of packets per flow */
+#define BENCH_PACKETS 200000
+/* Number of neighbors the packets are sent to */
+#define BENCH_NEIGHBORS 8
+/* Number of consecutive packets to the same neighbor */
+#define BENCH_BURST 4
+#define BENCH_PAYLOAD_LEN 32
+
+PROCESS(sicslowpan_iphc_bench_process, "6LoWPAN compression benchmark");
+AUTOSTART_PROCESSES(&sicslowpan_iphc_bench_process);
+
+enum {
+  FLOW_LINK_LOCAL,
+  FLOW_CONTEXT,
+  FLOW_INLINE,
+  NUM_FLOWS
+};
+
+static const char *flow_names[] = {
+  "link-local, IIDs from the MAC addresses",
+  "forwarded, context 0, 64-bit IIDs",
+  "global without context, inline",
+};
+
+static linkaddr_t neighbors[BENCH_NEIGHBORS];
+static unsigned frames;
+static uint8_t datagram[UIP_IPH_LEN + UIP_UDPH_LEN + BENCH_PAYLOAD_LEN];
+
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_send(mac_callback_t sent, void *ptr)
+{
+  frames++;
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+bench_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+bench_max_payload(void)
+{
+  return 127 - 23;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver bench_mac_driver = {
+  "bench",
+  bench_init,
+  bench_send,
+  NULL,
+  bench_on,
+  bench_on,
+  bench_max_payload,
+};
+/*---------------------------------------------------------------------------*/
+static void
+set_addresses(int flow, const linkaddr_t *neighbor)
+{
+  struct uip_ip_hdr *ip = (struct uip_ip_hdr *)datagram;
+  linkaddr_t child;
+
+  switch(flow) {
+  case FLOW_LINK_LOCAL:
+    uip_ip6addr(&ip->srcipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+    uip_ds6_set_addr_iid(&ip->srcipaddr, &uip_lladdr);
+    uip_ip6addr(&ip->destipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+    uip_ds6_set_addr_iid(&ip->destipaddr, (const uip_lladdr_t *)neighbor);
+    break;
+  case FLOW_CONTEXT:
+    /* From a child of ours to a node behind the neighbor */
+    linkaddr_copy(&child, neighbor);
+    child.u8[0] ^= 0x80;
+    uip_ip6addr(&ip->srcipaddr, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0, 0, 0);
+    uip_ds6_set_addr_iid(&ip->srcipaddr, (const uip_lladdr_t *)&child);
+    child.u8[0] ^= 0x40;
+    uip_ip6addr(&ip->destipaddr, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0, 0, 0);
+    uip_ds6_set_addr_iid(&ip->destipaddr, (const uip_lladdr_t *)&child);
+    break;
+  default:
+    uip_ip6addr(&ip->srcipaddr, 0x2001, 0xdb8, 0, 0, 0, 0, 0, 1);
+    uip_ip6addr(&ip->destipaddr, 0x2001, 0xdb8, 1, 0, 0, 0, 0,
+                neighbor->u8[LINKADDR_SIZE - 1]);
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init_datagram(void)
+{
+  struct uip_ip_hdr *ip = (struct uip_ip_hdr *)datagram;
+  struct uip_udp_hdr *udp = (struct uip_udp_hdr *)&datagram[UIP_IPH_LEN];
+
+  ip->vtc = 0x60;
+  ip->len[0] = (UIP_UDPH_LEN + BENCH_PAYLOAD_LEN) >> 8;
+  ip->len[1] = (UIP_UDPH_LEN + BENCH_PAYLOAD_LEN) & 0xff;
+  ip->proto = UIP_PROTO_UDP;
+  ip->ttl = 64;
+  udp->srcport = UIP_HTONS(5678);
+  udp->destport = UIP_HTONS(8765);
+  udp->udplen = UIP_HTONS(UIP_UDPH_LEN + BENCH_PAYLOAD_LEN);
+  udp->udpchksum = UIP_HTONS(0x1234);
+  memset(&datagram[UIP_IPH_LEN + UIP_UDPH_LEN], 0xa5, BENCH_PAYLOAD_LEN);
+}
+/*---------------------------------------------------------------------------*/
+static void
+bench(int flow)
+{
+  uint64_t start;
+  uint64_t duration;
+  unsigned packet;
+  int neighbor;
+
+  frames = 0;
+  start = now();
+  for(packet = 0; packet < BENCH_PACKETS; packet++) {
+    neighbor = (packet / BENCH_BURST) % BENCH_NEIGHBORS;
+    set_addresses(flow, &neighbors[neighbor]);
+    memcpy(uip_buf, datagram, sizeof(datagram));
+    uip_len = sizeof(datagram);
+    tcpip_output((const uip_lladdr_t *)&neighbors[neighbor]);
+  }
+  duration = now() - start;
+  uipbuf_clear();
+
+  printf("%-40s %9.0f packets/s%s\n", flow_names[flow],
+         BENCH_PACKETS * 1e9 / (double)duration,
+         frames != BENCH_PACKETS ? " (packets lost)" : "");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sicslowpan_iphc_bench_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < BENCH_NEIGHBORS; i++) {
+    linkaddr_copy(&neighbors[i], &linkaddr_node_addr);
+    neighbors[i].u8[LINKADDR_SIZE - 1] ^= i + 1;
+  }
+  init_datagram();
+
+  for(i = 0; i < NUM_FLOWS; i++) {
+    bench(i);
+  }
+
+  exit(0);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -81,6 +81,7 @@ static const uint8_t sbox[256] = {
   0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
 };
 static uint8_t round_keys[11][AES_128_KEY_LENGTH];
+static uint8_t has_key;
 
 /*---------------------------------------------------------------------------*/
 /* multiplies by 2 in GF(2) */
@@ -98,6 +99,12 @@ set_key(const uint8_t *key)
   uint8_t j;
   uint8_t rcon;
 
+  /* CCM* sets the key before every frame: skip the expansion if unchanged */
+  if(has_key && !memcmp(round_keys[0], key, AES_128_KEY_LENGTH)) {
+    return;
+  }
+  has_key = 1;
+
   rcon = 0x01;
   memcpy(round_keys[0], key, AES_128_KEY_LENGTH);
   for(i = 1; i <= 10; i++) {
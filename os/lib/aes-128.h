@@ -45,6 +45,12 @@
 #define AES_128_BLOCK_SIZE 16
 #define AES_128_KEY_LENGTH 16
 
+/*
+ * The AES-128 driver. aes_128_driver works byte by byte and suits 8 and
+ * 16-bit MCUs. aes_128_ttable_driver works on 32-bit words with a 1 KiB
+ * lookup table; it is much faster on 32-bit and native targets without
+ * an AES coprocessor.
+ */
 #ifdef AES_128_CONF
 #define AES_128            AES_128_CONF
 #else /* AES_128_CONF */
@@ -67,6 +73,8 @@ struct aes_128_driver {
   void (* encrypt)(uint8_t *plaintext_and_result);
 };
 
+extern const struct aes_128_driver aes_128_driver;
+extern const struct aes_128_driver aes_128_ttable_driver;
 extern const struct aes_128_driver AES_128;
 
 #endif /* AES_128_H_ */
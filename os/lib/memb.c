@@ -42,6 +42,7 @@
  * Memory block allocation routines.
  * \author Adam Dunkels <adam@sics.se>
  */
+#include <stddef.h>
 #include <string.h>
 
 #include "contiki.h"
@@ -104,6 +105,17 @@ memb_inmemb(struct memb *m, void *ptr)
     (char *)ptr < (char *)m->mem + (m->num * m->size);
 }
 /*---------------------------------------------------------------------------*/
+int
+memb_index(struct memb *m, const void *ptr)
+{
+  ptrdiff_t offset = (const char *)ptr - (const char *)m->mem;
+
+  if(offset < 0 || offset >= m->num * m->size || offset % m->size != 0) {
+    return -1;
+  }
+  return offset / m->size;
+}
+/*---------------------------------------------------------------------------*/
 size_t
 memb_numfree(struct memb *m)
 {
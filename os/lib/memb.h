@@ -141,6 +141,19 @@ int  memb_free(struct memb *m, void *ptr);
  */
 int memb_inmemb(struct memb *m, void *ptr);
 
+/**
+ * Get the index of a memory block within a memory area previously
+ * declared with MEMB().
+ *
+ * \param m m A set of memory blocks previously declared with MEMB().
+ *
+ * \param ptr A pointer to the memory block
+ *
+ * \return the index of the memory block, between 0 and the number of
+ * blocks minus one, or -1 if "ptr" does not point to a block of the area
+ */
+int memb_index(struct memb *m, const void *ptr);
+
 /**
  * Count free memory blocks
  *
@@ -70,6 +70,7 @@
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/uipbuf.h"
 #include "net/ipv6/sicslowpan.h"
+#include "net/nbr-table.h"
 #include "net/netstack.h"
 #include "net/packetbuf.h"
 #include "net/queuebuf.h"
@@ -94,6 +95,10 @@
 #define PACKETBUF_FRAG_DISPATCH_SIZE 0   /* 16 bit */
 #define PACKETBUF_FRAG_TAG           2   /* 16 bit */
 #define PACKETBUF_FRAG_OFFSET        4   /* 8 bit */
+#define PACKETBUF_RFRAG_TAG          1   /* 8 bit */
+#define PACKETBUF_RFRAG_SEQ_SIZE     2   /* 16 bit */
+#define PACKETBUF_RFRAG_OFFSET       4   /* 16 bit */
+#define PACKETBUF_RFRAG_ACK_BITMAP   2   /* 32 bit */
 
 /* define the buffer as a byte array */
 #define PACKETBUF_IPHC_BUF              ((uint8_t *)(packetbuf_ptr + packetbuf_hdr_len))
@@ -239,6 +244,49 @@ static uint16_t my_tag;
 /* Assuming that the worst growth for uncompression is 38 bytes */
 #define SICSLOWPAN_FIRST_FRAGMENT_SIZE (SICSLOWPAN_FRAGMENT_SIZE + 38)
 
+/* Selective fragment recovery (RFC 8931): datagrams are sent in RFRAG
+ * fragments, which the receiver acknowledges with a bitmap, and only the
+ * missing fragments are sent again. */
+#ifdef SICSLOWPAN_CONF_FRAG_RECOVERY
+#define SICSLOWPAN_FRAG_RECOVERY SICSLOWPAN_CONF_FRAG_RECOVERY
+#else
+#define SICSLOWPAN_FRAG_RECOVERY 0
+#endif
+
+#if SICSLOWPAN_FRAG_RECOVERY
+/* The number of datagrams that can be awaiting an RFRAG-ACK at the same time */
+#ifdef SICSLOWPAN_CONF_SFR_ENTRIES
+#define SICSLOWPAN_SFR_ENTRIES SICSLOWPAN_CONF_SFR_ENTRIES
+#else
+#define SICSLOWPAN_SFR_ENTRIES 1
+#endif
+
+/* How long to wait for an RFRAG-ACK once the fragment requesting it is sent */
+#ifdef SICSLOWPAN_CONF_SFR_ACK_TIMEOUT
+#define SICSLOWPAN_SFR_ACK_TIMEOUT SICSLOWPAN_CONF_SFR_ACK_TIMEOUT
+#else
+#define SICSLOWPAN_SFR_ACK_TIMEOUT (2 * CLOCK_SECOND)
+#endif
+
+/* The number of times an RFRAG-ACK is requested again before giving up */
+#ifdef SICSLOWPAN_CONF_SFR_MAX_RETRIES
+#define SICSLOWPAN_SFR_MAX_RETRIES SICSLOWPAN_CONF_SFR_MAX_RETRIES
+#else
+#define SICSLOWPAN_SFR_MAX_RETRIES 3
+#endif
+
+/* How long the sender may take to recover the missing fragments */
+#define SICSLOWPAN_SFR_REASS_TIMEOUT \
+  (SICSLOWPAN_SFR_ACK_TIMEOUT * (SICSLOWPAN_SFR_MAX_RETRIES + 1))
+
+/* The RFRAG-ACK bitmap has one bit per fragment, the first one being the MSB */
+#define SICSLOWPAN_RFRAG_MAX_FRAGMENTS 32
+#define SICSLOWPAN_RFRAG_BIT(seq) (0x80000000UL >> (seq))
+#define SICSLOWPAN_RFRAG_ACK_REQ  0x8000
+#define SICSLOWPAN_RFRAG_SEQ(x)   (((x) >> 10) & 0x1f)
+#define SICSLOWPAN_RFRAG_SIZE(x)  ((x) & 0x03ff)
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+
 /* all information needed for reassembly */
 struct sicslowpan_frag_info {
   /** When reassembling, the source address of the fragments being merged */
@@ -252,6 +300,19 @@ struct sicslowpan_frag_info {
   /** Reassembly %process %timer. */
   struct timer reass_timer;
 
+#if SICSLOWPAN_FRAG_RECOVERY
+  /** The datagram is sent in RFRAG fragments */
+  uint8_t is_rfrag;
+  /** The RFRAG fragments received so far */
+  uint32_t rfrag_bitmap;
+  /** Size of the compressed datagram (zero until the first fragment) */
+  uint16_t comp_len;
+  /** Number of bytes of the compressed datagram received so far */
+  uint16_t comp_received;
+  /** Offset in the IP packet minus offset in the compressed datagram */
+  int16_t offset_delta;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+
   /** Fragment size of first fragment */
   uint16_t first_frag_len;
   /** First fragment - needs a larger buffer since the size is uncompressed size
@@ -264,8 +325,8 @@ static struct sicslowpan_frag_info frag_info[SICSLOWPAN_REASS_CONTEXTS];
 struct sicslowpan_frag_buf {
   /* the index of the frag_info */
   uint8_t index;
-  /* Fragment offset */
-  uint8_t offset;
+  /* Fragment offset, in bytes */
+  uint16_t offset;
   /* Length of this fragment (if zero this buffer is not allocated) */
   uint8_t len;
   uint8_t data[SICSLOWPAN_FRAGMENT_SIZE];
@@ -273,6 +334,149 @@ struct sicslowpan_frag_buf {
 
 static struct sicslowpan_frag_buf frag_buf[SICSLOWPAN_FRAGMENT_BUFFERS];
 
+/* Fragment forwarding (RFC 8930): the fragments of a datagram that is not
+ * for us are forwarded as they arrive, with the tag rewritten, instead of
+ * being reassembled and fragmented again. */
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARDING
+#define SICSLOWPAN_FRAG_FORWARDING SICSLOWPAN_CONF_FRAG_FORWARDING
+#else
+#define SICSLOWPAN_FRAG_FORWARDING 0
+#endif
+
+#if SICSLOWPAN_FRAG_FORWARDING
+/* The number of datagrams that can be forwarded at the same time */
+#ifdef SICSLOWPAN_CONF_VRB_ENTRIES
+#define SICSLOWPAN_VRB_ENTRIES SICSLOWPAN_CONF_VRB_ENTRIES
+#else
+#define SICSLOWPAN_VRB_ENTRIES 4
+#endif
+
+/* The number of 8-byte units of the largest datagram */
+#define SICSLOWPAN_VRB_UNITS ((UIP_BUFSIZE + 7) / 8)
+
+/* A Virtual Reassembly Buffer entry: where to forward the fragments of a datagram */
+struct sicslowpan_vrb {
+  /** The previous hop of the datagram */
+  linkaddr_t sender;
+  /** The tag of the datagram from the previous hop */
+  uint16_t tag;
+  /** The next hop of the datagram */
+  linkaddr_t next_hop;
+  /** The tag of the datagram to the next hop */
+  uint16_t next_tag;
+  /** Total length of the datagram (if zero this entry is not allocated) */
+  uint16_t len;
+  /** Bitmap of the 8-byte units of the datagram forwarded so far */
+  uint8_t forwarded_units[(SICSLOWPAN_VRB_UNITS + 7) / 8];
+  /** Number of 8-byte units of the datagram forwarded so far */
+  uint16_t forwarded;
+  /** Removes the entry if the datagram is not completed in time */
+  struct timer timer;
+};
+
+static struct sicslowpan_vrb vrb_table[SICSLOWPAN_VRB_ENTRIES];
+
+/*---------------------------------------------------------------------------*/
+static struct sicslowpan_vrb *
+vrb_alloc(void)
+{
+  int i;
+  for(i = 0; i < SICSLOWPAN_VRB_ENTRIES; i++) {
+    if(vrb_table[i].len == 0 || timer_expired(&vrb_table[i].timer)) {
+      return &vrb_table[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct sicslowpan_vrb *
+vrb_lookup(const linkaddr_t *sender, uint16_t tag)
+{
+  int i;
+  for(i = 0; i < SICSLOWPAN_VRB_ENTRIES; i++) {
+    if(vrb_table[i].len > 0 && vrb_table[i].tag == tag
+       && linkaddr_cmp(&vrb_table[i].sender, sender)) {
+      if(timer_expired(&vrb_table[i].timer)) {
+        vrb_table[i].len = 0;
+        return NULL;
+      }
+      return &vrb_table[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Mark the bytes [offset, offset + len[ of the datagram as forwarded, and
+ * free the entry once the whole datagram is forwarded, whatever the order
+ * of its fragments. Duplicate fragments are counted once. */
+static void
+vrb_forwarded(struct sicslowpan_vrb *vrb, uint16_t offset, uint16_t len)
+{
+  uint16_t num_units = (vrb->len + 7) / 8;
+  uint16_t end = MIN((offset + len + 7) / 8, num_units);
+  uint16_t unit;
+
+  for(unit = offset / 8; unit < end; unit++) {
+    if((vrb->forwarded_units[unit / 8] & (1 << (unit % 8))) == 0) {
+      vrb->forwarded_units[unit / 8] |= 1 << (unit % 8);
+      vrb->forwarded++;
+    }
+  }
+  if(vrb->forwarded >= num_units) {
+    vrb->len = 0;
+  }
+}
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
+#if SICSLOWPAN_FRAG_RECOVERY
+/* A datagram sent in RFRAG fragments, kept until they are all acknowledged */
+struct sicslowpan_rfrag_tx {
+  /** Requests the RFRAG-ACK again if it does not come in time */
+  struct ctimer timer;
+  /** The link-layer attributes of the datagram */
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  /** The next hop of the datagram */
+  linkaddr_t receiver;
+  /** The fragments acknowledged so far */
+  uint32_t acked;
+  /** Size of the compressed datagram (if zero this entry is not allocated) */
+  uint16_t len;
+  /** Size of all fragments but the last one */
+  uint16_t frag_size;
+  uint8_t tag;
+  /** Number of fragments */
+  uint8_t count;
+  /** Number of times fragments were sent again */
+  uint8_t retries;
+  /** The compressed datagram */
+  uint8_t data[UIP_BUFSIZE];
+};
+
+static struct sicslowpan_rfrag_tx rfrag_tx[SICSLOWPAN_SFR_ENTRIES];
+
+/* The RFRAG-ACK to send once the received fragment is processed */
+static struct {
+  linkaddr_t dest;
+  uint32_t bitmap;
+  uint8_t tag;
+  uint8_t pending;
+#if LLSEC802154_USES_AUX_HEADER
+  uint8_t security_level;
+  uint8_t key_index;
+#endif /* LLSEC802154_USES_AUX_HEADER */
+} rfrag_ack;
+
+/* The last datagram reassembled from RFRAG fragments, so that fragments
+ * sent again because of a lost RFRAG-ACK are acknowledged again */
+static struct {
+  linkaddr_t sender;
+  uint32_t bitmap;
+  struct timer timer;
+  uint8_t tag;
+} rfrag_done;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+
 /*---------------------------------------------------------------------------*/
 static int
 clear_fragments(uint8_t frag_info_index)
@@ -306,7 +510,7 @@ timeout_fragments(int not_context)
 }
 /*---------------------------------------------------------------------------*/
 static int
-store_fragment(uint8_t index, uint8_t offset)
+store_fragment(uint8_t index, uint16_t offset)
 {
   int i;
   int len;
@@ -342,8 +546,23 @@ add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
   int len;
   int8_t found = -1;
 
-  if(offset == 0) {
-    /* This is a first fragment - check if we can add this */
+  /* Fragments may arrive out of order: look for the context of the
+     datagram, unless this is a first fragment that was received already */
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(frag_info[i].tag == tag && frag_info[i].len > 0 &&
+#if SICSLOWPAN_FRAG_RECOVERY
+       !frag_info[i].is_rfrag &&
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+       (offset != 0 || frag_info[i].first_frag_len == 0) &&
+       linkaddr_cmp(&frag_info[i].sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+      /* Tag and Sender match - this must be the correct info to store in */
+      found = i;
+      break;
+    }
+  }
+
+  if(found < 0) {
+    /* This is a new datagram - check if we can add this */
     for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
       /* clear all fragment info with expired timer to free all fragment buffers */
       if(frag_info[i].len > 0 && timer_expired(&frag_info[i].reass_timer)) {
@@ -366,42 +585,34 @@ add_fragment(uint16_t tag, uint16_t frag_size, uint8_t offset)
     /* Found a free fragment info to store data in */
     frag_info[found].len = frag_size;
     frag_info[found].tag = tag;
+    frag_info[found].reassembled_len = 0;
+    frag_info[found].first_frag_len = 0;
     linkaddr_copy(&frag_info[found].sender,
                   packetbuf_addr(PACKETBUF_ADDR_SENDER));
     timer_set(&frag_info[found].reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+#if SICSLOWPAN_FRAG_RECOVERY
+    frag_info[found].is_rfrag = 0;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+  }
+
+  if(offset == 0) {
     /* first fragment can not be stored immediately but is moved into
        the buffer while uncompressing */
     return found;
   }
 
-  /* This is a N-fragment - should find the info */
-  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
-    if(frag_info[i].tag == tag && frag_info[i].len > 0 &&
-       linkaddr_cmp(&frag_info[i].sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
-      /* Tag and Sender match - this must be the correct info to store in */
-      found = i;
-      break;
-    }
-  }
-
-  if(found < 0) {
-    /* no entry found for storing the new fragment */
-    LOG_WARN("reassembly: failed to store N-fragment - could not find session - tag: %d offset: %d\n", tag, offset);
-    return -1;
-  }
-
-  /* i is the index of the reassembly context */
-  len = store_fragment(i, offset);
-  if(len < 0 && timeout_fragments(i) > 0) {
-    len = store_fragment(i, offset);
+  /* found is the index of the reassembly context */
+  len = store_fragment(found, (uint16_t)offset << 3);
+  if(len < 0 && timeout_fragments(found) > 0) {
+    len = store_fragment(found, (uint16_t)offset << 3);
   }
   if(len > 0) {
-    frag_info[i].reassembled_len += len;
-    return i;
+    frag_info[found].reassembled_len += len;
+    return found;
   } else {
     /* should we also clear all fragments since we failed to store
        this fragment? */
-    LOG_WARN("reassembly: failed to store fragment - packet reassembly will fail tag:%d l\n", frag_info[i].tag);
+    LOG_WARN("reassembly: failed to store fragment - packet reassembly will fail tag:%d l\n", frag_info[found].tag);
     return -1;
   }
 }
@@ -432,12 +643,22 @@ copy_frags2uip(int context)
   for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
     /* And also copy all matching fragments */
     if(frag_buf[i].len > 0 && frag_buf[i].index == context) {
-      if(((size_t)frag_buf[i].offset << 3) + frag_buf[i].len > sizeof(uip_buf)) {
+      int offset = frag_buf[i].offset;
+#if SICSLOWPAN_FRAG_RECOVERY
+      if(frag_info[context].is_rfrag) {
+        /* The offset is in the compressed datagram */
+        offset += frag_info[context].offset_delta;
+        if(offset < frag_info[context].first_frag_len) {
+          offset = -1;
+        }
+      }
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+      if(offset < 0 || (size_t)offset + frag_buf[i].len > sizeof(uip_buf)) {
         LOG_WARN("input: invalid fragment offset\n");
         clear_fragments(context);
         return false;
       }
-      memcpy((uint8_t *)UIP_IP_BUF + (uint16_t)(frag_buf[i].offset << 3),
+      memcpy((uint8_t *)UIP_IP_BUF + offset,
              (uint8_t *)frag_buf[i].data, frag_buf[i].len);
     }
   }
@@ -510,6 +731,79 @@ static struct sicslowpan_addr_context
 addr_contexts[SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS];
 #endif
 
+/* Per-neighbor cache of the address compression: the addresses of the
+ * packets sent to a neighbor rarely change, so the context lookups and
+ * IID checks are done once and their outcome is reused. */
+#ifdef SICSLOWPAN_CONF_IPHC_CACHE
+#define SICSLOWPAN_IPHC_CACHE SICSLOWPAN_CONF_IPHC_CACHE
+#else
+#define SICSLOWPAN_IPHC_CACHE 0
+#endif
+
+#if SICSLOWPAN_GHC && SICSLOWPAN_COMPRESSION < SICSLOWPAN_COMPRESSION_IPHC
+#error "SICSLOWPAN_CONF_GHC requires IPHC compression"
+#endif
+
+#define SICSLOWPAN_NBR_STATE (SICSLOWPAN_IPHC_CACHE || SICSLOWPAN_GHC)
+
+#if SICSLOWPAN_NBR_STATE
+/* The compression state of a neighbor */
+struct sicslowpan_nbr {
+#if SICSLOWPAN_IPHC_CACHE
+  /* The address compression of the last packet sent to the neighbor */
+  /** The source address of the packet */
+  uip_ipaddr_t src;
+  /** The destination address of the packet */
+  uip_ipaddr_t dst;
+  /** The CID, SAC, SAM, M, DAC and DAM bits of the second IPHC byte */
+  uint8_t iphc1;
+  /** The SCI | DCI byte */
+  uint8_t cid;
+  /** The generation of the contexts the entry was computed with */
+  uint8_t generation;
+#endif /* SICSLOWPAN_IPHC_CACHE */
+#if SICSLOWPAN_GHC
+  /** Whether the neighbor decompresses GHC */
+  uint8_t ghc_capable;
+#endif /* SICSLOWPAN_GHC */
+};
+
+NBR_TABLE(struct sicslowpan_nbr, sicslowpan_nbrs);
+
+/* The entry of the last neighbor, saves the table lookup on bursts */
+static struct sicslowpan_nbr *nbr_last;
+#endif /* SICSLOWPAN_NBR_STATE */
+
+#if SICSLOWPAN_IPHC_CACHE
+/* Incremented whenever the contexts change; zero is never valid */
+static uint8_t iphc_cache_generation;
+#endif /* SICSLOWPAN_IPHC_CACHE */
+
+#if SICSLOWPAN_GHC
+/* GHC bytecodes (RFC 7400) */
+#define GHC_LITERAL_MAX   95    /* 0kkkkkkk: k bytes follow, k < 96 */
+#define GHC_ZEROS         0x80  /* 1000nnnn: nnnn + 2 zeroes */
+#define GHC_ZEROS_MASK    0xf0
+#define GHC_ZEROS_MAX     17
+#define GHC_STOP          0x90
+#define GHC_EXTEND        0xa0  /* 101nssss: sa += ssss << 3, na += n << 3 */
+#define GHC_EXTEND_MASK   0xe0
+#define GHC_BACKREF       0xc0  /* 11nnnkkk: n = na + nnn + 2, s = kkk + sa + n */
+/* Longest back-reference and farthest offset with a single extension */
+#define GHC_BACKREF_MAX   17
+#define GHC_OFFSET_MAX    127
+/* Pseudo-header: source and destination addresses, then static dictionary */
+#define GHC_DICT_LEN      48
+
+static const uint8_t ghc_static_dict[16] = {
+  0x16, 0xfe, 0xfd, 0x17, 0xfe, 0xfd, 0x00, 0x01,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00
+};
+
+/* The LOWPAN_UDP byte of the packet being compressed, if any */
+static uint8_t *ghc_udp_nhc;
+#endif /* SICSLOWPAN_GHC */
+
 /** pointer to the byte where to write next inline field. */
 static uint8_t *iphc_ptr;
 
@@ -570,12 +864,10 @@ addr_context_lookup_by_number(uint8_t number)
 {
 /* Remove code to avoid warnings and save flash if no context is used */
 #if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
-  int i;
-  for(i = 0; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
-    if((addr_contexts[i].used == 1) &&
-       addr_contexts[i].number == number) {
-      return &addr_contexts[i];
-    }
+  /* sicslowpan_init() gives each context the number of its slot */
+  if(number < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS &&
+     addr_contexts[number].used == 1) {
+    return &addr_contexts[number];
   }
 #endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
   return NULL;
@@ -599,6 +891,307 @@ compress_addr_64(uint8_t bitpos, uip_ipaddr_t *ipaddr,
     return 1 << bitpos; /* 64-bits */
   }
 }
+#if SICSLOWPAN_NBR_STATE
+/*--------------------------------------------------------------------*/
+/** \brief find the compression state of a neighbor, or allocate it */
+static struct sicslowpan_nbr *
+nbr_lookup(const linkaddr_t *lladdr)
+{
+  struct sicslowpan_nbr *nbr = nbr_last;
+  const linkaddr_t *nbr_lladdr;
+
+  if(linkaddr_cmp(lladdr, &linkaddr_null)) {
+    return NULL;
+  }
+  if(nbr != NULL) {
+    nbr_lladdr = nbr_table_get_lladdr(sicslowpan_nbrs, nbr);
+    if(nbr_lladdr != NULL && linkaddr_cmp(nbr_lladdr, lladdr)) {
+      return nbr;
+    }
+  }
+  if(!nbr_table_is_registered(sicslowpan_nbrs)) {
+    return NULL;
+  }
+  nbr = nbr_table_get_from_lladdr(sicslowpan_nbrs, lladdr);
+  if(nbr == NULL) {
+    nbr = nbr_table_add_lladdr(sicslowpan_nbrs, lladdr,
+                               NBR_TABLE_REASON_SICSLOWPAN, NULL);
+    if(nbr == NULL) {
+      return NULL;
+    }
+    memset(nbr, 0, sizeof(struct sicslowpan_nbr));
+  }
+  nbr_last = nbr;
+  return nbr;
+}
+/*--------------------------------------------------------------------*/
+/** \brief forget the last neighbor when its entry is removed */
+static void
+nbr_removed(struct sicslowpan_nbr *nbr)
+{
+  if(nbr == nbr_last) {
+    nbr_last = NULL;
+  }
+}
+#endif /* SICSLOWPAN_NBR_STATE */
+#if SICSLOWPAN_IPHC_CACHE
+/*--------------------------------------------------------------------*/
+/** \brief write the inline fields of an address compressed with the
+ * given SAM/DAM mode (the mode computed by compress_hdr_iphc) */
+static void
+copy_addr_inline(const uip_ipaddr_t *ipaddr, uint8_t mode,
+                 uint8_t context, uint8_t mcast)
+{
+  if(mcast) {
+    switch(mode) {
+    case 3:
+      *iphc_ptr = ipaddr->u8[15];
+      iphc_ptr += 1;
+      break;
+    case 2:
+      *iphc_ptr = ipaddr->u8[1];
+      memcpy(iphc_ptr + 1, &ipaddr->u8[13], 3);
+      iphc_ptr += 4;
+      break;
+    case 1:
+      *iphc_ptr = ipaddr->u8[1];
+      memcpy(iphc_ptr + 1, &ipaddr->u8[11], 5);
+      iphc_ptr += 6;
+      break;
+    default:
+      memcpy(iphc_ptr, &ipaddr->u8[0], 16);
+      iphc_ptr += 16;
+      break;
+    }
+    return;
+  }
+  switch(mode) {
+  case 3:
+    break;
+  case 2:
+    memcpy(iphc_ptr, &ipaddr->u16[7], 2);
+    iphc_ptr += 2;
+    break;
+  case 1:
+    memcpy(iphc_ptr, &ipaddr->u16[4], 8);
+    iphc_ptr += 8;
+    break;
+  default:
+    /* with a context, this is the unspecified address */
+    if(!context) {
+      memcpy(iphc_ptr, &ipaddr->u16[0], 16);
+      iphc_ptr += 16;
+    }
+    break;
+  }
+}
+#endif /* SICSLOWPAN_IPHC_CACHE */
+#if SICSLOWPAN_GHC
+static void send_packet(void);
+/*--------------------------------------------------------------------*/
+void
+sicslowpan_ghc_set_capable(const linkaddr_t *lladdr, int capable)
+{
+  struct sicslowpan_nbr *nbr = nbr_lookup(lladdr);
+  if(nbr != NULL) {
+    nbr->ghc_capable = capable != 0;
+  }
+}
+/*--------------------------------------------------------------------*/
+/** \brief fill the GHC dictionary of a packet */
+static void
+ghc_init_dict(uint8_t *dict, const uip_ipaddr_t *src, const uip_ipaddr_t *dst)
+{
+  memcpy(dict, src, 16);
+  memcpy(dict + 16, dst, 16);
+  memcpy(dict + 32, ghc_static_dict, sizeof(ghc_static_dict));
+}
+/*--------------------------------------------------------------------*/
+/** \brief the byte at a position of the dictionary followed by the data */
+static uint8_t
+ghc_byte(const uint8_t *dict, const uint8_t *data, uint16_t pos)
+{
+  return pos < GHC_DICT_LEN ? dict[pos] : data[pos - GHC_DICT_LEN];
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief compress data with GHC: greedy matching of runs of zeroes and
+ * back-references into the dictionary and the data before
+ * \return the compressed length, or 0 if it exceeds max
+ */
+static int
+ghc_compress(uint8_t *out, int max, const uint8_t *data, int len,
+             const uint8_t *dict)
+{
+  int i = 0;
+  int o = 0;
+  int literal = -1; /* position of the open literal bytecode */
+
+  while(i < len) {
+    uint16_t pos = GHC_DICT_LEN + i;
+    int zeroes = 0;
+    int best_n = 0;
+    int best_s = 0;
+    int best_cost = 0;
+    int max_n = MIN(GHC_BACKREF_MAX, len - i);
+    int s;
+
+    while(zeroes < GHC_ZEROS_MAX && i + zeroes < len && data[i + zeroes] == 0) {
+      zeroes++;
+    }
+
+    /* The longest back-reference that is worth it */
+    for(s = 2; s <= pos && s <= GHC_OFFSET_MAX + max_n; s++) {
+      int limit = MIN(max_n, s);
+      int n = 0;
+      int cost;
+      while(n < limit && ghc_byte(dict, data, pos - s + n) == data[i + n]) {
+        n++;
+      }
+      if(n < 2 || s - n > GHC_OFFSET_MAX) {
+        continue;
+      }
+      cost = (n - 2 < 8 && s - n < 8) ? 1 : 2;
+      if(n - cost > best_n - best_cost) {
+        best_n = n;
+        best_s = s;
+        best_cost = cost;
+      }
+    }
+
+    if(zeroes >= 2 && zeroes - 1 >= best_n - best_cost) {
+      if(o + 1 > max) {
+        return 0;
+      }
+      out[o++] = GHC_ZEROS | (zeroes - 2);
+      i += zeroes;
+      literal = -1;
+    } else if(best_n - best_cost > 0) {
+      int e = best_n - 2;
+      int d = best_s - best_n;
+      if(o + best_cost > max) {
+        return 0;
+      }
+      if(best_cost == 2) {
+        out[o++] = GHC_EXTEND | ((e & 8) << 1) | (d >> 3);
+      }
+      out[o++] = GHC_BACKREF | ((e & 7) << 3) | (d & 7);
+      i += best_n;
+      literal = -1;
+    } else {
+      if(literal < 0 || out[literal] == GHC_LITERAL_MAX) {
+        if(o + 1 > max) {
+          return 0;
+        }
+        literal = o;
+        out[o++] = 0;
+      }
+      if(o + 1 > max) {
+        return 0;
+      }
+      out[o++] = data[i++];
+      out[literal]++;
+    }
+  }
+  return o;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief decompress GHC data
+ * \return the decompressed length, or -1 if the data is invalid or does
+ * not fit max
+ */
+static int
+ghc_decompress(uint8_t *out, int max, const uint8_t *in, int len,
+               const uint8_t *dict)
+{
+  int i = 0;
+  int o = 0;
+  uint16_t sa = 0;
+  uint16_t na = 0;
+
+  while(i < len) {
+    uint8_t b = in[i++];
+    uint16_t n;
+    uint16_t s;
+
+    if((b & 0x80) == 0) {
+      n = b;
+      if(n > GHC_LITERAL_MAX || i + n > len || o + n > max) {
+        return -1;
+      }
+      memcpy(out + o, in + i, n);
+      i += n;
+      o += n;
+    } else if((b & GHC_ZEROS_MASK) == GHC_ZEROS) {
+      n = (b & 0x0f) + 2;
+      if(o + n > max) {
+        return -1;
+      }
+      memset(out + o, 0, n);
+      o += n;
+    } else if(b == GHC_STOP) {
+      break;
+    } else if((b & GHC_ZEROS_MASK) == GHC_STOP) {
+      /* reserved */
+      return -1;
+    } else if((b & GHC_EXTEND_MASK) == GHC_EXTEND) {
+      sa += (b & 0x0f) << 3;
+      na += (b & 0x10) >> 1;
+    } else {
+      n = na + ((b >> 3) & 7) + 2;
+      s = (b & 7) + sa + n;
+      if(s > GHC_DICT_LEN + o || o + n > max) {
+        return -1;
+      }
+      for(; n > 0; n--, o++) {
+        out[o] = ghc_byte(dict, out, GHC_DICT_LEN + o - s);
+      }
+      sa = 0;
+      na = 0;
+    }
+  }
+  return o;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief send the packet with its UDP payload compressed with GHC, if the
+ * receiver supports it and the result is smaller and fits a single frame
+ * \return 1 if the packet was sent, 0 to send it without GHC
+ */
+static int
+ghc_output(void)
+{
+  struct sicslowpan_nbr *nbr;
+  uint8_t dict[GHC_DICT_LEN];
+  int payload_len = uip_len - uncomp_hdr_len;
+  int len;
+
+  if(ghc_udp_nhc == NULL || payload_len <= 0) {
+    return 0;
+  }
+  nbr = nbr_lookup(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  if(nbr == NULL || !nbr->ghc_capable) {
+    return 0;
+  }
+
+  ghc_init_dict(dict, &UIP_IP_BUF->srcipaddr, &UIP_IP_BUF->destipaddr);
+  len = ghc_compress(packetbuf_ptr + packetbuf_hdr_len,
+                     MIN(mac_max_payload - packetbuf_hdr_len, payload_len - 1),
+                     (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, payload_len, dict);
+  if(len == 0) {
+    LOG_DBG("output: GHC payload %d does not fit a single frame\n", payload_len);
+    return 0;
+  }
+  LOG_INFO("output: GHC payload %d -> %d\n", payload_len, len);
+
+  *ghc_udp_nhc = SICSLOWPAN_NHC_UDP_GHC_ID |
+    (*ghc_udp_nhc & ~SICSLOWPAN_NHC_UDP_MASK);
+  packetbuf_set_datalen(packetbuf_hdr_len + len);
+  send_packet();
+  return 1;
+}
+#endif /* SICSLOWPAN_GHC */
 
 /*-------------------------------------------------------------------- */
 /* Uncompress addresses based on a prefix and a postfix with zeroes in
@@ -734,12 +1327,36 @@ compress_hdr_iphc(void)
    */
 
 
+#if SICSLOWPAN_IPHC_CACHE
+  struct sicslowpan_nbr *cache =
+      nbr_lookup(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  uint8_t cache_hit = cache != NULL &&
+      cache->generation == iphc_cache_generation &&
+      uip_ipaddr_cmp(&cache->src, &UIP_IP_BUF->srcipaddr) &&
+      uip_ipaddr_cmp(&cache->dst, &UIP_IP_BUF->destipaddr);
+  struct sicslowpan_addr_context *source_context = NULL;
+  struct sicslowpan_addr_context *destination_context = NULL;
+
+  if(cache_hit) {
+    /* same addresses as the last packet to this neighbor */
+    iphc1 = cache->iphc1;
+    PACKETBUF_IPHC_BUF[2] = cache->cid;
+    if(iphc1 & SICSLOWPAN_IPHC_CID) {
+      iphc_ptr++;
+    }
+  } else {
+    source_context = addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr);
+    destination_context = addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr);
+  }
+  if(!cache_hit && (source_context || destination_context)) {
+#else /* SICSLOWPAN_IPHC_CACHE */
   /* check if dest context exists (for allocating third byte) */
   struct sicslowpan_addr_context *source_context =
       addr_context_lookup_by_prefix(&UIP_IP_BUF->srcipaddr);
   struct sicslowpan_addr_context *destination_context =
       addr_context_lookup_by_prefix(&UIP_IP_BUF->destipaddr);
   if(source_context || destination_context) {
+#endif /* SICSLOWPAN_IPHC_CACHE */
     /* set context flag and increase iphc_ptr */
     LOG_DBG("compression: dest or src ipaddr - setting CID\n");
     iphc1 |= SICSLOWPAN_IPHC_CID;
@@ -826,6 +1443,18 @@ compress_hdr_iphc(void)
       break;
   }
 
+#if SICSLOWPAN_IPHC_CACHE
+  if(cache_hit) {
+    copy_addr_inline(&UIP_IP_BUF->srcipaddr,
+                     (iphc1 >> SICSLOWPAN_IPHC_SAM_BIT) & 3,
+                     iphc1 & SICSLOWPAN_IPHC_SAC, 0);
+    copy_addr_inline(&UIP_IP_BUF->destipaddr,
+                     (iphc1 >> SICSLOWPAN_IPHC_DAM_BIT) & 3,
+                     iphc1 & SICSLOWPAN_IPHC_DAC, iphc1 & SICSLOWPAN_IPHC_M);
+    goto addresses_done;
+  }
+#endif /* SICSLOWPAN_IPHC_CACHE */
+
   /* source address - cannot be multicast */
   if(uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr)) {
     LOG_DBG("compression: addr unspecified - setting SAC\n");
@@ -909,6 +1538,17 @@ compress_hdr_iphc(void)
     }
   }
 
+#if SICSLOWPAN_IPHC_CACHE
+  if(cache != NULL) {
+    uip_ipaddr_copy(&cache->src, &UIP_IP_BUF->srcipaddr);
+    uip_ipaddr_copy(&cache->dst, &UIP_IP_BUF->destipaddr);
+    cache->iphc1 = iphc1;
+    cache->cid = PACKETBUF_IPHC_BUF[2];
+    cache->generation = iphc_cache_generation;
+  }
+addresses_done:
+#endif /* SICSLOWPAN_IPHC_CACHE */
+
   uncomp_hdr_len = UIP_IPH_LEN;
 
   /* Start of ext hdr compression or UDP compression */
@@ -1021,6 +1661,9 @@ compress_hdr_iphc(void)
       memcpy(iphc_ptr, &udp_buf->udpchksum, 2);
       iphc_ptr += 2;
       uncomp_hdr_len += UIP_UDPH_LEN;
+#if SICSLOWPAN_GHC
+      ghc_udp_nhc = next_nhc;
+#endif /* SICSLOWPAN_GHC */
       /* this is the final header. */
       next_hdr = NULL;
       break;
@@ -1339,10 +1982,17 @@ uncompress_hdr_iphc(uint8_t *buf, uint16_t buf_size, uint16_t ip_len)
 
   /* The next header is compressed, NHC is following */
   CHECK_READ_SPACE(1);
-  if(nhc && (*iphc_ptr & SICSLOWPAN_NHC_UDP_MASK) == SICSLOWPAN_NHC_UDP_ID) {
+  if(nhc && ((*iphc_ptr & SICSLOWPAN_NHC_UDP_MASK) == SICSLOWPAN_NHC_UDP_ID
+#if SICSLOWPAN_GHC
+              || (*iphc_ptr & SICSLOWPAN_NHC_UDP_MASK) == SICSLOWPAN_NHC_UDP_GHC_ID
+#endif /* SICSLOWPAN_GHC */
+              )) {
     struct uip_udp_hdr *udp_buf;
     uint16_t udp_len;
     uint8_t checksum_compressed;
+#if SICSLOWPAN_GHC
+    uint8_t ghc = (*iphc_ptr & SICSLOWPAN_NHC_UDP_MASK) == SICSLOWPAN_NHC_UDP_GHC_ID;
+#endif /* SICSLOWPAN_GHC */
 
     /* Check that there is enough room to write the UDP header. */
     if((ip_payload - buf) + UIP_UDPH_LEN > buf_size) {
@@ -1354,7 +2004,8 @@ uncompress_hdr_iphc(uint8_t *buf, uint16_t buf_size, uint16_t ip_len)
     *last_nextheader = UIP_PROTO_UDP;
     checksum_compressed = *iphc_ptr & SICSLOWPAN_NHC_UDP_CHECKSUMC;
     LOG_DBG("uncompression: incoming header value: %i\n", *iphc_ptr);
-    switch(*iphc_ptr & SICSLOWPAN_NHC_UDP_CS_P_11) {
+    /* GHC uses the same port encoding */
+    switch((*iphc_ptr | SICSLOWPAN_NHC_UDP_ID) & SICSLOWPAN_NHC_UDP_CS_P_11) {
     case SICSLOWPAN_NHC_UDP_CS_P_00:
       /* 1 byte for NHC, 4 byte for ports, 2 bytes chksum */
       CHECK_READ_SPACE(5);
@@ -1414,14 +2065,45 @@ uncompress_hdr_iphc(uint8_t *buf, uint16_t buf_size, uint16_t ip_len)
       LOG_DBG("uncompression: checksum *NOT* included\n");
     }
 
-    /* length field in UDP header (8 byte header + payload) */
-    udp_len = 8 + packetbuf_datalen() - (iphc_ptr - packetbuf_ptr);
-    udp_buf->udplen = UIP_HTONS(ip_len == 0 ? udp_len :
-                                ip_len - UIP_IPH_LEN - ext_hdr_len);
-    LOG_DBG("uncompression: UDP length: %u (ext: %u) ip_len: %d udp_len: %d\n",
-           UIP_HTONS(udp_buf->udplen), ext_hdr_len, ip_len, udp_len);
+#if SICSLOWPAN_GHC
+    if(ghc) {
+      uint8_t dict[GHC_DICT_LEN];
+      uint8_t *payload = ip_payload + UIP_UDPH_LEN;
+      int payload_len;
+
+      /* GHC is only sent in unfragmented packets */
+      if(ip_len != 0) {
+        LOG_WARN("uncompression: GHC in a fragment\n");
+        return false;
+      }
+      ghc_init_dict(dict, &SICSLOWPAN_IP_BUF(buf)->srcipaddr,
+                    &SICSLOWPAN_IP_BUF(buf)->destipaddr);
+      payload_len = ghc_decompress(payload, buf_size - (payload - buf),
+                                   iphc_ptr, packetbuf_datalen() - (iphc_ptr - packetbuf_ptr),
+                                   dict);
+      if(payload_len < 0) {
+        LOG_WARN("uncompression: invalid GHC payload\n");
+        return false;
+      }
+      LOG_DBG("uncompression: GHC payload: %d\n", payload_len);
+      /* The whole frame is consumed, the payload is already in place */
+      iphc_ptr = packetbuf_ptr + packetbuf_datalen();
+      udp_buf->udplen = UIP_HTONS(UIP_UDPH_LEN + payload_len);
+      uncomp_hdr_len += UIP_UDPH_LEN + payload_len;
+      /* The sender obviously supports GHC */
+      sicslowpan_ghc_set_capable(packetbuf_addr(PACKETBUF_ADDR_SENDER), 1);
+    } else
+#endif /* SICSLOWPAN_GHC */
+    {
+      /* length field in UDP header (8 byte header + payload) */
+      udp_len = 8 + packetbuf_datalen() - (iphc_ptr - packetbuf_ptr);
+      udp_buf->udplen = UIP_HTONS(ip_len == 0 ? udp_len :
+                                  ip_len - UIP_IPH_LEN - ext_hdr_len);
+      LOG_DBG("uncompression: UDP length: %u (ext: %u) ip_len: %d udp_len: %d\n",
+             UIP_HTONS(udp_buf->udplen), ext_hdr_len, ip_len, udp_len);
 
-    uncomp_hdr_len += UIP_UDPH_LEN;
+      uncomp_hdr_len += UIP_UDPH_LEN;
+    }
   }
 
   packetbuf_hdr_len = iphc_ptr - packetbuf_ptr;
@@ -1582,6 +2264,7 @@ send_packet(void)
 static int
 fragment_copy_payload_and_send(uint16_t uip_offset)
 {
+  struct packetbuf_desc *d;
   struct queuebuf *q;
 
   /* Now copy fragment payload from uip_buf */
@@ -1589,19 +2272,31 @@ fragment_copy_payload_and_send(uint16_t uip_offset)
          (uint8_t *)UIP_IP_BUF + uip_offset, packetbuf_payload_len);
   packetbuf_set_datalen(packetbuf_payload_len + packetbuf_hdr_len);
 
-  /* Backup packetbuf to queuebuf. Enables preserving attributes for all framgnets */
-  q = queuebuf_new_from_packetbuf();
-  if(q == NULL) {
-    LOG_WARN("output: could not allocate queuebuf, dropping fragment\n");
-    return 0;
-  }
+  /* Backup packetbuf to a packet descriptor, which only costs one copy.
+   * Enables preserving attributes for all fragments */
+  d = packetbuf_desc_clone();
+  if(d != NULL) {
+    /* Send fragment */
+    send_packet();
 
-  /* Send fragment */
-  send_packet();
+    /* Restore packetbuf from the descriptor, whose buffer is another one */
+    packetbuf_desc_attach(d);
+    packetbuf_ptr = packetbuf_dataptr();
+  } else {
+    /* Backup packetbuf to queuebuf */
+    q = queuebuf_new_from_packetbuf();
+    if(q == NULL) {
+      LOG_WARN("output: could not allocate queuebuf, dropping fragment\n");
+      return 0;
+    }
+
+    /* Send fragment */
+    send_packet();
 
-  /* Restore packetbuf from queuebuf */
-  queuebuf_to_packetbuf(q);
-  queuebuf_free(q);
+    /* Restore packetbuf from queuebuf */
+    queuebuf_to_packetbuf(q);
+    queuebuf_free(q);
+  }
 
   /* Check tx result. */
   if((last_tx_status == MAC_TX_COLLISION) ||
@@ -1613,21 +2308,649 @@ fragment_copy_payload_and_send(uint16_t uip_offset)
 }
 #endif /* SICSLOWPAN_CONF_FRAG */
 /*--------------------------------------------------------------------*/
-/** \brief Take an IP packet and format it to be sent on an 802.15.4
- *  network using 6lowpan.
- *  \param localdest The MAC address of the destination
- *
- *  The IP packet is initially in uip_buf. Its header is compressed
- *  and if necessary it is fragmented. The resulting
- *  packet/fragments are put in packetbuf and delivered to the 802.15.4
- *  MAC.
- */
-static uint8_t
-output(const linkaddr_t *localdest)
+/** \brief Set the packetbuf attributes of an outgoing packet from the
+ *  uipbuf attributes */
+static void
+set_link_attrs(void)
 {
-  int frag_needed;
+  /* copy over the retransmission count from uipbuf attributes */
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     uipbuf_get_attr(UIPBUF_ATTR_MAX_MAC_TRANSMISSIONS));
+  /* and the traffic class */
+  packetbuf_set_attr(PACKETBUF_ATTR_TRAFFIC_CLASS,
+                     uipbuf_get_attr(UIPBUF_ATTR_TRAFFIC_CLASS));
 
-  /* init */
+#if LLSEC802154_USES_AUX_HEADER
+  /* copy LLSEC level */
+  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL,
+    uipbuf_get_attr(UIPBUF_ATTR_LLSEC_LEVEL));
+#if LLSEC802154_USES_EXPLICIT_KEYS
+  packetbuf_set_attr(PACKETBUF_ATTR_KEY_INDEX,
+    uipbuf_get_attr(UIPBUF_ATTR_LLSEC_KEY_ID));
+#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
+#endif /*  LLSEC802154_USES_AUX_HEADER */
+}
+/*--------------------------------------------------------------------*/
+/** \brief Compress the headers of the IP packet in uip_buf to packetbuf
+ *  \return 1 if success, 0 otherwise
+ */
+static int
+compress_hdr(void)
+{
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6
+  compress_hdr_ipv6();
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6 */
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_6LORH
+  /* Add 6LoRH headers before IPHC. Only needed on routed traffic
+  (non link-local). */
+  if(!uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr)) {
+    add_paging_dispatch(1);
+    add_6lorh_hdr();
+  }
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_6LORH */
+#if SICSLOWPAN_COMPRESSION >= SICSLOWPAN_COMPRESSION_IPHC
+  if(compress_hdr_iphc() == 0) {
+    /* Warning should already be issued by function above */
+    return 0;
+  }
+#endif /* SICSLOWPAN_COMPRESSION >= SICSLOWPAN_COMPRESSION_IPHC */
+  return 1;
+}
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING
+/*--------------------------------------------------------------------*/
+/** \brief Get the link-layer next hop of the IP packet in uip_buf, without
+ *  any side effect: when in doubt, the datagram is reassembled and handed
+ *  over to the IP layer instead.
+ *  \return the link-layer address of the next hop, NULL if not found
+ */
+static const linkaddr_t *
+get_nexthop_lladdr(void)
+{
+  uip_ipaddr_t ipaddr;
+  const uip_ipaddr_t *nexthop;
+  uip_ds6_route_t *route;
+  uip_ds6_nbr_t *nbr;
+
+  if(NETSTACK_ROUTING.ext_header_srh_get_next_hop(&ipaddr)) {
+    nexthop = &ipaddr;
+  } else if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)) {
+    nexthop = &UIP_IP_BUF->destipaddr;
+  } else if((route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr)) != NULL) {
+    nexthop = uip_ds6_route_nexthop(route);
+  } else {
+    nexthop = uip_ds6_defrt_choose();
+  }
+  if(nexthop == NULL) {
+    return NULL;
+  }
+
+  nbr = uip_ds6_nbr_lookup(nexthop);
+#if UIP_ND6_SEND_NS
+  if(nbr != NULL && nbr->state == NBR_INCOMPLETE) {
+    return NULL;
+  }
+#endif /* UIP_ND6_SEND_NS */
+  return nbr != NULL ? (const linkaddr_t *)uip_ds6_nbr_get_ll(nbr) : NULL;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Forward the first fragment of a datagram that is not for us,
+ *  and set up a VRB entry to forward the next fragments as they arrive.
+ *  \param context the reassembly context holding the uncompressed
+ *  first fragment
+ *  \return 1 if the fragment was forwarded, 0 if the datagram must be
+ *  reassembled
+ */
+static int
+forward_first_fragment(int context)
+{
+  struct sicslowpan_frag_info *info = &frag_info[context];
+  struct uip_ip_hdr *hdr = (struct uip_ip_hdr *)info->first_frag;
+  struct sicslowpan_vrb *vrb;
+  const linkaddr_t *next_hop;
+  int payload_len;
+  uint16_t frag_tag;
+  int i;
+
+#if SICSLOWPAN_FRAG_RECOVERY
+  /* RFRAG fragments are acknowledged hop by hop, hence reassembled */
+  if(info->is_rfrag) {
+    return 0;
+  }
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+
+  /* Let the IP layer handle datagrams for us, multicast datagrams,
+   * and datagrams with an expiring hop limit */
+  if(uip_is_addr_mcast(&hdr->destipaddr)
+     || uip_ds6_is_my_addr(&hdr->destipaddr)
+     || uip_ds6_is_my_aaddr(&hdr->destipaddr)
+     || hdr->ttl <= 1
+     || info->first_frag_len < UIP_IPH_LEN
+     || info->len > sizeof(uip_buf)
+     || (vrb = vrb_alloc()) == NULL) {
+    return 0;
+  }
+
+  /* Process the headers as the IP layer does when forwarding. The
+   * datagram must keep its size for the offsets of its next fragments
+   * to remain valid. */
+  memcpy(UIP_IP_BUF, info->first_frag, info->first_frag_len);
+  memset((uint8_t *)UIP_IP_BUF + info->first_frag_len, 0,
+         info->len - info->first_frag_len);
+  uip_len = info->len;
+  UIP_IP_BUF->ttl--;
+  if(!NETSTACK_ROUTING.ext_header_update() || uip_len != info->len
+     || (next_hop = get_nexthop_lladdr()) == NULL) {
+    uipbuf_clear();
+    return 0;
+  }
+
+  /* Compress the headers for the next hop */
+  uncomp_hdr_len = 0;
+  packetbuf_hdr_len = 0;
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  set_link_attrs();
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, next_hop);
+  mac_max_payload = NETSTACK_MAC.max_payload();
+  if(mac_max_payload <= 0 || compress_hdr() == 0) {
+    uipbuf_clear();
+    return 0;
+  }
+  payload_len = info->first_frag_len - uncomp_hdr_len;
+  if(payload_len < 0
+     || packetbuf_hdr_len + SICSLOWPAN_FRAG1_HDR_LEN + payload_len > mac_max_payload) {
+    LOG_WARN("forward: first fragment does not fit the next hop\n");
+    uipbuf_clear();
+    return 0;
+  }
+
+  frag_tag = my_tag++;
+  memmove(packetbuf_ptr + SICSLOWPAN_FRAG1_HDR_LEN, packetbuf_ptr, packetbuf_hdr_len);
+  packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | uip_len));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, frag_tag);
+  memcpy(packetbuf_ptr + packetbuf_hdr_len,
+         (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, payload_len);
+  packetbuf_set_datalen(packetbuf_hdr_len + payload_len);
+
+  linkaddr_copy(&vrb->sender, &info->sender);
+  vrb->tag = info->tag;
+  linkaddr_copy(&vrb->next_hop, next_hop);
+  vrb->next_tag = frag_tag;
+  vrb->len = info->len;
+  vrb->forwarded = 0;
+  memset(vrb->forwarded_units, 0, sizeof(vrb->forwarded_units));
+  vrb_forwarded(vrb, 0, info->first_frag_len);
+  timer_set(&vrb->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+
+  LOG_INFO("forward: first fragment (tag %u -> %u, len %u) to ",
+           vrb->tag, vrb->next_tag, vrb->len);
+  LOG_INFO_LLADDR(next_hop);
+  LOG_INFO_("\n");
+
+  uipbuf_clear();
+  send_packet();
+
+  /* Forward the next fragments that arrived before this one */
+  for(i = 0; i < SICSLOWPAN_FRAGMENT_BUFFERS; i++) {
+    if(frag_buf[i].len > 0 && frag_buf[i].index == context) {
+      packetbuf_clear();
+      packetbuf_ptr = packetbuf_dataptr();
+      SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+            ((SICSLOWPAN_DISPATCH_FRAGN << 8) | info->len));
+      SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, frag_tag);
+      PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] = frag_buf[i].offset >> 3;
+      memcpy(packetbuf_ptr + SICSLOWPAN_FRAGN_HDR_LEN, frag_buf[i].data, frag_buf[i].len);
+      packetbuf_set_datalen(SICSLOWPAN_FRAGN_HDR_LEN + frag_buf[i].len);
+      set_link_attrs();
+      packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, next_hop);
+
+      LOG_INFO("forward: buffered fragment (tag %u -> %u, offset %u)\n",
+               info->tag, frag_tag, frag_buf[i].offset);
+      vrb_forwarded(vrb, frag_buf[i].offset, frag_buf[i].len);
+      send_packet();
+    }
+  }
+
+  clear_fragments(context);
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Forward a subsequent fragment, if its datagram has a VRB entry
+ *  \param tag the tag of the fragment
+ *  \param offset the offset of the fragment, in units of 8 bytes
+ *  \return 1 if the fragment was forwarded, 0 otherwise
+ */
+static int
+forward_fragment(uint16_t tag, uint8_t offset)
+{
+  struct sicslowpan_vrb *vrb;
+  uint8_t *data;
+  uint16_t len;
+
+  vrb = vrb_lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER), tag);
+  if(vrb == NULL) {
+    return 0;
+  }
+
+  /* The fragment is sent as is, but with the tag of the next hop */
+  data = packetbuf_dataptr();
+  len = packetbuf_datalen();
+  packetbuf_clear();
+  memmove(packetbuf_dataptr(), data, len);
+  packetbuf_set_datalen(len);
+  packetbuf_ptr = packetbuf_dataptr();
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, vrb->next_tag);
+  set_link_attrs();
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &vrb->next_hop);
+
+  LOG_INFO("forward: fragment (tag %u -> %u, offset %u)\n",
+           tag, vrb->next_tag, offset << 3);
+
+  vrb_forwarded(vrb, offset << 3, len - SICSLOWPAN_FRAGN_HDR_LEN);
+  send_packet();
+  return 1;
+}
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARDING */
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY
+static void rfrag_send_fragment(struct sicslowpan_rfrag_tx *tx, uint8_t seq,
+                                int ack_req);
+/*--------------------------------------------------------------------*/
+static void
+rfrag_free(struct sicslowpan_rfrag_tx *tx)
+{
+  ctimer_stop(&tx->timer);
+  tx->len = 0;
+}
+/*--------------------------------------------------------------------*/
+/* The sequence number of the last fragment not acknowledged yet */
+static int
+rfrag_last_missing(const struct sicslowpan_rfrag_tx *tx)
+{
+  int seq;
+  for(seq = tx->count - 1; seq >= 0; seq--) {
+    if(!(tx->acked & SICSLOWPAN_RFRAG_BIT(seq))) {
+      return seq;
+    }
+  }
+  return -1;
+}
+/*--------------------------------------------------------------------*/
+static void
+rfrag_timeout(void *ptr)
+{
+  struct sicslowpan_rfrag_tx *tx = ptr;
+  int seq = rfrag_last_missing(tx);
+
+  if(seq < 0 || tx->retries++ >= SICSLOWPAN_SFR_MAX_RETRIES) {
+    LOG_WARN("rfrag: no RFRAG-ACK for tag %u, dropping datagram\n", tx->tag);
+    rfrag_free(tx);
+    return;
+  }
+  /* Request the RFRAG-ACK again, with the last fragment */
+  rfrag_send_fragment(tx, seq, 1);
+}
+/*--------------------------------------------------------------------*/
+/* MAC callback of a fragment that requests an RFRAG-ACK */
+static void
+rfrag_sent(void *ptr, int status, int transmissions)
+{
+  struct sicslowpan_rfrag_tx *tx = ptr;
+
+  packet_sent(NULL, status, transmissions);
+  /* Wait for the RFRAG-ACK from the moment the fragment actually left,
+   * not from when it was queued */
+  if(tx->len > 0) {
+    ctimer_set(&tx->timer, SICSLOWPAN_SFR_ACK_TIMEOUT, rfrag_timeout, tx);
+  }
+}
+/*--------------------------------------------------------------------*/
+/** \brief Send a fragment of a datagram from the fragment cache
+ *  \param tx the datagram
+ *  \param seq the sequence number of the fragment
+ *  \param ack_req whether the fragment requests an RFRAG-ACK
+ */
+static void
+rfrag_send_fragment(struct sicslowpan_rfrag_tx *tx, uint8_t seq, int ack_req)
+{
+  uint16_t offset = seq * tx->frag_size;
+  uint16_t size = MIN(tx->frag_size, tx->len - offset);
+
+  packetbuf_clear();
+  packetbuf_attr_copyfrom(tx->attrs, tx->addrs);
+  packetbuf_ptr = packetbuf_dataptr();
+  PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_DISPATCH_SIZE] = SICSLOWPAN_DISPATCH_RFRAG;
+  PACKETBUF_FRAG_PTR[PACKETBUF_RFRAG_TAG] = tx->tag;
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_RFRAG_SEQ_SIZE,
+        (ack_req ? SICSLOWPAN_RFRAG_ACK_REQ : 0) | ((uint16_t)seq << 10) | size);
+  /* The first fragment carries the size of the compressed datagram instead
+   * of its offset */
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_RFRAG_OFFSET, seq == 0 ? tx->len : offset);
+  memcpy(packetbuf_ptr + SICSLOWPAN_RFRAG_HDR_LEN, tx->data + offset, size);
+  packetbuf_set_datalen(SICSLOWPAN_RFRAG_HDR_LEN + size);
+
+  LOG_INFO("rfrag: fragment %u/%u (tag %u, size %u, offset %u%s)\n",
+           seq + 1, tx->count, tx->tag, size, offset, ack_req ? ", ack req" : "");
+
+  if(ack_req) {
+    NETSTACK_MAC.send(&rfrag_sent, tx);
+    watchdog_periodic();
+  } else {
+    send_packet();
+  }
+}
+/*--------------------------------------------------------------------*/
+/* Send the fragments not acknowledged yet, the last one requesting an
+ * RFRAG-ACK */
+static void
+rfrag_send_missing(struct sicslowpan_rfrag_tx *tx)
+{
+  int last = rfrag_last_missing(tx);
+  int seq;
+
+  for(seq = 0; seq <= last; seq++) {
+    if(!(tx->acked & SICSLOWPAN_RFRAG_BIT(seq))) {
+      rfrag_send_fragment(tx, seq, seq == last);
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+/** \brief Send the compressed datagram in packetbuf and uip_buf in RFRAG
+ *  fragments, and keep it until they are all acknowledged
+ *  \return 1 if the datagram was sent, 0 if it must be sent in RFC 4944
+ *  fragments instead
+ */
+static int
+rfrag_output(void)
+{
+  struct sicslowpan_rfrag_tx *tx = NULL;
+  int frag_size = MIN(mac_max_payload - SICSLOWPAN_RFRAG_HDR_LEN, 0x3ff);
+  int comp_len = packetbuf_hdr_len + uip_len - uncomp_hdr_len;
+  int count;
+  int i;
+
+  /* Broadcast fragments are not acknowledged */
+  if(linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &linkaddr_null)) {
+    return 0;
+  }
+  for(i = 0; i < SICSLOWPAN_SFR_ENTRIES; i++) {
+    if(rfrag_tx[i].len == 0) {
+      tx = &rfrag_tx[i];
+      break;
+    }
+  }
+  if(tx == NULL || frag_size < packetbuf_hdr_len || uip_len < uncomp_hdr_len
+     || comp_len > sizeof(tx->data)) {
+    return 0;
+  }
+  count = (comp_len + frag_size - 1) / frag_size;
+  /* Keep one queuebuf in reserve, as for RFC 4944 fragments */
+  if(count > SICSLOWPAN_RFRAG_MAX_FRAGMENTS || queuebuf_numfree() < count + 1) {
+    return 0;
+  }
+
+  memcpy(tx->data, packetbuf_ptr, packetbuf_hdr_len);
+  memcpy(tx->data + packetbuf_hdr_len, (uint8_t *)UIP_IP_BUF + uncomp_hdr_len,
+         uip_len - uncomp_hdr_len);
+  tx->len = comp_len;
+  tx->frag_size = frag_size;
+  tx->count = count;
+  tx->tag = my_tag++;
+  tx->acked = 0;
+  tx->retries = 0;
+  linkaddr_copy(&tx->receiver, packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  packetbuf_attr_copyto(tx->attrs, tx->addrs);
+
+  LOG_INFO("output: %u RFRAG fragments (tag %u, compressed len %u)\n",
+           tx->count, tx->tag, tx->len);
+  rfrag_send_missing(tx);
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/** \brief Process a received RFRAG-ACK: send the missing fragments again,
+ *  or release the datagram once it is acknowledged or aborted
+ */
+static void
+rfrag_ack_input(void)
+{
+  struct sicslowpan_rfrag_tx *tx = NULL;
+  uint32_t bitmap;
+  uint32_t all;
+  uint8_t tag;
+  int i;
+
+  if(packetbuf_datalen() < SICSLOWPAN_RFRAG_ACK_HDR_LEN) {
+    return;
+  }
+  tag = PACKETBUF_FRAG_PTR[PACKETBUF_RFRAG_TAG];
+  bitmap = ((uint32_t)GET16(PACKETBUF_FRAG_PTR, PACKETBUF_RFRAG_ACK_BITMAP) << 16)
+    | GET16(PACKETBUF_FRAG_PTR, PACKETBUF_RFRAG_ACK_BITMAP + 2);
+
+  for(i = 0; i < SICSLOWPAN_SFR_ENTRIES; i++) {
+    if(rfrag_tx[i].len > 0 && rfrag_tx[i].tag == tag
+       && linkaddr_cmp(&rfrag_tx[i].receiver, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
+      tx = &rfrag_tx[i];
+      break;
+    }
+  }
+  if(tx == NULL) {
+    return;
+  }
+
+  LOG_INFO("input: RFRAG-ACK (tag %u, bitmap %08lx)\n", tag, (unsigned long)bitmap);
+
+  if(bitmap == 0) {
+    /* The receiver aborted the reassembly */
+    LOG_WARN("input: RFRAG-ACK aborts tag %u\n", tag);
+    rfrag_free(tx);
+    return;
+  }
+
+  tx->acked |= bitmap;
+  all = tx->count == SICSLOWPAN_RFRAG_MAX_FRAGMENTS ?
+    0xffffffffUL : ~(0xffffffffUL >> tx->count);
+  if((tx->acked & all) == all) {
+    rfrag_free(tx);
+    return;
+  }
+
+  ctimer_stop(&tx->timer);
+  if(tx->retries++ >= SICSLOWPAN_SFR_MAX_RETRIES) {
+    LOG_WARN("rfrag: too many retries for tag %u, dropping datagram\n", tag);
+    rfrag_free(tx);
+    return;
+  }
+  rfrag_send_missing(tx);
+}
+/*--------------------------------------------------------------------*/
+/* Prepare an RFRAG-ACK to the sender of the fragment in packetbuf */
+static void
+rfrag_ack_prepare(uint8_t tag, uint32_t bitmap)
+{
+  linkaddr_copy(&rfrag_ack.dest, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  rfrag_ack.tag = tag;
+  rfrag_ack.bitmap = bitmap;
+#if LLSEC802154_USES_AUX_HEADER
+  rfrag_ack.security_level = packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL);
+  rfrag_ack.key_index = packetbuf_attr(PACKETBUF_ATTR_KEY_INDEX);
+#endif /* LLSEC802154_USES_AUX_HEADER */
+  rfrag_ack.pending = 1;
+}
+/*--------------------------------------------------------------------*/
+static void
+rfrag_ack_send(void)
+{
+  if(!rfrag_ack.pending) {
+    return;
+  }
+  rfrag_ack.pending = 0;
+
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_DISPATCH_SIZE] = SICSLOWPAN_DISPATCH_RFRAG_ACK;
+  PACKETBUF_FRAG_PTR[PACKETBUF_RFRAG_TAG] = rfrag_ack.tag;
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_RFRAG_ACK_BITMAP, rfrag_ack.bitmap >> 16);
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_RFRAG_ACK_BITMAP + 2, rfrag_ack.bitmap & 0xffff);
+  packetbuf_set_datalen(SICSLOWPAN_RFRAG_ACK_HDR_LEN);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &rfrag_ack.dest);
+#if LLSEC802154_USES_AUX_HEADER
+  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL, rfrag_ack.security_level);
+  packetbuf_set_attr(PACKETBUF_ATTR_KEY_INDEX, rfrag_ack.key_index);
+#endif /* LLSEC802154_USES_AUX_HEADER */
+
+  LOG_INFO("output: RFRAG-ACK (tag %u, bitmap %08lx)\n",
+           rfrag_ack.tag, (unsigned long)rfrag_ack.bitmap);
+  send_packet();
+}
+/*--------------------------------------------------------------------*/
+/** \brief Add a received RFRAG fragment to its reassembly context, which
+ *  the first fragment to arrive allocates, whatever its sequence number
+ *  \param tag the tag of the fragment
+ *  \param seq_size the sequence and size field of the fragment
+ *  \param offset the offset field of the fragment
+ *  \param complete set if the datagram is complete with this fragment
+ *  \return the index of the reassembly context, or -1 if the fragment
+ *  was dropped or already received
+ *
+ *  Non-first fragments are stored, and the first one is uncompressed in
+ *  the context by input(). An RFRAG-ACK is prepared if the fragment
+ *  requests one or completes the datagram.
+ */
+static int8_t
+rfrag_add_fragment(uint8_t tag, uint16_t seq_size, uint16_t offset,
+                   uint8_t *complete)
+{
+  const linkaddr_t *sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  uint8_t seq = SICSLOWPAN_RFRAG_SEQ(seq_size);
+  int len = packetbuf_datalen() - packetbuf_hdr_len;
+  struct sicslowpan_frag_info *info;
+  int8_t found = -1;
+  int i;
+
+  *complete = 0;
+
+  if(rfrag_done.tag == tag && linkaddr_cmp(&rfrag_done.sender, sender)
+     && !timer_expired(&rfrag_done.timer)) {
+    /* The datagram is already reassembled: the RFRAG-ACK was lost */
+    if(seq_size & SICSLOWPAN_RFRAG_ACK_REQ) {
+      rfrag_ack_prepare(tag, rfrag_done.bitmap);
+      rfrag_ack_send();
+    }
+    return -1;
+  }
+
+  for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+    if(frag_info[i].len > 0 && frag_info[i].is_rfrag && frag_info[i].tag == tag
+       && linkaddr_cmp(&frag_info[i].sender, sender)) {
+      found = i;
+      break;
+    }
+  }
+
+  if(found < 0) {
+    for(i = 0; i < SICSLOWPAN_REASS_CONTEXTS; i++) {
+      if(frag_info[i].len > 0 && timer_expired(&frag_info[i].reass_timer)) {
+        clear_fragments(i);
+      }
+      if(found < 0 && frag_info[i].len == 0) {
+        found = i;
+      }
+    }
+    if(found < 0) {
+      LOG_WARN("reassembly: failed to store new RFRAG session - tag: %d\n", tag);
+      return -1;
+    }
+    info = &frag_info[found];
+    /* The size of the IP packet is known once the first fragment is
+     * uncompressed; until then, len only marks the context as used */
+    info->len = UIP_BUFSIZE;
+    info->tag = tag;
+    linkaddr_copy(&info->sender, sender);
+    timer_set(&info->reass_timer, SICSLOWPAN_SFR_REASS_TIMEOUT);
+    info->is_rfrag = 1;
+    info->rfrag_bitmap = 0;
+    info->comp_len = 0;
+    info->comp_received = 0;
+    info->reassembled_len = 0;
+    info->first_frag_len = 0;
+  }
+  info = &frag_info[found];
+
+  if(info->rfrag_bitmap & SICSLOWPAN_RFRAG_BIT(seq)) {
+    /* Already received: the RFRAG-ACK was lost */
+    if(seq_size & SICSLOWPAN_RFRAG_ACK_REQ) {
+      rfrag_ack_prepare(tag, info->rfrag_bitmap);
+      rfrag_ack_send();
+    }
+    return -1;
+  }
+
+  if(seq == 0) {
+    if(offset < len) {
+      LOG_WARN("reassembly: invalid RFRAG datagram size %u\n", offset);
+      return -1;
+    }
+    info->comp_len = offset;
+  } else {
+    int stored = store_fragment(found, offset);
+    if(stored < 0 && timeout_fragments(found) > 0) {
+      stored = store_fragment(found, offset);
+    }
+    if(stored < 0) {
+      LOG_WARN("reassembly: failed to store RFRAG fragment - tag: %d seq: %d\n",
+               tag, seq);
+      return -1;
+    }
+  }
+
+  /* Keep the context as long as the sender may recover missing fragments */
+  timer_set(&info->reass_timer, SICSLOWPAN_SFR_REASS_TIMEOUT);
+  info->rfrag_bitmap |= SICSLOWPAN_RFRAG_BIT(seq);
+  info->comp_received += len;
+  /* The first fragment counts once it is uncompressed */
+  if(info->comp_len > 0 && info->comp_received >= info->comp_len
+     && (seq == 0 || info->first_frag_len > 0)) {
+    *complete = 1;
+    linkaddr_copy(&rfrag_done.sender, sender);
+    rfrag_done.tag = tag;
+    rfrag_done.bitmap = info->rfrag_bitmap;
+    timer_set(&rfrag_done.timer, SICSLOWPAN_SFR_REASS_TIMEOUT);
+  }
+  if(*complete || (seq_size & SICSLOWPAN_RFRAG_ACK_REQ)) {
+    rfrag_ack_prepare(tag, info->rfrag_bitmap);
+  }
+  return found;
+}
+/*--------------------------------------------------------------------*/
+/* The size of the IP packet whose first RFRAG fragment is uncompressed:
+ * the size of the compressed datagram, with the uncompressed headers */
+static uint16_t
+rfrag_datagram_size(int context)
+{
+  int comp_hdr_len = packetbuf_hdr_len - SICSLOWPAN_RFRAG_HDR_LEN;
+  if(frag_info[context].comp_len < comp_hdr_len) {
+    return 0;
+  }
+  return frag_info[context].comp_len - comp_hdr_len + uncomp_hdr_len;
+}
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY */
+/*--------------------------------------------------------------------*/
+/** \brief Take an IP packet and format it to be sent on an 802.15.4
+ *  network using 6lowpan.
+ *  \param localdest The MAC address of the destination
+ *
+ *  The IP packet is initially in uip_buf. Its header is compressed
+ *  and if necessary it is fragmented. The resulting
+ *  packet/fragments are put in packetbuf and delivered to the 802.15.4
+ *  MAC.
+ */
+static uint8_t
+output(const linkaddr_t *localdest)
+{
+  int frag_needed;
+
+  /* init */
   uncomp_hdr_len = 0;
   packetbuf_hdr_len = 0;
 
@@ -1643,24 +2966,12 @@ output(const linkaddr_t *localdest)
 
   LOG_INFO("output: sending IPv6 packet with len %d\n", uip_len);
 
-  /* copy over the retransmission count from uipbuf attributes */
-  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
-                     uipbuf_get_attr(UIPBUF_ATTR_MAX_MAC_TRANSMISSIONS));
+  set_link_attrs();
 
   /* Copy destination address to packetbuf */
   packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER,
       localdest ? localdest : &linkaddr_null);
 
-#if LLSEC802154_USES_AUX_HEADER
-  /* copy LLSEC level */
-  packetbuf_set_attr(PACKETBUF_ATTR_SECURITY_LEVEL,
-    uipbuf_get_attr(UIPBUF_ATTR_LLSEC_LEVEL));
-#if LLSEC802154_USES_EXPLICIT_KEYS
-  packetbuf_set_attr(PACKETBUF_ATTR_KEY_INDEX,
-    uipbuf_get_attr(UIPBUF_ATTR_LLSEC_KEY_ID));
-#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
-#endif /*  LLSEC802154_USES_AUX_HEADER */
-
   /* Calculate NETSTACK_FRAMER's header length, that will be added in the NETSTACK_MAC */
   mac_max_payload = NETSTACK_MAC.max_payload();
 
@@ -1670,24 +2981,20 @@ output(const linkaddr_t *localdest)
     return 0;
   }
 
+#if SICSLOWPAN_GHC
+  ghc_udp_nhc = NULL;
+#endif /* SICSLOWPAN_GHC */
+
   /* Try to compress the headers */
-#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6
-  compress_hdr_ipv6();
-#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6 */
-#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_6LORH
-  /* Add 6LoRH headers before IPHC. Only needed on routed traffic
-  (non link-local). */
-  if(!uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr)) {
-    add_paging_dispatch(1);
-    add_6lorh_hdr();
-  }
-#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_6LORH */
-#if SICSLOWPAN_COMPRESSION >= SICSLOWPAN_COMPRESSION_IPHC
-  if(compress_hdr_iphc() == 0) {
-    /* Warning should already be issued by function above */
+  if(compress_hdr() == 0) {
     return 0;
   }
-#endif /* SICSLOWPAN_COMPRESSION >= SICSLOWPAN_COMPRESSION_IPHC */
+
+#if SICSLOWPAN_GHC
+  if(ghc_output()) {
+    return 1;
+  }
+#endif /* SICSLOWPAN_GHC */
 
   /* Use the mac_max_payload to understand what is the max payload in a MAC
    * packet. We calculate it here only to make a better decision of whether
@@ -1730,6 +3037,12 @@ output(const linkaddr_t *localdest)
       fragment_count += 1 + (middle_fragn_total_payload - 1) / fragn_max_payload;
     }
 
+#if SICSLOWPAN_FRAG_RECOVERY
+    if(rfrag_output()) {
+      return 1;
+    }
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
+
     size_t free_bufs = queuebuf_numfree();
     LOG_INFO("output: fragmentation needed. fragments: %u, free queuebufs: %zu\n",
       fragment_count, free_bufs);
@@ -1866,6 +3179,10 @@ input(void)
   /* tag of the fragment */
   uint16_t frag_tag = 0;
   uint8_t first_fragment = 0, last_fragment = 0;
+#if SICSLOWPAN_FRAG_RECOVERY
+  uint8_t is_rfrag = 0;
+  uint16_t seq_size;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
   /* Update link statistics */
@@ -1874,6 +3191,9 @@ input(void)
   /* init */
   uncomp_hdr_len = 0;
   packetbuf_hdr_len = 0;
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY
+  rfrag_ack.pending = 0;
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY */
 
   /* The MAC puts the 15.4 payload inside the packetbuf data buffer */
   packetbuf_ptr = packetbuf_dataptr();
@@ -1914,6 +3234,14 @@ input(void)
       LOG_INFO("input: received first element of a fragmented packet (tag %d, len %d)\n",
              frag_tag, frag_size);
 
+#if SICSLOWPAN_FRAG_FORWARDING
+      /* A duplicate of a first fragment already forwarded */
+      if(vrb_lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER), frag_tag) != NULL) {
+        LOG_WARN("input: duplicate first fragment (tag %d), dropped\n", frag_tag);
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
       /* Add the fragment to the fragmentation context */
       frag_context = add_fragment(frag_tag, frag_size, frag_offset);
 
@@ -1935,6 +3263,12 @@ input(void)
       frag_size = GET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE) & 0x07ff;
       packetbuf_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
 
+#if SICSLOWPAN_FRAG_FORWARDING
+      if(forward_fragment(frag_tag, frag_offset)) {
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+
       /* Add the fragment to the fragmentation context (this will also
          copy the payload) */
       frag_context = add_fragment(frag_tag, frag_size, frag_offset);
@@ -1948,11 +3282,51 @@ input(void)
          we should not store more */
       buffer = NULL;
 
-      if(frag_info[frag_context].reassembled_len >= frag_size) {
+      /* The datagram is complete once its first fragment is received too */
+      if(frag_info[frag_context].first_frag_len > 0
+         && frag_info[frag_context].reassembled_len >= frag_size) {
         last_fragment = 1;
       }
       is_fragment = 1;
       break;
+#if SICSLOWPAN_FRAG_RECOVERY
+    case SICSLOWPAN_DISPATCH_RFRAG:
+      if((PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_DISPATCH_SIZE] & SICSLOWPAN_DISPATCH_RFRAG_MASK)
+         == SICSLOWPAN_DISPATCH_RFRAG_ACK) {
+        rfrag_ack_input();
+        return;
+      }
+      if(packetbuf_datalen() < SICSLOWPAN_RFRAG_HDR_LEN) {
+        LOG_WARN("input: truncated RFRAG fragment\n");
+        return;
+      }
+      frag_tag = PACKETBUF_FRAG_PTR[PACKETBUF_RFRAG_TAG];
+      seq_size = GET16(PACKETBUF_FRAG_PTR, PACKETBUF_RFRAG_SEQ_SIZE);
+      packetbuf_hdr_len += SICSLOWPAN_RFRAG_HDR_LEN;
+
+      LOG_INFO("input: received RFRAG fragment (tag %d, seq %d)\n",
+               frag_tag, SICSLOWPAN_RFRAG_SEQ(seq_size));
+
+      frag_context = rfrag_add_fragment(frag_tag, seq_size,
+                                        GET16(PACKETBUF_FRAG_PTR, PACKETBUF_RFRAG_OFFSET),
+                                        &last_fragment);
+      if(frag_context == -1) {
+        return;
+      }
+      is_fragment = 1;
+      is_rfrag = 1;
+      if(SICSLOWPAN_RFRAG_SEQ(seq_size) == 0) {
+        /* The size of the IP packet is set once the headers are uncompressed */
+        first_fragment = 1;
+        buffer = frag_info[frag_context].first_frag;
+        buffer_size = SICSLOWPAN_FIRST_FRAGMENT_SIZE;
+      } else {
+        /* rfrag_add_fragment stored the fragment already */
+        buffer = NULL;
+        frag_size = last_fragment ? frag_info[frag_context].len : 0;
+      }
+      break;
+#endif /* SICSLOWPAN_FRAG_RECOVERY */
     default:
       break;
   }
@@ -1978,10 +3352,28 @@ input(void)
   if(SICSLOWPAN_COMPRESSION > SICSLOWPAN_COMPRESSION_IPV6 &&
      (PACKETBUF_6LO_PTR[PACKETBUF_6LO_DISPATCH] & SICSLOWPAN_DISPATCH_IPHC_MASK) == SICSLOWPAN_DISPATCH_IPHC) {
     LOG_DBG("uncompression: IPHC dispatch\n");
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY
+    uint8_t hdr_len = packetbuf_hdr_len;
+    uint8_t prev_uncomp_hdr_len = uncomp_hdr_len;
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY */
     if(uncompress_hdr_iphc(buffer, buffer_size, frag_size) == false) {
       LOG_ERR("input: failed to decompress IPHC packet\n");
       return;
     }
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY
+    if(is_rfrag) {
+      /* The IP and UDP length fields derive from the size of the IP
+       * packet, which RFRAG only gives compressed: uncompress again now
+       * that the size of the compressed headers is known */
+      frag_size = rfrag_datagram_size(frag_context);
+      packetbuf_hdr_len = hdr_len;
+      uncomp_hdr_len = prev_uncomp_hdr_len;
+      if(frag_size == 0 || uncompress_hdr_iphc(buffer, buffer_size, frag_size) == false) {
+        LOG_ERR("input: failed to decompress IPHC packet\n");
+        return;
+      }
+    }
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY */
   } else if(PACKETBUF_6LO_PTR[PACKETBUF_6LO_DISPATCH] == SICSLOWPAN_DISPATCH_IPV6) {
     LOG_DBG("uncompression: IPV6 dispatch\n");
     packetbuf_hdr_len += SICSLOWPAN_IPV6_HDR_LEN;
@@ -1998,6 +3390,19 @@ input(void)
     return;
   }
 
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY
+  if(is_rfrag) {
+    frag_size = rfrag_datagram_size(frag_context);
+    if(frag_size == 0) {
+      LOG_ERR("input: invalid RFRAG datagram size\n");
+      return;
+    }
+    frag_info[frag_context].len = frag_size;
+    frag_info[frag_context].offset_delta =
+      uncomp_hdr_len - (packetbuf_hdr_len - SICSLOWPAN_RFRAG_HDR_LEN);
+  }
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY */
+
 #if SICSLOWPAN_CONF_FRAG
  copypayload:
 #endif /*SICSLOWPAN_CONF_FRAG*/
@@ -2056,8 +3461,17 @@ input(void)
   if(frag_size > 0) {
     /* Add the size of the header only for the first fragment. */
     if(first_fragment != 0) {
-      frag_info[frag_context].reassembled_len = uncomp_hdr_len + packetbuf_payload_len;
+      /* Next fragments may have been received before */
+      frag_info[frag_context].reassembled_len += uncomp_hdr_len + packetbuf_payload_len;
       frag_info[frag_context].first_frag_len = uncomp_hdr_len + packetbuf_payload_len;
+#if SICSLOWPAN_FRAG_FORWARDING
+      if(forward_first_fragment(frag_context)) {
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARDING */
+      if(frag_info[frag_context].reassembled_len >= frag_size) {
+        last_fragment = 1;
+      }
     }
     /* For the last fragment, we are OK if there is extrenous bytes at
        the end of the packet. */
@@ -2120,6 +3534,11 @@ input(void)
 #if SICSLOWPAN_CONF_FRAG
   }
 #endif /* SICSLOWPAN_CONF_FRAG */
+
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY
+  /* Only now, as packetbuf holds the fragment until it is processed */
+  rfrag_ack_send();
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_RECOVERY */
 }
 /** @} */
 
@@ -2172,6 +3591,18 @@ sicslowpan_init(void)
   }
 #endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 1 */
 
+#if SICSLOWPAN_IPHC_CACHE
+  /* The contexts changed: invalidate all cached compressions */
+  if(++iphc_cache_generation == 0) {
+    iphc_cache_generation = 1;
+  }
+#endif /* SICSLOWPAN_IPHC_CACHE */
+#if SICSLOWPAN_NBR_STATE
+  if(!nbr_table_register(sicslowpan_nbrs, (nbr_table_callback *)nbr_removed)) {
+    LOG_WARN("no neighbor table left for the compression state\n");
+  }
+#endif /* SICSLOWPAN_NBR_STATE */
+
 #endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPHC */
 }
 /*--------------------------------------------------------------------*/
@@ -62,6 +62,14 @@
 #define SICSLOWPAN_UDP_8_BIT_PORT_MIN                     0xF000
 #define SICSLOWPAN_UDP_8_BIT_PORT_MAX                     0xF0FF   /* F000 + 255 */
 
+/* Generic header compression (RFC 7400) of the UDP payloads, for the
+ * neighbors that support it */
+#ifdef SICSLOWPAN_CONF_GHC
+#define SICSLOWPAN_GHC SICSLOWPAN_CONF_GHC
+#else
+#define SICSLOWPAN_GHC 0
+#endif
+
 /** @} */
 
 /**
@@ -88,6 +96,9 @@
 #define SICSLOWPAN_DISPATCH_FRAG1                   0xc0 /* 11000xxx */
 #define SICSLOWPAN_DISPATCH_FRAGN                   0xe0 /* 11100xxx */
 #define SICSLOWPAN_DISPATCH_FRAG_MASK               0xf8
+#define SICSLOWPAN_DISPATCH_RFRAG                   0xe8 /* 1110100x */
+#define SICSLOWPAN_DISPATCH_RFRAG_ACK               0xea /* 1110101x */
+#define SICSLOWPAN_DISPATCH_RFRAG_MASK              0xfe
 #define SICSLOWPAN_DISPATCH_PAGING                  0xf0 /* 1111xxxx */
 #define SICSLOWPAN_DISPATCH_PAGING_MASK             0xf0
 /** @} */
@@ -177,6 +188,14 @@
 #define SICSLOWPAN_NHC_UDP_CS_P_11  0xF3 /* source & dest = 0xF0B + 4bit inline */
 /** @} */
 
+/**
+ * \name LOWPAN_NHC GHC encoding (RFC 7400)
+ * @{
+ */
+/* LOWPAN_UDP header (same C and P bits), followed by a GHC-compressed payload */
+#define SICSLOWPAN_NHC_UDP_GHC_ID                   0xD0
+/** @} */
+
 
 /**
  * \name The 6lowpan "headers" length
@@ -188,6 +207,8 @@
 #define SICSLOWPAN_HC1_HC_UDP_HDR_LEN               7
 #define SICSLOWPAN_FRAG1_HDR_LEN                    4
 #define SICSLOWPAN_FRAGN_HDR_LEN                    5
+#define SICSLOWPAN_RFRAG_HDR_LEN                    6
+#define SICSLOWPAN_RFRAG_ACK_HDR_LEN                6
 /** @} */
 
 /**
@@ -294,6 +315,17 @@ struct sicslowpan_nh_compressor {
 
 };
 
+#if SICSLOWPAN_GHC
+/**
+ * \brief Record whether a neighbor decompresses 6LoWPAN-GHC (RFC 7400),
+ * e.g. as advertised in the 6CIO of its Neighbor Discovery messages.
+ * UDP payloads to the neighbor are compressed with GHC from then on.
+ * \param lladdr The link-layer address of the neighbor
+ * \param capable Non-zero if the neighbor supports GHC
+ */
+void sicslowpan_ghc_set_capable(const linkaddr_t *lladdr, int capable);
+#endif /* SICSLOWPAN_GHC */
+
 extern const struct network_driver sicslowpan_driver;
 
 #endif /* SICSLOWPAN_H_ */
@@ -46,6 +46,7 @@
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/uip-ds6-nbr.h"
 #include "net/linkaddr.h"
+#include "net/packetbuf.h"
 #include "net/routing/routing.h"
 
 #include <string.h>
@@ -109,6 +110,14 @@ tcpip_output(const uip_lladdr_t *a)
 {
   int ret;
 
+#if UIP_TELEMETRY_DSCP
+  /* Tag Traffic Class with the telemetry DSCP, keeping ECN and flow label */
+  if(uipbuf_get_attr(UIPBUF_ATTR_TRAFFIC_CLASS) == PACKETBUF_TRAFFIC_CLASS_TELEMETRY) {
+    UIP_IP_BUF->vtc = 0x60 | (UIP_TELEMETRY_DSCP >> 2);
+    UIP_IP_BUF->tcflow = ((UIP_TELEMETRY_DSCP & 0x03) << 6) | (UIP_IP_BUF->tcflow & 0x3f);
+  }
+#endif /* UIP_TELEMETRY_DSCP */
+
   /* Tag Traffic Class if we are using TC for variable retrans */
 #if UIP_TAG_TC_WITH_VARIABLE_RETRANSMISSIONS
   if(uipbuf_get_attr(UIPBUF_ATTR_MAX_MAC_TRANSMISSIONS) !=
@@ -183,6 +192,16 @@ packet_input(void)
     }
 #endif /* UIP_TAG_TC_WITH_VARIABLE_RETRANSMISSIONS */
 
+#if UIP_TELEMETRY_DSCP
+    /* Forward telemetry with the telemetry traffic class */
+    if(uip_len >= UIP_IPH_LEN) {
+      uint8_t traffic_class = (UIP_IP_BUF->vtc << 4) | (UIP_IP_BUF->tcflow >> 4);
+      if((traffic_class >> 2) == UIP_TELEMETRY_DSCP) {
+        uipbuf_set_attr(UIPBUF_ATTR_TRAFFIC_CLASS, PACKETBUF_TRAFFIC_CLASS_TELEMETRY);
+      }
+    }
+#endif /* UIP_TELEMETRY_DSCP */
+
     uip_input();
     if(uip_len > 0) {
       tcpip_ipv6_output();
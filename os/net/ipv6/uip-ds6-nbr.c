@@ -114,11 +114,60 @@ MEMB(uip_ds6_nbr_memb, uip_ds6_nbr_t, UIP_DS6_NBR_MAX_NEIGHBOR_CACHES);
 NBR_TABLE(uip_ds6_nbr_t, ds6_neighbors);
 #endif /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
 
+#if UIP_DS6_NBR_IPADDR_HASH
+/* Neighbor cache entries hashed by IPv6 address, chained through their
+ * hash_next field */
+static uip_ds6_nbr_t *ipaddr_hash[NBR_TABLE_MAX_NEIGHBORS];
+
+/*---------------------------------------------------------------------------*/
+static unsigned
+ipaddr_hash_bucket(const uip_ipaddr_t *ipaddr)
+{
+  unsigned hash = 0;
+  int i;
+
+  for(i = 0; i < 8; i++) {
+    hash = hash * 31 + ipaddr->u16[i];
+  }
+  return hash % NBR_TABLE_MAX_NEIGHBORS;
+}
+/*---------------------------------------------------------------------------*/
+static void
+ipaddr_hash_add(uip_ds6_nbr_t *nbr)
+{
+  unsigned bucket = ipaddr_hash_bucket(&nbr->ipaddr);
+
+  nbr->hash_next = ipaddr_hash[bucket];
+  ipaddr_hash[bucket] = nbr;
+}
+/*---------------------------------------------------------------------------*/
+static void
+ipaddr_hash_remove(const uip_ds6_nbr_t *nbr)
+{
+  uip_ds6_nbr_t **link;
+
+  if(nbr == NULL) {
+    return;
+  }
+  for(link = &ipaddr_hash[ipaddr_hash_bucket(&nbr->ipaddr)];
+      *link != NULL;
+      link = &(*link)->hash_next) {
+    if(*link == nbr) {
+      *link = nbr->hash_next;
+      return;
+    }
+  }
+}
+#endif /* UIP_DS6_NBR_IPADDR_HASH */
+
 /*---------------------------------------------------------------------------*/
 void
 uip_ds6_neighbors_init(void)
 {
   link_stats_init();
+#if UIP_DS6_NBR_IPADDR_HASH
+  memset(ipaddr_hash, 0, sizeof(ipaddr_hash));
+#endif /* UIP_DS6_NBR_IPADDR_HASH */
 #if UIP_DS6_NBR_MULTI_IPV6_ADDRS
   memb_init(&uip_ds6_nbr_memb);
   nbr_table_register(uip_ds6_nbr_entries,
@@ -187,6 +236,11 @@ uip_ds6_nbr_add(const uip_ipaddr_t *ipaddr, const uip_lladdr_t *lladdr,
     add_uip_ds6_nbr_to_nbr_entry(nbr, nbr_entry);
   }
 #else
+#if UIP_DS6_NBR_IPADDR_HASH
+  /* An entry of the same link-layer address is reused */
+  ipaddr_hash_remove(nbr_table_get_from_lladdr(ds6_neighbors,
+                                               (const linkaddr_t *)lladdr));
+#endif /* UIP_DS6_NBR_IPADDR_HASH */
   nbr = nbr_table_add_lladdr(ds6_neighbors, (linkaddr_t*)lladdr, reason, data);
 #endif /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
 
@@ -195,6 +249,9 @@ uip_ds6_nbr_add(const uip_ipaddr_t *ipaddr, const uip_lladdr_t *lladdr,
     NETSTACK_CONF_DS6_NEIGHBOR_UPDATED_CALLBACK((const linkaddr_t *)lladdr, 1);
 #endif /* NETSTACK_CONF_DS6_NEIGHBOR_ADDED_CALLBACK */
     uip_ipaddr_copy(&nbr->ipaddr, ipaddr);
+#if UIP_DS6_NBR_IPADDR_HASH
+    ipaddr_hash_add(nbr);
+#endif /* UIP_DS6_NBR_IPADDR_HASH */
 #if UIP_ND6_SEND_RA || !UIP_CONF_ROUTER
     nbr->isrouter = isrouter;
 #endif /* UIP_ND6_SEND_RA || !UIP_CONF_ROUTER */
@@ -272,6 +329,9 @@ free_uip_ds6_nbr(uip_ds6_nbr_t *nbr)
 #if UIP_CONF_IPV6_QUEUE_PKT
   uip_packetqueue_free(&nbr->packethandle);
 #endif /* UIP_CONF_IPV6_QUEUE_PKT */
+#if UIP_DS6_NBR_IPADDR_HASH
+  ipaddr_hash_remove(nbr);
+#endif /* UIP_DS6_NBR_IPADDR_HASH */
   NETSTACK_ROUTING.neighbor_state_changed(nbr);
   assert(nbr->nbr_entry != NULL);
   if(nbr->nbr_entry == NULL) {
@@ -331,6 +391,9 @@ uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr)
   uip_packetqueue_free(&nbr->packethandle);
 #endif /* UIP_CONF_IPV6_QUEUE_PKT */
 
+#if UIP_DS6_NBR_IPADDR_HASH
+  ipaddr_hash_remove(nbr);
+#endif /* UIP_DS6_NBR_IPADDR_HASH */
   NETSTACK_ROUTING.neighbor_state_changed(nbr);
   ret = nbr_table_remove(ds6_neighbors, nbr);
 #endif /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
@@ -405,6 +468,10 @@ uip_ds6_nbr_update_ll(uip_ds6_nbr_t **nbr_pp, const uip_lladdr_t *new_ll_addr)
     LOG_ERR("%s: cannot allocate a new nbr for new_ll_addr\n", __func__);
     return -1;
   }
+#if UIP_DS6_NBR_IPADDR_HASH
+  /* Keep the hash chain of the new entry */
+  nbr_backup.hash_next = (*nbr_pp)->hash_next;
+#endif /* UIP_DS6_NBR_IPADDR_HASH */
   memcpy(*nbr_pp, &nbr_backup, sizeof(uip_ds6_nbr_t));
 #endif /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
 
@@ -500,7 +567,13 @@ uip_ds6_nbr_lookup(const uip_ipaddr_t *ipaddr)
   if(ipaddr == NULL) {
     return NULL;
   }
+#if UIP_DS6_NBR_IPADDR_HASH
+  for(nbr = ipaddr_hash[ipaddr_hash_bucket(ipaddr)];
+      nbr != NULL;
+      nbr = nbr->hash_next) {
+#else /* UIP_DS6_NBR_IPADDR_HASH */
   for(nbr = uip_ds6_nbr_head(); nbr != NULL; nbr = uip_ds6_nbr_next(nbr)) {
+#endif /* UIP_DS6_NBR_IPADDR_HASH */
     if(uip_ipaddr_cmp(&nbr->ipaddr, ipaddr)) {
       return nbr;
     }
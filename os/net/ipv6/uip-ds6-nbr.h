@@ -91,6 +91,15 @@
   (NBR_TABLE_MAX_NEIGHBORS * UIP_DS6_NBR_MAX_6ADDRS_PER_NBR)
 #endif /* UIP_DS6_NBR_CONF_MAX_NEIGHBOR_CACHES */
 
+/** \brief Set non-zero (1) to index the neighbor cache entries by IPv6
+ * address in a hash table, rather than scanning all of them on every
+ * lookup */
+#ifdef UIP_DS6_NBR_CONF_IPADDR_HASH
+#define UIP_DS6_NBR_IPADDR_HASH UIP_DS6_NBR_CONF_IPADDR_HASH
+#else
+#define UIP_DS6_NBR_IPADDR_HASH 0
+#endif /* UIP_DS6_NBR_CONF_IPADDR_HASH */
+
 #if UIP_DS6_NBR_MULTI_IPV6_ADDRS
 /** \brief nbr_table entry when UIP_DS6_NBR_MULTI_IPV6_ADDRS is
  * enabled. uip_ds6_nbrs is a list of uip_ds6_nbr_t objects */
@@ -107,6 +116,9 @@ typedef struct uip_ds6_nbr {
   struct uip_ds6_nbr *next;
   uip_ds6_nbr_entry_t *nbr_entry;
 #endif /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
+#if UIP_DS6_NBR_IPADDR_HASH
+  struct uip_ds6_nbr *hash_next;
+#endif /* UIP_DS6_NBR_IPADDR_HASH */
   uip_ipaddr_t ipaddr;
   uint8_t isrouter;
   uint8_t state;
@@ -85,6 +85,33 @@ MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 static int num_routes = 0;
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 
+#if UIP_DS6_ROUTE_TRIE
+/* The routes are indexed by prefix in a binary radix trie. A node
+   matches the first length bits of its prefix, and its children extend
+   it with a 0 or a 1 bit. Paths are compressed: a node without a route
+   has two children, so that N routes take at most 2N - 1 nodes. */
+struct route_trie_node {
+  struct route_trie_node *children[2];
+  uip_ds6_route_t *route;
+  uip_ipaddr_t prefix;
+  uint8_t length;
+};
+MEMB(route_trie_memb, struct route_trie_node, 2 * UIP_DS6_ROUTE_NB);
+static struct route_trie_node *route_trie;
+
+/* The last destination looked up and its route, until the routes
+   change */
+static uip_ipaddr_t last_dest;
+static uip_ds6_route_t *last_route;
+static uint8_t last_valid;
+
+#if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+/* Number of lookups, to tell the least recently used route without
+   moving routes around the list on every lookup */
+static uint32_t route_lookups;
+#endif /* UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
+#endif /* UIP_DS6_ROUTE_TRIE */
+
 #endif /* (UIP_MAX_ROUTES != 0) */
 
 /* Default routes are held on the defaultrouterlist and their
@@ -125,6 +152,191 @@ assert_nbr_routes_list_sane(void)
 #endif /* (UIP_MAX_ROUTES != 0) */
 }
 /*---------------------------------------------------------------------------*/
+#if (UIP_MAX_ROUTES != 0) && UIP_DS6_ROUTE_TRIE
+static int
+addr_bit(const uip_ipaddr_t *addr, int bit)
+{
+  return (addr->u8[bit >> 3] >> (7 - (bit & 7))) & 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Number of leading bits two addresses have in common, up to max. Their
+   first from bits are known to be equal. */
+static int
+common_prefix_len(const uip_ipaddr_t *addr1, const uip_ipaddr_t *addr2,
+                  int from, int max)
+{
+  int i;
+  int bits;
+  uint8_t diff;
+
+  for(i = from >> 3; i << 3 < max; i++) {
+    diff = addr1->u8[i] ^ addr2->u8[i];
+    if(diff != 0) {
+      for(bits = i << 3; !(diff & 0x80); bits++) {
+        diff <<= 1;
+      }
+      return MIN(bits, max);
+    }
+  }
+  return max;
+}
+/*---------------------------------------------------------------------------*/
+static struct route_trie_node *
+trie_node_alloc(const uip_ipaddr_t *prefix, uint8_t length,
+                uip_ds6_route_t *route)
+{
+  struct route_trie_node *node = memb_alloc(&route_trie_memb);
+  if(node != NULL) {
+    node->children[0] = node->children[1] = NULL;
+    node->route = route;
+    uip_ipaddr_copy(&node->prefix, prefix);
+    node->length = length;
+  }
+  return node;
+}
+/*---------------------------------------------------------------------------*/
+static int
+trie_add(uip_ds6_route_t *route)
+{
+  struct route_trie_node **link = &route_trie;
+  struct route_trie_node *node;
+  struct route_trie_node *parent;
+  struct route_trie_node *leaf;
+  int common = 0;
+
+  last_valid = 0;
+
+  while((node = *link) != NULL) {
+    common = common_prefix_len(&node->prefix, &route->ipaddr, common,
+                               MIN(node->length, route->length));
+    if(common < node->length) {
+      /* The route branches off above the node */
+      parent = trie_node_alloc(&route->ipaddr, common, NULL);
+      if(parent == NULL) {
+        return 0;
+      }
+      if(common == route->length) {
+        parent->route = route;
+      } else {
+        leaf = trie_node_alloc(&route->ipaddr, route->length, route);
+        if(leaf == NULL) {
+          memb_free(&route_trie_memb, parent);
+          return 0;
+        }
+        parent->children[addr_bit(&route->ipaddr, common)] = leaf;
+      }
+      parent->children[addr_bit(&node->prefix, common)] = node;
+      *link = parent;
+      return 1;
+    }
+    if(node->length == route->length) {
+      /* Another route to the same prefix is shadowed until removed */
+      node->route = route;
+      return 1;
+    }
+    link = &node->children[addr_bit(&route->ipaddr, node->length)];
+  }
+
+  *link = trie_node_alloc(&route->ipaddr, route->length, route);
+  return *link != NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a node that lost its route, unless it still branches */
+static void
+trie_compact(struct route_trie_node **link)
+{
+  struct route_trie_node *node = *link;
+
+  if(node->route != NULL
+     || (node->children[0] != NULL && node->children[1] != NULL)) {
+    return;
+  }
+  *link = node->children[0] != NULL ? node->children[0] : node->children[1];
+  memb_free(&route_trie_memb, node);
+}
+/*---------------------------------------------------------------------------*/
+static void
+trie_rm(const uip_ds6_route_t *route)
+{
+  struct route_trie_node **link = &route_trie;
+  struct route_trie_node **parent_link = NULL;
+  struct route_trie_node *node;
+  uip_ds6_route_t *r;
+  int common = 0;
+
+  last_valid = 0;
+
+  while((node = *link) != NULL && node->length < route->length) {
+    common = common_prefix_len(&node->prefix, &route->ipaddr, common,
+                               node->length);
+    if(common < node->length) {
+      return;
+    }
+    parent_link = link;
+    link = &node->children[addr_bit(&route->ipaddr, node->length)];
+  }
+  if(node == NULL || node->route != route) {
+    return;
+  }
+
+  /* A route it shadowed takes its place */
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    if(r != route && r->length == route->length
+       && common_prefix_len(&r->ipaddr, &route->ipaddr, 0,
+                            route->length) == route->length) {
+      node->route = r;
+      return;
+    }
+  }
+
+  node->route = NULL;
+  trie_compact(link);
+  if(parent_link != NULL) {
+    trie_compact(parent_link);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+trie_lookup(const uip_ipaddr_t *addr)
+{
+  struct route_trie_node *node = route_trie;
+  uip_ds6_route_t *found_route = NULL;
+  int common = 0;
+
+  while(node != NULL) {
+    common = common_prefix_len(&node->prefix, addr, common, node->length);
+    if(common < node->length) {
+      break;
+    }
+    if(node->route != NULL) {
+      found_route = node->route;
+    }
+    if(node->length == 128) {
+      break;
+    }
+    node = node->children[addr_bit(addr, node->length)];
+  }
+  return found_route;
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+static uip_ds6_route_t *
+least_recently_used(void)
+{
+  uip_ds6_route_t *r;
+  uip_ds6_route_t *oldest = NULL;
+
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    if(oldest == NULL
+       || route_lookups - r->last_used > route_lookups - oldest->last_used) {
+      oldest = r;
+    }
+  }
+  return oldest;
+}
+#endif /* UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
+#endif /* (UIP_MAX_ROUTES != 0) && UIP_DS6_ROUTE_TRIE */
+/*---------------------------------------------------------------------------*/
 #if UIP_DS6_NOTIFICATIONS
 static void
 call_route_callback(int event, const uip_ipaddr_t *route,
@@ -168,6 +380,11 @@ uip_ds6_route_init(void)
 #if (UIP_MAX_ROUTES != 0)
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_TRIE
+  memb_init(&route_trie_memb);
+  route_trie = NULL;
+  last_valid = 0;
+#endif /* UIP_DS6_ROUTE_TRIE */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 #endif /* (UIP_MAX_ROUTES != 0) */
@@ -275,9 +492,11 @@ uip_ds6_route_t *
 uip_ds6_route_lookup(const uip_ipaddr_t *addr)
 {
 #if (UIP_MAX_ROUTES != 0)
-  uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_TRIE
+  uip_ds6_route_t *r;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_TRIE */
 
   LOG_INFO("Looking up route for ");
   LOG_INFO_6ADDR(addr);
@@ -287,6 +506,16 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
     return NULL;
   }
 
+#if UIP_DS6_ROUTE_TRIE
+  if(last_valid && uip_ipaddr_cmp(addr, &last_dest)) {
+    found_route = last_route;
+  } else {
+    found_route = trie_lookup(addr);
+    uip_ipaddr_copy(&last_dest, addr);
+    last_route = found_route;
+    last_valid = 1;
+  }
+#else /* UIP_DS6_ROUTE_TRIE */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -302,6 +531,7 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_TRIE */
 
   if(found_route != NULL) {
     LOG_INFO("Found route: ");
@@ -313,6 +543,13 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
     LOG_INFO("No route found\n");
   }
 
+#if UIP_DS6_ROUTE_TRIE
+#if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+  if(found_route != NULL) {
+    found_route->last_used = ++route_lookups;
+  }
+#endif /* UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
+#else /* UIP_DS6_ROUTE_TRIE */
   if(found_route != NULL && found_route != list_head(routelist)) {
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
@@ -322,6 +559,7 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
     list_remove(routelist, found_route);
     list_push(routelist, found_route);
   }
+#endif /* UIP_DS6_ROUTE_TRIE */
 
   return found_route;
 #else /* (UIP_MAX_ROUTES != 0) */
@@ -383,7 +621,11 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
 #if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
       /* Removing the oldest route entry from the route table. The
          least recently used route is the first route on the list. */
+#if UIP_DS6_ROUTE_TRIE
+      oldest = least_recently_used();
+#else /* UIP_DS6_ROUTE_TRIE */
       oldest = list_tail(routelist);
+#endif /* UIP_DS6_ROUTE_TRIE */
 #endif
       if(oldest == NULL) {
         return NULL;
@@ -464,6 +706,17 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_TRIE
+#if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+  r->last_used = ++route_lookups;
+#endif /* UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
+  if(!trie_add(r)) {
+    /* This should not happen, as the trie has room for all routes */
+    LOG_ERR("Add: could not index route\n");
+    uip_ds6_route_rm(r);
+    return NULL;
+  }
+#endif /* UIP_DS6_ROUTE_TRIE */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -507,6 +760,10 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
     LOG_INFO_6ADDR(&route->ipaddr);
     LOG_INFO_("\n");
 
+#if UIP_DS6_ROUTE_TRIE
+    trie_rm(route);
+#endif /* UIP_DS6_ROUTE_TRIE */
+
     /* Remove the route from the route list */
     list_remove(routelist, route);
 
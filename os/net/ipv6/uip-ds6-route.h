@@ -111,6 +111,15 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB 4
 #endif /* UIP_MAX_ROUTES */
 
+/** \brief Set non-zero (1) to index the routes by prefix in a radix
+    trie, with a cache of the last destination looked up, rather than
+    scanning all routes on every lookup */
+#ifdef UIP_DS6_ROUTE_CONF_TRIE
+#define UIP_DS6_ROUTE_TRIE UIP_DS6_ROUTE_CONF_TRIE
+#else /* UIP_DS6_ROUTE_CONF_TRIE */
+#define UIP_DS6_ROUTE_TRIE 0
+#endif /* UIP_DS6_ROUTE_CONF_TRIE */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -179,6 +188,10 @@ typedef struct uip_ds6_route {
   uip_ipaddr_t ipaddr;
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   UIP_DS6_ROUTE_STATE_TYPE state;
+#endif
+#if UIP_DS6_ROUTE_TRIE && UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+  /* Lookup count when last used, in place of the order of the list */
+  uint32_t last_used;
 #endif
   uint8_t length;
 } uip_ds6_route_t;
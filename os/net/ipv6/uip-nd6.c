@@ -74,6 +74,7 @@
 #include "net/ipv6/uip-nd6.h"
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/uip-nameserver.h"
+#include "net/ipv6/sicslowpan.h"
 #include "lib/random.h"
 
 /* Log configuration */
@@ -146,6 +147,37 @@ create_llao(uint8_t *llao, uint8_t type)
          UIP_ND6_OPT_LLAO_LEN - 2 - UIP_LLADDR_LEN);
 }
 #endif /* UIP_ND6_SEND_NA */
+/*------------------------------------------------------------------*/
+#if SICSLOWPAN_GHC
+/* Our NS and NA advertise GHC support in a 6CIO */
+#define ND6_OPT_6CIO_OUT_LEN UIP_ND6_OPT_6CIO_LEN
+#if UIP_ND6_SEND_NA || UIP_ND6_SEND_NS
+/* create a 6CIO */
+static void
+create_6cio(uint8_t *cio)
+{
+  memset(cio, 0, UIP_ND6_OPT_6CIO_LEN);
+  cio[UIP_ND6_OPT_TYPE_OFFSET] = UIP_ND6_OPT_6CIO;
+  cio[UIP_ND6_OPT_LEN_OFFSET] = UIP_ND6_OPT_6CIO_LEN >> 3;
+  cio[UIP_ND6_6CIO_FLAGS_OFFSET] = UIP_ND6_6CIO_FLAG_G;
+}
+#endif /* UIP_ND6_SEND_NA || UIP_ND6_SEND_NS */
+/*------------------------------------------------------------------*/
+#if UIP_ND6_SEND_NA || UIP_ND6_SEND_NS
+/* record the GHC support a neighbor advertised along with its LLAO */
+static void
+ghc_capability_input(int cio_flags)
+{
+  uip_lladdr_t lladdr_aligned;
+  if(cio_flags >= 0 && extract_lladdr_from_llao_aligned(&lladdr_aligned)) {
+    sicslowpan_ghc_set_capable((const linkaddr_t *)&lladdr_aligned,
+                               cio_flags & UIP_ND6_6CIO_FLAG_G);
+  }
+}
+#endif /* UIP_ND6_SEND_NA || UIP_ND6_SEND_NS */
+#else /* SICSLOWPAN_GHC */
+#define ND6_OPT_6CIO_OUT_LEN 0
+#endif /* SICSLOWPAN_GHC */
 /*------------------------------------------------------------------*/
  /**
  * Neighbor Solicitation Processing
@@ -173,6 +205,9 @@ static void
 ns_input(void)
 {
   uint8_t flags = 0;
+#if SICSLOWPAN_GHC
+  int cio_flags = -1;
+#endif /* SICSLOWPAN_GHC */
 
   LOG_INFO("Received NS from ");
   LOG_INFO_6ADDR(&UIP_IP_BUF->srcipaddr);
@@ -247,12 +282,22 @@ ns_input(void)
       }
 #endif /*UIP_CONF_IPV6_CHECKS */
       break;
+#if SICSLOWPAN_GHC
+    case UIP_ND6_OPT_6CIO:
+      if(uip_l3_icmp_hdr_len + nd6_opt_offset + UIP_ND6_OPT_6CIO_LEN <= uip_len) {
+        cio_flags = *ND6_OPT(nd6_opt_offset + UIP_ND6_6CIO_FLAGS_OFFSET);
+      }
+      break;
+#endif /* SICSLOWPAN_GHC */
     default:
       LOG_WARN("ND option not supported in NS");
       break;
     }
     nd6_opt_offset += (ND6_OPT_HDR_BUF(nd6_opt_offset)->len << 3);
   }
+#if SICSLOWPAN_GHC
+  ghc_capability_input(cio_flags);
+#endif /* SICSLOWPAN_GHC */
 
   addr = uip_ds6_addr_lookup(&UIP_ND6_NS_BUF->tgtipaddr);
   if(addr != NULL) {
@@ -326,7 +371,8 @@ create_na:
   UIP_IP_BUF->vtc = 0x60;
   UIP_IP_BUF->tcflow = 0;
   UIP_IP_BUF->flow = 0;
-  uipbuf_set_len_field(UIP_IP_BUF, UIP_ICMPH_LEN + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN);
+  uipbuf_set_len_field(UIP_IP_BUF, UIP_ICMPH_LEN + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN
+                       + ND6_OPT_6CIO_OUT_LEN);
   UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
   UIP_IP_BUF->ttl = UIP_ND6_HOP_LIMIT;
 
@@ -338,11 +384,15 @@ create_na:
 
   create_llao(&uip_buf[uip_l3_icmp_hdr_len + UIP_ND6_NA_LEN],
               UIP_ND6_OPT_TLLAO);
+#if SICSLOWPAN_GHC
+  create_6cio(&uip_buf[uip_l3_icmp_hdr_len + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN]);
+#endif /* SICSLOWPAN_GHC */
 
   UIP_ICMP_BUF->icmpchksum = 0;
   UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
 
-  uipbuf_set_len(UIP_IPH_LEN + UIP_ICMPH_LEN + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN);
+  uipbuf_set_len(UIP_IPH_LEN + UIP_ICMPH_LEN + UIP_ND6_NA_LEN + UIP_ND6_OPT_LLAO_LEN
+                 + ND6_OPT_6CIO_OUT_LEN);
 
   UIP_STAT(++uip_stat.nd6.sent);
   LOG_INFO("Sending NA to ");
@@ -398,13 +448,18 @@ uip_nd6_ns_output(const uip_ipaddr_t * src, const uip_ipaddr_t * dest,
       uipbuf_clear();
       return;
     }
-    uipbuf_set_len_field(UIP_IP_BUF, UIP_ICMPH_LEN + UIP_ND6_NS_LEN + UIP_ND6_OPT_LLAO_LEN);
+    uipbuf_set_len_field(UIP_IP_BUF, UIP_ICMPH_LEN + UIP_ND6_NS_LEN + UIP_ND6_OPT_LLAO_LEN
+                         + ND6_OPT_6CIO_OUT_LEN);
 
     create_llao(&uip_buf[uip_l3_icmp_hdr_len + UIP_ND6_NS_LEN],
                 UIP_ND6_OPT_SLLAO);
+#if SICSLOWPAN_GHC
+    create_6cio(&uip_buf[uip_l3_icmp_hdr_len + UIP_ND6_NS_LEN + UIP_ND6_OPT_LLAO_LEN]);
+#endif /* SICSLOWPAN_GHC */
 
     uip_len =
-      UIP_IPH_LEN + UIP_ICMPH_LEN + UIP_ND6_NS_LEN + UIP_ND6_OPT_LLAO_LEN;
+      UIP_IPH_LEN + UIP_ICMPH_LEN + UIP_ND6_NS_LEN + UIP_ND6_OPT_LLAO_LEN
+      + ND6_OPT_6CIO_OUT_LEN;
   } else {
     uip_create_unspecified(&UIP_IP_BUF->srcipaddr);
     UIP_IP_BUF->len[1] = UIP_ICMPH_LEN + UIP_ND6_NS_LEN;
@@ -453,6 +508,9 @@ na_input(void)
   uint8_t is_solicited;
   uint8_t is_override;
   uip_lladdr_t lladdr_aligned;
+#if SICSLOWPAN_GHC
+  int cio_flags = -1;
+#endif /* SICSLOWPAN_GHC */
 
   LOG_INFO("Received NA from ");
   LOG_INFO_6ADDR(&UIP_IP_BUF->srcipaddr);
@@ -498,12 +556,22 @@ na_input(void)
     case UIP_ND6_OPT_TLLAO:
       nd6_opt_llao = (uint8_t *)ND6_OPT_HDR_BUF(nd6_opt_offset);
       break;
+#if SICSLOWPAN_GHC
+    case UIP_ND6_OPT_6CIO:
+      if(uip_l3_icmp_hdr_len + nd6_opt_offset + UIP_ND6_OPT_6CIO_LEN <= uip_len) {
+        cio_flags = *ND6_OPT(nd6_opt_offset + UIP_ND6_6CIO_FLAGS_OFFSET);
+      }
+      break;
+#endif /* SICSLOWPAN_GHC */
     default:
       LOG_WARN("ND option not supported in NA\n");
       break;
     }
     nd6_opt_offset += (ND6_OPT_HDR_BUF(nd6_opt_offset)->len << 3);
   }
+#if SICSLOWPAN_GHC
+  ghc_capability_input(cio_flags);
+#endif /* SICSLOWPAN_GHC */
   addr = uip_ds6_addr_lookup(&UIP_ND6_NA_BUF->tgtipaddr);
   /* Message processing, including TLLAO if any */
   if(addr != NULL) {
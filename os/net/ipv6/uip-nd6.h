@@ -200,6 +200,7 @@ be added regardless of their reachability and liveness.  */
 #define UIP_ND6_OPT_MTU                 5
 #define UIP_ND6_OPT_RDNSS               25
 #define UIP_ND6_OPT_DNSSL               31
+#define UIP_ND6_OPT_6CIO                36
 /** @} */
 
 /** \name ND6 option types */
@@ -224,6 +225,7 @@ be added regardless of their reachability and liveness.  */
 #define UIP_ND6_OPT_MTU_LEN            8
 #define UIP_ND6_OPT_RDNSS_LEN          1
 #define UIP_ND6_OPT_DNSSL_LEN          1
+#define UIP_ND6_OPT_6CIO_LEN           8
 
 
 /* Length of TLLAO and SLLAO options, it is L2 dependant */
@@ -255,6 +257,14 @@ be added regardless of their reachability and liveness.  */
 #define UIP_ND6_RA_FLAG_AUTONOMOUS      0x40
 /** @} */
 
+/** \name 6LoWPAN Capability Indication Option (RFC 7400) */
+/** @{ */
+/** Offset of the flags byte holding the G bit */
+#define UIP_ND6_6CIO_FLAGS_OFFSET       3
+/** The node supports 6LoWPAN-GHC */
+#define UIP_ND6_6CIO_FLAG_G             0x01
+/** @} */
+
 /**
  * \name ND message structures
  * @{
@@ -210,6 +210,7 @@ enum {
   UIPBUF_ATTR_FLAGS,   /**< Flags that can control lower layers.  see above. */
   UIPBUF_ATTR_RSSI, /**< Last packet's RSSI */
   UIPBUF_ATTR_LINK_QUALITY, /**< Last packet's LQI */
+  UIPBUF_ATTR_TRAFFIC_CLASS, /**< PACKETBUF_TRAFFIC_CLASS_* of the packet */
   UIPBUF_ATTR_MAX
 };
 
@@ -437,6 +437,20 @@ void uip_log(char *msg);
 #define UIP_TAG_TC_WITH_VARIABLE_RETRANSMISSIONS 0
 #endif
 
+/**
+ * The DSCP tagged in the "Traffic Class" field of packets sent with the
+ * telemetry traffic class (see UIPBUF_ATTR_TRAFFIC_CLASS), so that forwarders
+ * classify them alike. Set it along with the Orchestra telemetry rule,
+ * typically to Lower Effort (0x01, RFC 8622). When 0 (default), packets are
+ * neither tagged nor classified by their DSCP, and are only classified on the
+ * node that originates them.
+ */
+#ifdef UIP_CONF_TELEMETRY_DSCP
+#define UIP_TELEMETRY_DSCP UIP_CONF_TELEMETRY_DSCP
+#else
+#define UIP_TELEMETRY_DSCP 0
+#endif
+
 /**
  * This is the default value of MAC-layer transmissons for uIPv6
  *
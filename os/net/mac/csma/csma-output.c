@@ -88,6 +88,16 @@
 #define CSMA_MAX_FRAME_RETRIES 7
 #endif
 
+/* Create the frame once, when a packet is queued, and transmit it straight
+ * from its queuebuf. Retransmissions then neither copy the packet back to
+ * packetbuf nor run the framer again; they reuse the frame as is, including
+ * its security frame counter. */
+#ifdef CSMA_CONF_ZERO_COPY
+#define CSMA_ZERO_COPY CSMA_CONF_ZERO_COPY
+#else
+#define CSMA_ZERO_COPY 0
+#endif
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
@@ -166,12 +176,10 @@ backoff_period(void)
 #endif /* CONTIKI_TARGET_COOJA */
 }
 /*---------------------------------------------------------------------------*/
+/* Create the frame of the packet in packetbuf */
 static int
-send_one_packet(struct neighbor_queue *n, struct packet_queue *q)
+create_frame(void)
 {
-  int ret;
-  int last_sent_ok = 0;
-
   packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
   packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
 
@@ -182,18 +190,50 @@ send_one_packet(struct neighbor_queue *n, struct packet_queue *q)
 #endif /* LLSEC802154_USES_EXPLICIT_KEYS */
 #endif /* LLSEC802154_ENABLED */
 
-  if(csma_security_create_frame() < 0) {
+  return csma_security_create_frame();
+}
+/*---------------------------------------------------------------------------*/
+/* Get the frame to transmit for a queued packet */
+static int
+get_frame(struct packet_queue *q, uint8_t **frame, int *frame_len)
+{
+#if CSMA_ZERO_COPY
+  /* The frame was created when the packet was queued. Only its attributes
+   * go to packetbuf, for the radio driver and rexmit() to update them. */
+  queuebuf_attr_to_packetbuf(q->buf);
+  *frame = queuebuf_dataptr(q->buf);
+  *frame_len = queuebuf_datalen(q->buf);
+#else /* CSMA_ZERO_COPY */
+  queuebuf_to_packetbuf(q->buf);
+  if(create_frame() < 0) {
+    return -1;
+  }
+  *frame = packetbuf_hdrptr();
+  *frame_len = packetbuf_totlen();
+#endif /* CSMA_ZERO_COPY */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+send_one_packet(struct neighbor_queue *n, struct packet_queue *q)
+{
+  int ret;
+  int last_sent_ok = 0;
+  uint8_t *frame;
+  int frame_len;
+
+  if(get_frame(q, &frame, &frame_len) < 0) {
     /* Failed to allocate space for headers */
-    LOG_ERR("failed to create packet, seqno: %d\n", packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO));
+    LOG_ERR("failed to create packet, seqno: %d\n", queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_SEQNO));
     ret = MAC_TX_ERR_FATAL;
   } else {
     int is_broadcast;
     uint8_t dsn;
-    dsn = ((uint8_t *)packetbuf_hdrptr())[2] & 0xff;
+    dsn = frame[2] & 0xff;
 
-    NETSTACK_RADIO.prepare(packetbuf_hdrptr(), packetbuf_totlen());
+    NETSTACK_RADIO.prepare(frame, frame_len);
 
-    is_broadcast = packetbuf_holds_broadcast();
+    is_broadcast = linkaddr_cmp(&n->addr, &linkaddr_null);
 
     if(NETSTACK_RADIO.receiving_packet() ||
        (!is_broadcast && NETSTACK_RADIO.pending_packet())) {
@@ -204,7 +244,7 @@ send_one_packet(struct neighbor_queue *n, struct packet_queue *q)
       ret = MAC_TX_COLLISION;
     } else {
 
-      switch(NETSTACK_RADIO.transmit(packetbuf_totlen())) {
+      switch(NETSTACK_RADIO.transmit(frame_len)) {
       case RADIO_TX_OK:
         if(is_broadcast) {
           ret = MAC_TX_OK;
@@ -267,7 +307,6 @@ transmit_from_queue(void *ptr)
         queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_SEQNO),
         n->transmissions, list_length(n->packet_queue));
       /* Send first packet in the neighbor queue */
-      queuebuf_to_packetbuf(q->buf);
       send_one_packet(n, q);
     }
   }
@@ -336,9 +375,13 @@ tx_done(int status, struct packet_queue *q, struct neighbor_queue *n)
   LOG_INFO("packet sent to ");
   LOG_INFO_LLADDR(&n->addr);
   LOG_INFO_(", seqno %u, status %u, tx %u, coll %u\n",
-              packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO),
+              queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_SEQNO),
               status, n->transmissions, n->collisions);
 
+#if CSMA_ZERO_COPY
+  /* Put packet into packetbuf for packet_sent callback */
+  queuebuf_to_packetbuf(q->buf);
+#endif /* CSMA_ZERO_COPY */
   free_packet(n, q, status);
   mac_call_sent_callback(sent, cptr, status, ntx);
 }
@@ -417,7 +460,7 @@ packet_sent(struct neighbor_queue *n,
   LOG_INFO("tx to ");
   LOG_INFO_LLADDR(&n->addr);
   LOG_INFO_(", seqno %u, status %u, tx %u, coll %u\n",
-            packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO),
+            queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_SEQNO),
             status, n->transmissions, n->collisions);
 
   switch(status) {
@@ -448,6 +491,15 @@ csma_output_packet(mac_callback_t sent, void *ptr)
   mac_sequence_set_dsn();
   packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_DATAFRAME);
 
+#if CSMA_ZERO_COPY
+  if(create_frame() < 0) {
+    /* Failed to allocate space for headers */
+    LOG_ERR("failed to create packet, seqno: %d\n", packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO));
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+    return;
+  }
+#endif /* CSMA_ZERO_COPY */
+
   /* Look for the neighbor entry */
   n = neighbor_queue_from_addr(addr);
   if(n == NULL) {
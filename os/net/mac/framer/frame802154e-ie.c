@@ -87,6 +87,8 @@ enum ieee802154e_mlme_long_subie_id {
 enum ieee802154e_ietf_subie_id {
   IETF_IE_6TOP = SIXTOP_SUBIE_ID,
   IETF_IE_INT  = INT_SUBIE_ID,
+  IETF_IE_SCHEDULE_LEVEL = TSCH_SCHEDULE_LEVEL_SUBIE_ID,
+  IETF_IE_CHANNEL_MAP = TSCH_CHANNEL_MAP_SUBIE_ID,
 };
 
 #define WRITE16(buf, val) \
@@ -237,6 +239,54 @@ frame80215e_create_ie_ietf_int(uint8_t *buf, int len, struct ieee802154_ies *ies
 
 #endif
 
+#if TSCH_WITH_SCHEDULE_LEVEL
+/* Payload IE. IETF, schedule level sub-IE. Used in EBs: level in use, next
+ * level and the ASN from which the next level applies */
+int
+frame80215e_create_ie_ietf_schedule_level(uint8_t *buf, int len,
+    struct ieee802154_ies *ies)
+{
+  int ie_len = 8;
+  if(len >= 2 + ie_len && ies != NULL) {
+    buf[2] = IETF_IE_SCHEDULE_LEVEL;
+    buf[3] = ies->ie_schedule_level.level;
+    buf[4] = ies->ie_schedule_level.next_level;
+    buf[5] = ies->ie_schedule_level.switch_asn.ls4b;
+    buf[6] = ies->ie_schedule_level.switch_asn.ls4b >> 8;
+    buf[7] = ies->ie_schedule_level.switch_asn.ls4b >> 16;
+    buf[8] = ies->ie_schedule_level.switch_asn.ls4b >> 24;
+    buf[9] = ies->ie_schedule_level.switch_asn.ms1b;
+    create_payload_ie_descriptor(buf, PAYLOAD_IE_IETF, ie_len);
+    return 2 + ie_len;
+  }
+  return -1;
+}
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+
+#if TSCH_WITH_CHANNEL_MAP
+/* Payload IE. IETF, channel map sub-IE. Used in EBs: blacklist in use, next
+ * blacklist and the ASN from which the next blacklist applies */
+int
+frame80215e_create_ie_ietf_channel_map(uint8_t *buf, int len,
+    struct ieee802154_ies *ies)
+{
+  int ie_len = 10;
+  if(len >= 2 + ie_len && ies != NULL) {
+    buf[2] = IETF_IE_CHANNEL_MAP;
+    WRITE16(buf + 3, ies->ie_channel_map.blacklist);
+    WRITE16(buf + 5, ies->ie_channel_map.next_blacklist);
+    buf[7] = ies->ie_channel_map.switch_asn.ls4b;
+    buf[8] = ies->ie_channel_map.switch_asn.ls4b >> 8;
+    buf[9] = ies->ie_channel_map.switch_asn.ls4b >> 16;
+    buf[10] = ies->ie_channel_map.switch_asn.ls4b >> 24;
+    buf[11] = ies->ie_channel_map.switch_asn.ms1b;
+    create_payload_ie_descriptor(buf, PAYLOAD_IE_IETF, ie_len);
+    return 2 + ie_len;
+  }
+  return -1;
+}
+#endif /* TSCH_WITH_CHANNEL_MAP */
+
 /* Payload IE. MLME. Used to nest sub-IEs */
 int
 frame80215e_create_ie_mlme(uint8_t *buf, int len,
@@ -574,7 +624,7 @@ frame802154e_parse_information_elements(const uint8_t *buf, uint8_t buf_size,
             len = 0; /* Reset len as we want to read subIEs and not jump over them */
             LOG_DBG("entering MLME ie with len %u\n", nested_mlme_len);
             break;
-#if TSCH_WITH_SIXTOP || TSCH_WITH_INT
+#if TSCH_WITH_SIXTOP || TSCH_WITH_INT || TSCH_WITH_SCHEDULE_LEVEL || TSCH_WITH_CHANNEL_MAP
           case PAYLOAD_IE_IETF:
             switch(*buf) {
   #if TSCH_WITH_SIXTOP
@@ -598,6 +648,38 @@ frame802154e_parse_information_elements(const uint8_t *buf, uint8_t buf_size,
                 ies->int_ie_content_ptr = buf + 1;
                 ies->int_ie_content_len = len - 1;
                 break;
+  #endif
+  #if TSCH_WITH_SCHEDULE_LEVEL
+              case IETF_IE_SCHEDULE_LEVEL:
+                if(len == 8) {
+                  ies->ie_schedule_level_id = 1;
+                  ies->ie_schedule_level.level = buf[1];
+                  ies->ie_schedule_level.next_level = buf[2];
+                  ies->ie_schedule_level.switch_asn.ls4b = (uint32_t)buf[3];
+                  ies->ie_schedule_level.switch_asn.ls4b |= (uint32_t)buf[4] << 8;
+                  ies->ie_schedule_level.switch_asn.ls4b |= (uint32_t)buf[5] << 16;
+                  ies->ie_schedule_level.switch_asn.ls4b |= (uint32_t)buf[6] << 24;
+                  ies->ie_schedule_level.switch_asn.ms1b = buf[7];
+                } else {
+                  LOG_ERR("frame802154e: wrong schedule level IE len %u\n", len);
+                }
+                break;
+  #endif
+  #if TSCH_WITH_CHANNEL_MAP
+              case IETF_IE_CHANNEL_MAP:
+                if(len == 10) {
+                  ies->ie_channel_map_id = 1;
+                  READ16(buf + 1, ies->ie_channel_map.blacklist);
+                  READ16(buf + 3, ies->ie_channel_map.next_blacklist);
+                  ies->ie_channel_map.switch_asn.ls4b = (uint32_t)buf[5];
+                  ies->ie_channel_map.switch_asn.ls4b |= (uint32_t)buf[6] << 8;
+                  ies->ie_channel_map.switch_asn.ls4b |= (uint32_t)buf[7] << 16;
+                  ies->ie_channel_map.switch_asn.ls4b |= (uint32_t)buf[8] << 24;
+                  ies->ie_channel_map.switch_asn.ms1b = buf[9];
+                } else {
+                  LOG_ERR("frame802154e: wrong channel map IE len %u\n", len);
+                }
+                break;
   #endif
               default:
                 LOG_ERR("frame802154e: unsupported IETF sub-IE %u\n", *buf);
@@ -94,6 +94,16 @@ struct ieee802154_ies {
   const uint8_t *int_ie_content_ptr;
   uint16_t int_ie_content_len;
 #endif
+#if TSCH_WITH_SCHEDULE_LEVEL
+  /* Payload IETF IE, schedule level sub-IE */
+  uint8_t ie_schedule_level_id;
+  struct tsch_schedule_level ie_schedule_level;
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+#if TSCH_WITH_CHANNEL_MAP
+  /* Payload IETF IE, channel map sub-IE */
+  uint8_t ie_channel_map_id;
+  struct tsch_channel_map ie_channel_map;
+#endif /* TSCH_WITH_CHANNEL_MAP */
 };
 
 /** Insert various Information Elements **/
@@ -121,6 +131,16 @@ int frame80215e_create_ie_ietf(uint8_t *buf, int len,
 int frame80215e_create_ie_ietf_int(uint8_t *buf, int len,
     struct ieee802154_ies *ies);
 #endif /* TSCH_WITH_SIXTOP */
+#if TSCH_WITH_SCHEDULE_LEVEL
+/* Payload IE. IETF, schedule level sub-IE. Used in EBs: network-wide schedule level */
+int frame80215e_create_ie_ietf_schedule_level(uint8_t *buf, int len,
+    struct ieee802154_ies *ies);
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+#if TSCH_WITH_CHANNEL_MAP
+/* Payload IE. IETF, channel map sub-IE. Used in EBs: network-wide channel blacklist */
+int frame80215e_create_ie_ietf_channel_map(uint8_t *buf, int len,
+    struct ieee802154_ies *ies);
+#endif /* TSCH_WITH_CHANNEL_MAP */
 /* Payload IE. MLME. Used to nest sub-IEs */
 int frame80215e_create_ie_mlme(uint8_t *buf, int len,
     struct ieee802154_ies *ies);
@@ -48,11 +48,13 @@
 #include "lib/random.h"
 #include "net/mac/mac-sequence.h"
 #include "net/packetbuf.h"
+#include "net/nbr-table.h"
 
 struct seqno {
   linkaddr_t sender;
   clock_time_t timestamp;
   uint8_t seqno;
+  uint8_t in_use;
 };
 
 #ifdef NETSTACK_CONF_MAC_SEQNO_MAX_AGE
@@ -61,15 +63,65 @@ struct seqno {
 #define SEQNO_MAX_AGE (20 * CLOCK_SECOND)
 #endif /* NETSTACK_CONF_MAC_SEQNO_MAX_AGE */
 
+/* Number of senders whose last sequence number is kept: one per neighbor,
+ * and no less than the former global history of 16 */
 #ifdef NETSTACK_CONF_MAC_SEQNO_HISTORY
 #define MAX_SEQNOS NETSTACK_CONF_MAC_SEQNO_HISTORY
 #else /* NETSTACK_CONF_MAC_SEQNO_HISTORY */
-#define MAX_SEQNOS 16
+#define MAX_SEQNOS MAX(16, NBR_TABLE_MAX_NEIGHBORS)
 #endif /* NETSTACK_CONF_MAC_SEQNO_HISTORY */
+
+/* Senders are hashed into received_seqnos, and looked up in at most
+ * MAX_PROBES consecutive entries from their hash */
+#define MAX_PROBES MIN(8, MAX_SEQNOS)
+
 static struct seqno received_seqnos[MAX_SEQNOS];
 
 static uint8_t mac_dsn;
 
+/*---------------------------------------------------------------------------*/
+static unsigned
+sender_hash(const linkaddr_t *addr)
+{
+  unsigned hash = 0;
+  int i;
+
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    hash = hash * 31 + addr->u8[i];
+  }
+  return hash % MAX_SEQNOS;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_expired(const struct seqno *entry, clock_time_t now)
+{
+#if SEQNO_MAX_AGE > 0
+  return now - entry->timestamp > SEQNO_MAX_AGE;
+#else /* SEQNO_MAX_AGE > 0 */
+  return 0;
+#endif /* SEQNO_MAX_AGE > 0 */
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the entry of a sender, NULL if none */
+static struct seqno *
+lookup(const linkaddr_t *sender)
+{
+  unsigned index = sender_hash(sender);
+  int i;
+
+  for(i = 0; i < MAX_PROBES; i++) {
+    struct seqno *entry = &received_seqnos[index];
+    if(!entry->in_use) {
+      /* Entries are never freed, so the sender cannot be further */
+      return NULL;
+    }
+    if(linkaddr_cmp(sender, &entry->sender)) {
+      return entry;
+    }
+    index = (index + 1) % MAX_SEQNOS;
+  }
+  return NULL;
+}
 /*---------------------------------------------------------------------------*/
 void
 mac_sequence_init(void)
@@ -86,53 +138,49 @@ mac_sequence_set_dsn(void)
 int
 mac_sequence_is_duplicate(void)
 {
-  int i;
-  clock_time_t now = clock_time();
+  struct seqno *entry;
 
   /*
    * Check for duplicate packet by comparing the sequence number of the incoming
-   * packet with the last few ones we saw.
+   * packet with the last one we saw from the same sender.
    */
-  for(i = 0; i < MAX_SEQNOS; ++i) {
-    if(linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_SENDER),
-                    &received_seqnos[i].sender)) {
-      if(packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO) == received_seqnos[i].seqno) {
-#if SEQNO_MAX_AGE > 0
-        if(now - received_seqnos[i].timestamp <= SEQNO_MAX_AGE) {
-          /* Duplicate packet. */
-          return 1;
-        }
-#else /* SEQNO_MAX_AGE > 0 */
-        return 1;
-#endif /* SEQNO_MAX_AGE > 0 */
-      }
-      break;
-    }
-  }
-  return 0;
+  entry = lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  return entry != NULL
+         && packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO) == entry->seqno
+         && !is_expired(entry, clock_time());
 }
 /*---------------------------------------------------------------------------*/
 void
 mac_sequence_register_seqno(void)
 {
-  int i, j;
-
-  /* Locate possible previous sequence number for this address. */
-  for(i = 0; i < MAX_SEQNOS; ++i) {
-    if(linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_SENDER),
-                    &received_seqnos[i].sender)) {
-      i++;
-      break;
+  const linkaddr_t *sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  clock_time_t now = clock_time();
+  struct seqno *entry;
+
+  entry = lookup(sender);
+  if(entry == NULL) {
+    /* Take a free or expired entry, else the least recently updated one */
+    unsigned index = sender_hash(sender);
+    int i;
+
+    for(i = 0; i < MAX_PROBES; i++) {
+      struct seqno *candidate = &received_seqnos[index];
+      if(!candidate->in_use || is_expired(candidate, now)) {
+        entry = candidate;
+        break;
+      }
+      if(entry == NULL
+         || now - candidate->timestamp > now - entry->timestamp) {
+        entry = candidate;
+      }
+      index = (index + 1) % MAX_SEQNOS;
     }
+    linkaddr_copy(&entry->sender, sender);
+    entry->in_use = 1;
   }
 
   /* Keep the last sequence number for each address as per 802.15.4e. */
-  for(j = i - 1; j > 0; --j) {
-    memcpy(&received_seqnos[j], &received_seqnos[j - 1], sizeof(struct seqno));
-  }
-  received_seqnos[0].seqno = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
-  received_seqnos[0].timestamp = clock_time();
-  linkaddr_copy(&received_seqnos[0].sender,
-                packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  entry->seqno = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
+  entry->timestamp = now;
 }
 /*---------------------------------------------------------------------------*/
@@ -35,6 +35,10 @@
 
 #define INT_SUBIE_ID 0xCA
 
+/* #define this callback to get the channel and RSSI of every telemetry record
+ * a node receives, e.g. for network-wide channel selection (tsch-cs) */
+/* TSCH_CALLBACK_INT_TELEMETRY_INPUT(channel, rssi); */
+
 #ifdef TELEMETRY_CONF_COUNTER
 #define  INT_TELEMETRY_COUNTER  TELEMETRY_CONF_COUNTER
 #else
@@ -47,6 +47,14 @@ int input_save_telemetry_data(const uint8_t *buf, struct telemetry_model * telem
         telemetry_entry->channel_and_timestamp & 0x0FFF, 
         telemetry_entry->rssi
     );
+#ifdef TSCH_CALLBACK_INT_TELEMETRY_INPUT
+    {
+        /* Only the 4 LSBs of the channel are recorded; 2.4 GHz channels are 11..26 */
+        uint8_t hop_channel = telemetry_entry->channel_and_timestamp >> 12;
+        TSCH_CALLBACK_INT_TELEMETRY_INPUT(hop_channel < 11 ? hop_channel + 16 : hop_channel,
+                                          (int8_t)telemetry_entry->rssi);
+    }
+#endif /* TSCH_CALLBACK_INT_TELEMETRY_INPUT */
     #endif
 
 
@@ -0,0 +1,117 @@
+/**
+ * \file
+ *         TSCH adaptive beaconing. EBs are sent from a Trickle timer: the EB
+ *         interval doubles from TSCH_ADAPTIVE_EB_IMIN while the network is
+ *         stable, and is reset on inconsistencies (a node joining, a
+ *         desynchronization, a time source change). The keep-alive timeout
+ *         follows the same pattern: it doubles from TSCH_ADAPTIVE_KA_IMIN with
+ *         every acknowledged keep-alive, up to TSCH_ADAPTIVE_KA_IMAX, beyond
+ *         the regular keep-alive timeout.
+ */
+
+/**
+  * \addtogroup tsch
+  * @{
+*/
+
+#include "net/mac/tsch/tsch.h"
+#include "lib/trickle-timer.h"
+
+#include "sys/log.h"
+#define LOG_MODULE "TSCH"
+#define LOG_LEVEL LOG_LEVEL_MAC
+
+#if TSCH_ADAPTIVE_BEACONING
+
+/* Trickle timer scheduling EB transmissions */
+static struct trickle_timer eb_trickle;
+/* Number of keep-alive timeout doublings since the last inconsistency */
+static uint8_t ka_doublings;
+
+/*---------------------------------------------------------------------------*/
+static void
+eb_trickle_fired(void *ptr, uint8_t suppress)
+{
+  if(suppress == TRICKLE_TIMER_TX_OK) {
+    /* Time to send an EB */
+    process_poll(&tsch_send_eb_process);
+  } else {
+    LOG_DBG("adaptive beaconing: EB suppressed\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_adaptive_beaconing_init(void)
+{
+  trickle_timer_config(&eb_trickle, TSCH_ADAPTIVE_EB_IMIN,
+                       TSCH_ADAPTIVE_EB_IMAX, TSCH_ADAPTIVE_EB_REDUNDANCY);
+  ka_doublings = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_adaptive_beaconing_start(void)
+{
+  ka_doublings = 0;
+  if(TSCH_EB_PERIOD > 0) {
+    if(trickle_timer_is_running(&eb_trickle)) {
+      trickle_timer_reset_event(&eb_trickle);
+    } else {
+      trickle_timer_set(&eb_trickle, eb_trickle_fired, NULL);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_adaptive_beaconing_stop(void)
+{
+  trickle_timer_stop(&eb_trickle);
+  ka_doublings = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_adaptive_beaconing_inconsistency(const char *reason)
+{
+  if(!tsch_is_associated) {
+    return;
+  }
+  LOG_INFO("adaptive beaconing: reset, %s\n", reason);
+  ka_doublings = 0;
+  if(trickle_timer_is_running(&eb_trickle)) {
+    trickle_timer_inconsistency(&eb_trickle);
+  }
+  /* Reschedule the next keep-alive with the shortened timeout */
+  tsch_schedule_keepalive(0);
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_adaptive_beaconing_consistency(void)
+{
+  if(trickle_timer_is_running(&eb_trickle)) {
+    trickle_timer_consistency(&eb_trickle);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_adaptive_beaconing_keepalive_acked(void)
+{
+  if(((clock_time_t)TSCH_ADAPTIVE_KA_IMIN << ka_doublings) < TSCH_ADAPTIVE_KA_IMAX) {
+    ka_doublings++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+tsch_adaptive_beaconing_keepalive_timeout(clock_time_t ka_timeout)
+{
+  clock_time_t timeout = (clock_time_t)TSCH_ADAPTIVE_KA_IMIN << ka_doublings;
+  /* Once stable, stretch the regular timeout up to TSCH_ADAPTIVE_KA_IMAX */
+  return MIN(timeout, MAX(ka_timeout, TSCH_ADAPTIVE_KA_IMAX));
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+tsch_adaptive_beaconing_eb_interval(void)
+{
+  return eb_trickle.i_cur;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* TSCH_ADAPTIVE_BEACONING */
+/** @} */
@@ -0,0 +1,69 @@
+/**
+ * \addtogroup tsch
+ * @{
+ * \file
+ *	TSCH adaptive beaconing: EB period and keep-alive timeout adapted to
+ *	network stability, following the Trickle algorithm (RFC 6206)
+*/
+
+#ifndef TSCH_ADAPTIVE_BEACONING_H_
+#define TSCH_ADAPTIVE_BEACONING_H_
+
+/********** Includes **********/
+
+#include "contiki.h"
+
+/********** Functions *********/
+
+/**
+ * \brief Initialize the module, call once at startup
+ */
+void tsch_adaptive_beaconing_init(void);
+
+/**
+ * \brief Start adapting EB and keep-alive intervals, from their minimum,
+ * after joining or creating a network
+ */
+void tsch_adaptive_beaconing_start(void);
+
+/**
+ * \brief Stop sending EBs, after leaving the network
+ */
+void tsch_adaptive_beaconing_stop(void);
+
+/**
+ * \brief Reset EB and keep-alive intervals to their minimum, upon an event
+ * showing that the network is not stable (a node joining, a desynchronization,
+ * a time source change)
+ * \param reason A short description of the event, for logging
+ */
+void tsch_adaptive_beaconing_inconsistency(const char *reason);
+
+/**
+ * \brief Report an EB that makes ours redundant: consistent with our own
+ * state, from a neighbor with an equal or better join priority
+ */
+void tsch_adaptive_beaconing_consistency(void);
+
+/**
+ * \brief Report a keep-alive acknowledged by the time source. Stretches the
+ * keep-alive timeout.
+ */
+void tsch_adaptive_beaconing_keepalive_acked(void);
+
+/**
+ * \brief Get the keep-alive timeout to use
+ * \param ka_timeout The timeout in use without adaptive beaconing. Once the
+ * network is stable, the larger of it and TSCH_ADAPTIVE_KA_IMAX is used.
+ * \return The keep-alive timeout, in clock ticks
+ */
+clock_time_t tsch_adaptive_beaconing_keepalive_timeout(clock_time_t ka_timeout);
+
+/**
+ * \brief Get the current EB interval (Trickle interval)
+ * \return The current EB interval in clock ticks, 0 if not running
+ */
+clock_time_t tsch_adaptive_beaconing_eb_interval(void);
+
+#endif /* TSCH_ADAPTIVE_BEACONING_H_ */
+/** @} */
@@ -44,7 +44,9 @@
 */
 
 #include "net/mac/tsch/tsch.h"
+#include "net/link-stats.h"
 #include <stdio.h>
+#include <string.h>
 #include <inttypes.h>
 
 #if TSCH_ADAPTIVE_TIMESYNC
@@ -61,9 +63,25 @@ static uint32_t asn_since_last_learning;
 /* The last neighbor used for timesync */
 struct tsch_neighbor *last_timesource_neighbor;
 
+/* Size of the moving average of the time source drift */
+#define NUM_TIMESYNC_ENTRIES 8
+
 /* Units in which drift is stored: ppm * 256 */
 #define TSCH_DRIFT_UNIT (1000L * 1000 * 256)
 
+#if TSCH_ADAPTIVE_TIMESYNC_FUSION
+/* All the adjustments of the local clock so far: corrections from the time
+ * source and drift compensation. Adding it to an offset measured to a
+ * neighbor gives the offset to our free-running clock */
+static int32_t local_adjustment_ticks;
+/* Neighbor drift samples are only taken over at least this many slots,
+ * and the reference is renewed after this many */
+#define FUSION_MIN_DELTA_ASN (4 * TSCH_SLOTS_PER_SECOND)
+#define FUSION_MAX_DELTA_ASN (120 * TSCH_SLOTS_PER_SECOND)
+/* Samples taken into account for the weight of a neighbor */
+#define FUSION_MAX_WEIGHT_SAMPLES 8
+#endif /* TSCH_ADAPTIVE_TIMESYNC_FUSION */
+
 /*---------------------------------------------------------------------------*/
 long int
 tsch_adaptive_timesync_get_drift_ppm(void)
@@ -71,11 +89,11 @@ tsch_adaptive_timesync_get_drift_ppm(void)
   return (long int)drift_ppm / 256;
 }
 /*---------------------------------------------------------------------------*/
+#if !TSCH_ADAPTIVE_TIMESYNC_FUSION
 /* Add a value to a moving average estimator */
 static int32_t
 timesync_entry_add(int32_t val)
 {
-#define NUM_TIMESYNC_ENTRIES 8
   static int32_t buffer[NUM_TIMESYNC_ENTRIES];
   static uint8_t pos;
   int i;
@@ -116,11 +134,118 @@ timesync_learn_drift_ticks(uint32_t time_delta_asn, int32_t drift_ticks)
           tsch_adaptive_timesync_get_drift_ppm(),
           min_drift_seen, max_drift_seen));
 }
+#endif /* !TSCH_ADAPTIVE_TIMESYNC_FUSION */
+/*---------------------------------------------------------------------------*/
+#if TSCH_ADAPTIVE_TIMESYNC_FUSION
+/* Update the relative drift of a neighbor from a timing offset */
+static void
+fusion_learn(struct tsch_neighbor *n, int32_t offset_ticks)
+{
+  struct tsch_timesync_nbr *ts = &n->timesync;
+  int32_t offset = offset_ticks + local_adjustment_ticks;
+  uint32_t delta_asn;
+
+  if(ts->has_reference) {
+    delta_asn = TSCH_ASN_DIFF(tsch_current_asn, ts->last_asn);
+    if(delta_asn < FUSION_MIN_DELTA_ASN) {
+      /* Too short to be accurate, keep the older reference */
+      return;
+    }
+    if(delta_asn <= FUSION_MAX_DELTA_ASN) {
+      int32_t delta_ticks = delta_asn * tsch_timing[tsch_ts_timeslot_length];
+      int32_t drift_ppm = (int32_t)(((int64_t)(offset - ts->last_offset) * TSCH_DRIFT_UNIT) / delta_ticks);
+      if(ts->num_samples == 0) {
+        ts->drift_ppm = drift_ppm;
+      } else {
+        /* EWMA with alpha = 0.25 */
+        ts->drift_ppm = (ts->drift_ppm * 3 + drift_ppm) / 4;
+      }
+      if(ts->num_samples < 0xff) {
+        ts->num_samples++;
+      }
+    }
+  }
+  ts->last_asn = tsch_current_asn;
+  ts->last_offset = offset;
+  ts->has_reference = 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Weight of a neighbor's drift estimate: the more samples and the better the
+ * link, the higher. The time source counts double */
+static uint32_t
+fusion_weight(struct tsch_neighbor *n)
+{
+  const struct link_stats *stats = link_stats_from_lladdr(tsch_queue_get_nbr_address(n));
+  uint32_t etx = LINK_STATS_ETX_DIVISOR * 2;
+  uint32_t weight;
+
+  if(stats != NULL && stats->etx > 0) {
+    etx = MAX(stats->etx, LINK_STATS_ETX_DIVISOR);
+  }
+  weight = MIN(n->timesync.num_samples, FUSION_MAX_WEIGHT_SAMPLES)
+    * (LINK_STATS_ETX_DIVISOR * 16) / etx;
+  return n->is_time_source ? 2 * weight : weight;
+}
+/*---------------------------------------------------------------------------*/
+/* Fuse the relative drifts of all neighbors into our drift estimate */
+static void
+fusion_update(void)
+{
+  struct tsch_neighbor *n;
+  int64_t sum = 0;
+  uint32_t total_weight = 0;
+  uint16_t total_samples = 0;
+
+  for(n = tsch_queue_first_nbr(); n != NULL; n = tsch_queue_next_nbr(n)) {
+    uint32_t weight;
+    if(n->is_broadcast || n->timesync.num_samples == 0) {
+      continue;
+    }
+    weight = fusion_weight(n);
+    sum += (int64_t)n->timesync.drift_ppm * weight;
+    total_weight += weight;
+    total_samples += n->timesync.num_samples;
+  }
+
+  if(total_weight > 0) {
+    drift_ppm = (int32_t)(sum / total_weight);
+    if(total_samples >= NUM_TIMESYNC_ENTRIES
+       && timesync_entry_count < NUM_TIMESYNC_ENTRIES) {
+      /* We now have accurate drift compensation.
+       * Increase keep-alive timeout. */
+      timesync_entry_count = NUM_TIMESYNC_ENTRIES;
+      tsch_set_ka_timeout(TSCH_MAX_KEEPALIVE_TIMEOUT);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_timesync_neighbor_offset(struct tsch_neighbor *n, int32_t offset_ticks)
+{
+  if(n != NULL && !n->is_broadcast) {
+    fusion_learn(n, offset_ticks);
+  }
+}
+#endif /* TSCH_ADAPTIVE_TIMESYNC_FUSION */
 /*---------------------------------------------------------------------------*/
 /* Either reset or update the neighbor's drift */
 void
 tsch_timesync_update(struct tsch_neighbor *n, uint16_t time_delta_asn, int32_t drift_correction)
 {
+#if TSCH_ADAPTIVE_TIMESYNC_FUSION
+  /* The estimates of all neighbors survive a time source switch */
+  if(n != last_timesource_neighbor && timesync_entry_count >= NUM_TIMESYNC_ENTRIES) {
+    /* The drift is known already, keep the long keep-alive timeout */
+    tsch_set_ka_timeout(TSCH_MAX_KEEPALIVE_TIMEOUT);
+  }
+  last_timesource_neighbor = n;
+  if(n != NULL) {
+    fusion_learn(n, drift_correction);
+    fusion_update();
+  }
+  /* The correction is applied to the local clock */
+  local_adjustment_ticks += drift_correction;
+#else /* TSCH_ADAPTIVE_TIMESYNC_FUSION */
   /* Account the drift if either this is a new timesource,
    * or the timedelta is not too small, as smaller timedelta
    * means proportionally larger measurement error. */
@@ -138,6 +263,7 @@ tsch_timesync_update(struct tsch_neighbor *n, uint16_t time_delta_asn, int32_t d
       compensated_ticks += drift_correction;
     }
   }
+#endif /* TSCH_ADAPTIVE_TIMESYNC_FUSION */
   min_drift_seen = MIN(drift_correction, min_drift_seen);
   max_drift_seen = MAX(drift_correction, max_drift_seen);
 }
@@ -189,6 +315,10 @@ tsch_timesync_adaptive_compensate(rtimer_clock_t time_delta_ticks)
         &base_drift_remainder, &base_drift_tick_conversion_error);
   }
 
+#if TSCH_ADAPTIVE_TIMESYNC_FUSION
+  local_adjustment_ticks += result;
+#endif /* TSCH_ADAPTIVE_TIMESYNC_FUSION */
+
   return result;
 }
 /*---------------------------------------------------------------------------*/
@@ -200,6 +330,15 @@ tsch_adaptive_timesync_reset(void)
   timesync_entry_count = 0;
   compensated_ticks = 0;
   asn_since_last_learning = 0;
+#if TSCH_ADAPTIVE_TIMESYNC_FUSION
+  {
+    struct tsch_neighbor *n;
+    for(n = tsch_queue_first_nbr(); n != NULL; n = tsch_queue_next_nbr(n)) {
+      memset(&n->timesync, 0, sizeof(n->timesync));
+    }
+    local_adjustment_ticks = 0;
+  }
+#endif /* TSCH_ADAPTIVE_TIMESYNC_FUSION */
 }
 /*---------------------------------------------------------------------------*/
 #else /* TSCH_ADAPTIVE_TIMESYNC */
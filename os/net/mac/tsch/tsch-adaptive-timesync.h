@@ -54,6 +54,18 @@
  */
 void tsch_timesync_update(struct tsch_neighbor *n, uint16_t time_delta_asn, int32_t drift_correction);
 
+#if TSCH_ADAPTIVE_TIMESYNC && TSCH_ADAPTIVE_TIMESYNC_FUSION
+/**
+ * \brief Accounts for a timing offset measured to a neighbor other than the
+ * time source, for multi-neighbor drift fusion
+ * \param n The neighbor
+ * \param offset_ticks The correction that would synchronize us to the neighbor
+ */
+void tsch_timesync_neighbor_offset(struct tsch_neighbor *n, int32_t offset_ticks);
+#else
+#define tsch_timesync_neighbor_offset(n, offset_ticks)
+#endif
+
 /**
  * \brief Computes time compensation for a given point in the future
  * \param delta_ticks The number of ticks in the future we want to calculate compensation for
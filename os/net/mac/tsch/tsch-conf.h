@@ -91,6 +91,57 @@
 #define TSCH_MAX_EB_PERIOD (16 * CLOCK_SECOND)
 #endif
 
+/* Adaptive beaconing: send EBs from a Trickle timer (RFC 6206) instead of
+ * periodically, and adapt the keep-alive timeout the same way. Intervals start
+ * short after joining, grow while the network is stable, and are reset upon a
+ * node joining, a keep-alive failure, or a time source change. */
+#ifdef TSCH_CONF_ADAPTIVE_BEACONING
+#define TSCH_ADAPTIVE_BEACONING TSCH_CONF_ADAPTIVE_BEACONING
+#else
+#define TSCH_ADAPTIVE_BEACONING 0
+#endif
+
+/* With TSCH_ADAPTIVE_BEACONING: minimum EB interval (Trickle Imin) */
+#ifdef TSCH_CONF_ADAPTIVE_EB_IMIN
+#define TSCH_ADAPTIVE_EB_IMIN TSCH_CONF_ADAPTIVE_EB_IMIN
+#else
+#define TSCH_ADAPTIVE_EB_IMIN (TSCH_EB_PERIOD / 4)
+#endif
+
+/* With TSCH_ADAPTIVE_BEACONING: number of doublings of the EB interval
+ * (Trickle Imax). The maximum EB interval is TSCH_ADAPTIVE_EB_IMIN * 2^IMAX. */
+#ifdef TSCH_CONF_ADAPTIVE_EB_IMAX
+#define TSCH_ADAPTIVE_EB_IMAX TSCH_CONF_ADAPTIVE_EB_IMAX
+#else
+#define TSCH_ADAPTIVE_EB_IMAX 4
+#endif
+
+/* With TSCH_ADAPTIVE_BEACONING: redundancy constant (Trickle k). An EB is
+ * suppressed after hearing this many consistent EBs within the interval,
+ * from neighbors with an equal or lower join priority. */
+#ifdef TSCH_CONF_ADAPTIVE_EB_REDUNDANCY
+#define TSCH_ADAPTIVE_EB_REDUNDANCY TSCH_CONF_ADAPTIVE_EB_REDUNDANCY
+#else
+#define TSCH_ADAPTIVE_EB_REDUNDANCY 3
+#endif
+
+/* With TSCH_ADAPTIVE_BEACONING: keep-alive timeout after an inconsistency.
+ * Doubles with every acknowledged keep-alive, up to TSCH_ADAPTIVE_KA_IMAX. */
+#ifdef TSCH_CONF_ADAPTIVE_KA_IMIN
+#define TSCH_ADAPTIVE_KA_IMIN TSCH_CONF_ADAPTIVE_KA_IMIN
+#else
+#define TSCH_ADAPTIVE_KA_IMIN (TSCH_KEEPALIVE_TIMEOUT / 4)
+#endif
+
+/* With TSCH_ADAPTIVE_BEACONING: keep-alive timeout once the network is
+ * stable. Leaves time for a keep-alive and its retries before reaching
+ * the desynchronization threshold. */
+#ifdef TSCH_CONF_ADAPTIVE_KA_IMAX
+#define TSCH_ADAPTIVE_KA_IMAX TSCH_CONF_ADAPTIVE_KA_IMAX
+#else
+#define TSCH_ADAPTIVE_KA_IMAX MIN(TSCH_MAX_KEEPALIVE_TIMEOUT, TSCH_DESYNC_THRESHOLD / 2)
+#endif
+
 /* Use SFD timestamp for synchronization? By default we merely rely on rtimer and busy wait
  * until SFD is high, which we found to provide greater accuracy on JN516x and CC2420.
  * Note: for association, however, we always use SFD timestamp to know the time of arrival
@@ -125,6 +176,52 @@
 #define TSCH_ADAPTIVE_TIMESYNC 1
 #endif
 
+/* With TSCH_ADAPTIVE_TIMESYNC enabled: estimate the drift from the timing
+ * offsets of all neighbors (ACKs and received frames), not only the time
+ * source. Every neighbor keeps its own relative drift estimate, so that a
+ * time source switch does not restart learning */
+#ifdef TSCH_CONF_ADAPTIVE_TIMESYNC_FUSION
+#define TSCH_ADAPTIVE_TIMESYNC_FUSION TSCH_CONF_ADAPTIVE_TIMESYNC_FUSION
+#else
+#define TSCH_ADAPTIVE_TIMESYNC_FUSION 0
+#endif
+
+/* Adapt the Rx guard time of every link with a unicast neighbor address
+ * to the timing offsets measured with that neighbor (received frames and
+ * time correction IEs of its ACKs), instead of always listening for the
+ * full TSCH_CONF_RX_WAIT. Shared links to the broadcast address keep the
+ * full guard time */
+#ifdef TSCH_CONF_ADAPTIVE_GUARD_TIME
+#define TSCH_ADAPTIVE_GUARD_TIME TSCH_CONF_ADAPTIVE_GUARD_TIME
+#else
+#define TSCH_ADAPTIVE_GUARD_TIME 0
+#endif
+
+/* With TSCH_ADAPTIVE_GUARD_TIME: the smallest half guard time (us) */
+#ifdef TSCH_CONF_GUARD_TIME_MIN
+#define TSCH_GUARD_TIME_MIN TSCH_CONF_GUARD_TIME_MIN
+#else
+#define TSCH_GUARD_TIME_MIN 300
+#endif
+
+/* With TSCH_ADAPTIVE_GUARD_TIME: the worst-case relative drift between two
+ * neighbors (ppm), used to widen the guard time with the time elapsed since
+ * the last offset measured with the neighbor */
+#ifdef TSCH_CONF_GUARD_TIME_DRIFT_PPM
+#define TSCH_GUARD_TIME_DRIFT_PPM TSCH_CONF_GUARD_TIME_DRIFT_PPM
+#else
+#define TSCH_GUARD_TIME_DRIFT_PPM 40
+#endif
+
+/* With TSCH_ADAPTIVE_GUARD_TIME: the number of consecutive idle Rx slots
+ * with a narrowed guard time after which the guard time is doubled, in
+ * case frames of the neighbor fell outside of it */
+#ifdef TSCH_CONF_GUARD_TIME_MAX_IDLE
+#define TSCH_GUARD_TIME_MAX_IDLE TSCH_CONF_GUARD_TIME_MAX_IDLE
+#else
+#define TSCH_GUARD_TIME_MAX_IDLE 8
+#endif
+
 /* An ad-hoc mechanism to have TSCH select its time source without the
  * help of an upper-layer, simply by collecting statistics on received
  * EBs and their join priority. Disabled by default as we recomment
@@ -225,6 +322,56 @@
 #define TSCH_CHANNEL_SCAN_DURATION CLOCK_SECOND
 #endif
 
+/* Fast join: keep a record of the network (saved in CFS), and when scanning
+ * again, predict the channel on which the last time source sends EBs.
+ * Also skips channels on which no activity was sensed. Requires CFS. */
+#ifdef TSCH_CONF_FAST_JOIN
+#define TSCH_FAST_JOIN TSCH_CONF_FAST_JOIN
+#else
+#define TSCH_FAST_JOIN 0
+#endif
+
+/* With TSCH_FAST_JOIN: does clock_time() keep running across reboots
+ * (e.g. RTC-backed)? If not, the ASN is only predicted after a desynchronization,
+ * not after a reboot. */
+#ifdef TSCH_CONF_FAST_JOIN_PERSISTENT_CLOCK
+#define TSCH_FAST_JOIN_PERSISTENT_CLOCK TSCH_CONF_FAST_JOIN_PERSISTENT_CLOCK
+#else
+#define TSCH_FAST_JOIN_PERSISTENT_CLOCK 0
+#endif
+
+/* With TSCH_FAST_JOIN: max age of the network record to predict the ASN.
+ * The prediction needs the drift over this time to stay within half the EB slotframe. */
+#ifdef TSCH_CONF_FAST_JOIN_MAX_AGE
+#define TSCH_FAST_JOIN_MAX_AGE TSCH_CONF_FAST_JOIN_MAX_AGE
+#else
+#define TSCH_FAST_JOIN_MAX_AGE (10 * 60 * CLOCK_SECOND)
+#endif
+
+/* With TSCH_FAST_JOIN: how long to follow the predicted EB channel before
+ * falling back to scanning at random */
+#ifdef TSCH_CONF_FAST_JOIN_PREDICTION_DURATION
+#define TSCH_FAST_JOIN_PREDICTION_DURATION TSCH_CONF_FAST_JOIN_PREDICTION_DURATION
+#else
+#define TSCH_FAST_JOIN_PREDICTION_DURATION (2 * TSCH_MAX_EB_PERIOD)
+#endif
+
+/* With TSCH_FAST_JOIN: min period between two saves of the network record in CFS */
+#ifdef TSCH_CONF_FAST_JOIN_SAVE_PERIOD
+#define TSCH_FAST_JOIN_SAVE_PERIOD TSCH_CONF_FAST_JOIN_SAVE_PERIOD
+#else
+#define TSCH_FAST_JOIN_SAVE_PERIOD (5 * 60 * CLOCK_SECOND)
+#endif
+
+/* With TSCH_FAST_JOIN: number of consecutive scans of a channel without any
+ * activity (CCA busy or frame) after which the channel is skipped.
+ * 0 disables skipping. */
+#ifdef TSCH_CONF_FAST_JOIN_DEAD_CHANNEL_SCANS
+#define TSCH_FAST_JOIN_DEAD_CHANNEL_SCANS TSCH_CONF_FAST_JOIN_DEAD_CHANNEL_SCANS
+#else
+#define TSCH_FAST_JOIN_DEAD_CHANNEL_SCANS 3
+#endif
+
 /* TSCH EB: include timeslot timing Information Element? */
 #ifdef TSCH_PACKET_CONF_EB_WITH_TIMESLOT_TIMING
 #define TSCH_PACKET_EB_WITH_TIMESLOT_TIMING TSCH_PACKET_CONF_EB_WITH_TIMESLOT_TIMING
@@ -325,13 +472,79 @@
 
 /* Set an upper bound on burst length. Set to 0 to never set the frame pending
  * bit, i.e., never trigger a burst. Note that receiver-side support for burst
- * is always enabled, as it is part of IEEE 802.1.5.4-2015 (Section 7.2.1.3)*/
+ * is always enabled, as it is part of IEEE 802.1.5.4-2015 (Section 7.2.1.3).
+ * This is the default for every neighbor; it can be changed per neighbor
+ * at run-time with tsch_queue_set_nbr_burst_max_len() */
 #ifdef TSCH_CONF_BURST_MAX_LEN
 #define TSCH_BURST_MAX_LEN TSCH_CONF_BURST_MAX_LEN
 #else
 #define TSCH_BURST_MAX_LEN 0
 #endif
 
+/* Only extend a burst into the next timeslot if no link is scheduled there,
+ * so that a burst never steals a cell reserved in any slotframe. Checked
+ * by both the sender and the receiver, each against its own schedule. */
+#ifdef TSCH_CONF_BURST_ONLY_IN_FREE_SLOTS
+#define TSCH_BURST_ONLY_IN_FREE_SLOTS TSCH_CONF_BURST_ONLY_IN_FREE_SLOTS
+#else
+#define TSCH_BURST_ONLY_IN_FREE_SLOTS 1
+#endif
+
+/* The receiver confirms that it will listen in the next timeslot by setting
+ * the frame pending bit in the EACK. When enabled, the sender continues the
+ * burst only upon such a confirmation. Implementations that do not set the
+ * frame pending bit in EACKs never confirm, so enable only if all nodes of
+ * the network do. */
+#ifdef TSCH_CONF_BURST_ACK_CONFIRMATION
+#define TSCH_BURST_ACK_CONFIRMATION TSCH_CONF_BURST_ACK_CONFIRMATION
+#else
+#define TSCH_BURST_ACK_CONFIRMATION 0
+#endif
+
+/* Build the frame of the next Tx slot ahead of time: as soon as the next
+ * active link is known, the frame pending bit, EB Sync-IE and link-layer
+ * security are applied outside of the slot critical path, so that the Tx slot
+ * only copies the frame to the radio and transmits it. The in-slot path
+ * is used as fallback whenever the pre-built frame is stale. */
+#ifdef TSCH_CONF_WITH_PRESTAGING
+#define TSCH_WITH_PRESTAGING TSCH_CONF_WITH_PRESTAGING
+#else
+#define TSCH_WITH_PRESTAGING 0
+#endif
+
+/* Minimum time left before the start of the next slot for the next frame to
+ * be built ahead of time, in rtimer ticks. Must cover the worst-case duration
+ * of building and securing a frame on the platform. */
+#ifdef TSCH_CONF_PRESTAGING_MIN_MARGIN
+#define TSCH_PRESTAGING_MIN_MARGIN TSCH_CONF_PRESTAGING_MIN_MARGIN
+#else
+#define TSCH_PRESTAGING_MIN_MARGIN US_TO_RTIMERTICKS(2000)
+#endif
+
+/* Detect duplicate frames with a sliding window of the last
+ * TSCH_DUPLICATE_WINDOW_SIZE sequence numbers of every sender, instead of the
+ * global history of mac-sequence.c */
+#ifdef TSCH_CONF_WITH_DUPLICATE_WINDOW
+#define TSCH_WITH_DUPLICATE_WINDOW TSCH_CONF_WITH_DUPLICATE_WINDOW
+#else
+#define TSCH_WITH_DUPLICATE_WINDOW 0
+#endif
+
+/* Number of sequence numbers of the duplicate window. At most 32 */
+#ifdef TSCH_CONF_DUPLICATE_WINDOW_SIZE
+#define TSCH_DUPLICATE_WINDOW_SIZE TSCH_CONF_DUPLICATE_WINDOW_SIZE
+#else
+#define TSCH_DUPLICATE_WINDOW_SIZE 32
+#endif
+
+/* Time after which the duplicate window of a silent sender is forgotten,
+ * in clock ticks */
+#ifdef TSCH_CONF_DUPLICATE_WINDOW_MAX_AGE
+#define TSCH_DUPLICATE_WINDOW_MAX_AGE TSCH_CONF_DUPLICATE_WINDOW_MAX_AGE
+#else
+#define TSCH_DUPLICATE_WINDOW_MAX_AGE (20 * CLOCK_SECOND)
+#endif
+
 /* 6TiSCH Minimal schedule slotframe length */
 #ifdef TSCH_SCHEDULE_CONF_DEFAULT_LENGTH
 #define TSCH_SCHEDULE_DEFAULT_LENGTH TSCH_SCHEDULE_CONF_DEFAULT_LENGTH
@@ -367,6 +580,35 @@
 #define TSCH_WITH_INT 0
 #endif
 
+/* Include the schedule level in EBs: a network-wide level set by the PAN
+ * coordinator and relayed by all nodes, along with the ASN from which the
+ * next level applies. Lets a scheduler switch all schedules in sync
+ * (e.g. Orchestra, which scales its slotframe lengths with the level) */
+#ifdef TSCH_CONF_WITH_SCHEDULE_LEVEL
+#define TSCH_WITH_SCHEDULE_LEVEL TSCH_CONF_WITH_SCHEDULE_LEVEL
+#else
+#define TSCH_WITH_SCHEDULE_LEVEL 0
+#endif
+
+/* IETF IE Sub-ID of the schedule level IE */
+#define TSCH_SCHEDULE_LEVEL_SUBIE_ID 0xCB
+
+/* Include the channel map in EBs: a network-wide channel blacklist set by
+ * the PAN coordinator and relayed by all nodes, along with the ASN from which
+ * the next blacklist applies. Blacklisted channels of the hopping sequence are
+ * replaced with the remaining ones, so that all nodes avoid them in sync */
+#ifdef TSCH_CONF_WITH_CHANNEL_MAP
+#define TSCH_WITH_CHANNEL_MAP TSCH_CONF_WITH_CHANNEL_MAP
+#else
+#define TSCH_WITH_CHANNEL_MAP 0
+#endif
+
+/* IETF IE Sub-ID of the channel map IE */
+#define TSCH_CHANNEL_MAP_SUBIE_ID 0xCC
+
+/* The channel of bit 0 in a channel map */
+#define TSCH_CHANNEL_MAP_FIRST_CHANNEL 11
+
 /* A custom feature allowing upper layers to assign packets to
  * a specific slotframe and link */
 #ifdef TSCH_CONF_WITH_LINK_SELECTOR
@@ -0,0 +1,107 @@
+/**
+ * \file
+ *         TSCH duplicate detection. Every sender gets a sliding window of its
+ *         last TSCH_DUPLICATE_WINDOW_SIZE sequence numbers, so that late
+ *         retransmissions are detected too. Windows are kept in a neighbor
+ *         table of their own, looked up from the sender address, and are
+ *         forgotten after TSCH_DUPLICATE_WINDOW_MAX_AGE without frames from
+ *         their sender.
+ */
+
+/**
+  * \addtogroup tsch
+  * @{
+*/
+
+#include "net/mac/tsch/tsch.h"
+#include "net/packetbuf.h"
+#include "net/nbr-table.h"
+
+#include "sys/log.h"
+#define LOG_MODULE "TSCH"
+#define LOG_LEVEL LOG_LEVEL_MAC
+
+#if TSCH_WITH_DUPLICATE_WINDOW
+
+/* Sequence numbers received from a sender */
+struct tsch_duplicate_window {
+  clock_time_t last_time; /* Time of the last frame */
+  uint32_t bitmap; /* Bit i set: last_seqno - i was received */
+  uint8_t last_seqno; /* Most recent sequence number */
+  uint8_t is_valid; /* Was any frame received yet? */
+};
+NBR_TABLE(struct tsch_duplicate_window, duplicate_windows);
+
+/*---------------------------------------------------------------------------*/
+/* Is a window recent enough to be used? */
+static int
+window_is_valid(const struct tsch_duplicate_window *w)
+{
+  return w->is_valid
+         && clock_time() - w->last_time <= TSCH_DUPLICATE_WINDOW_MAX_AGE;
+}
+/*---------------------------------------------------------------------------*/
+/* Record a sequence number in the window of its sender */
+static void
+window_register(struct tsch_duplicate_window *w, uint8_t seqno)
+{
+  uint8_t ahead = seqno - w->last_seqno;
+  uint8_t age = w->last_seqno - seqno;
+
+  if(!window_is_valid(w)) {
+    /* Start a new window */
+    w->bitmap = 1;
+    w->last_seqno = seqno;
+  } else if(ahead > 0 && ahead < 128) {
+    /* Newer frame: slide the window */
+    w->bitmap = ahead < TSCH_DUPLICATE_WINDOW_SIZE ? (w->bitmap << ahead) | 1 : 1;
+    w->last_seqno = seqno;
+  } else if(age < TSCH_DUPLICATE_WINDOW_SIZE) {
+    /* Late frame within the window */
+    w->bitmap |= (uint32_t)1 << age;
+  } else {
+    /* Far behind the window: the sender restarted its sequence */
+    w->bitmap = 1;
+    w->last_seqno = seqno;
+  }
+  w->last_time = clock_time();
+  w->is_valid = 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_duplicate_window_init(void)
+{
+  nbr_table_register(duplicate_windows, NULL);
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_duplicate_window_check(void)
+{
+  const linkaddr_t *sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  uint8_t seqno = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
+  struct tsch_duplicate_window *w;
+  uint8_t age;
+
+  w = nbr_table_get_from_lladdr(duplicate_windows, sender);
+  if(w == NULL) {
+    w = nbr_table_add_lladdr(duplicate_windows, sender, NBR_TABLE_REASON_MAC, NULL);
+    if(w == NULL) {
+      LOG_WARN("! no duplicate window for ");
+      LOG_WARN_LLADDR(sender);
+      LOG_WARN_("\n");
+      return 0;
+    }
+  }
+
+  age = w->last_seqno - seqno;
+  if(window_is_valid(w)
+     && age < TSCH_DUPLICATE_WINDOW_SIZE
+     && (w->bitmap & ((uint32_t)1 << age))) {
+    return 1;
+  }
+  window_register(w, seqno);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* TSCH_WITH_DUPLICATE_WINDOW */
+/** @} */
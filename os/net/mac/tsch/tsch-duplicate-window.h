@@ -0,0 +1,31 @@
+/**
+ * \addtogroup tsch
+ * @{
+ * \file
+ *	TSCH duplicate detection with a sliding window of the last sequence
+ *	numbers of every sender, kept in a neighbor table
+*/
+
+#ifndef TSCH_DUPLICATE_WINDOW_H_
+#define TSCH_DUPLICATE_WINDOW_H_
+
+/********** Includes **********/
+
+#include "contiki.h"
+
+/********** Functions *********/
+
+/**
+ * \brief Initialize the module, call once at startup
+ */
+void tsch_duplicate_window_init(void);
+
+/**
+ * \brief Is the frame in packetbuf a duplicate? If not, record its sequence
+ * number in the window of its sender
+ * \return 1 if the frame is a duplicate, 0 otherwise
+ */
+int tsch_duplicate_window_check(void);
+
+#endif /* TSCH_DUPLICATE_WINDOW_H_ */
+/** @} */
@@ -0,0 +1,322 @@
+/**
+ * \file
+ *         TSCH fast join. While associated, the node keeps a record of the
+ *         network: a reference ASN and the local time it was observed at, the
+ *         hopping sequence, and the cell in which its time source sends EBs.
+ *         The record is saved in CFS. When scanning again (after a
+ *         desynchronization, or after a reboot with TSCH_FAST_JOIN_PERSISTENT_CLOCK),
+ *         the current ASN is extrapolated from the elapsed time, and the node
+ *         follows the channel of the time source's EB cell. This only requires
+ *         the local time to be accurate within half the EB slotframe.
+ *         Otherwise, the node scans channels at random, skipping channels on
+ *         which no activity was sensed during the last scans.
+ */
+
+/**
+  * \addtogroup tsch
+  * @{
+*/
+
+#include "net/mac/tsch/tsch.h"
+#include "cfs/cfs.h"
+#include "lib/random.h"
+#include <string.h>
+
+#include "sys/log.h"
+#define LOG_MODULE "TSCH"
+#define LOG_LEVEL LOG_LEVEL_MAC
+
+#if TSCH_FAST_JOIN
+
+#define TSCH_FAST_JOIN_FILENAME "tsch-join"
+#define TSCH_FAST_JOIN_RECORD_VERSION 1
+
+/* The network state saved in CFS */
+struct tsch_fast_join_record {
+  uint8_t version;
+  /* Last time source */
+  linkaddr_t time_source;
+  /* ASN at ref_time */
+  struct tsch_asn_t asn;
+  clock_time_t ref_time;
+  uint16_t timeslot_length_us;
+  /* EB cell of the time source */
+  uint16_t eb_slotframe_len;
+  uint16_t eb_timeslot;
+  uint16_t eb_channel_offset;
+  /* Channel the last EB was received on */
+  uint8_t last_channel;
+  uint8_t hopping_sequence_len;
+  uint8_t hopping_sequence[TSCH_HOPPING_SEQUENCE_MAX_LEN];
+};
+
+static struct tsch_fast_join_record record;
+/* Is record valid? */
+static uint8_t record_valid;
+/* Are record.asn and record.ref_time usable to predict the current ASN? */
+static uint8_t record_time_valid;
+/* Is the record saved since associating? */
+static uint8_t record_saved;
+static clock_time_t last_save_time;
+
+/* Predicting channels since tracking_start */
+static uint8_t is_tracking;
+static clock_time_t tracking_start;
+
+/* Consecutive scans without activity, per channel of TSCH_JOIN_HOPPING_SEQUENCE */
+static uint8_t silent_scans[sizeof(TSCH_JOIN_HOPPING_SEQUENCE)];
+/* Activity sensed on the channel currently scanned? */
+static uint8_t activity_sensed;
+/* Try the channel of the last EB first */
+static uint8_t try_last_channel;
+
+/*---------------------------------------------------------------------------*/
+static void
+save_record(void)
+{
+  int fd;
+
+  cfs_remove(TSCH_FAST_JOIN_FILENAME);
+  fd = cfs_open(TSCH_FAST_JOIN_FILENAME, CFS_WRITE);
+  if(fd < 0) {
+    LOG_WARN("fast join: could not open file\n");
+    return;
+  }
+  if(cfs_write(fd, &record, sizeof(record)) != sizeof(record)) {
+    LOG_WARN("fast join: could not save network state\n");
+  }
+  cfs_close(fd);
+  record_saved = 1;
+  last_save_time = clock_time();
+}
+/*---------------------------------------------------------------------------*/
+static void
+load_record(void)
+{
+  int fd;
+
+  fd = cfs_open(TSCH_FAST_JOIN_FILENAME, CFS_READ);
+  if(fd < 0) {
+    return;
+  }
+  if(cfs_read(fd, &record, sizeof(record)) == sizeof(record)
+     && record.version == TSCH_FAST_JOIN_RECORD_VERSION
+     && record.hopping_sequence_len > 0
+     && record.hopping_sequence_len <= TSCH_HOPPING_SEQUENCE_MAX_LEN
+     && record.eb_slotframe_len > 0
+     && record.timeslot_length_us > 0) {
+    record_valid = 1;
+    /* The reference time is meaningless after a reboot, unless the clock
+     * kept running */
+    record_time_valid = TSCH_FAST_JOIN_PERSISTENT_CLOCK;
+    try_last_channel = 1;
+    LOG_INFO("fast join: loaded network state, asn-%x.%"PRIx32", time source ",
+             record.asn.ms1b, record.asn.ls4b);
+    LOG_INFO_LLADDR(&record.time_source);
+    LOG_INFO_("\n");
+  }
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+/* Predict the channel of the time source's EB cell closest to now */
+static uint8_t
+predict_channel(clock_time_t now)
+{
+  struct tsch_asn_t asn = record.asn;
+  struct tsch_asn_divisor_t sf_len;
+  struct tsch_asn_divisor_t hs_len;
+  uint64_t elapsed_us;
+  uint16_t offset;
+  uint16_t index;
+
+  /* Extrapolate the current ASN */
+  elapsed_us = (uint64_t)(now - record.ref_time) * 1000000 / CLOCK_SECOND;
+  TSCH_ASN_INC(asn, (uint32_t)((elapsed_us + record.timeslot_length_us / 2)
+                               / record.timeslot_length_us));
+
+  /* Move to the closest EB cell */
+  TSCH_ASN_DIVISOR_INIT(sf_len, record.eb_slotframe_len);
+  offset = (record.eb_timeslot + sf_len.val - TSCH_ASN_MOD(asn, sf_len)) % sf_len.val;
+  if(offset <= sf_len.val / 2) {
+    TSCH_ASN_INC(asn, offset);
+  } else {
+    TSCH_ASN_DEC(asn, sf_len.val - offset);
+  }
+
+  TSCH_ASN_DIVISOR_INIT(hs_len, record.hopping_sequence_len);
+  index = (TSCH_ASN_MOD(asn, hs_len) + record.eb_channel_offset) % hs_len.val;
+  return record.hopping_sequence[index];
+}
+/*---------------------------------------------------------------------------*/
+/* Pick a channel at random in TSCH_JOIN_HOPPING_SEQUENCE, skipping dead channels */
+static uint8_t
+pick_channel(void)
+{
+  int i;
+  int alive_count = 0;
+  int pick;
+
+  if(try_last_channel) {
+    try_last_channel = 0;
+    if(record.last_channel != 0) {
+      return record.last_channel;
+    }
+  }
+
+  for(i = 0; i < sizeof(TSCH_JOIN_HOPPING_SEQUENCE); i++) {
+    if(TSCH_FAST_JOIN_DEAD_CHANNEL_SCANS == 0
+       || silent_scans[i] < TSCH_FAST_JOIN_DEAD_CHANNEL_SCANS) {
+      alive_count++;
+    }
+  }
+  if(alive_count == 0) {
+    /* All channels found dead, give them all another chance */
+    memset(silent_scans, 0, sizeof(silent_scans));
+    alive_count = sizeof(TSCH_JOIN_HOPPING_SEQUENCE);
+  }
+
+  pick = random_rand() % alive_count;
+  for(i = 0; i < sizeof(TSCH_JOIN_HOPPING_SEQUENCE); i++) {
+    if(TSCH_FAST_JOIN_DEAD_CHANNEL_SCANS == 0
+       || silent_scans[i] < TSCH_FAST_JOIN_DEAD_CHANNEL_SCANS) {
+      if(pick-- == 0) {
+        break;
+      }
+    }
+  }
+  return TSCH_JOIN_HOPPING_SEQUENCE[i];
+}
+/*---------------------------------------------------------------------------*/
+/* Account for a complete scan of a channel */
+static void
+update_silent_scans(uint8_t channel)
+{
+  int i;
+  for(i = 0; i < sizeof(TSCH_JOIN_HOPPING_SEQUENCE); i++) {
+    if(TSCH_JOIN_HOPPING_SEQUENCE[i] == channel) {
+      if(activity_sensed) {
+        silent_scans[i] = 0;
+      } else if(silent_scans[i] < 0xff) {
+        silent_scans[i]++;
+        if(silent_scans[i] == TSCH_FAST_JOIN_DEAD_CHANNEL_SCANS) {
+          LOG_INFO("fast join: skipping dead channel %u\n", channel);
+        }
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_fast_join_init(void)
+{
+  record_valid = 0;
+  record_time_valid = 0;
+  is_tracking = 0;
+  memset(silent_scans, 0, sizeof(silent_scans));
+  load_record();
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_fast_join_scan_start(void)
+{
+  clock_time_t now = clock_time();
+
+  activity_sensed = 0;
+  is_tracking = record_valid && record_time_valid
+    && (now - record.ref_time) <= TSCH_FAST_JOIN_MAX_AGE;
+  if(is_tracking) {
+    tracking_start = now;
+    LOG_INFO("fast join: predicting EB channels of ");
+    LOG_INFO_LLADDR(&record.time_source);
+    LOG_INFO_(", state age %lu ticks\n", (unsigned long)(now - record.ref_time));
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+tsch_fast_join_scan_channel(uint8_t current_channel, int dwell_expired)
+{
+  clock_time_t now = clock_time();
+
+  if(is_tracking) {
+    if(now - tracking_start < TSCH_FAST_JOIN_PREDICTION_DURATION) {
+      return predict_channel(now);
+    }
+    /* No EB heard in time, the prediction is off */
+    LOG_INFO("fast join: prediction failed, scanning at random\n");
+    is_tracking = 0;
+    record_time_valid = 0;
+    return pick_channel();
+  }
+
+  if(current_channel == 0) {
+    return pick_channel();
+  }
+  if(dwell_expired) {
+    update_silent_scans(current_channel);
+    activity_sensed = 0;
+    return pick_channel();
+  }
+  return current_channel;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_fast_join_channel_activity(void)
+{
+  activity_sensed = 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_fast_join_associated(const linkaddr_t *time_source)
+{
+  if(is_tracking) {
+    LOG_INFO("fast join: joined after %lu ticks of prediction\n",
+             (unsigned long)(clock_time() - tracking_start));
+  }
+  if(record_valid && linkaddr_cmp(time_source, &record.time_source)) {
+    LOG_INFO("fast join: rejoined the last time source\n");
+  }
+  is_tracking = 0;
+  record_saved = 0;
+  memset(silent_scans, 0, sizeof(silent_scans));
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_fast_join_time_source_eb(const linkaddr_t *time_source,
+                              const struct tsch_asn_t *eb_asn, uint8_t channel)
+{
+  struct tsch_slotframe *sf;
+  struct tsch_link *link = NULL;
+
+  /* Find the Rx cell the EB was received in */
+  for(sf = tsch_schedule_slotframe_head(); sf != NULL; sf = tsch_schedule_slotframe_next(sf)) {
+    link = tsch_schedule_get_link_by_timeslot(sf, TSCH_ASN_MOD(*eb_asn, sf->size));
+    if(link != NULL && (link->link_options & LINK_OPTION_RX)) {
+      break;
+    }
+  }
+  if(sf == NULL || link == NULL) {
+    return;
+  }
+
+  record.version = TSCH_FAST_JOIN_RECORD_VERSION;
+  linkaddr_copy(&record.time_source, time_source);
+  /* The current ASN and time as the reference */
+  record.asn = tsch_current_asn;
+  record.ref_time = clock_time();
+  record.timeslot_length_us = tsch_timing_us[tsch_ts_timeslot_length];
+  record.eb_slotframe_len = sf->size.val;
+  record.eb_timeslot = link->timeslot;
+  record.eb_channel_offset = link->channel_offset;
+  record.last_channel = channel;
+  record.hopping_sequence_len = tsch_hopping_sequence_length.val;
+  memcpy(record.hopping_sequence, tsch_hopping_sequence, tsch_hopping_sequence_length.val);
+  record_valid = 1;
+  record_time_valid = 1;
+
+  if(!record_saved || clock_time() - last_save_time >= TSCH_FAST_JOIN_SAVE_PERIOD) {
+    save_record();
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* TSCH_FAST_JOIN */
+/** @} */
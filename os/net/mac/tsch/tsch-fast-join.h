@@ -0,0 +1,61 @@
+/**
+ * \addtogroup tsch
+ * @{
+ * \file
+ *	TSCH fast join: remember the network across reboots and desynchronizations,
+ *	predict the channel of the time source's EBs, skip dead channels while scanning
+*/
+
+#ifndef TSCH_FAST_JOIN_H_
+#define TSCH_FAST_JOIN_H_
+
+/********** Includes **********/
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+#include "net/mac/tsch/tsch-asn.h"
+
+/********** Functions *********/
+
+/**
+ * \brief Initialize the module and load the saved network state, call once at startup
+ */
+void tsch_fast_join_init(void);
+
+/**
+ * \brief Notify the start of a scan. Enables channel prediction when the
+ * saved network state is recent enough.
+ */
+void tsch_fast_join_scan_start(void);
+
+/**
+ * \brief Get the channel to scan on
+ * \param current_channel The channel currently scanned, 0 if none
+ * \param dwell_expired Whether current_channel was scanned for TSCH_CHANNEL_SCAN_DURATION
+ * \return The channel to scan on: the channel of the next EB cell of the last
+ * time source when predicting, a channel not found dead otherwise
+ */
+uint8_t tsch_fast_join_scan_channel(uint8_t current_channel, int dwell_expired);
+
+/**
+ * \brief Report radio activity (energy or a frame) sensed on the channel currently scanned
+ */
+void tsch_fast_join_channel_activity(void);
+
+/**
+ * \brief Notify the association to a network
+ * \param time_source The address of the neighbor we associated from
+ */
+void tsch_fast_join_associated(const linkaddr_t *time_source);
+
+/**
+ * \brief Report an EB received from the time source, to update the saved network state
+ * \param time_source The address of the time source
+ * \param eb_asn The ASN at which the EB was received
+ * \param channel The channel on which the EB was received
+ */
+void tsch_fast_join_time_source_eb(const linkaddr_t *time_source,
+                                   const struct tsch_asn_t *eb_asn, uint8_t channel);
+
+#endif /* TSCH_FAST_JOIN_H_ */
+/** @} */
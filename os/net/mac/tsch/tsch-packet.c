@@ -60,7 +60,7 @@
 /*
  * We use a local packetbuf_attr array to collect necessary frame settings to
  * create an EACK because EACK is generated in the interrupt context where
- * packetbuf and packetbuf_attrs[] may be in use for another purpose.
+ * packetbuf and its attributes may be in use for another purpose.
  *
  * We have accessors of eackbuf_attrs: tsch_packet_eackbuf_set_attr() and
  * tsch_packet_eackbuf_attr(). For some platform, they might need to be
@@ -333,6 +333,32 @@ tsch_packet_create_eb(uint8_t *hdr_len, uint8_t *tsch_sync_ie_offset)
     return -1;
   }
 
+#if TSCH_WITH_SCHEDULE_LEVEL
+  /* Add the schedule level IE after the MLME IE, if we know the level */
+  if(tsch_get_schedule_level(&ies.ie_schedule_level)) {
+    ie_len = frame80215e_create_ie_ietf_schedule_level((uint8_t *)packetbuf_dataptr() + packetbuf_datalen(),
+                                                       packetbuf_remaininglen(),
+                                                       &ies);
+    if(ie_len < 0) {
+      return -1;
+    }
+    packetbuf_set_datalen(packetbuf_datalen() + ie_len);
+  }
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+
+#if TSCH_WITH_CHANNEL_MAP
+  /* Add the channel map IE after the MLME IE, if we know the map */
+  if(tsch_get_channel_map(&ies.ie_channel_map)) {
+    ie_len = frame80215e_create_ie_ietf_channel_map((uint8_t *)packetbuf_dataptr() + packetbuf_datalen(),
+                                                    packetbuf_remaininglen(),
+                                                    &ies);
+    if(ie_len < 0) {
+      return -1;
+    }
+    packetbuf_set_datalen(packetbuf_datalen() + ie_len);
+  }
+#endif /* TSCH_WITH_CHANNEL_MAP */
+
   /* allocate space for Header Termination IE, the size of which is 2 octets */
   packetbuf_hdralloc(2);
   ie_len = frame80215e_create_ie_header_list_termination_1(packetbuf_hdrptr(),
@@ -456,6 +482,13 @@ tsch_packet_set_frame_pending(uint8_t *buf, int buf_size)
   buf[0] |= (1 << IEEE802154_FRAME_PENDING_BIT_OFFSET);
 }
 /*---------------------------------------------------------------------------*/
+/* Clear frame pending bit in a packet (whose header was already build) */
+void
+tsch_packet_clear_frame_pending(uint8_t *buf, int buf_size)
+{
+  buf[0] &= ~(1 << IEEE802154_FRAME_PENDING_BIT_OFFSET);
+}
+/*---------------------------------------------------------------------------*/
 /* Get frame pending bit from a packet */
 int
 tsch_packet_get_frame_pending(uint8_t *buf, int buf_size)
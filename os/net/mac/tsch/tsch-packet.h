@@ -107,6 +107,12 @@ int tsch_packet_parse_eb(const uint8_t *buf, int buf_size,
  * \param buf_size The buffer size
  */
 void tsch_packet_set_frame_pending(uint8_t *buf, int buf_size);
+/**
+ * \brief Clear frame pending bit in a packet (whose header was already build)
+ * \param buf The buffer where the packet resides
+ * \param buf_size The buffer size
+ */
+void tsch_packet_clear_frame_pending(uint8_t *buf, int buf_size);
 /**
  * \brief Get frame pending bit from a packet
  * \param buf The buffer where the packet resides
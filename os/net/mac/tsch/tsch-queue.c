@@ -97,6 +97,7 @@ tsch_queue_add_nbr(const linkaddr_t *addr)
         ringbufindex_init(&n->tx_ringbuf, TSCH_QUEUE_NUM_PER_NEIGHBOR);
         n->is_broadcast = linkaddr_cmp(addr, &tsch_eb_address)
           || linkaddr_cmp(addr, &tsch_broadcast_address);
+        n->burst_max_len = TSCH_BURST_MAX_LEN;
         tsch_queue_backoff_reset(n);
       }
       tsch_release_lock();
@@ -137,6 +138,20 @@ tsch_queue_get_nbr_address(const struct tsch_neighbor *n)
   return nbr_table_get_lladdr(tsch_neighbors, n);
 }
 /*---------------------------------------------------------------------------*/
+/* Get the first TSCH neighbor */
+struct tsch_neighbor *
+tsch_queue_first_nbr(void)
+{
+  return (struct tsch_neighbor *)nbr_table_head(tsch_neighbors);
+}
+/*---------------------------------------------------------------------------*/
+/* Get the next TSCH neighbor */
+struct tsch_neighbor *
+tsch_queue_next_nbr(struct tsch_neighbor *n)
+{
+  return (struct tsch_neighbor *)nbr_table_next(tsch_neighbors, n);
+}
+/*---------------------------------------------------------------------------*/
 /* Update TSCH time source */
 int
 tsch_queue_update_time_source(const linkaddr_t *new_addr)
@@ -177,6 +192,11 @@ tsch_queue_update_time_source(const linkaddr_t *new_addr)
 
         tsch_stats_reset_neighbor_stats();
 
+#if TSCH_ADAPTIVE_BEACONING
+        /* Parent change: beacon and keep-alive at a fast pace again */
+        tsch_adaptive_beaconing_inconsistency("time source change");
+#endif /* TSCH_ADAPTIVE_BEACONING */
+
 #ifdef TSCH_CALLBACK_NEW_TIME_SOURCE
         TSCH_CALLBACK_NEW_TIME_SOURCE(old_time_src, new_time_src);
 #endif
@@ -188,6 +208,18 @@ tsch_queue_update_time_source(const linkaddr_t *new_addr)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/* Set the maximum burst length towards a neighbor */
+int
+tsch_queue_set_nbr_burst_max_len(const linkaddr_t *addr, uint8_t burst_max_len)
+{
+  struct tsch_neighbor *n = tsch_queue_add_nbr(addr);
+  if(n != NULL && !n->is_broadcast) {
+    n->burst_max_len = burst_max_len;
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 /* Flush a neighbor queue */
 static void
 tsch_queue_flush_nbr_queue(struct tsch_neighbor *n)
@@ -243,6 +275,11 @@ tsch_queue_add_packet(const linkaddr_t *addr, uint8_t max_transmissions,
 #endif
 
   if(!tsch_is_locked()) {
+#if WITH_SWAP
+    /* Let the swapped packets at the head of the queues take the free RAM
+       before the new packet does */
+    tsch_queue_swap_in();
+#endif /* WITH_SWAP */
     n = tsch_queue_add_nbr(addr);
     if(n != NULL) {
       put_index = ringbufindex_peek_put(&n->tx_ringbuf);
@@ -257,9 +294,11 @@ tsch_queue_add_packet(const linkaddr_t *addr, uint8_t max_transmissions,
             p->ret = MAC_TX_DEFERRED;
             p->transmissions = 0;
             p->max_transmissions = max_transmissions;
+            p->is_prestaged = 0;
             /* Add to ringbuf (actual add committed through atomic operation) */
             n->tx_array[put_index] = p;
             ringbufindex_put(&n->tx_ringbuf);
+            tsch_stats_on_packet_queued(n);
             LOG_DBG("packet is added put_index %u, packet %p\n",
                    put_index, p);
             return p;
@@ -341,6 +380,11 @@ tsch_queue_packet_sent(struct tsch_neighbor *n, struct tsch_packet *p,
   int is_shared_link = link->link_options & LINK_OPTION_SHARED;
   int is_unicast = !n->is_broadcast;
 
+  /* Count transmission attempts, for scheduling functions */
+  if(is_unicast) {
+    n->tx_attempts++;
+  }
+
   if(mac_tx_status == MAC_TX_OK) {
     /* Successful transmission */
     tsch_queue_remove_packet_from_queue(n);
@@ -403,8 +447,10 @@ tsch_queue_free_unused_neighbors(void)
     while(n != NULL) {
       struct tsch_neighbor *next_n = (struct tsch_neighbor *)nbr_table_next(tsch_neighbors, n);
       /* Queue is empty, no tx link to this neighbor: deallocate.
-       * Always keep time source and virtual broadcast neighbors. */
+       * Always keep time source and virtual broadcast neighbors, and
+       * neighbors with a burst length of their own. */
       if(!n->is_broadcast && !n->is_time_source && !n->tx_links_count
+         && n->burst_max_len == TSCH_BURST_MAX_LEN
          && tsch_queue_is_empty(n)) {
         tsch_queue_remove_nbr(n);
       }
@@ -412,6 +458,28 @@ tsch_queue_free_unused_neighbors(void)
     }
   }
 }
+#if WITH_SWAP
+/*---------------------------------------------------------------------------*/
+/* Bring the swapped packets at the head of the queues back to RAM */
+void
+tsch_queue_swap_in(void)
+{
+  if(!tsch_is_locked()) {
+    if(tsch_get_lock()) {
+      struct tsch_neighbor *n = (struct tsch_neighbor *)nbr_table_head(tsch_neighbors);
+      while(n != NULL) {
+        int16_t get_index = ringbufindex_peek_get(&n->tx_ringbuf);
+        if(get_index != -1 && !queuebuf_swap_in(n->tx_array[get_index]->qb)) {
+          /* No RAM left */
+          break;
+        }
+        n = (struct tsch_neighbor *)nbr_table_next(tsch_neighbors, n);
+      }
+      tsch_release_lock();
+    }
+  }
+}
+#endif /* WITH_SWAP */
 /*---------------------------------------------------------------------------*/
 /* Is the neighbor queue empty? */
 int
@@ -431,6 +499,13 @@ tsch_queue_get_packet_for_nbr(const struct tsch_neighbor *n, struct tsch_link *l
       if(get_index != -1 &&
           !(is_shared_link && !tsch_queue_backoff_expired(n))) {    /* If this is a shared link,
                                                                     make sure the backoff has expired */
+#if WITH_SWAP
+        if(!queuebuf_in_ram(n->tx_array[get_index]->qb)) {
+          /* Slot operation does not read CFS: the packet waits until
+             tsch_queue_swap_in brings it back to RAM */
+          return NULL;
+        }
+#endif /* WITH_SWAP */
 #if TSCH_WITH_LINK_SELECTOR
         int packet_attr_slotframe = queuebuf_attr(n->tx_array[get_index]->qb, PACKETBUF_ATTR_TSCH_SLOTFRAME);
         int packet_attr_timeslot = queuebuf_attr(n->tx_array[get_index]->qb, PACKETBUF_ATTR_TSCH_TIMESLOT);
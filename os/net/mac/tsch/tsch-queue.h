@@ -76,11 +76,31 @@ struct tsch_neighbor *tsch_queue_get_time_source(void);
  * \return The link-layer address of the neighbor.
  */
 linkaddr_t *tsch_queue_get_nbr_address(const struct tsch_neighbor *);
+/**
+ * \brief Get the first TSCH neighbor, to iterate over all neighbors
+ * \return The first neighbor, NULL if none
+ */
+struct tsch_neighbor *tsch_queue_first_nbr(void);
+/**
+ * \brief Get the next TSCH neighbor
+ * \param n The current neighbor
+ * \return The neighbor after n, NULL if none
+ */
+struct tsch_neighbor *tsch_queue_next_nbr(struct tsch_neighbor *n);
 /**
  * \brief Update TSCH time source
  * \param new_addr The address of the new TSCH time source
  */
 int tsch_queue_update_time_source(const linkaddr_t *new_addr);
+/**
+ * \brief Set the maximum burst length towards a neighbor. A neighbor with
+ * another length than TSCH_BURST_MAX_LEN is kept even when idle; setting it
+ * back to TSCH_BURST_MAX_LEN lets the entry be freed.
+ * \param addr The link-layer address of the neighbor
+ * \param burst_max_len The max number of frames sent back-to-back; 0 disables bursts
+ * \return 1 if success, 0 otherwise
+ */
+int tsch_queue_set_nbr_burst_max_len(const linkaddr_t *addr, uint8_t burst_max_len);
 /**
  * \brief Add packet to neighbor queue. Use same lockfree implementation as ringbuf.c (put is atomic)
  * \param addr The address of the targetted neighbor, &tsch_broadcast_address for broadcast
@@ -136,6 +156,11 @@ void tsch_queue_reset(void);
  * \brief Deallocate all neighbors with empty queue
  */
 void tsch_queue_free_unused_neighbors(void);
+/**
+ * \brief Move the swapped packets at the head of the queues back to RAM,
+ * so that slot operation does not read them from CFS
+ */
+void tsch_queue_swap_in(void);
 /**
  * \brief Is the neighbor queue empty?
  * \param n The neighbor queue
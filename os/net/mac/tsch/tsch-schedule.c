@@ -67,6 +67,54 @@ MEMB(link_memb, struct tsch_link, TSCH_SCHEDULE_MAX_LINKS);
 MEMB(slotframe_memb, struct tsch_slotframe, TSCH_SCHEDULE_MAX_SLOTFRAMES);
 /* List of slotframes (each slotframe holds its own list of links) */
 LIST(slotframe_list);
+/* Links removed from the schedule but possibly still in use by slot operation */
+LIST(retired_link_list);
+
+/* The schedule is modified from process context only, while slot operation
+ * reads it from interrupt context. Modifications do not take the TSCH lock:
+ * items are fully initialized before being published in a list with a single
+ * pointer write (list_add), and unpublished the same way (list_remove).
+ * Slot operation only keeps references to links across interrupts (the
+ * current and backup links), so removed links are retired and freed once no
+ * longer in use, while removed slotframes can be freed right away. */
+
+/*---------------------------------------------------------------------------*/
+/* Free the retired links that slot operation no longer uses */
+static void
+reclaim_retired_links(void)
+{
+  struct tsch_link *l = list_head(retired_link_list);
+  while(l != NULL) {
+    struct tsch_link *next = list_item_next(l);
+    if(!tsch_slot_operation_is_link_in_use(l)) {
+      list_remove(retired_link_list, l);
+      memb_free(&link_memb, l);
+    }
+    l = next;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Allocate a link, reclaiming retired ones if needed */
+static struct tsch_link *
+alloc_link(void)
+{
+  struct tsch_link *l;
+  reclaim_retired_links();
+  l = memb_alloc(&link_memb);
+  if(l == NULL && list_head(retired_link_list) != NULL) {
+    /* Out of links, while slot operation still uses retired ones. This is
+     * the only case where we take the lock: to make slot operation drop
+     * its references and skip the next slot. */
+    if(tsch_get_lock()) {
+      tsch_slot_operation_release_links();
+      tsch_release_lock();
+      reclaim_retired_links();
+      l = memb_alloc(&link_memb);
+    }
+  }
+  return l;
+}
+/*---------------------------------------------------------------------------*/
 
 /* Adds and returns a slotframe (NULL if failure) */
 struct tsch_slotframe *
@@ -81,21 +129,20 @@ tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
     return NULL;
   }
 
-  if(tsch_get_lock()) {
-    struct tsch_slotframe *sf = memb_alloc(&slotframe_memb);
-    if(sf != NULL) {
-      /* Initialize the slotframe */
-      sf->handle = handle;
-      TSCH_ASN_DIVISOR_INIT(sf->size, size);
-      LIST_STRUCT_INIT(sf, links_list);
-      /* Add the slotframe to the global list */
-      list_add(slotframe_list, sf);
-    }
-    LOG_INFO("Adding slotframe %u, size %u\n", handle, size);
-    tsch_release_lock();
-    return sf;
+  struct tsch_slotframe *sf = memb_alloc(&slotframe_memb);
+  if(sf != NULL) {
+    /* Initialize the slotframe */
+    sf->handle = handle;
+    TSCH_ASN_DIVISOR_INIT(sf->size, size);
+#if TSCH_WITH_SCHEDULE_LEVEL
+    sf->next_size.val = 0;
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+    LIST_STRUCT_INIT(sf, links_list);
+    /* Publish the slotframe in the global list */
+    list_add(slotframe_list, sf);
   }
-  return NULL;
+  LOG_INFO("Adding slotframe %u, size %u\n", handle, size);
+  return sf;
 }
 /*---------------------------------------------------------------------------*/
 /* Removes all slotframes, resulting in an empty schedule */
@@ -122,19 +169,78 @@ tsch_schedule_remove_slotframe(struct tsch_slotframe *slotframe)
       tsch_schedule_remove_link(slotframe, l);
     }
 
-    /* Now that the slotframe has no links, remove it. */
-    if(tsch_get_lock()) {
-      LOG_INFO("Remove slotframe %u, size %u\n",
-               slotframe->handle, slotframe->size.val);
-      memb_free(&slotframe_memb, slotframe);
-      list_remove(slotframe_list, slotframe);
-      tsch_release_lock();
-      return 1;
-    }
+    /* Now that the slotframe has no links, remove it. Slot operation does
+     * not keep references to slotframes, it can be freed right away. */
+    LOG_INFO("Remove slotframe %u, size %u\n",
+             slotframe->handle, slotframe->size.val);
+    list_remove(slotframe_list, slotframe);
+    memb_free(&slotframe_memb, slotframe);
+    return 1;
   }
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/* Changes the size of a slotframe. Return 1 if success, 0 if failure */
+int
+tsch_schedule_set_slotframe_size(struct tsch_slotframe *slotframe, uint16_t size)
+{
+  if(slotframe == NULL || size == 0) {
+    return 0;
+  }
+  /* The size is not updated with a single write: take the lock so that slot
+   * operation never sees a half-updated divisor. Resizing is rare. */
+  if(tsch_get_lock()) {
+    uint16_t old_size = slotframe->size.val;
+    TSCH_ASN_DIVISOR_INIT(slotframe->size, size);
+#if TSCH_WITH_SCHEDULE_LEVEL
+    slotframe->next_size.val = 0;
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+    tsch_release_lock();
+    LOG_INFO("Resize slotframe %u, size %u -> %u\n",
+             slotframe->handle, old_size, size);
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+#if TSCH_WITH_SCHEDULE_LEVEL
+/* Changes the size of a slotframe from a given ASN on. Return 1 if success,
+ * 0 if failure */
+int
+tsch_schedule_set_slotframe_size_at(struct tsch_slotframe *slotframe,
+                                    uint16_t size, const struct tsch_asn_t *asn)
+{
+  /* The time to a link after the switch must fit 16 bits */
+  if(slotframe == NULL || size == 0
+     || (uint32_t)slotframe->size.val + size > 0xffff) {
+    return 0;
+  }
+  if(tsch_get_lock()) {
+    TSCH_ASN_DIVISOR_INIT(slotframe->next_size, size);
+    slotframe->next_size_asn = *asn;
+    tsch_release_lock();
+    LOG_INFO("Resize slotframe %u, size %u -> %u at asn-%x.%"PRIx32"\n",
+             slotframe->handle, slotframe->size.val, size,
+             asn->ms1b, asn->ls4b);
+    return 1;
+  }
+  return 0;
+}
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+/*---------------------------------------------------------------------------*/
+/* The size of a slotframe at a given ASN */
+static const struct tsch_asn_divisor_t *
+slotframe_size_at(const struct tsch_slotframe *sf, const struct tsch_asn_t *asn)
+{
+#if TSCH_WITH_SCHEDULE_LEVEL
+  if(sf->next_size.val != 0
+     && (int32_t)TSCH_ASN_DIFF(*asn, sf->next_size_asn) >= 0) {
+    return &sf->next_size;
+  }
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+  return &sf->size;
+}
+/*---------------------------------------------------------------------------*/
 /* Looks for a slotframe from a handle */
 struct tsch_slotframe *
 tsch_schedule_get_slotframe_by_handle(uint16_t handle)
@@ -151,6 +257,16 @@ tsch_schedule_get_slotframe_by_handle(uint16_t handle)
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+/* Returns the index of a link in the link pool */
+int
+tsch_schedule_get_link_index(const struct tsch_link *l)
+{
+  if(l == NULL) {
+    return -1;
+  }
+  return memb_index(&link_memb, l);
+}
+/*---------------------------------------------------------------------------*/
 /* Looks for a link from a handle */
 struct tsch_link *
 tsch_schedule_get_link_by_handle(uint16_t handle)
@@ -238,48 +354,41 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
         l = NULL;
       }
     }
-    if(!tsch_get_lock()) {
-      LOG_ERR("! add_link memb_alloc couldn't take lock\n");
+    l = alloc_link();
+    if(l == NULL) {
+      LOG_ERR("! add_link memb_alloc failed\n");
     } else {
-      l = memb_alloc(&link_memb);
-      if(l == NULL) {
-        LOG_ERR("! add_link memb_alloc failed\n");
-        tsch_release_lock();
-      } else {
-        static int current_link_handle = 0;
-        struct tsch_neighbor *n;
-        /* Add the link to the slotframe */
-        list_add(slotframe->links_list, l);
-        /* Initialize link */
-        l->handle = current_link_handle++;
-        l->link_options = link_options;
-        l->link_type = link_type;
-        l->slotframe_handle = slotframe->handle;
-        l->timeslot = timeslot;
-        l->channel_offset = channel_offset;
-        l->data = NULL;
-        if(address == NULL) {
-          address = &linkaddr_null;
-        }
-        linkaddr_copy(&l->addr, address);
-
-        LOG_INFO("add_link sf=%u opt=%s type=%s ts=%u ch=%u addr=",
-                 slotframe->handle,
-                 print_link_options(link_options),
-                 print_link_type(link_type), timeslot, channel_offset);
-        LOG_INFO_LLADDR(address);
-        LOG_INFO_("\n");
-        /* Release the lock before we update the neighbor (will take the lock) */
-        tsch_release_lock();
-
-        if(l->link_options & LINK_OPTION_TX) {
-          n = tsch_queue_add_nbr(&l->addr);
-          /* We have a tx link to this neighbor, update counters */
-          if(n != NULL) {
-            n->tx_links_count++;
-            if(!(l->link_options & LINK_OPTION_SHARED)) {
-              n->dedicated_tx_links_count++;
-            }
+      static int current_link_handle = 0;
+      struct tsch_neighbor *n;
+      /* Initialize link */
+      l->handle = current_link_handle++;
+      l->link_options = link_options;
+      l->link_type = link_type;
+      l->slotframe_handle = slotframe->handle;
+      l->timeslot = timeslot;
+      l->channel_offset = channel_offset;
+      l->data = NULL;
+      if(address == NULL) {
+        address = &linkaddr_null;
+      }
+      linkaddr_copy(&l->addr, address);
+      /* Publish the link in the slotframe, now that it is initialized */
+      list_add(slotframe->links_list, l);
+
+      LOG_INFO("add_link sf=%u opt=%s type=%s ts=%u ch=%u addr=",
+               slotframe->handle,
+               print_link_options(link_options),
+               print_link_type(link_type), timeslot, channel_offset);
+      LOG_INFO_LLADDR(address);
+      LOG_INFO_("\n");
+
+      if(l->link_options & LINK_OPTION_TX) {
+        n = tsch_queue_add_nbr(&l->addr);
+        /* We have a tx link to this neighbor, update counters */
+        if(n != NULL) {
+          n->tx_links_count++;
+          if(!(l->link_options & LINK_OPTION_SHARED)) {
+            n->dedicated_tx_links_count++;
           }
         }
       }
@@ -293,48 +402,42 @@ int
 tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
 {
   if(slotframe != NULL && l != NULL && l->slotframe_handle == slotframe->handle) {
-    if(tsch_get_lock()) {
-      uint8_t link_options;
-      linkaddr_t addr;
-
-      /* Save link option and addr in local variables as we need them
-       * after freeing the link */
-      link_options = l->link_options;
-      linkaddr_copy(&addr, &l->addr);
-
-      /* The link to be removed is scheduled as next, set it to NULL
-       * to abort the next link operation */
-      if(l == current_link) {
-        current_link = NULL;
-      }
-      LOG_INFO("remove_link sf=%u opt=%s type=%s ts=%u ch=%u addr=",
-               slotframe->handle,
-               print_link_options(l->link_options),
-               print_link_type(l->link_type), l->timeslot, l->channel_offset);
-      LOG_INFO_LLADDR(&l->addr);
-      LOG_INFO_("\n");
-
-      list_remove(slotframe->links_list, l);
-      memb_free(&link_memb, l);
-
-      /* Release the lock before we update the neighbor (will take the lock) */
-      tsch_release_lock();
-
-      /* This was a tx link to this neighbor, update counters */
-      if(link_options & LINK_OPTION_TX) {
-        struct tsch_neighbor *n = tsch_queue_get_nbr(&addr);
-        if(n != NULL) {
-          n->tx_links_count--;
-          if(!(link_options & LINK_OPTION_SHARED)) {
-            n->dedicated_tx_links_count--;
-          }
+    uint8_t link_options;
+    linkaddr_t addr;
+
+    /* Save link option and addr in local variables as we need them
+     * after freeing the link */
+    link_options = l->link_options;
+    linkaddr_copy(&addr, &l->addr);
+
+    LOG_INFO("remove_link sf=%u opt=%s type=%s ts=%u ch=%u addr=",
+             slotframe->handle,
+             print_link_options(l->link_options),
+             print_link_type(l->link_type), l->timeslot, l->channel_offset);
+    LOG_INFO_LLADDR(&l->addr);
+    LOG_INFO_("\n");
+
+    /* Unpublish the link: slot operation will no longer select it */
+    list_remove(slotframe->links_list, l);
+    /* The link may be scheduled as next: clearing its options
+     * turns the next link operation into an idle slot */
+    l->link_options = 0;
+    /* Free the link once slot operation no longer uses it */
+    list_add(retired_link_list, l);
+    reclaim_retired_links();
+
+    /* This was a tx link to this neighbor, update counters */
+    if(link_options & LINK_OPTION_TX) {
+      struct tsch_neighbor *n = tsch_queue_get_nbr(&addr);
+      if(n != NULL) {
+        n->tx_links_count--;
+        if(!(link_options & LINK_OPTION_SHARED)) {
+          n->dedicated_tx_links_count--;
         }
       }
-
-      return 1;
-    } else {
-      LOG_ERR("! remove_link memb_alloc couldn't take lock\n");
     }
+
+    return 1;
   }
   return 0;
 }
@@ -408,6 +511,28 @@ tsch_schedule_get_link_by_timeslot(struct tsch_slotframe *slotframe,
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+/* Checks whether no link of any slotframe is scheduled at a given ASN */
+int
+tsch_schedule_is_slot_free(const struct tsch_asn_t *asn)
+{
+  if(!tsch_is_locked()) {
+    struct tsch_slotframe *sf = list_head(slotframe_list);
+    while(sf != NULL) {
+      uint16_t timeslot = TSCH_ASN_MOD(*asn, *slotframe_size_at(sf, asn));
+      struct tsch_link *l = list_head(sf->links_list);
+      while(l != NULL) {
+        if(l->timeslot == timeslot) {
+          return 0;
+        }
+        l = list_item_next(l);
+      }
+      sf = list_item_next(sf);
+    }
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 static struct tsch_link *
 default_tsch_link_comparator(struct tsch_link *a, struct tsch_link *b)
 {
@@ -447,13 +572,32 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
     /* For each slotframe, look for the earliest occurring link */
     while(sf != NULL) {
       /* Get timeslot from ASN, given the slotframe length */
-      uint16_t timeslot = TSCH_ASN_MOD(*asn, sf->size);
+      const struct tsch_asn_divisor_t *size = slotframe_size_at(sf, asn);
+      uint16_t timeslot = TSCH_ASN_MOD(*asn, *size);
       struct tsch_link *l = list_head(sf->links_list);
+#if TSCH_WITH_SCHEDULE_LEVEL
+      /* With a size change ahead, links from the switch ASN on occur at
+       * their timeslot in the new size, counted from the switch */
+      uint16_t time_to_switch = 0;
+      uint16_t switch_timeslot = 0;
+      if(size != &sf->next_size && sf->next_size.val != 0) {
+        time_to_switch = MIN(TSCH_ASN_DIFF(sf->next_size_asn, *asn), 0xffff);
+        switch_timeslot = TSCH_ASN_MOD(sf->next_size_asn, sf->next_size);
+      }
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
       while(l != NULL) {
         uint16_t time_to_timeslot =
           l->timeslot > timeslot ?
           l->timeslot - timeslot :
-          sf->size.val + l->timeslot - timeslot;
+          size->val + l->timeslot - timeslot;
+#if TSCH_WITH_SCHEDULE_LEVEL
+        if(time_to_switch > 0 && time_to_timeslot >= time_to_switch) {
+          time_to_timeslot = time_to_switch +
+            (l->timeslot >= switch_timeslot ?
+             l->timeslot - switch_timeslot :
+             sf->next_size.val + l->timeslot - switch_timeslot);
+        }
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
         if(curr_best == NULL || time_to_timeslot < time_to_curr_best) {
           time_to_curr_best = time_to_timeslot;
           curr_best = l;
@@ -521,6 +665,7 @@ tsch_schedule_init(void)
     memb_init(&link_memb);
     memb_init(&slotframe_memb);
     list_init(slotframe_list);
+    list_init(retired_link_list);
     tsch_release_lock();
     return 1;
   } else {
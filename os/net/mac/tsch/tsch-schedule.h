@@ -84,6 +84,31 @@ struct tsch_slotframe *tsch_schedule_get_slotframe_by_handle(uint16_t handle);
  */
 int tsch_schedule_remove_slotframe(struct tsch_slotframe *slotframe);
 
+/**
+ * \brief Changes the size of a slotframe, keeping its links. Links with a
+ * timeslot beyond the new size are no longer active.
+ * \param slotframe The slotframe to be resized
+ * \param size The new slotframe size
+ * \return 1 if success, 0 if failure
+ */
+int tsch_schedule_set_slotframe_size(struct tsch_slotframe *slotframe, uint16_t size);
+
+#if TSCH_WITH_SCHEDULE_LEVEL
+/**
+ * \brief Changes the size of a slotframe from a given ASN on, so that all
+ * nodes switch at the same slot. Until then, and until the size is set
+ * again, the slotframe keeps its current size. The sum of both sizes must
+ * not exceed 0xffff.
+ * \param slotframe The slotframe to be resized
+ * \param size The new slotframe size
+ * \param asn The ASN of the first slot with the new size
+ * \return 1 if success, 0 if failure
+ */
+int tsch_schedule_set_slotframe_size_at(struct tsch_slotframe *slotframe,
+                                        uint16_t size,
+                                        const struct tsch_asn_t *asn);
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+
 /**
  * \brief Removes all slotframes, resulting in an empty schedule
  * \return 1 if success, 0 if failure
@@ -110,6 +135,14 @@ struct tsch_link *tsch_schedule_add_link(struct tsch_slotframe *slotframe,
 * \return The link with required handle, if any. Otherwise, NULL
 */
 struct tsch_link *tsch_schedule_get_link_by_handle(uint16_t handle);
+/**
+* \brief Get the index of a link in the link pool. Indexes range from 0 to
+* TSCH_SCHEDULE_MAX_LINKS - 1 and are reused once a link is freed. Safe to
+* call from slot operation
+* \param l The link
+* \return The index of the link, -1 if l is not a link
+*/
+int tsch_schedule_get_link_index(const struct tsch_link *l);
 
 /**
  * \brief Looks within a slotframe for a link with a given timeslot and channel offset
@@ -130,6 +163,13 @@ struct tsch_link *tsch_schedule_get_link_by_offsets(struct tsch_slotframe *slotf
 struct tsch_link *tsch_schedule_get_link_by_timeslot(struct tsch_slotframe *slotframe,
                                                      uint16_t timeslot);
 
+/**
+ * \brief Checks whether no link of any slotframe is scheduled at a given ASN
+ * \param asn The ASN to check
+ * \return 1 if the timeslot is free in all slotframes, 0 otherwise (or if TSCH is locked)
+ */
+int tsch_schedule_is_slot_free(const struct tsch_asn_t *asn);
+
 /**
  * \brief Removes a link
  * \param slotframe The slotframe the link belongs to
@@ -169,6 +169,24 @@ static int burst_link_scheduled = 0;
 /* Counts the length of the current burst */
 int tsch_current_burst_count = 0;
 
+#if LLSEC802154_ENABLED
+/* Output of frame encryption. Holds the frame of the current slot, or of the
+ * next one when it was pre-built */
+static uint8_t encrypted_packet[TSCH_PACKET_MAX_LEN];
+#endif /* LLSEC802154_ENABLED */
+
+#if TSCH_WITH_PRESTAGING
+/* The frame of the next Tx slot, built ahead of time. Only valid for
+ * the packet and ASN it was built for */
+static struct {
+  struct tsch_packet *packet;
+  struct tsch_asn_t asn;
+  uint8_t *frame;
+  uint8_t len;
+  int burst_link_requested;
+} prestaged;
+#endif /* TSCH_WITH_PRESTAGING */
+
 /* Protothread for association */
 PT_THREAD(tsch_scan(struct pt *pt));
 /* Protothread for slot operation, called from rtimer interrupt
@@ -235,6 +253,23 @@ tsch_release_lock(void)
   tsch_locked = 0;
 }
 
+/*---------------------------------------------------------------------------*/
+/* Links are the only schedule items slot operation keeps references to
+ * between two interrupts */
+int
+tsch_slot_operation_is_link_in_use(const struct tsch_link *link)
+{
+  return link == current_link || link == backup_link;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_slot_operation_release_links(void)
+{
+  if(tsch_locked) {
+    current_link = NULL;
+    backup_link = NULL;
+  }
+}
 /*---------------------------------------------------------------------------*/
 /* Channel hopping utility functions */
 
@@ -254,6 +289,16 @@ tsch_get_channel_offset(struct tsch_link *link, struct tsch_packet *p)
   return link->channel_offset;
 }
 
+#if TSCH_WITH_CHANNEL_MAP
+static int
+is_blacklisted(uint16_t blacklist, uint8_t channel)
+{
+  return channel >= TSCH_CHANNEL_MAP_FIRST_CHANNEL
+    && channel < TSCH_CHANNEL_MAP_FIRST_CHANNEL + 16
+    && (blacklist & (1 << (channel - TSCH_CHANNEL_MAP_FIRST_CHANNEL)));
+}
+#endif /* TSCH_WITH_CHANNEL_MAP */
+
 /**
  * Returns a 802.15.4 channel from an ASN and channel offset. Basically adds
  * The offset to the ASN and performs a hopping sequence lookup.
@@ -268,7 +313,31 @@ tsch_calculate_channel(struct tsch_asn_t *asn, uint16_t channel_offset)
   uint16_t index_of_0, index_of_offset;
   index_of_0 = TSCH_ASN_MOD(*asn, tsch_hopping_sequence_length);
   index_of_offset = (index_of_0 + channel_offset) % tsch_hopping_sequence_length.val;
+#if TSCH_WITH_CHANNEL_MAP
+  {
+    uint16_t blacklist = tsch_get_channel_blacklist(asn);
+    uint8_t channel = tsch_hopping_sequence[index_of_offset];
+    if(blacklist != 0) {
+      /* Hop over the non-blacklisted channels of the sequence only, so
+       * that distinct channel offsets keep distinct channels */
+      uint8_t allowed[TSCH_HOPPING_SEQUENCE_MAX_LEN];
+      struct tsch_asn_divisor_t count;
+      uint16_t i, num_allowed = 0;
+      for(i = 0; i < tsch_hopping_sequence_length.val; i++) {
+        if(!is_blacklisted(blacklist, tsch_hopping_sequence[i])) {
+          allowed[num_allowed++] = tsch_hopping_sequence[i];
+        }
+      }
+      if(num_allowed > 0 && num_allowed < tsch_hopping_sequence_length.val) {
+        TSCH_ASN_DIVISOR_INIT(count, num_allowed);
+        channel = allowed[(TSCH_ASN_MOD(*asn, count) + channel_offset) % num_allowed];
+      }
+    }
+    return channel;
+  }
+#else /* TSCH_WITH_CHANNEL_MAP */
   return tsch_hopping_sequence[index_of_offset];
+#endif /* TSCH_WITH_CHANNEL_MAP */
 }
 
 /*---------------------------------------------------------------------------*/
@@ -402,6 +471,174 @@ get_packet_and_neighbor_for_link(struct tsch_link *link, struct tsch_neighbor **
   return p;
 }
 /*---------------------------------------------------------------------------*/
+/* Can the current link be extended into the next timeslot for a burst? */
+static int
+is_next_slot_free_for_burst(void)
+{
+#if TSCH_BURST_ONLY_IN_FREE_SLOTS
+  struct tsch_asn_t next_asn = tsch_current_asn;
+  TSCH_ASN_INC(next_asn, 1);
+  return tsch_schedule_is_slot_free(&next_asn);
+#else /* TSCH_BURST_ONLY_IN_FREE_SLOTS */
+  return 1;
+#endif /* TSCH_BURST_ONLY_IN_FREE_SLOTS */
+}
+#if TSCH_ADAPTIVE_GUARD_TIME
+/*---------------------------------------------------------------------------*/
+/* Account for a timing offset measured with neighbor n, in rtimer ticks.
+ * A larger offset than the average widens the guard time at once,
+ * smaller ones narrow it slowly */
+static void
+guard_time_update(struct tsch_neighbor *n, int32_t offset)
+{
+  uint32_t sample = MIN((uint32_t)ABS(offset) * 8, 0xffff);
+  if(!n->guard.is_valid || sample > n->guard.offset_avg) {
+    n->guard.offset_avg = sample;
+  } else {
+    n->guard.offset_avg = (7 * (uint32_t)n->guard.offset_avg + sample) / 8;
+  }
+  n->guard.last_asn = tsch_current_asn;
+  n->guard.idle_count = 0;
+  n->guard.is_valid = 1;
+}
+/*---------------------------------------------------------------------------*/
+/* An Rx slot with a narrowed guard time was idle. Frames of the neighbor
+ * may have fallen outside of the guard time: widen it after too many */
+static void
+guard_time_idle(struct tsch_neighbor *n)
+{
+  if(++n->guard.idle_count >= TSCH_GUARD_TIME_MAX_IDLE) {
+    n->guard.offset_avg = MIN(2 * (uint32_t)n->guard.offset_avg
+                              + 4 * US_TO_RTIMERTICKS(TSCH_GUARD_TIME_MIN), 0xffff);
+    n->guard.idle_count = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Returns the half guard time of an Rx link: twice the average offset
+ * measured with the neighbor of the link, plus the drift since the last
+ * measurement. Set *nbr to the neighbor, or NULL if the link uses the
+ * full guard time */
+static rtimer_clock_t
+guard_time_get(const struct tsch_link *link, struct tsch_neighbor **nbr)
+{
+  rtimer_clock_t max_guard = tsch_timing[tsch_ts_rx_wait] / 2;
+  struct tsch_neighbor *n;
+  uint32_t elapsed_slots;
+  uint32_t drift_us;
+  rtimer_clock_t guard;
+
+  *nbr = NULL;
+  n = tsch_queue_get_nbr(&link->addr);
+  if(n == NULL || n->is_broadcast || !n->guard.is_valid) {
+    return max_guard;
+  }
+
+  /* Cap the elapsed time to avoid overflows. By then, the guard time
+   * is the full one anyway */
+  elapsed_slots = MIN((uint32_t)TSCH_ASN_DIFF(tsch_current_asn, n->guard.last_asn),
+                      100 * TSCH_SLOTS_PER_SECOND);
+  drift_us = elapsed_slots * tsch_timing_us[tsch_ts_timeslot_length] / 1000
+    * TSCH_GUARD_TIME_DRIFT_PPM / 1000;
+  guard = US_TO_RTIMERTICKS(TSCH_GUARD_TIME_MIN + drift_us)
+    + TSCH_TIMESYNC_MEASUREMENT_ERROR + n->guard.offset_avg / 4;
+  if(guard >= max_guard) {
+    return max_guard;
+  }
+  *nbr = n;
+  return guard;
+}
+#endif /* TSCH_ADAPTIVE_GUARD_TIME */
+/*---------------------------------------------------------------------------*/
+/* Build the frame to send packet p to neighbor n at tsch_current_asn: set or
+ * clear the frame pending bit, update the Sync-IE of EBs and secure the frame.
+ * Returns the frame to pass to the radio and its length in *len, or NULL
+ * if the frame could not be built. */
+static uint8_t *
+build_tx_frame(struct tsch_packet *p, struct tsch_neighbor *n,
+               uint8_t *len, int *burst_link_requested)
+{
+  uint8_t *frame = queuebuf_dataptr(p->qb);
+  uint8_t frame_len = queuebuf_datalen(p->qb);
+
+  /* Unicast. More packets in queue for the neighbor, and is the next
+   * timeslot available to continue the burst? */
+  *burst_link_requested = 0;
+  if(!n->is_broadcast
+         && tsch_current_burst_count + 1 < n->burst_max_len
+         && tsch_queue_nbr_packet_count(n) > 1
+         && is_next_slot_free_for_burst()) {
+    *burst_link_requested = 1;
+    tsch_packet_set_frame_pending(frame, frame_len);
+  } else {
+    /* The bit may have been set in a previous attempt of this packet */
+    tsch_packet_clear_frame_pending(frame, frame_len);
+  }
+  /* if this is an EB, then update its Sync-IE */
+  if(n == n_eb && !tsch_packet_update_eb(frame, frame_len, p->tsch_sync_ie_offset)) {
+    return NULL;
+  }
+
+#if LLSEC802154_ENABLED
+  if(tsch_is_pan_secured) {
+    /* If we are going to encrypt, we need to generate the output in a separate buffer and keep
+     * the original untouched. This is to allow for future retransmissions. */
+    int with_encryption = queuebuf_attr(p->qb, PACKETBUF_ATTR_SECURITY_LEVEL) & 0x4;
+    frame_len += tsch_security_secure_frame(frame, with_encryption ? encrypted_packet : frame, p->header_len,
+        frame_len - p->header_len, &tsch_current_asn);
+    if(with_encryption) {
+      frame = encrypted_packet;
+    }
+  }
+#endif /* LLSEC802154_ENABLED */
+
+  *len = frame_len;
+  return frame;
+}
+/*---------------------------------------------------------------------------*/
+#if TSCH_WITH_PRESTAGING
+/* Build the frame of the next active slot, if it is a Tx slot and if there is
+ * enough time left before it starts. Called at the end of a slot, once
+ * current_link and tsch_current_asn point to the next active slot. */
+static void
+prestage_next_tx_frame(void)
+{
+  struct tsch_packet *p;
+  struct tsch_neighbor *n;
+
+  /* Invalidate the previous frame: its buffer is about to be reused */
+  if(prestaged.packet != NULL) {
+    prestaged.packet->is_prestaged = 0;
+    prestaged.packet = NULL;
+  }
+
+  if(current_link == NULL || tsch_locked || tsch_lock_requested
+     || RTIMER_CLOCK_DIFF(current_slot_start, RTIMER_NOW()) < (int32_t)TSCH_PRESTAGING_MIN_MARGIN) {
+    return;
+  }
+
+  p = get_packet_and_neighbor_for_link(current_link, &n);
+  if(p == NULL || p->qb == NULL || n == NULL) {
+    return;
+  }
+
+  prestaged.frame = build_tx_frame(p, n, &prestaged.len, &prestaged.burst_link_requested);
+  if(prestaged.frame != NULL) {
+    prestaged.asn = tsch_current_asn;
+    prestaged.packet = p;
+    p->is_prestaged = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Was the frame of packet p built ahead of the current slot? */
+static int
+is_prestaged(const struct tsch_packet *p)
+{
+  return p == prestaged.packet && p->is_prestaged
+         && prestaged.asn.ms1b == tsch_current_asn.ms1b
+         && prestaged.asn.ls4b == tsch_current_asn.ls4b;
+}
+#endif /* TSCH_WITH_PRESTAGING */
+/*---------------------------------------------------------------------------*/
 static
 void update_link_backoff(struct tsch_link *link) {
   if(link != NULL
@@ -521,7 +758,6 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
   /* is the packet in its neighbor's queue? */
   uint8_t in_queue;
   static int dequeued_index;
-  static int packet_ready = 1;
 
   PT_BEGIN(pt);
 
@@ -535,11 +771,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
       mac_tx_status = MAC_TX_ERR_FATAL;
     } else {
       /* packet payload */
-      static void *packet;
-#if LLSEC802154_ENABLED
-      /* encrypted payload */
-      static uint8_t encrypted_packet[TSCH_PACKET_MAX_LEN];
-#endif /* LLSEC802154_ENABLED */
+      static uint8_t *packet;
       /* packet payload length */
       static uint8_t packet_len;
       /* packet seqno */
@@ -554,43 +786,24 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
       static uint8_t cca_status;
 #endif /* TSCH_CCA_ENABLED */
 
-      /* get payload */
-      packet = queuebuf_dataptr(current_packet->qb);
-      packet_len = queuebuf_datalen(current_packet->qb);
       /* if is this a broadcast packet, don't wait for ack */
       do_wait_for_ack = !current_neighbor->is_broadcast;
-      /* Unicast. More packets in queue for the neighbor? */
-      burst_link_requested = 0;
-      if(do_wait_for_ack
-             && tsch_current_burst_count + 1 < TSCH_BURST_MAX_LEN
-             && tsch_queue_nbr_packet_count(current_neighbor) > 1) {
-        burst_link_requested = 1;
-        tsch_packet_set_frame_pending(packet, packet_len);
-      }
       /* read seqno from payload */
-      seqno = ((uint8_t *)(packet))[2];
-      /* if this is an EB, then update its Sync-IE */
-      if(current_neighbor == n_eb) {
-        packet_ready = tsch_packet_update_eb(packet, packet_len, current_packet->tsch_sync_ie_offset);
-      } else {
-        packet_ready = 1;
-      }
-
-#if LLSEC802154_ENABLED
-      if(tsch_is_pan_secured) {
-        /* If we are going to encrypt, we need to generate the output in a separate buffer and keep
-         * the original untouched. This is to allow for future retransmissions. */
-        int with_encryption = queuebuf_attr(current_packet->qb, PACKETBUF_ATTR_SECURITY_LEVEL) & 0x4;
-        packet_len += tsch_security_secure_frame(packet, with_encryption ? encrypted_packet : packet, current_packet->header_len,
-            packet_len - current_packet->header_len, &tsch_current_asn);
-        if(with_encryption) {
-          packet = encrypted_packet;
-        }
+      seqno = ((uint8_t *)queuebuf_dataptr(current_packet->qb))[2];
+      /* get the frame to send, unless it was already built ahead of the slot */
+#if TSCH_WITH_PRESTAGING
+      if(is_prestaged(current_packet)) {
+        packet = prestaged.frame;
+        packet_len = prestaged.len;
+        burst_link_requested = prestaged.burst_link_requested;
+      } else
+#endif /* TSCH_WITH_PRESTAGING */
+      {
+        packet = build_tx_frame(current_packet, current_neighbor, &packet_len, &burst_link_requested);
       }
-#endif /* LLSEC802154_ENABLED */
 
       /* prepare packet to send: copy to radio buffer */
-      if(packet_ready && NETSTACK_RADIO.prepare(packet, packet_len) == 0) { /* 0 means success */
+      if(packet != NULL && NETSTACK_RADIO.prepare(packet, packet_len) == 0) { /* 0 means success */
         static rtimer_clock_t tx_duration;
 
 #if TSCH_CCA_ENABLED
@@ -703,6 +916,9 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
               }
 
               if(ack_len != 0) {
+#if TSCH_ADAPTIVE_GUARD_TIME
+                guard_time_update(current_neighbor, US_TO_RTIMERTICKS(ack_ies.ie_time_correction));
+#endif /* TSCH_ADAPTIVE_GUARD_TIME */
                 if(is_time_source) {
                   int32_t eack_time_correction = US_TO_RTIMERTICKS(ack_ies.ie_time_correction);
                   int32_t since_last_timesync = TSCH_ASN_DIFF(tsch_current_asn, last_sync_asn);
@@ -726,12 +942,20 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
                   last_sync_asn = tsch_current_asn;
                   tsch_last_sync_time = clock_time();
                   tsch_schedule_keepalive(0);
+                } else {
+                  /* Not used for synchronization, but tells our drift to the neighbor */
+                  int32_t eack_time_correction = US_TO_RTIMERTICKS(ack_ies.ie_time_correction);
+                  if(ABS(eack_time_correction) <= SYNC_IE_BOUND) {
+                    tsch_timesync_neighbor_offset(current_neighbor, eack_time_correction);
+                  }
                 }
                 mac_tx_status = MAC_TX_OK;
 
                 /* We requested an extra slot and got an ack. This means
-                the extra slot will be scheduled at the received */
-                if(burst_link_requested) {
+                the extra slot will be scheduled at the received, unless
+                the receiver did not confirm it in the ACK */
+                if(burst_link_requested
+                   && (!TSCH_BURST_ACK_CONFIRMATION || frame.fcf.frame_pending)) {
                   burst_link_scheduled = 1;
                 }
               } else {
@@ -763,11 +987,19 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
       ringbufindex_put(&dequeued_ringbuf);
     }
 
-    /* If this is an unicast packet to timesource, update stats */
-    if(current_neighbor != NULL && current_neighbor->is_time_source) {
+    /* Update stats. Per-neighbor stats are only kept for the time source,
+     * per-channel Tx stats cover all unicast packets */
+    if(current_neighbor != NULL
+       && (current_neighbor->is_time_source || TSCH_STATS_CHANNEL_TX)) {
       tsch_stats_tx_packet(current_neighbor, mac_tx_status, tsch_current_channel);
     }
 
+    /* Update the stats of the cell, unless within a burst */
+    if(current_neighbor != NULL && !current_neighbor->is_broadcast
+       && tsch_current_burst_count == 0) {
+      tsch_stats_cell_tx(current_link, mac_tx_status);
+    }
+
     /* Log every tx attempt */
     TSCH_LOG_ADD(tsch_log_tx,
         log->tx.mac_tx_status = mac_tx_status;
@@ -800,7 +1032,8 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
   /**
    * RX slot:
    * 1. Check if it is used for TIME_KEEPING
-   * 2. Sleep and wake up just before expected RX time (with a guard time: TS_LONG_GT)
+   * 2. Sleep and wake up just before expected RX time (with a guard time: TS_LONG_GT,
+   *    or narrower with TSCH_ADAPTIVE_GUARD_TIME)
    * 3. Check for radio activity for the guard time: TS_LONG_GT
    * 4. Prepare and send ACK if needed
    * 5. Drift calculated in the ACK callback registered with the radio driver. Use it if receiving from a time source neighbor.
@@ -827,6 +1060,11 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
     static rtimer_clock_t rx_start_time;
     static rtimer_clock_t expected_rx_time;
     static rtimer_clock_t packet_duration;
+    /* Part of the guard time skipped at both ends of the Rx window */
+    static rtimer_clock_t guard_skip;
+#if TSCH_ADAPTIVE_GUARD_TIME
+    static struct tsch_neighbor *guard_nbr;
+#endif /* TSCH_ADAPTIVE_GUARD_TIME */
     uint8_t packet_seen;
 
     expected_rx_time = current_slot_start + tsch_timing[tsch_ts_tx_offset];
@@ -835,8 +1073,14 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
 
     current_input = &input_array[input_index];
 
+#if TSCH_ADAPTIVE_GUARD_TIME
+    guard_skip = tsch_timing[tsch_ts_rx_wait] / 2 - guard_time_get(current_link, &guard_nbr);
+#else /* TSCH_ADAPTIVE_GUARD_TIME */
+    guard_skip = 0;
+#endif /* TSCH_ADAPTIVE_GUARD_TIME */
+
     /* Wait before starting to listen */
-    TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_rx_offset] - RADIO_DELAY_BEFORE_RX, "RxBeforeListen");
+    TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_rx_offset] + guard_skip - RADIO_DELAY_BEFORE_RX, "RxBeforeListen");
     TSCH_DEBUG_RX_EVENT();
 
     /* Start radio for at least guard time */
@@ -845,11 +1089,16 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
     if(!packet_seen) {
       /* Check if receiving within guard time */
       RTIMER_BUSYWAIT_UNTIL_ABS((packet_seen = (NETSTACK_RADIO.receiving_packet() || NETSTACK_RADIO.pending_packet())),
-          current_slot_start, tsch_timing[tsch_ts_rx_offset] + tsch_timing[tsch_ts_rx_wait] + RADIO_DELAY_BEFORE_DETECT);
+          current_slot_start, tsch_timing[tsch_ts_rx_offset] + tsch_timing[tsch_ts_rx_wait] - guard_skip + RADIO_DELAY_BEFORE_DETECT);
     }
     if(!packet_seen) {
       /* no packets on air */
       tsch_radio_off(TSCH_RADIO_CMD_OFF_FORCE);
+#if TSCH_ADAPTIVE_GUARD_TIME
+      if(guard_nbr != NULL) {
+        guard_time_idle(guard_nbr);
+      }
+#endif /* TSCH_ADAPTIVE_GUARD_TIME */
     } else {
       ENERGEST_ON(ENERGEST_TYPE_CUSTOM_LISTEN);
       TSCH_DEBUG_RX_EVENT();
@@ -958,12 +1207,24 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
             if(frame.fcf.ack_required) {
               static uint8_t ack_buf[TSCH_PACKET_MAX_LEN];
               static int ack_len;
+              static int burst_accepted;
+
+              /* Follow a burst iff the frame pending bit was set and
+               * the next timeslot is free in our own schedule */
+              burst_accepted = tsch_packet_get_frame_pending(current_input->payload, current_input->len)
+                && is_next_slot_free_for_burst();
 
               /* Build ACK frame */
               ack_len = tsch_packet_create_eack(ack_buf, sizeof(ack_buf),
                   &source_address, frame.seq, (int16_t)RTIMERTICKS_TO_US(estimated_drift), do_nack);
 
               if(ack_len > 0) {
+#if TSCH_BURST_ACK_CONFIRMATION
+                if(burst_accepted) {
+                  /* Confirm to the sender that we will listen in the next timeslot */
+                  tsch_packet_set_frame_pending(ack_buf, ack_len);
+                }
+#endif /* TSCH_BURST_ACK_CONFIRMATION */
 #if LLSEC802154_ENABLED
                 if(tsch_is_pan_secured) {
                   /* Secure ACK frame. There is only header and header IEs, therefore data len == 0. */
@@ -981,13 +1242,18 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
                 NETSTACK_RADIO.transmit(ack_len);
                 tsch_radio_off(TSCH_RADIO_CMD_OFF_WITHIN_TIMESLOT);
 
-                /* Schedule a burst link iff the frame pending bit was set */
-                burst_link_scheduled = tsch_packet_get_frame_pending(current_input->payload, current_input->len);
+                /* Schedule a burst link iff we accepted the burst */
+                burst_link_scheduled = burst_accepted;
               }
             }
 
             /* If the sender is a time source, proceed to clock drift compensation */
             n = tsch_queue_get_nbr(&source_address);
+#if TSCH_ADAPTIVE_GUARD_TIME
+            if(n != NULL) {
+              guard_time_update(n, estimated_drift);
+            }
+#endif /* TSCH_ADAPTIVE_GUARD_TIME */
             if(n != NULL && n->is_time_source) {
               int32_t since_last_timesync = TSCH_ASN_DIFF(tsch_current_asn, last_sync_asn);
               /* Keep track of last sync time */
@@ -999,11 +1265,18 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
               sync_count++;
               tsch_timesync_update(n, since_last_timesync, -estimated_drift);
               tsch_schedule_keepalive(0);
+            } else if(n != NULL) {
+              /* Not used for synchronization, but tells our drift to the neighbor */
+              tsch_timesync_neighbor_offset(n, -estimated_drift);
             }
 
             /* Add current input to ringbuf */
             ringbufindex_put(&input_ringbuf);
 
+            if(tsch_current_burst_count == 0) {
+              tsch_stats_cell_rx(current_link);
+            }
+
             /* If the neighbor is known, update its stats */
             if(n != NULL) {
               NETSTACK_RADIO.get_value(RADIO_PARAM_LAST_LINK_QUALITY, &radio_last_lqi);
@@ -1196,6 +1469,11 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
         prev_slot_start = current_slot_start;
         current_slot_start += time_to_next_active_slot;
       } while(!tsch_schedule_slot_operation(t, prev_slot_start, time_to_next_active_slot, "main"));
+
+#if TSCH_WITH_PRESTAGING
+      /* Use the time until the next slot to get its frame ready */
+      prestage_next_tx_frame();
+#endif /* TSCH_WITH_PRESTAGING */
     }
 
     tsch_in_slot_operation = 0;
@@ -65,7 +65,8 @@ extern int tsch_current_burst_count;
 /**
  * Checks if the TSCH lock is set. Accesses to global structures outside of
  * interrupts must be done through the lock, unless the sturcutre has
- * atomic read/write
+ * atomic read/write. The schedule is updated without the lock
+ * (see tsch-schedule.c)
  *
  * \return 1 if the lock is taken, 0 otherwise
  */
@@ -81,6 +82,20 @@ int tsch_get_lock(void);
  * Releases the TSCH lock.
  */
 void tsch_release_lock(void);
+/**
+ * Checks if a link is referenced by slot operation, i.e. it is the link of
+ * the current (or next) slot, or its backup link. Links removed from the
+ * schedule can only be freed once this no longer holds.
+ *
+ * \param link The link
+ * \return 1 if the link is in use, 0 otherwise
+ */
+int tsch_slot_operation_is_link_in_use(const struct tsch_link *link);
+/**
+ * Makes slot operation drop its references to links (the next slot is
+ * skipped). Must be called with the TSCH lock taken.
+ */
+void tsch_slot_operation_release_links(void);
 /**
  * Set global time before starting slot operation, with a rtimer time and an ASN
  *
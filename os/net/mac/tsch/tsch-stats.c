@@ -37,7 +37,9 @@
 #include "contiki.h"
 #include "net/mac/tsch/tsch.h"
 #include "net/netstack.h"
+#include "net/link-stats.h"
 #include "dev/radio.h"
+#include <string.h>
 
 /* Log configuration */
 #include "sys/log.h"
@@ -60,14 +62,20 @@ static void periodic(void *);
 void
 tsch_stats_init(void)
 {    
-#if TSCH_STATS_SAMPLE_NOISE_RSSI
+#if TSCH_STATS_SAMPLE_NOISE_RSSI || TSCH_STATS_CHANNEL_TX
   int i;
-
+#endif
+#if TSCH_STATS_SAMPLE_NOISE_RSSI
   for(i = 0; i < TSCH_STATS_NUM_CHANNELS; ++i) {
     tsch_stats.noise_rssi[i] = TSCH_STATS_DEFAULT_RSSI;
     tsch_stats.channel_free_ewma[i] = TSCH_STATS_DEFAULT_CHANNEL_FREE;
   }
 #endif
+#if TSCH_STATS_CHANNEL_TX
+  for(i = 0; i < TSCH_STATS_NUM_CHANNELS; ++i) {
+    tsch_stats.channel_tx_success_ewma[i] = TSCH_STATS_DEFAULT_P_TX;
+  }
+#endif /* TSCH_STATS_CHANNEL_TX */
 
   tsch_stats_reset_neighbor_stats();
 
@@ -104,6 +112,14 @@ tsch_stats_tx_packet(struct tsch_neighbor *n, uint8_t mac_status, uint8_t channe
 {
   struct tsch_neighbor_stats *stats;
 
+#if TSCH_STATS_CHANNEL_TX
+  if(n != NULL && !n->is_broadcast) {
+    uint8_t index = tsch_stats_channel_to_index(channel);
+    uint16_t new_tx_value = (mac_status == MAC_TX_OK ? TSCH_STATS_BINARY_SCALING_FACTOR : 0);
+    TSCH_STATS_EWMA_UPDATE(tsch_stats.channel_tx_success_ewma[index], new_tx_value);
+  }
+#endif /* TSCH_STATS_CHANNEL_TX */
+
   stats = tsch_stats_get_from_neighbor(n);
   if(stats != NULL) {
     uint8_t index = tsch_stats_channel_to_index(channel);
@@ -187,6 +203,270 @@ tsch_stats_sample_rssi(void)
 #endif /* TSCH_STATS_SAMPLE_NOISE_RSSI */
 }
 /*---------------------------------------------------------------------------*/
+void
+tsch_stats_on_packet_queued(const struct tsch_neighbor *n)
+{
+  int count = MIN(tsch_queue_global_packet_count(), 0xff);
+  tsch_stats.queue_high_water = MAX(tsch_stats.queue_high_water, count);
+  count = MIN(tsch_queue_nbr_packet_count(n), 0xff);
+  tsch_stats.nbr_queue_high_water = MAX(tsch_stats.nbr_queue_high_water, count);
+}
+/*---------------------------------------------------------------------------*/
+/* Sequential writer for snapshots. Writes past the end of the buffer are
+ * dropped, but still counted, to detect a short buffer once done */
+struct snapshot_writer {
+  uint8_t *buf;
+  int len;
+  int pos;
+};
+
+static void
+put_u8(struct snapshot_writer *w, uint8_t value)
+{
+  if(w->pos < w->len) {
+    w->buf[w->pos] = value;
+  }
+  w->pos++;
+}
+
+static void
+put_u16(struct snapshot_writer *w, uint16_t value)
+{
+  put_u8(w, value & 0xff);
+  put_u8(w, value >> 8);
+}
+
+static void
+put_u32(struct snapshot_writer *w, uint32_t value)
+{
+  put_u16(w, value & 0xffff);
+  put_u16(w, value >> 16);
+}
+/*---------------------------------------------------------------------------*/
+static void
+snapshot_neighbors(struct snapshot_writer *w)
+{
+  struct tsch_neighbor *n;
+  int count_pos = w->pos;
+  uint8_t count = 0;
+
+  put_u8(w, 0);
+  for(n = tsch_queue_first_nbr(); n != NULL; n = tsch_queue_next_nbr(n)) {
+    const linkaddr_t *addr;
+    const struct link_stats *ls;
+    struct tsch_neighbor_stats *stats;
+    int rssi = -128;
+    uint8_t lqi = 0xff;
+    uint16_t etx = 0;
+    int i;
+
+    if(n->is_broadcast || count == 0xff) {
+      continue;
+    }
+    addr = tsch_queue_get_nbr_address(n);
+    ls = link_stats_from_lladdr(addr);
+    if(ls != NULL) {
+      etx = ls->etx;
+      if(ls->rssi != LINK_STATS_RSSI_UNKNOWN) {
+        rssi = MAX(-127, MIN(ls->rssi, 127));
+      }
+    }
+    stats = tsch_stats_get_from_neighbor(n);
+    if(stats != NULL) {
+      uint32_t sum = 0;
+      for(i = 0; i < TSCH_STATS_NUM_CHANNELS; i++) {
+        sum += stats->channel_stats[i].lqi / TSCH_STATS_LQI_SCALING_FACTOR;
+      }
+      lqi = MIN(sum / TSCH_STATS_NUM_CHANNELS, 0xfe);
+    }
+
+    for(i = 0; i < LINKADDR_SIZE; i++) {
+      put_u8(w, addr->u8[i]);
+    }
+    put_u8(w, n->is_time_source ? 1 : 0);
+    put_u8(w, (uint8_t)(int8_t)rssi);
+    put_u8(w, lqi);
+    put_u16(w, etx);
+    put_u8(w, MIN(tsch_queue_nbr_packet_count(n), 0xff));
+    count++;
+  }
+  if(count_pos < w->len) {
+    w->buf[count_pos] = count;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+snapshot_slotframes(struct snapshot_writer *w)
+{
+  struct tsch_slotframe *sf;
+  int count_pos = w->pos;
+  uint8_t count = 0;
+
+  put_u8(w, 0);
+  for(sf = tsch_schedule_slotframe_head(); sf != NULL;
+      sf = tsch_schedule_slotframe_next(sf)) {
+    struct tsch_link *l;
+    uint8_t tx_links = 0;
+    uint8_t rx_links = 0;
+#if TSCH_STATS_PER_CELL
+    uint32_t tx_attempts = 0;
+    uint32_t tx_acked = 0;
+    uint32_t rx = 0;
+#endif /* TSCH_STATS_PER_CELL */
+
+    for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+#if TSCH_STATS_PER_CELL
+      const struct tsch_cell_stats *cs = tsch_stats_get_cell(l);
+      if(cs != NULL) {
+        tx_attempts += cs->tx_attempts;
+        tx_acked += cs->tx_acked;
+        rx += cs->rx;
+      }
+#endif /* TSCH_STATS_PER_CELL */
+      if((l->link_options & LINK_OPTION_TX) && tx_links < 0xff) {
+        tx_links++;
+      }
+      if((l->link_options & LINK_OPTION_RX) && rx_links < 0xff) {
+        rx_links++;
+      }
+    }
+
+    put_u16(w, sf->handle);
+    put_u16(w, sf->size.val);
+    put_u8(w, tx_links);
+    put_u8(w, rx_links);
+#if TSCH_STATS_PER_CELL
+    put_u16(w, MIN(tx_attempts, 0xffff));
+    put_u16(w, MIN(tx_acked, 0xffff));
+    put_u16(w, MIN(rx, 0xffff));
+#endif /* TSCH_STATS_PER_CELL */
+    count++;
+  }
+  if(count_pos < w->len) {
+    w->buf[count_pos] = count;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_stats_snapshot(uint8_t *buf, int len)
+{
+  struct snapshot_writer w = { buf, len, 0 };
+  uint8_t sections = TSCH_STATS_SNAPSHOT_GLOBAL | TSCH_STATS_SNAPSHOT_NEIGHBORS
+    | TSCH_STATS_SNAPSHOT_SLOTFRAMES;
+  struct tsch_asn_t asn = tsch_current_asn;
+
+#if TSCH_STATS_SAMPLE_NOISE_RSSI
+  sections |= TSCH_STATS_SNAPSHOT_CHANNELS;
+#endif /* TSCH_STATS_SAMPLE_NOISE_RSSI */
+#if TSCH_STATS_PER_CELL
+  sections |= TSCH_STATS_SNAPSHOT_CELLS;
+#endif /* TSCH_STATS_PER_CELL */
+
+  /* Header */
+  put_u8(&w, TSCH_STATS_SNAPSHOT_VERSION);
+  put_u8(&w, sections);
+
+  /* Global */
+  put_u32(&w, asn.ls4b);
+  put_u8(&w, asn.ms1b);
+  put_u32(&w, tsch_stats.max_sync_error);
+  put_u16(&w, tsch_stats.num_disassociations);
+  put_u8(&w, MIN(tsch_queue_global_packet_count(), 0xff));
+  put_u8(&w, tsch_stats.queue_high_water);
+  put_u8(&w, tsch_stats.nbr_queue_high_water);
+
+  snapshot_neighbors(&w);
+
+#if TSCH_STATS_SAMPLE_NOISE_RSSI
+  {
+    int i;
+    put_u8(&w, TSCH_STATS_FIRST_CHANNEL);
+    put_u8(&w, TSCH_STATS_NUM_CHANNELS);
+    for(i = 0; i < TSCH_STATS_NUM_CHANNELS; i++) {
+      int16_t noise = (int16_t)tsch_stats.noise_rssi[i] / TSCH_STATS_RSSI_SCALING_FACTOR;
+      uint32_t free = tsch_stats.channel_free_ewma[i];
+      put_u8(&w, (uint8_t)(int8_t)MAX(-128, MIN(noise, 127)));
+      put_u8(&w, 100 - MIN(free * 100 / TSCH_STATS_BINARY_SCALING_FACTOR, 100));
+    }
+  }
+#endif /* TSCH_STATS_SAMPLE_NOISE_RSSI */
+
+  snapshot_slotframes(&w);
+
+  return w.pos <= len ? w.pos : -1;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_stats_snapshot_delta(const uint8_t *base, int base_len,
+                          const uint8_t *snapshot, int snapshot_len,
+                          uint8_t *buf, int len)
+{
+  struct snapshot_writer w = { buf, len, 0 };
+  int i = 0;
+
+  put_u16(&w, snapshot_len);
+  while(i < snapshot_len) {
+    int skip = 0;
+    int changed = 0;
+    /* Unchanged bytes. Bytes beyond the base are always changed */
+    while(skip < 0xff && i + skip < snapshot_len && i + skip < base_len
+          && base[i + skip] == snapshot[i + skip]) {
+      skip++;
+    }
+    i += skip;
+    if(i == snapshot_len) {
+      /* The remaining bytes are unchanged */
+      break;
+    }
+    while(changed < 0xff && i + changed < snapshot_len
+          && (i + changed >= base_len || base[i + changed] != snapshot[i + changed])) {
+      changed++;
+    }
+    put_u8(&w, skip);
+    put_u8(&w, changed);
+    while(changed-- > 0) {
+      put_u8(&w, snapshot[i++]);
+    }
+  }
+
+  return w.pos <= len ? w.pos : -1;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_stats_snapshot_apply_delta(uint8_t *snapshot, int snapshot_len, int max_len,
+                                const uint8_t *delta, int delta_len)
+{
+  int new_len;
+  int pos = 2;
+  int i = 0;
+
+  if(delta_len < 2) {
+    return -1;
+  }
+  new_len = delta[0] | (delta[1] << 8);
+  if(new_len > max_len) {
+    return -1;
+  }
+  while(pos + 2 <= delta_len) {
+    int skip = delta[pos];
+    int changed = delta[pos + 1];
+    pos += 2;
+    /* Skipped bytes must be in the base, changed ones in the new snapshot */
+    if((skip > 0 && i + skip > snapshot_len)
+       || i + skip + changed > new_len || pos + changed > delta_len) {
+      return -1;
+    }
+    i += skip;
+    memcpy(snapshot + i, delta + pos, changed);
+    pos += changed;
+    i += changed;
+  }
+  if(pos != delta_len || (new_len > snapshot_len && i < new_len)) {
+    return -1;
+  }
+  return new_len;
+}
+/*---------------------------------------------------------------------------*/
 /* Periodic timer called every TSCH_STATS_DECAY_INTERVAL ticks */
 static void
 periodic(void *ptr)
@@ -227,6 +507,9 @@ periodic(void *ptr)
     TSCH_STATS_EWMA_UPDATE(stats[i].lqi, TSCH_STATS_DEFAULT_LQI);
     /* decay Tx stats */
     TSCH_STATS_EWMA_UPDATE(stats[i].p_tx_success, TSCH_STATS_DEFAULT_P_TX);
+#if TSCH_STATS_CHANNEL_TX
+    TSCH_STATS_EWMA_UPDATE(tsch_stats.channel_tx_success_ewma[i], TSCH_STATS_DEFAULT_P_TX);
+#endif /* TSCH_STATS_CHANNEL_TX */
   }
 
   ctimer_set(&periodic_timer, TSCH_STATS_DECAY_INTERVAL, periodic, NULL);
@@ -234,3 +517,67 @@ periodic(void *ptr)
 /*---------------------------------------------------------------------------*/
 #endif /* TSCH_STATS_ON */
 /*---------------------------------------------------------------------------*/
+#if TSCH_STATS_PER_CELL
+/*---------------------------------------------------------------------------*/
+
+/* Per-cell counters, indexed by the position of the link in the link pool.
+ * An entry belongs to the link whose handle it holds; it is reset when the
+ * position is reused by a new link. */
+static struct tsch_cell_stats cell_stats[TSCH_SCHEDULE_MAX_LINKS];
+
+/*---------------------------------------------------------------------------*/
+static struct tsch_cell_stats *
+get_cell_stats(const struct tsch_link *l)
+{
+  struct tsch_cell_stats *stats;
+  int index = tsch_schedule_get_link_index(l);
+  if(index < 0) {
+    return NULL;
+  }
+  stats = &cell_stats[index];
+  if(stats->link_handle != l->handle) {
+    stats->link_handle = l->handle;
+    stats->tx_attempts = 0;
+    stats->tx_acked = 0;
+    stats->rx = 0;
+  }
+  return stats;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_stats_cell_tx(const struct tsch_link *l, uint8_t mac_status)
+{
+  struct tsch_cell_stats *stats = get_cell_stats(l);
+  if(stats != NULL) {
+    if(stats->tx_attempts >= TSCH_STATS_CELL_TX_WINDOW) {
+      stats->tx_attempts /= 2;
+      stats->tx_acked /= 2;
+    }
+    stats->tx_attempts++;
+    if(mac_status == MAC_TX_OK) {
+      stats->tx_acked++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_stats_cell_rx(const struct tsch_link *l)
+{
+  struct tsch_cell_stats *stats = get_cell_stats(l);
+  if(stats != NULL && stats->rx < 0xffff) {
+    stats->rx++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+const struct tsch_cell_stats *
+tsch_stats_get_cell(const struct tsch_link *l)
+{
+  int index = tsch_schedule_get_link_index(l);
+  if(index < 0 || cell_stats[index].link_handle != l->handle) {
+    return NULL;
+  }
+  return &cell_stats[index];
+}
+/*---------------------------------------------------------------------------*/
+#endif /* TSCH_STATS_PER_CELL */
+/*---------------------------------------------------------------------------*/
@@ -46,6 +46,7 @@
 
 #include "contiki.h"
 #include "net/linkaddr.h"
+#include "net/nbr-table.h"
 #include "net/mac/tsch/tsch-conf.h"
 #include "net/mac/tsch/tsch-queue.h"
 
@@ -65,6 +66,30 @@
 #define TSCH_STATS_SAMPLE_NOISE_RSSI 0
 #endif
 
+/* Enable the collection of the per-channel unicast Tx success ratio, over
+ * all neighbors? */
+#ifdef TSCH_STATS_CONF_CHANNEL_TX
+#define TSCH_STATS_CHANNEL_TX TSCH_STATS_CONF_CHANNEL_TX
+#else
+#define TSCH_STATS_CHANNEL_TX 0
+#endif
+
+/* Enable the collection of per-cell Tx and Rx counters? Independent of
+ * TSCH_STATS_ON */
+#ifdef TSCH_STATS_CONF_PER_CELL
+#define TSCH_STATS_PER_CELL TSCH_STATS_CONF_PER_CELL
+#else
+#define TSCH_STATS_PER_CELL 0
+#endif
+
+/* Per-cell Tx counters are halved whenever the number of attempts reaches
+ * this value, so that the cell PDR reflects recent transmissions */
+#ifdef TSCH_STATS_CONF_CELL_TX_WINDOW
+#define TSCH_STATS_CELL_TX_WINDOW TSCH_STATS_CONF_CELL_TX_WINDOW
+#else
+#define TSCH_STATS_CELL_TX_WINDOW 128
+#endif
+
 /*
  * How to update a TSCH statistic.
  * Uses a hardcoded EWMA alpha value equal to 0.125 by default.
@@ -109,6 +134,31 @@
 #define TSCH_STATS_FIRST_CHANNEL 11
 #endif
 
+/* Version of the binary snapshot format, see tsch_stats_snapshot() */
+#define TSCH_STATS_SNAPSHOT_VERSION 1
+
+/* The sections of a snapshot, flagged in its header */
+#define TSCH_STATS_SNAPSHOT_GLOBAL     0x01
+#define TSCH_STATS_SNAPSHOT_NEIGHBORS  0x02
+#define TSCH_STATS_SNAPSHOT_CHANNELS   0x04
+#define TSCH_STATS_SNAPSHOT_SLOTFRAMES 0x08
+/* Slotframe entries include per-cell counters (see TSCH_STATS_PER_CELL) */
+#define TSCH_STATS_SNAPSHOT_CELLS      0x10
+
+/* The size of the snapshot sections */
+#define TSCH_STATS_SNAPSHOT_HEADER_LEN    2
+#define TSCH_STATS_SNAPSHOT_GLOBAL_LEN    14
+#define TSCH_STATS_SNAPSHOT_NEIGHBOR_LEN  (LINKADDR_SIZE + 6)
+#define TSCH_STATS_SNAPSHOT_CHANNEL_LEN   2
+#define TSCH_STATS_SNAPSHOT_SLOTFRAME_LEN (6 + (TSCH_STATS_PER_CELL ? 6 : 0))
+
+/* The maximum length of a snapshot */
+#define TSCH_STATS_SNAPSHOT_MAX_LEN \
+  (TSCH_STATS_SNAPSHOT_HEADER_LEN + TSCH_STATS_SNAPSHOT_GLOBAL_LEN \
+   + 1 + NBR_TABLE_MAX_NEIGHBORS * TSCH_STATS_SNAPSHOT_NEIGHBOR_LEN \
+   + 2 + TSCH_STATS_NUM_CHANNELS * TSCH_STATS_SNAPSHOT_CHANNEL_LEN \
+   + 1 + TSCH_SCHEDULE_MAX_SLOTFRAMES * TSCH_STATS_SNAPSHOT_SLOTFRAME_LEN)
+
 /* Internal: the scaling of the various stats */
 #define TSCH_STATS_RSSI_SCALING_FACTOR    -16
 #define TSCH_STATS_LQI_SCALING_FACTOR      16
@@ -143,12 +193,19 @@ struct tsch_global_stats {
   uint32_t max_sync_error;
   /* number of disassociations */
   uint16_t num_disassociations;
+  /* high-water marks of the number of queued packets, in total and for a neighbor */
+  uint8_t queue_high_water;
+  uint8_t nbr_queue_high_water;
 #if TSCH_STATS_SAMPLE_NOISE_RSSI
   /* per-channel noise estimates */
   tsch_stat_t noise_rssi[TSCH_STATS_NUM_CHANNELS];
   /* derived from `noise_rssi` and BUSY_CHANNEL_RSSI */
   tsch_stat_t channel_free_ewma[TSCH_STATS_NUM_CHANNELS];
 #endif /* TSCH_STATS_SAMPLE_NOISE_RSSI */
+#if TSCH_STATS_CHANNEL_TX
+  /* per-channel EWMA of probability, for unicast transmissions to any neighbor */
+  tsch_stat_t channel_tx_success_ewma[TSCH_STATS_NUM_CHANNELS];
+#endif /* TSCH_STATS_CHANNEL_TX */
 };
 
 struct tsch_channel_stats {
@@ -164,7 +221,20 @@ struct tsch_neighbor_stats {
   struct tsch_channel_stats channel_stats[TSCH_STATS_NUM_CHANNELS];
 };
 
+/* Counters of a cell, i.e. of a (slotframe, timeslot, channel offset) link.
+ * Bursts are not accounted for, as they use the following timeslots */
+struct tsch_cell_stats {
+  /* Handle of the link the counters belong to */
+  uint16_t link_handle;
+  /* Unicast transmission attempts, and acknowledged ones */
+  uint16_t tx_attempts;
+  uint16_t tx_acked;
+  /* Frames received */
+  uint16_t rx;
+};
+
 struct tsch_neighbor; /* Forward declaration */
+struct tsch_link; /* Forward declaration */
 
 
 /************ External variables ***********/
@@ -194,6 +264,53 @@ struct tsch_neighbor_stats *tsch_stats_get_from_neighbor(struct tsch_neighbor *)
 
 void tsch_stats_reset_neighbor_stats(void);
 
+void tsch_stats_on_packet_queued(const struct tsch_neighbor *);
+
+/**
+ * Serialize the TSCH statistics into a compact binary snapshot.
+ * All fields are little-endian:
+ *   header:     version (u8), sections (u8, TSCH_STATS_SNAPSHOT_*)
+ *   global:     ASN (u32 ls4b, u8 ms1b), max sync error (u32),
+ *               disassociations (u16), queued packets (u8),
+ *               queue high-water mark (u8), neighbor queue high-water mark (u8)
+ *   neighbors:  count (u8), then per neighbor: address (LINKADDR_SIZE),
+ *               flags (u8, 1: time source), RSSI (i8, -128: unknown),
+ *               LQI (u8, 255: unknown), ETX (u16, LINK_STATS_ETX_DIVISOR),
+ *               queued packets (u8)
+ *   channels:   first channel (u8), count (u8), then per channel:
+ *               noise RSSI (i8), busy ratio (u8, in percent)
+ *   slotframes: count (u8), then per slotframe: handle (u16), size (u16),
+ *               Tx links (u8), Rx links (u8), and with TSCH_STATS_SNAPSHOT_CELLS
+ *               the Tx attempts (u16), acked Tx (u16) and Rx (u16) of its cells
+ *
+ * \param buf The buffer to write the snapshot to
+ * \param len The buffer length, TSCH_STATS_SNAPSHOT_MAX_LEN is always enough
+ * \return The snapshot length, -1 if the buffer is too short
+ */
+int tsch_stats_snapshot(uint8_t *buf, int len);
+
+/**
+ * Encode a snapshot as a delta from a previous one: the new length (u16),
+ * followed by runs of unchanged bytes to skip (u8) and changed bytes (u8
+ * count, then the bytes).
+ *
+ * \return The delta length, -1 if the buffer is too short
+ */
+int tsch_stats_snapshot_delta(const uint8_t *base, int base_len,
+                              const uint8_t *snapshot, int snapshot_len,
+                              uint8_t *buf, int len);
+
+/**
+ * Apply a delta to a snapshot, in place
+ *
+ * \param snapshot The snapshot the delta was computed from
+ * \param snapshot_len Its length
+ * \param max_len The size of the snapshot buffer
+ * \return The length of the new snapshot, -1 if the delta is invalid
+ */
+int tsch_stats_snapshot_apply_delta(uint8_t *snapshot, int snapshot_len, int max_len,
+                                    const uint8_t *delta, int delta_len);
+
 #else /* TSCH_STATS_ON */
 
 #define tsch_stats_init()
@@ -203,9 +320,29 @@ void tsch_stats_reset_neighbor_stats(void);
 #define tsch_stats_sample_rssi()
 #define tsch_stats_get_from_neighbor(neighbor) NULL
 #define tsch_stats_reset_neighbor_stats()
+#define tsch_stats_on_packet_queued(n)
 
 #endif /* TSCH_STATS_ON */
 
+#if TSCH_STATS_PER_CELL
+
+/* Called from slot operation after a unicast transmission in a link */
+void tsch_stats_cell_tx(const struct tsch_link *, uint8_t mac_status);
+
+/* Called from slot operation after a reception in a link */
+void tsch_stats_cell_rx(const struct tsch_link *);
+
+/* The counters of a link, NULL if none were collected yet */
+const struct tsch_cell_stats *tsch_stats_get_cell(const struct tsch_link *);
+
+#else /* TSCH_STATS_PER_CELL */
+
+#define tsch_stats_cell_tx(l, mac_status)
+#define tsch_stats_cell_rx(l)
+#define tsch_stats_get_cell(l) NULL
+
+#endif /* TSCH_STATS_PER_CELL */
+
 static inline uint8_t
 tsch_stats_channel_to_index(uint8_t channel)
 {
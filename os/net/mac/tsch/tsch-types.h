@@ -89,10 +89,30 @@ struct tsch_slotframe {
   /* Number of timeslots in the slotframe.
    * Stored as struct asn_divisor_t because we often need ASN%size */
   struct tsch_asn_divisor_t size;
+#if TSCH_WITH_SCHEDULE_LEVEL
+  /* A size change scheduled at a given ASN, if next_size.val is non-zero */
+  struct tsch_asn_divisor_t next_size;
+  struct tsch_asn_t next_size_asn;
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
   /* List of links belonging to this slotframe */
   LIST_STRUCT(links_list);
 };
 
+/** \brief Network-wide schedule level, advertised in EBs */
+struct tsch_schedule_level {
+  uint8_t level; /* The level in use until switch_asn */
+  uint8_t next_level; /* The level in use from switch_asn on */
+  struct tsch_asn_t switch_asn;
+};
+
+/** \brief Network-wide channel blacklist, advertised in EBs. Bit i stands for
+ * channel TSCH_CHANNEL_MAP_FIRST_CHANNEL + i */
+struct tsch_channel_map {
+  uint16_t blacklist; /* The blacklist in use until switch_asn */
+  uint16_t next_blacklist; /* The blacklist in use from switch_asn on */
+  struct tsch_asn_t switch_asn;
+};
+
 /** \brief TSCH packet information */
 struct tsch_packet {
   struct queuebuf *qb;  /* pointer to the queuebuf to be sent */
@@ -103,6 +123,24 @@ struct tsch_packet {
   uint8_t ret; /* status -- MAC return code */
   uint8_t header_len; /* length of header and header IEs (needed for link-layer security) */
   uint8_t tsch_sync_ie_offset; /* Offset within the frame used for quick update of EB ASN and join priority */
+  uint8_t is_prestaged; /* Was the frame built ahead of its Tx slot? (see TSCH_WITH_PRESTAGING) */
+};
+
+/** \brief Relative drift of a neighbor, with TSCH_ADAPTIVE_TIMESYNC_FUSION */
+struct tsch_timesync_nbr {
+  struct tsch_asn_t last_asn; /* ASN of the reference measurement */
+  int32_t last_offset; /* Offset at the reference, plus all local adjustments so far */
+  int32_t drift_ppm; /* Relative drift, ppm * 256 */
+  uint8_t has_reference; /* Are last_asn and last_offset valid? */
+  uint8_t num_samples; /* Number of drift samples, saturated */
+};
+
+/** \brief Rx guard time state of a neighbor, with TSCH_ADAPTIVE_GUARD_TIME */
+struct tsch_guard_time_nbr {
+  struct tsch_asn_t last_asn; /* ASN of the last offset measurement */
+  uint16_t offset_avg; /* Moving average of the absolute offset, rtimer ticks * 8 */
+  uint8_t idle_count; /* Consecutive idle Rx slots with a narrowed guard time */
+  uint8_t is_valid; /* Was any offset measured yet? */
 };
 
 /** \brief TSCH neighbor information */
@@ -113,11 +151,19 @@ struct tsch_neighbor {
   uint16_t backoff_window; /* CSMA backoff window (number of slots to skip) */
   uint8_t tx_links_count; /* How many links do we have to this neighbor? */
   uint8_t dedicated_tx_links_count; /* How many dedicated links do we have to this neighbor? */
+  uint8_t burst_max_len; /* Max number of frames sent back-to-back to this neighbor in a burst */
+  uint16_t tx_attempts; /* Unicast transmission attempts, wraps around (for scheduling functions) */
   /* Array for the ringbuf. Contains pointers to packets.
    * Its size must be a power of two to allow for atomic put */
   struct tsch_packet *tx_array[TSCH_QUEUE_NUM_PER_NEIGHBOR];
   /* Circular buffer of pointers to packet. */
   struct ringbufindex tx_ringbuf;
+#if TSCH_ADAPTIVE_TIMESYNC_FUSION
+  struct tsch_timesync_nbr timesync; /* Relative drift to this neighbor */
+#endif /* TSCH_ADAPTIVE_TIMESYNC_FUSION */
+#if TSCH_ADAPTIVE_GUARD_TIME
+  struct tsch_guard_time_nbr guard; /* Rx guard time for links with this neighbor */
+#endif /* TSCH_ADAPTIVE_GUARD_TIME */
 };
 
 /** \brief TSCH timeslot timing elements. Used to index timeslot timing
@@ -82,6 +82,19 @@ static linkaddr_t last_eb_nbr_addr;
 /* The join priority advertised by last_eb_nbr_addr */
 static uint8_t last_eb_nbr_jp;
 
+#if TSCH_WITH_SCHEDULE_LEVEL
+/* The schedule level we advertise in EBs, valid if schedule_level_is_set */
+static struct tsch_schedule_level schedule_level;
+static uint8_t schedule_level_is_set;
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+
+#if TSCH_WITH_CHANNEL_MAP
+/* The channel map we advertise in EBs and apply to the hopping sequence,
+ * valid if channel_map_is_set. Read by slot operation */
+static struct tsch_channel_map channel_map;
+static uint8_t channel_map_is_set;
+#endif /* TSCH_WITH_CHANNEL_MAP */
+
 /* Let TSCH select a time source with no help of an upper layer.
  * We do so using statistics from incoming EBs */
 #if TSCH_AUTOSELECT_TIME_SOURCE
@@ -190,6 +203,112 @@ tsch_set_join_priority(uint8_t jp)
   tsch_join_priority = jp;
 }
 /*---------------------------------------------------------------------------*/
+#if TSCH_WITH_SCHEDULE_LEVEL
+void
+tsch_set_schedule_level(const struct tsch_schedule_level *sl)
+{
+  schedule_level = *sl;
+  schedule_level_is_set = 1;
+#if TSCH_ADAPTIVE_BEACONING
+  /* Get the new level across the network quickly */
+  tsch_adaptive_beaconing_inconsistency("schedule level");
+#endif /* TSCH_ADAPTIVE_BEACONING */
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_get_schedule_level(struct tsch_schedule_level *sl)
+{
+  if(schedule_level_is_set && sl != NULL) {
+    *sl = schedule_level;
+  }
+  return schedule_level_is_set;
+}
+/*---------------------------------------------------------------------------*/
+/* Adopt the schedule level advertised in an EB from our time source */
+static void
+schedule_level_input(const struct ieee802154_ies *ies)
+{
+  const struct tsch_schedule_level *sl = &ies->ie_schedule_level;
+  if(ies->ie_schedule_level_id == 0) {
+    return;
+  }
+  if(!schedule_level_is_set
+     || sl->level != schedule_level.level
+     || sl->next_level != schedule_level.next_level
+     || sl->switch_asn.ls4b != schedule_level.switch_asn.ls4b
+     || sl->switch_asn.ms1b != schedule_level.switch_asn.ms1b) {
+    LOG_INFO("schedule level %u, %u from asn-%x.%"PRIx32"\n",
+             sl->level, sl->next_level, sl->switch_asn.ms1b, sl->switch_asn.ls4b);
+    tsch_set_schedule_level(sl);
+#ifdef TSCH_CALLBACK_SCHEDULE_LEVEL_UPDATED
+    TSCH_CALLBACK_SCHEDULE_LEVEL_UPDATED();
+#endif /* TSCH_CALLBACK_SCHEDULE_LEVEL_UPDATED */
+  }
+}
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+/*---------------------------------------------------------------------------*/
+#if TSCH_WITH_CHANNEL_MAP
+int
+tsch_set_channel_map(const struct tsch_channel_map *cm)
+{
+  /* Slot operation must never see a half-updated map */
+  if(!tsch_get_lock()) {
+    LOG_WARN("! failed to set the channel map, TSCH busy\n");
+    return 0;
+  }
+  channel_map = *cm;
+  channel_map_is_set = 1;
+  tsch_release_lock();
+#if TSCH_ADAPTIVE_BEACONING
+  /* Get the new map across the network quickly */
+  tsch_adaptive_beaconing_inconsistency("channel map");
+#endif /* TSCH_ADAPTIVE_BEACONING */
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_get_channel_map(struct tsch_channel_map *cm)
+{
+  if(channel_map_is_set && cm != NULL) {
+    *cm = channel_map;
+  }
+  return channel_map_is_set;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+tsch_get_channel_blacklist(const struct tsch_asn_t *asn)
+{
+  if(!channel_map_is_set) {
+    return 0;
+  }
+  if((int32_t)TSCH_ASN_DIFF(*asn, channel_map.switch_asn) >= 0) {
+    return channel_map.next_blacklist;
+  }
+  return channel_map.blacklist;
+}
+/*---------------------------------------------------------------------------*/
+/* Adopt the channel map advertised in an EB from our time source */
+static void
+channel_map_input(const struct ieee802154_ies *ies)
+{
+  const struct tsch_channel_map *cm = &ies->ie_channel_map;
+  if(ies->ie_channel_map_id == 0) {
+    return;
+  }
+  if(!channel_map_is_set
+     || cm->blacklist != channel_map.blacklist
+     || cm->next_blacklist != channel_map.next_blacklist
+     || cm->switch_asn.ls4b != channel_map.switch_asn.ls4b
+     || cm->switch_asn.ms1b != channel_map.switch_asn.ms1b) {
+    LOG_INFO("channel blacklist %04x, %04x from asn-%x.%"PRIx32"\n",
+             cm->blacklist, cm->next_blacklist,
+             cm->switch_asn.ms1b, cm->switch_asn.ls4b);
+    /* On failure, the next EB carrying the map sets it again */
+    tsch_set_channel_map(cm);
+  }
+}
+#endif /* TSCH_WITH_CHANNEL_MAP */
+/*---------------------------------------------------------------------------*/
 void
 tsch_set_ka_timeout(uint32_t timeout)
 {
@@ -229,6 +348,12 @@ tsch_reset(void)
   TSCH_CALLBACK_LEAVING_NETWORK();
 #endif
   linkaddr_copy(&last_eb_nbr_addr, &linkaddr_null);
+#if TSCH_WITH_SCHEDULE_LEVEL
+  schedule_level_is_set = 0;
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+#if TSCH_WITH_CHANNEL_MAP
+  channel_map_is_set = 0;
+#endif /* TSCH_WITH_CHANNEL_MAP */
 #if TSCH_AUTOSELECT_TIME_SOURCE
   struct eb_stat *stat;
   best_neighbor_eb_count = 0;
@@ -241,6 +366,9 @@ tsch_reset(void)
 #endif /* TSCH_AUTOSELECT_TIME_SOURCE */
   tsch_set_eb_period(TSCH_EB_PERIOD);
   keepalive_status = KEEPALIVE_SCHEDULING_UNCHANGED;
+#if TSCH_ADAPTIVE_BEACONING
+  tsch_adaptive_beaconing_stop();
+#endif /* TSCH_ADAPTIVE_BEACONING */
 }
 /* TSCH keep-alive functions */
 
@@ -301,8 +429,17 @@ keepalive_packet_sent(void *ptr, int status, int transmissions)
 
   /* We got no ack, try to resynchronize */
   if(status == MAC_TX_NOACK) {
+#if TSCH_ADAPTIVE_BEACONING
+    tsch_adaptive_beaconing_inconsistency("keep-alive not acked");
+#endif /* TSCH_ADAPTIVE_BEACONING */
     schedule_next_keepalive = !resynchronize(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
   }
+#if TSCH_ADAPTIVE_BEACONING
+  else if(status == MAC_TX_OK) {
+    /* The time source is still there, stretch the keep-alive timeout */
+    tsch_adaptive_beaconing_keepalive_acked();
+  }
+#endif /* TSCH_ADAPTIVE_BEACONING */
 
   if(schedule_next_keepalive) {
     tsch_schedule_keepalive(0);
@@ -363,13 +500,18 @@ tsch_keepalive_process_pending(void)
 
       case KEEPALIVE_SCHEDULE_OR_STOP:
         if(tsch_current_ka_timeout > 0) {
-          /* Pick a delay in the range [tsch_current_ka_timeout*0.9, tsch_current_ka_timeout[ */
+          clock_time_t ka_timeout = tsch_current_ka_timeout;
           unsigned long delay;
-          if(tsch_current_ka_timeout >= 10) {
-            delay = (tsch_current_ka_timeout - tsch_current_ka_timeout / 10)
-                + random_rand() % (tsch_current_ka_timeout / 10);
+#if TSCH_ADAPTIVE_BEACONING
+          /* Short timeout after an inconsistency, long once the network is stable */
+          ka_timeout = tsch_adaptive_beaconing_keepalive_timeout(ka_timeout);
+#endif /* TSCH_ADAPTIVE_BEACONING */
+          /* Pick a delay in the range [ka_timeout*0.9, ka_timeout[ */
+          if(ka_timeout >= 10) {
+            delay = (ka_timeout - ka_timeout / 10)
+                + random_rand() % (ka_timeout / 10);
           } else {
-            delay = tsch_current_ka_timeout - 1;
+            delay = ka_timeout - 1;
           }
           ctimer_set(&keepalive_timer, delay, keepalive_send, NULL);
         } else {
@@ -443,6 +585,15 @@ eb_input(struct input_packet *current_input)
     }
 #endif /* TSCH_AUTOSELECT_TIME_SOURCE */
 
+#if TSCH_ADAPTIVE_BEACONING
+    /* An EB consistent with our state, from a neighbor at least as close to
+     * the PAN coordinator as we are, makes our next EB redundant */
+    if(TSCH_ASN_DIFF(current_input->rx_asn, eb_ies.ie_asn) == 0
+       && eb_ies.ie_join_priority <= tsch_join_priority) {
+      tsch_adaptive_beaconing_consistency();
+    }
+#endif /* TSCH_ADAPTIVE_BEACONING */
+
     /* If this EB is coming from the root, add it to the root list */
     if(eb_ies.ie_join_priority == 0) {
       tsch_roots_add_address((linkaddr_t *)&frame.src_addr);
@@ -450,6 +601,11 @@ eb_input(struct input_packet *current_input)
 
     /* Did the EB come from our time source? */
     if(ts_addr != NULL && linkaddr_cmp((linkaddr_t *)&frame.src_addr, ts_addr)) {
+#if TSCH_FAST_JOIN
+      /* Keep track of the network for the next join */
+      tsch_fast_join_time_source_eb(ts_addr, &current_input->rx_asn, current_input->channel);
+#endif /* TSCH_FAST_JOIN */
+
       /* Check for ASN drift */
       int32_t asn_diff = TSCH_ASN_DIFF(current_input->rx_asn, eb_ies.ie_asn);
       if(asn_diff != 0) {
@@ -490,6 +646,13 @@ eb_input(struct input_packet *current_input)
           }
         }
       }
+
+#if TSCH_WITH_SCHEDULE_LEVEL
+      schedule_level_input(&eb_ies);
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+#if TSCH_WITH_CHANNEL_MAP
+      channel_map_input(&eb_ies);
+#endif /* TSCH_WITH_CHANNEL_MAP */
     }
   }
 }
@@ -560,6 +723,10 @@ tsch_tx_process_pending(void)
   if(num_packets_freed > 0) {
     /* Free all unused neighbors */
     tsch_queue_free_unused_neighbors();
+#if WITH_SWAP
+    /* Use the freed RAM for the next packets to send */
+    tsch_queue_swap_in();
+#endif /* WITH_SWAP */
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -752,10 +919,21 @@ tsch_associate(const struct input_packet *input_eb, rtimer_clock_t timestamp)
         tsch_roots_add_address((linkaddr_t *)&frame.src_addr);
       }
 
+#if TSCH_WITH_SCHEDULE_LEVEL
+      schedule_level_input(&ies);
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+#if TSCH_WITH_CHANNEL_MAP
+      channel_map_input(&ies);
+#endif /* TSCH_WITH_CHANNEL_MAP */
+
 #ifdef TSCH_CALLBACK_JOINING_NETWORK
       TSCH_CALLBACK_JOINING_NETWORK();
 #endif
 
+#if TSCH_FAST_JOIN
+      tsch_fast_join_associated((linkaddr_t *)&frame.src_addr);
+#endif /* TSCH_FAST_JOIN */
+
       tsch_association_count++;
       LOG_INFO("association done (%u), sec %u, PAN ID %x, asn-%x.%"PRIx32", jp %u, timeslot id %u, hopping id %u, slotframe len %u with %u links, from ",
              tsch_association_count,
@@ -795,6 +973,9 @@ PT_THREAD(tsch_scan(struct pt *pt))
 
   etimer_set(&scan_timer, MAX(1, CLOCK_SECOND / TSCH_ASSOCIATION_POLL_FREQUENCY));
   current_channel_since = clock_time();
+#if TSCH_FAST_JOIN
+  tsch_fast_join_scan_start();
+#endif /* TSCH_FAST_JOIN */
 
   while(!tsch_is_associated && !tsch_is_coordinator) {
     /* Hop to any channel offset */
@@ -806,6 +987,21 @@ PT_THREAD(tsch_scan(struct pt *pt))
     clock_time_t now_time = clock_time();
 
     /* Switch to a (new) channel for scanning */
+#if TSCH_FAST_JOIN
+    {
+      /* Follow the predicted EB channel, or pick a channel not found dead */
+      int dwell_expired = now_time - current_channel_since > TSCH_CHANNEL_SCAN_DURATION;
+      uint8_t scan_channel = tsch_fast_join_scan_channel(current_channel, dwell_expired);
+
+      if(scan_channel != current_channel || dwell_expired) {
+        NETSTACK_RADIO.set_value(RADIO_PARAM_CHANNEL, scan_channel);
+        current_channel = scan_channel;
+        LOG_DBG("scanning on channel %u\n", scan_channel);
+
+        current_channel_since = now_time;
+      }
+    }
+#else /* TSCH_FAST_JOIN */
     if(current_channel == 0 || now_time - current_channel_since > TSCH_CHANNEL_SCAN_DURATION) {
       /* Pick a channel at random in TSCH_JOIN_HOPPING_SEQUENCE */
       uint8_t scan_channel = TSCH_JOIN_HOPPING_SEQUENCE[
@@ -817,6 +1013,7 @@ PT_THREAD(tsch_scan(struct pt *pt))
 
       current_channel_since = now_time;
     }
+#endif /* TSCH_FAST_JOIN */
 
     /* Turn radio on and wait for EB */
     NETSTACK_RADIO.on();
@@ -828,6 +1025,13 @@ PT_THREAD(tsch_scan(struct pt *pt))
       RTIMER_BUSYWAIT_UNTIL_ABS((is_packet_pending = NETSTACK_RADIO.pending_packet()), t0, RTIMER_SECOND / 100);
     }
 
+#if TSCH_FAST_JOIN
+    /* Energy detection: is anyone using this channel? */
+    if(is_packet_pending || NETSTACK_RADIO.channel_clear() == 0) {
+      tsch_fast_join_channel_activity();
+    }
+#endif /* TSCH_FAST_JOIN */
+
     if(is_packet_pending) {
       rtimer_clock_t t1;
       /* Read packet */
@@ -889,6 +1093,11 @@ PROCESS_THREAD(tsch_process, ev, data)
     /* We are part of a TSCH network, start slot operation */
     tsch_slot_operation_start();
 
+#if TSCH_ADAPTIVE_BEACONING
+    /* Start from short EB and keep-alive intervals */
+    tsch_adaptive_beaconing_start();
+#endif /* TSCH_ADAPTIVE_BEACONING */
+
     /* Yield our main process. Slot operation will re-schedule itself
      * as long as we are associated */
     PROCESS_YIELD_UNTIL(!tsch_is_associated);
@@ -920,12 +1129,19 @@ PROCESS_THREAD(tsch_send_eb_process, ev, data)
 
   /* Set an initial delay except for coordinator, which should send an EB asap */
   if(!tsch_is_coordinator) {
+#if TSCH_ADAPTIVE_BEACONING
+    /* The Trickle timer picks the initial delay */
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+#else /* TSCH_ADAPTIVE_BEACONING */
     etimer_set(&eb_timer, TSCH_EB_PERIOD ? random_rand() % TSCH_EB_PERIOD : 0);
     PROCESS_WAIT_UNTIL(etimer_expired(&eb_timer));
+#endif /* TSCH_ADAPTIVE_BEACONING */
   }
 
   while(1) {
+#if !TSCH_ADAPTIVE_BEACONING
     unsigned long delay;
+#endif /* !TSCH_ADAPTIVE_BEACONING */
 
     if(!tsch_is_associated) {
       LOG_DBG("skip sending EB: not joined a TSCH network\n");
@@ -959,6 +1175,10 @@ PROCESS_THREAD(tsch_send_eb_process, ev, data)
         }
       }
     }
+#if TSCH_ADAPTIVE_BEACONING
+    /* Next EB transmission when the Trickle timer fires */
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+#else /* TSCH_ADAPTIVE_BEACONING */
     if(tsch_current_eb_period > 0) {
       /* Next EB transmission with a random delay
        * within [tsch_current_eb_period*0.75, tsch_current_eb_period[ */
@@ -969,6 +1189,7 @@ PROCESS_THREAD(tsch_send_eb_process, ev, data)
     }
     etimer_set(&eb_timer, delay);
     PROCESS_WAIT_UNTIL(etimer_expired(&eb_timer));
+#endif /* TSCH_ADAPTIVE_BEACONING */
   }
   PROCESS_END();
 }
@@ -1067,6 +1288,15 @@ tsch_init(void)
 #endif /* TSCH_AUTOSELECT_TIME_SOURCE */
   tsch_reset();
   tsch_queue_init();
+#if TSCH_ADAPTIVE_BEACONING
+  tsch_adaptive_beaconing_init();
+#endif /* TSCH_ADAPTIVE_BEACONING */
+#if TSCH_FAST_JOIN
+  tsch_fast_join_init();
+#endif /* TSCH_FAST_JOIN */
+#if TSCH_WITH_DUPLICATE_WINDOW
+  tsch_duplicate_window_init();
+#endif /* TSCH_WITH_DUPLICATE_WINDOW */
   tsch_schedule_init();
   tsch_log_init();
   ringbufindex_init(&input_ringbuf, TSCH_MAX_INCOMING_PACKETS);
@@ -1183,6 +1413,21 @@ send_packet(mac_callback_t sent, void *ptr)
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Is the frame in packetbuf a duplicate? If not, record its sequence number */
+static int
+check_duplicate(void)
+{
+#if TSCH_WITH_DUPLICATE_WINDOW
+  return tsch_duplicate_window_check();
+#else /* TSCH_WITH_DUPLICATE_WINDOW */
+  if(mac_sequence_is_duplicate()) {
+    return 1;
+  }
+  mac_sequence_register_seqno();
+  return 0;
+#endif /* TSCH_WITH_DUPLICATE_WINDOW */
+}
+/*---------------------------------------------------------------------------*/
 static void
 packet_input(void)
 {
@@ -1198,18 +1443,21 @@ packet_input(void)
     /* Seqno of 0xffff means no seqno */
     if(packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO) != 0xffff) {
       /* Check for duplicates */
-      duplicate = mac_sequence_is_duplicate();
+      duplicate = check_duplicate();
       if(duplicate) {
         /* Drop the packet. */
         LOG_WARN("! drop dup ll from ");
         LOG_WARN_LLADDR(packetbuf_addr(PACKETBUF_ADDR_SENDER));
         LOG_WARN_(" seqno %u\n", packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO));
-      } else {
-        mac_sequence_register_seqno();
       }
     }
 
     if(!duplicate) {
+#if TSCH_ADAPTIVE_BEACONING
+      linkaddr_t sender;
+      int known_sender;
+#endif /* TSCH_ADAPTIVE_BEACONING */
+
       LOG_INFO("received from ");
       LOG_INFO_LLADDR(packetbuf_addr(PACKETBUF_ADDR_SENDER));
       LOG_INFO_(" with seqno %u\n", packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO));
@@ -1220,7 +1468,19 @@ packet_input(void)
 #if TSCH_WITH_INT
       inband_network_telemetry_input();
 #endif
+#if TSCH_ADAPTIVE_BEACONING
+      linkaddr_copy(&sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+      known_sender = link_stats_from_lladdr(&sender) != NULL;
+#endif /* TSCH_ADAPTIVE_BEACONING */
       NETSTACK_NETWORK.input();
+#if TSCH_ADAPTIVE_BEACONING
+      if(!known_sender && link_stats_from_lladdr(&sender) != NULL) {
+        /* The network layer just added the sender to link-stats: a node
+           is joining. A full link-stats table adds no entry, and must not
+           reset the EB period on every packet. */
+        tsch_adaptive_beaconing_inconsistency("new neighbor");
+      }
+#endif /* TSCH_ADAPTIVE_BEACONING */
     }
   }
 }
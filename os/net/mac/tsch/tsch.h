@@ -54,6 +54,9 @@ frequency hopping for enhanced reliability.
 #include "net/mac/tsch/tsch-const.h"
 #include "net/mac/tsch/tsch-types.h"
 #include "net/mac/tsch/tsch-adaptive-timesync.h"
+#include "net/mac/tsch/tsch-adaptive-beaconing.h"
+#include "net/mac/tsch/tsch-fast-join.h"
+#include "net/mac/tsch/tsch-duplicate-window.h"
 #include "net/mac/tsch/tsch-slot-operation.h"
 #include "net/mac/tsch/tsch-queue.h"
 #include "net/mac/tsch/tsch-log.h"
@@ -109,6 +112,12 @@ frequency hopping for enhanced reliability.
 #define TSCH_CALLBACK_ROOT_NODE_UPDATED orchestra_callback_root_node_updated
 #endif /* TSCH_CALLBACK_ROOT_NODE_UPDATED */
 
+#if TSCH_WITH_SCHEDULE_LEVEL
+#ifndef TSCH_CALLBACK_SCHEDULE_LEVEL_UPDATED
+#define TSCH_CALLBACK_SCHEDULE_LEVEL_UPDATED orchestra_callback_schedule_level_updated
+#endif /* TSCH_CALLBACK_SCHEDULE_LEVEL_UPDATED */
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+
 #endif /* BUILD_WITH_ORCHESTRA */
 
 /* Called by TSCH when joining a network */
@@ -153,6 +162,11 @@ int TSCH_CALLBACK_PACKET_READY(void);
 void TSCH_CALLBACK_ROOT_NODE_UPDATED(const linkaddr_t *, uint8_t is_added);
 #endif /* TSCH_CALLBACK_ROOT_NODE_UPDATED */
 
+/* Called by TSCH when learning a new schedule level from the time source */
+#ifdef TSCH_CALLBACK_SCHEDULE_LEVEL_UPDATED
+void TSCH_CALLBACK_SCHEDULE_LEVEL_UPDATED(void);
+#endif /* TSCH_CALLBACK_SCHEDULE_LEVEL_UPDATED */
+
 
 /***** External Variables *****/
 
@@ -205,6 +219,46 @@ PROCESS_NAME(tsch_pending_events_process);
  * \param jp the new join priority
  */
 void tsch_set_join_priority(uint8_t jp);
+#if TSCH_WITH_SCHEDULE_LEVEL
+/**
+ * Set the schedule level advertised in our EBs. Done at the PAN coordinator;
+ * other nodes adopt the level of their time source.
+ *
+ * \param sl The schedule level
+ */
+void tsch_set_schedule_level(const struct tsch_schedule_level *sl);
+/**
+ * Get the schedule level, as set locally or learned from the time source
+ *
+ * \param sl Where to store the schedule level
+ * \return 1 if the schedule level is known, 0 otherwise
+ */
+int tsch_get_schedule_level(struct tsch_schedule_level *sl);
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+#if TSCH_WITH_CHANNEL_MAP
+/**
+ * Set the channel map advertised in our EBs. Done at the PAN coordinator;
+ * other nodes adopt the channel map of their time source.
+ *
+ * \param cm The channel map
+ * \return 1 if success, 0 if TSCH was busy and the map was not set
+ */
+int tsch_set_channel_map(const struct tsch_channel_map *cm);
+/**
+ * Get the channel map, as set locally or learned from the time source
+ *
+ * \param cm Where to store the channel map
+ * \return 1 if the channel map is known, 0 otherwise
+ */
+int tsch_get_channel_map(struct tsch_channel_map *cm);
+/**
+ * Get the channel blacklist that applies at a given ASN
+ *
+ * \param asn The ASN
+ * \return The blacklist, 0 if the channel map is not known
+ */
+uint16_t tsch_get_channel_blacklist(const struct tsch_asn_t *asn);
+#endif /* TSCH_WITH_CHANNEL_MAP */
 /**
  * Set the period at wich TSCH enhanced beacons (EBs) are sent. The period can
  * not be set to exceed TSCH_MAX_EB_PERIOD. Set to 0 to stop sending EBs.
@@ -70,6 +70,18 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_LLADDR_HASH
+/* Neighbors hashed by link-layer address. Each bucket chains the indexes
+ * of its keys, stored plus one so that 0 ends a chain */
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t nbr_hash_index_t;
+#else
+typedef uint16_t nbr_hash_index_t;
+#endif
+static nbr_hash_index_t hash_heads[NBR_TABLE_MAX_NEIGHBORS];
+static nbr_hash_index_t hash_next[NBR_TABLE_MAX_NEIGHBORS];
+#endif /* NBR_TABLE_LLADDR_HASH */
+
 /*---------------------------------------------------------------------------*/
 static void remove_key(nbr_table_key_t *key, bool do_free);
 /*---------------------------------------------------------------------------*/
@@ -115,16 +127,67 @@ key_from_item(const nbr_table_t *table, const nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_LLADDR_HASH
+static unsigned
+lladdr_hash(const linkaddr_t *lladdr)
+{
+  unsigned hash = 0;
+  int i;
+
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    hash = hash * 31 + lladdr->u8[i];
+  }
+  return hash % NBR_TABLE_MAX_NEIGHBORS;
+}
+/*---------------------------------------------------------------------------*/
+/* Add a key to its bucket, once its link-layer address is set */
+static void
+hash_add(const nbr_table_key_t *key)
+{
+  unsigned bucket = lladdr_hash(&key->lladdr);
+  int index = index_from_key(key);
+
+  hash_next[index] = hash_heads[bucket];
+  hash_heads[bucket] = index + 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(const nbr_table_key_t *key)
+{
+  nbr_hash_index_t *link = &hash_heads[lladdr_hash(&key->lladdr)];
+  int index = index_from_key(key);
+
+  while(*link != 0) {
+    if(*link == index + 1) {
+      *link = hash_next[index];
+      return;
+    }
+    link = &hash_next[*link - 1];
+  }
+}
+#endif /* NBR_TABLE_LLADDR_HASH */
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
 {
+#if NBR_TABLE_LLADDR_HASH
+  nbr_hash_index_t i;
+#else /* NBR_TABLE_LLADDR_HASH */
   nbr_table_key_t *key;
+#endif /* NBR_TABLE_LLADDR_HASH */
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by linkaddr_null. */
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_LLADDR_HASH
+  for(i = hash_heads[lladdr_hash(lladdr)]; i != 0; i = hash_next[i - 1]) {
+    if(linkaddr_cmp(lladdr, &key_from_index(i - 1)->lladdr)) {
+      return i - 1;
+    }
+  }
+#else /* NBR_TABLE_LLADDR_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -132,6 +195,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     }
     key = list_item_next(key);
   }
+#endif /* NBR_TABLE_LLADDR_HASH */
   return -1;
 }
 /*---------------------------------------------------------------------------*/
@@ -183,6 +247,9 @@ remove_key(nbr_table_key_t *key, bool do_free)
   locked_map[index_from_key(key)] = 0;
   /* Remove neighbor from list */
   list_remove(nbr_table_keys, key);
+#if NBR_TABLE_LLADDR_HASH
+  hash_remove(key);
+#endif /* NBR_TABLE_LLADDR_HASH */
   if(do_free) {
     /* Release the memory */
     memb_free(&neighbor_addr_mem, key);
@@ -430,6 +497,9 @@ nbr_table_add_lladdr(const nbr_table_t *table, const linkaddr_t *lladdr,
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_LLADDR_HASH
+    hash_add(key);
+#endif /* NBR_TABLE_LLADDR_HASH */
   }
 
   /* Get item in the current table */
@@ -51,10 +51,19 @@ typedef enum {
   NBR_TABLE_REASON_LINK_STATS,
   NBR_TABLE_REASON_IPV6_ND_AUTOFILL,
   NBR_TABLE_REASON_SIXTOP,
+  NBR_TABLE_REASON_SICSLOWPAN,
 } nbr_table_reason_t;
 
 #define NBR_TABLE_MAX_NEIGHBORS NBR_TABLE_CONF_MAX_NEIGHBORS
 
+/* Index the neighbors by link-layer address in a hash table, rather than
+ * scanning all of them on every lookup */
+#ifdef NBR_TABLE_CONF_LLADDR_HASH
+#define NBR_TABLE_LLADDR_HASH NBR_TABLE_CONF_LLADDR_HASH
+#else /* NBR_TABLE_CONF_LLADDR_HASH */
+#define NBR_TABLE_LLADDR_HASH 0
+#endif /* NBR_TABLE_CONF_LLADDR_HASH */
+
 #ifdef NBR_TABLE_CONF_GC_GET_WORST
 #define NBR_TABLE_GC_GET_WORST NBR_TABLE_CONF_GC_GET_WORST
 #else /* NBR_TABLE_CONF_GC_GET_WORST */
@@ -47,20 +47,31 @@
 #include "contiki-net.h"
 #include "net/packetbuf.h"
 #include "sys/cc.h"
+#include "lib/memb.h"
 
-struct packetbuf_attr packetbuf_attrs[PACKETBUF_NUM_ATTRS];
-struct packetbuf_addr packetbuf_addrs[PACKETBUF_NUM_ADDRS];
+struct packetbuf_desc {
+  /* The declarations below ensure that the packet buffer is aligned on
+     an even 32-bit boundary. On some platforms (most notably the
+     msp430 or OpenRISC), having a potentially misaligned packet buffer may lead to
+     problems when accessing words. */
+  uint32_t buf_aligned[(PACKETBUF_HEADROOM + PACKETBUF_SIZE + 3) / 4];
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  uint16_t buflen, bufptr;
+  uint8_t hdrlen;
+  uint8_t headroom;
+};
 
+/* The packetbuf is the current descriptor. The default one needs no
+ * allocation, so that the packetbuf is usable without initialization */
+static struct packetbuf_desc default_desc = { .headroom = PACKETBUF_HEADROOM };
+static struct packetbuf_desc *current = &default_desc;
+static uint8_t default_desc_in_use = 1;
+#if PACKETBUF_NUM_DESCS > 0
+MEMB(desc_memb, struct packetbuf_desc, PACKETBUF_NUM_DESCS);
+#endif /* PACKETBUF_NUM_DESCS > 0 */
 
-static uint16_t buflen, bufptr;
-static uint8_t hdrlen;
-
-/* The declarations below ensure that the packet buffer is aligned on
-   an even 32-bit boundary. On some platforms (most notably the
-   msp430 or OpenRISC), having a potentially misaligned packet buffer may lead to
-   problems when accessing words. */
-static uint32_t packetbuf_aligned[(PACKETBUF_SIZE + 3) / 4];
-static uint8_t *packetbuf = (uint8_t *)packetbuf_aligned;
+#define packetbuf ((uint8_t *)current->buf_aligned + current->headroom)
 
 #define DEBUG 0
 #if DEBUG
@@ -74,8 +85,9 @@ static uint8_t *packetbuf = (uint8_t *)packetbuf_aligned;
 void
 packetbuf_clear(void)
 {
-  buflen = bufptr = 0;
-  hdrlen = 0;
+  current->buflen = current->bufptr = 0;
+  current->hdrlen = 0;
+  current->headroom = PACKETBUF_HEADROOM;
 
   packetbuf_attr_clear();
 }
@@ -88,19 +100,19 @@ packetbuf_copyfrom(const void *from, uint16_t len)
   packetbuf_clear();
   l = MIN(PACKETBUF_SIZE, len);
   memcpy(packetbuf, from, l);
-  buflen = l;
+  current->buflen = l;
   return l;
 }
 /*---------------------------------------------------------------------------*/
 int
 packetbuf_copyto(void *to)
 {
-  if(hdrlen + buflen > PACKETBUF_SIZE) {
+  if(current->hdrlen + current->buflen > PACKETBUF_SIZE) {
     return 0;
   }
-  memcpy(to, packetbuf_hdrptr(), hdrlen);
-  memcpy((uint8_t *)to + hdrlen, packetbuf_dataptr(), buflen);
-  return hdrlen + buflen;
+  memcpy(to, packetbuf_hdrptr(), current->hdrlen);
+  memcpy((uint8_t *)to + current->hdrlen, packetbuf_dataptr(), current->buflen);
+  return current->hdrlen + current->buflen;
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -112,23 +124,28 @@ packetbuf_hdralloc(int size)
     return 0;
   }
 
-  /* shift data to the right */
-  for(i = packetbuf_totlen() - 1; i >= 0; i--) {
-    packetbuf[i + size] = packetbuf[i];
+  if(current->headroom >= size) {
+    /* Take the space from the headroom */
+    current->headroom -= size;
+  } else {
+    /* shift data to the right */
+    for(i = packetbuf_totlen() - 1; i >= 0; i--) {
+      packetbuf[i + size] = packetbuf[i];
+    }
   }
-  hdrlen += size;
+  current->hdrlen += size;
   return 1;
 }
 /*---------------------------------------------------------------------------*/
 int
 packetbuf_hdrreduce(int size)
 {
-  if(buflen < size) {
+  if(current->buflen < size) {
     return 0;
   }
 
-  bufptr += size;
-  buflen -= size;
+  current->bufptr += size;
+  current->buflen -= size;
   return 1;
 }
 /*---------------------------------------------------------------------------*/
@@ -136,7 +153,7 @@ void
 packetbuf_set_datalen(uint16_t len)
 {
   PRINTF("packetbuf_set_len: len %d\n", len);
-  buflen = len;
+  current->buflen = len;
 }
 /*---------------------------------------------------------------------------*/
 void *
@@ -154,13 +171,13 @@ packetbuf_hdrptr(void)
 uint16_t
 packetbuf_datalen(void)
 {
-  return buflen;
+  return current->buflen;
 }
 /*---------------------------------------------------------------------------*/
 uint8_t
 packetbuf_hdrlen(void)
 {
-  return bufptr + hdrlen;
+  return current->bufptr + current->hdrlen;
 }
 /*---------------------------------------------------------------------------*/
 uint16_t
@@ -179,9 +196,9 @@ void
 packetbuf_attr_clear(void)
 {
   int i;
-  memset(packetbuf_attrs, 0, sizeof(packetbuf_attrs));
+  memset(current->attrs, 0, sizeof(current->attrs));
   for(i = 0; i < PACKETBUF_NUM_ADDRS; ++i) {
-    linkaddr_copy(&packetbuf_addrs[i].addr, &linkaddr_null);
+    linkaddr_copy(&current->addrs[i].addr, &linkaddr_null);
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -189,46 +206,100 @@ void
 packetbuf_attr_copyto(struct packetbuf_attr *attrs,
                       struct packetbuf_addr *addrs)
 {
-  memcpy(attrs, packetbuf_attrs, sizeof(packetbuf_attrs));
-  memcpy(addrs, packetbuf_addrs, sizeof(packetbuf_addrs));
+  memcpy(attrs, current->attrs, sizeof(current->attrs));
+  memcpy(addrs, current->addrs, sizeof(current->addrs));
 }
 /*---------------------------------------------------------------------------*/
 void
 packetbuf_attr_copyfrom(struct packetbuf_attr *attrs,
                         struct packetbuf_addr *addrs)
 {
-  memcpy(packetbuf_attrs, attrs, sizeof(packetbuf_attrs));
-  memcpy(packetbuf_addrs, addrs, sizeof(packetbuf_addrs));
+  memcpy(current->attrs, attrs, sizeof(current->attrs));
+  memcpy(current->addrs, addrs, sizeof(current->addrs));
 }
 /*---------------------------------------------------------------------------*/
 void
 packetbuf_set_attr(uint8_t type, const packetbuf_attr_t val)
 {
-  packetbuf_attrs[type].val = val;
+  current->attrs[type].val = val;
 }
 /*---------------------------------------------------------------------------*/
 packetbuf_attr_t
 packetbuf_attr(uint8_t type)
 {
-  return packetbuf_attrs[type].val;
+  return current->attrs[type].val;
 }
 /*---------------------------------------------------------------------------*/
 void
 packetbuf_set_addr(uint8_t type, const linkaddr_t *addr)
 {
-  linkaddr_copy(&packetbuf_addrs[type - PACKETBUF_ADDR_FIRST].addr, addr);
+  linkaddr_copy(&current->addrs[type - PACKETBUF_ADDR_FIRST].addr, addr);
 }
 /*---------------------------------------------------------------------------*/
 const linkaddr_t *
 packetbuf_addr(uint8_t type)
 {
-  return &packetbuf_addrs[type - PACKETBUF_ADDR_FIRST].addr;
+  return &current->addrs[type - PACKETBUF_ADDR_FIRST].addr;
 }
 /*---------------------------------------------------------------------------*/
 bool
 packetbuf_holds_broadcast(void)
 {
-  return linkaddr_cmp(&packetbuf_addrs[PACKETBUF_ADDR_RECEIVER - PACKETBUF_ADDR_FIRST].addr, &linkaddr_null);
+  return linkaddr_cmp(&current->addrs[PACKETBUF_ADDR_RECEIVER - PACKETBUF_ADDR_FIRST].addr, &linkaddr_null);
+}
+/*---------------------------------------------------------------------------*/
+static struct packetbuf_desc *
+desc_alloc(void)
+{
+  if(!default_desc_in_use) {
+    default_desc_in_use = 1;
+    return &default_desc;
+  }
+#if PACKETBUF_NUM_DESCS > 0
+  return memb_alloc(&desc_memb);
+#else /* PACKETBUF_NUM_DESCS > 0 */
+  return NULL;
+#endif /* PACKETBUF_NUM_DESCS > 0 */
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_desc_free(struct packetbuf_desc *d)
+{
+  if(d == &default_desc) {
+    default_desc_in_use = 0;
+  }
+#if PACKETBUF_NUM_DESCS > 0
+  else {
+    memb_free(&desc_memb, d);
+  }
+#endif /* PACKETBUF_NUM_DESCS > 0 */
+}
+/*---------------------------------------------------------------------------*/
+struct packetbuf_desc *
+packetbuf_desc_clone(void)
+{
+  struct packetbuf_desc *d = desc_alloc();
+
+  if(d == NULL) {
+    return NULL;
+  }
+  d->buflen = current->buflen;
+  d->bufptr = current->bufptr;
+  d->hdrlen = current->hdrlen;
+  d->headroom = current->headroom;
+  memcpy(d->attrs, current->attrs, sizeof(d->attrs));
+  memcpy(d->addrs, current->addrs, sizeof(d->addrs));
+  memcpy((uint8_t *)d->buf_aligned + d->headroom, packetbuf, packetbuf_totlen());
+  return d;
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_desc_attach(struct packetbuf_desc *d)
+{
+  if(d != current) {
+    packetbuf_desc_free(current);
+    current = d;
+  }
 }
 /*---------------------------------------------------------------------------*/
 
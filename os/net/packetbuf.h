@@ -67,6 +67,28 @@
 #define PACKETBUF_SIZE 128
 #endif
 
+/**
+ * \brief      Free bytes reserved before the header of the packetbuf, so that
+ *             packetbuf_hdralloc() does not need to move the packet. Should
+ *             be a multiple of 4 to keep the packetbuf aligned.
+ */
+#ifdef PACKETBUF_CONF_HEADROOM
+#define PACKETBUF_HEADROOM PACKETBUF_CONF_HEADROOM
+#else
+#define PACKETBUF_HEADROOM 0
+#endif
+
+/**
+ * \brief      The number of packet descriptors that can hold a packet besides
+ *             the packetbuf (see packetbuf_desc_clone()). Only 6LoWPAN
+ *             fragmentation uses one, to save a copy per fragment
+ */
+#ifdef PACKETBUF_CONF_NUM_DESCS
+#define PACKETBUF_NUM_DESCS PACKETBUF_CONF_NUM_DESCS
+#else
+#define PACKETBUF_NUM_DESCS 0
+#endif
+
 /**
  * \brief      Clear and reset the packetbuf
  *
@@ -217,6 +239,7 @@ enum {
   PACKETBUF_ATTR_MAC_METADATA,
   PACKETBUF_ATTR_MAC_NO_SRC_ADDR,
   PACKETBUF_ATTR_MAC_NO_DEST_ADDR,
+  PACKETBUF_ATTR_TRAFFIC_CLASS,
 #if TSCH_WITH_LINK_SELECTOR
   PACKETBUF_ATTR_TSCH_SLOTFRAME,
   PACKETBUF_ATTR_TSCH_TIMESLOT,
@@ -247,6 +270,11 @@ enum {
 };
 
 #define PACKETBUF_NUM_ADDRS 2
+
+/* Values of PACKETBUF_ATTR_TRAFFIC_CLASS, for the MAC layer to pick the
+ * cells a packet is sent in */
+#define PACKETBUF_TRAFFIC_CLASS_DEFAULT   0
+#define PACKETBUF_TRAFFIC_CLASS_TELEMETRY 1
 #define PACKETBUF_NUM_ATTRS (PACKETBUF_ATTR_MAX - PACKETBUF_NUM_ADDRS)
 #define PACKETBUF_ADDR_FIRST PACKETBUF_ADDR_SENDER
 
@@ -270,6 +298,34 @@ void              packetbuf_attr_copyto(struct packetbuf_attr *attrs,
 void              packetbuf_attr_copyfrom(struct packetbuf_attr *attrs,
                                           struct packetbuf_addr *addrs);
 
+/**
+ * \brief      A packet descriptor: a packet buffer with its attributes. The
+ *             packetbuf is the current descriptor; the others are handles
+ *             that layers keep and pass around without copying the packet.
+ */
+struct packetbuf_desc;
+
+/**
+ * \brief      Copy the packet in the packetbuf, with its attributes, to a
+ *             new packet descriptor. Only the used part of the buffer is
+ *             copied.
+ * \return     The descriptor holding the copy, or NULL if none is free
+ */
+struct packetbuf_desc *packetbuf_desc_clone(void);
+
+/**
+ * \brief      Make the packet of a descriptor the packetbuf, without copying
+ *             it. The previous packet in the packetbuf is discarded.
+ * \param d    The descriptor, which must not be used afterwards
+ */
+void packetbuf_desc_attach(struct packetbuf_desc *d);
+
+/**
+ * \brief      Discard the packet of a descriptor
+ * \param d    The descriptor, which must not be used afterwards
+ */
+void packetbuf_desc_free(struct packetbuf_desc *d);
+
 #define PACKETBUF_ATTRIBUTES(...) { __VA_ARGS__ PACKETBUF_ATTR_LAST }
 #define PACKETBUF_ATTR_LAST { PACKETBUF_ATTR_NONE, 0 }
 
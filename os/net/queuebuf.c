@@ -50,6 +50,7 @@
 #endif
 
 #include <string.h> /* for memcpy() */
+#include <stddef.h> /* for offsetof() */
 
 /* Structure pointing to a buffer either stored
    in RAM or swapped in CFS */
@@ -66,17 +67,22 @@ struct queuebuf {
 #endif
     struct queuebuf_data *ram_ptr;
 #if WITH_SWAP
-    int swap_id;
+    /* Location of the record in the swap */
+    struct {
+      uint8_t file;
+      cfs_offset_t offset;
+    } swap;
   };
 #endif
 };
 
-/* The actual queuebuf data */
+/* The actual queuebuf data. The data comes last so that only its used
+   part has to be written to the swap. */
 struct queuebuf_data {
-  uint8_t data[PACKETBUF_SIZE];
   uint16_t len;
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  uint8_t data[PACKETBUF_SIZE];
 };
 
 MEMB(bufmem, struct queuebuf, QUEUEBUF_NUM);
@@ -85,13 +91,24 @@ MEMB(buframmem, struct queuebuf_data, QUEUEBUFRAM_NUM);
 #if WITH_SWAP
 
 /* Swapping allows to store up to QUEUEBUF_NUM - QUEUEBUFRAM_NUM
-   queuebufs in CFS. The swap is made of several large CFS files.
-   Every buffer stored in CFS has a swap id, referring to a specific
-   offset in one of these files. */
+   queuebufs in CFS. The swap is a log made of several CFS files, used
+   in turn. Swapped queuebufs are appended to the current file as
+   variable-length records, through a RAM write buffer that is written
+   to CFS in a single operation when full. A file is renewed once all
+   of its records have been freed. Every swapped queuebuf keeps the
+   location of its record, and is read back only when accessed. */
 #define NQBUF_FILES 4
 #define NQBUF_PER_FILE 256
 #define QBUF_FILE_SIZE (NQBUF_PER_FILE*sizeof(struct queuebuf_data))
-#define NQBUF_ID (NQBUF_PER_FILE * NQBUF_FILES)
+
+#define QBUF_RECORD_LEN(d) (offsetof(struct queuebuf_data, data) + (d)->len)
+
+/* The size of the RAM write buffer of the swap */
+#ifdef QUEUEBUF_CONF_SWAP_BUF_SIZE
+#define QUEUEBUF_SWAP_BUF_SIZE MAX(QUEUEBUF_CONF_SWAP_BUF_SIZE, sizeof(struct queuebuf_data))
+#else
+#define QUEUEBUF_SWAP_BUF_SIZE (2 * sizeof(struct queuebuf_data))
+#endif
 
 struct qbuf_file {
   int fd;
@@ -103,10 +120,15 @@ struct qbuf_file {
 static struct queuebuf_data tmpdata;
 /* A pointer to the qbuf associated to the data in tmpdata */
 static struct queuebuf *tmpdata_qbuf = NULL;
-/* The swap id counter */
-static int next_swap_id = 0;
 /* The swap files */
 static struct qbuf_file qbuf_files[NQBUF_FILES];
+/* The file records are currently appended to */
+static uint8_t write_file;
+/* The offset in write_file of the first byte of the write buffer */
+static cfs_offset_t write_offset;
+/* The write buffer, holding the records not written to CFS yet */
+static uint8_t write_buf[QUEUEBUF_SWAP_BUF_SIZE];
+static uint16_t write_buf_len;
 /* The timer used to renew files during inactivity periods */
 static struct ctimer renew_timer;
 
@@ -146,6 +168,9 @@ qbuf_renew_file(int file)
   name[1] = '\0';
   if(qbuf_files[file].renewable == 1) {
     PRINTF("qbuf_renew_file: removing file %d\n", file);
+    if(qbuf_files[file].fd != -1) {
+      cfs_close(qbuf_files[file].fd);
+    }
     cfs_remove(name);
   }
   ret = cfs_open(name, CFS_READ | CFS_WRITE);
@@ -169,103 +194,149 @@ qbuf_renew_all(void *unused)
   }
 }
 /*---------------------------------------------------------------------------*/
-/* Removes a queuebuf from its swap file */
+/* Writes the write buffer to CFS */
+static int
+queuebuf_flush_write_buf(void)
+{
+  int fd;
+  if(write_buf_len > 0) {
+    fd = qbuf_files[write_file].fd;
+    if(cfs_seek(fd, write_offset, CFS_SEEK_SET) == -1) {
+      PRINTF("queuebuf_flush_write_buf: cfs seek error\n");
+      return -1;
+    }
+    if(cfs_write(fd, write_buf, write_buf_len) != write_buf_len) {
+      PRINTF("queuebuf_flush_write_buf: cfs write error\n");
+      return -1;
+    }
+    write_offset += write_buf_len;
+    write_buf_len = 0;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Releases a record of a file */
 static void
-queuebuf_remove_from_file(int swap_id)
+queuebuf_release_record(int fileid)
 {
-  int fileid;
-  if(swap_id != -1) {
-    fileid = swap_id / NQBUF_PER_FILE;
-    qbuf_files[fileid].usage--;
+  qbuf_files[fileid].usage--;
 
-    /* The file is full but doesn't contain any more queuebuf, mark it as renewable */
-    if(qbuf_files[fileid].usage == 0 && fileid != next_swap_id / NQBUF_PER_FILE) {
+  if(qbuf_files[fileid].usage == 0) {
+    if(fileid == write_file) {
+      /* All records of the current file are gone: start it over */
+      write_offset = 0;
+      write_buf_len = 0;
+    } else {
+      /* The file is full but doesn't contain any more queuebuf, mark it as renewable */
       qbuf_files[fileid].renewable = 1;
       /* This file is renewable, set a timer to renew files */
       ctimer_set(&renew_timer, 0, qbuf_renew_all, NULL);
     }
-
-    if(tmpdata_qbuf->swap_id == swap_id) {
-      tmpdata_qbuf->swap_id = -1;
-    }
   }
 }
 /*---------------------------------------------------------------------------*/
-static int
-get_new_swap_id(void)
+/* Removes the record of a queuebuf from the swap */
+static void
+queuebuf_remove_from_file(struct queuebuf *b)
 {
-  int fileid;
-  int swap_id = next_swap_id;
-  fileid = swap_id / NQBUF_PER_FILE;
-  if(swap_id % NQBUF_PER_FILE == 0) { /* This is the first id in the file */
-    if(qbuf_files[fileid].renewable) {
-      qbuf_renew_file(fileid);
-    }
-    if(qbuf_files[fileid].usage>0) {
-      return -1;
-    }
+  queuebuf_release_record(b->swap.file);
+
+  if(tmpdata_qbuf == b) {
+    tmpdata_qbuf = NULL;
   }
-  qbuf_files[fileid].usage++;
-  next_swap_id = (next_swap_id+1) % NQBUF_ID;
-  return swap_id;
 }
 /*---------------------------------------------------------------------------*/
-/* Flush tmpdata to CFS */
+/* Appends the data in tmpdata to the swap, as the record of b */
 static int
-queuebuf_flush_tmpdata(void)
+queuebuf_append_tmpdata(struct queuebuf *b)
 {
-  int fileid, fd, ret;
-  cfs_offset_t offset;
-  if(tmpdata_qbuf) {
-    queuebuf_remove_from_file(tmpdata_qbuf->swap_id);
-    tmpdata_qbuf->swap_id = get_new_swap_id();
-    if(tmpdata_qbuf->swap_id == -1) {
-      return -1;
-    }
-    fileid = tmpdata_qbuf->swap_id / NQBUF_PER_FILE;
-    offset = (tmpdata_qbuf->swap_id % NQBUF_PER_FILE) * sizeof(struct queuebuf_data);
-    fd = qbuf_files[fileid].fd;
-    ret = cfs_seek(fd, offset, CFS_SEEK_SET);
-    if(ret == -1) {
-      PRINTF("queuebuf_flush_tmpdata: cfs seek error\n");
+  uint16_t len = QBUF_RECORD_LEN(&tmpdata);
+
+  if(write_offset + write_buf_len + len > QBUF_FILE_SIZE) {
+    /* The current file is full, move on to the next one */
+    int next_file = (write_file + 1) % NQBUF_FILES;
+    if(qbuf_files[next_file].usage > 0
+       || queuebuf_flush_write_buf() == -1) {
       return -1;
     }
-    ret = cfs_write(fd, &tmpdata, sizeof(struct queuebuf_data));
-    if(ret == -1) {
-      PRINTF("queuebuf_flush_tmpdata: cfs write error\n");
-      return -1;
+    if(qbuf_files[next_file].renewable) {
+      qbuf_renew_file(next_file);
     }
+    write_file = next_file;
+    write_offset = 0;
+  }
+
+  if(write_buf_len + len > sizeof(write_buf)
+     && queuebuf_flush_write_buf() == -1) {
+    return -1;
   }
+
+  memcpy(write_buf + write_buf_len, &tmpdata, len);
+  b->swap.file = write_file;
+  b->swap.offset = write_offset + write_buf_len;
+  write_buf_len += len;
+  qbuf_files[write_file].usage++;
+  tmpdata_qbuf = b;
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+/* Stores the updated data of a swapped queuebuf, found in tmpdata.
+   Records are never rewritten in place: the updated one is appended,
+   and the old one is released only then. If the swap is full, the
+   queuebuf moves to RAM if possible, else the update is lost. */
+static void
+queuebuf_write_back(struct queuebuf *b)
+{
+  int old_file = b->swap.file;
+  struct queuebuf_data *ram_ptr;
+
+  if(queuebuf_append_tmpdata(b) == 0) {
+    queuebuf_release_record(old_file);
+    return;
+  }
+
+  ram_ptr = memb_alloc(&buframmem);
+  if(ram_ptr != NULL) {
+    memcpy(ram_ptr, &tmpdata, sizeof(struct queuebuf_data));
+    queuebuf_remove_from_file(b);
+    b->location = IN_RAM;
+    b->ram_ptr = ram_ptr;
+  } else {
+    PRINTF("queuebuf_write_back: swap full, update lost\n");
+    /* tmpdata no longer matches the record of b */
+    tmpdata_qbuf = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
 /* If the queuebuf is in CFS, load it to tmpdata */
 static struct queuebuf_data *
 queuebuf_load_to_ram(struct queuebuf *b)
 {
-  int fileid, fd, ret;
-  cfs_offset_t offset;
+  int fd, ret;
   if(b->location == IN_RAM) { /* the qbuf is loacted in RAM */
     return b->ram_ptr;
   } else { /* the qbuf is located in CFS */
-    if(tmpdata_qbuf && tmpdata_qbuf->swap_id == b->swap_id) { /* the qbuf is already in tmpdata */
-      return &tmpdata;
-    } else { /* the qbuf needs to be loaded from CFS */
+    if(tmpdata_qbuf != b) { /* the qbuf needs to be loaded */
       tmpdata_qbuf = b;
-      /* read the qbuf from CFS */
-      fileid = b->swap_id / NQBUF_PER_FILE;
-      offset = (b->swap_id % NQBUF_PER_FILE) * sizeof(struct queuebuf_data);
-      fd = qbuf_files[fileid].fd;
-      ret = cfs_seek(fd, offset, CFS_SEEK_SET);
-      if(ret == -1) {
-        PRINTF("queuebuf_load_to_ram: cfs seek error\n");
+      if(b->swap.file == write_file && b->swap.offset >= write_offset) {
+        /* The record is still in the write buffer */
+        const uint8_t *record = write_buf + (b->swap.offset - write_offset);
+        memcpy(&tmpdata, record, offsetof(struct queuebuf_data, data));
+        memcpy(tmpdata.data, record + offsetof(struct queuebuf_data, data), tmpdata.len);
+      } else {
+        /* read the qbuf from CFS */
+        fd = qbuf_files[b->swap.file].fd;
+        ret = cfs_seek(fd, b->swap.offset, CFS_SEEK_SET);
+        if(ret == -1) {
+          PRINTF("queuebuf_load_to_ram: cfs seek error\n");
+        }
+        ret = cfs_read(fd, &tmpdata, sizeof(struct queuebuf_data));
+        if(ret < (int)offsetof(struct queuebuf_data, data)) {
+          PRINTF("queuebuf_load_to_ram: cfs read error\n");
+        }
       }
-      ret = cfs_read(fd, &tmpdata, sizeof(struct queuebuf_data));
-      if(ret == -1) {
-        PRINTF("queuebuf_load_to_ram: cfs read error\n");
-      }
-      return &tmpdata;
     }
+    return &tmpdata;
   }
 }
 #else /* WITH_SWAP */
@@ -283,9 +354,14 @@ queuebuf_init(void)
 #if WITH_SWAP
   int i;
   for(i=0; i<NQBUF_FILES; i++) {
+    qbuf_files[i].fd = -1;
     qbuf_files[i].renewable = 1;
     qbuf_renew_file(i);
   }
+  write_file = 0;
+  write_offset = 0;
+  write_buf_len = 0;
+  tmpdata_qbuf = NULL;
 #endif
   memb_init(&buframmem);
   memb_init(&bufmem);
@@ -327,8 +403,6 @@ queuebuf_new_from_packetbuf(void)
       buframptr = buf->ram_ptr;
     } else {
       buf->location = IN_CFS;
-      buf->swap_id = -1;
-      tmpdata_qbuf = buf;
       buframptr = &tmpdata;
     }
 #else
@@ -345,7 +419,7 @@ queuebuf_new_from_packetbuf(void)
 
 #if WITH_SWAP
     if(buf->location == IN_CFS) {
-      if(queuebuf_flush_tmpdata() == -1) {
+      if(queuebuf_append_tmpdata(buf) == -1) {
         /* We were unable to write the data in the swap */
         memb_free(&bufmem, buf);
         return NULL;
@@ -367,6 +441,35 @@ queuebuf_new_from_packetbuf(void)
   return buf;
 }
 /*---------------------------------------------------------------------------*/
+int
+queuebuf_swap_in(struct queuebuf *b)
+{
+#if WITH_SWAP
+  struct queuebuf_data *ram_ptr;
+  if(memb_inmemb(&bufmem, b) && b->location == IN_CFS) {
+    ram_ptr = memb_alloc(&buframmem);
+    if(ram_ptr == NULL) {
+      return 0;
+    }
+    memcpy(ram_ptr, queuebuf_load_to_ram(b), sizeof(struct queuebuf_data));
+    queuebuf_remove_from_file(b);
+    b->location = IN_RAM;
+    b->ram_ptr = ram_ptr;
+  }
+#endif /* WITH_SWAP */
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+queuebuf_in_ram(struct queuebuf *b)
+{
+#if WITH_SWAP
+  return b->location == IN_RAM;
+#else /* WITH_SWAP */
+  return 1;
+#endif /* WITH_SWAP */
+}
+/*---------------------------------------------------------------------------*/
 void
 queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
 {
@@ -374,7 +477,7 @@ queuebuf_update_attr_from_packetbuf(struct queuebuf *buf)
   packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
-    queuebuf_flush_tmpdata();
+    queuebuf_write_back(buf);
   }
 #endif
 }
@@ -387,7 +490,7 @@ queuebuf_update_from_packetbuf(struct queuebuf *buf)
   buframptr->len = packetbuf_copyto(buframptr->data);
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
-    queuebuf_flush_tmpdata();
+    queuebuf_write_back(buf);
   }
 #endif
 }
@@ -400,7 +503,7 @@ queuebuf_free(struct queuebuf *buf)
     if(buf->location == IN_RAM) {
       memb_free(&buframmem, buf->ram_ptr);
     } else {
-      queuebuf_remove_from_file(buf->swap_id);
+      queuebuf_remove_from_file(buf);
     }
 #else
     memb_free(&buframmem, buf->ram_ptr);
@@ -426,6 +529,15 @@ queuebuf_to_packetbuf(struct queuebuf *b)
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+queuebuf_attr_to_packetbuf(struct queuebuf *b)
+{
+  if(memb_inmemb(&bufmem, b)) {
+    struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+    packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
+  }
+}
+/*---------------------------------------------------------------------------*/
 void *
 queuebuf_dataptr(struct queuebuf *b)
 {
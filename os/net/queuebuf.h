@@ -86,6 +86,10 @@
   #define WITH_SWAP 0
 #endif /* QUEUEBUFRAM_CONF_NUM */
 
+/* QUEUEBUF_CONF_SWAP_BUF_SIZE is the size of the RAM buffer through
+   which swapped queuebufs are written to CFS, in batches. It defaults to
+   twice the size of a queuebuf. */
+
 #ifdef QUEUEBUF_CONF_DEBUG
 #define QUEUEBUF_DEBUG QUEUEBUF_CONF_DEBUG
 #else /* QUEUEBUF_CONF_DEBUG */
@@ -102,10 +106,37 @@ struct queuebuf *queuebuf_new_from_packetbuf_debug(const char *file, int line);
 #else /* QUEUEBUF_DEBUG */
 struct queuebuf *queuebuf_new_from_packetbuf(void);
 #endif /* QUEUEBUF_DEBUG */
+/**
+ * \brief Move a swapped queuebuf back to RAM
+ *
+ * Swapped queuebufs are otherwise read from CFS whenever accessed. Call
+ * this before a queuebuf is accessed from interrupt context.
+ *
+ * \param b The queuebuf
+ * \return 1 if b is in RAM, 0 if no RAM is available
+ */
+int queuebuf_swap_in(struct queuebuf *b);
+/**
+ * \brief Is a queuebuf in RAM, i.e. accessible without reading CFS?
+ *
+ * \param b The queuebuf
+ * \return 1 if b is in RAM, 0 if it is swapped
+ */
+int queuebuf_in_ram(struct queuebuf *b);
+
 void queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
 void queuebuf_update_from_packetbuf(struct queuebuf *b);
 
 void queuebuf_to_packetbuf(struct queuebuf *b);
+
+/**
+ * \brief Copy the attributes and addresses of a queuebuf to packetbuf,
+ * leaving the packetbuf data untouched
+ *
+ * \param b The queuebuf
+ */
+void queuebuf_attr_to_packetbuf(struct queuebuf *b);
+
 void queuebuf_free(struct queuebuf *b);
 
 void *queuebuf_dataptr(struct queuebuf *b);
@@ -163,4 +163,84 @@
 #define ORCHESTRA_EB_MAX_CHANNEL_OFFSET 1
 #endif
 
+/* Length of the telemetry slotframe (rule telemetry_per_sender). Its cells have
+ * the lowest priority as long as the rule is listed last */
+#ifdef ORCHESTRA_CONF_TELEMETRY_PERIOD
+#define ORCHESTRA_TELEMETRY_PERIOD                ORCHESTRA_CONF_TELEMETRY_PERIOD
+#else /* ORCHESTRA_CONF_TELEMETRY_PERIOD */
+#define ORCHESTRA_TELEMETRY_PERIOD                41
+#endif /* ORCHESTRA_CONF_TELEMETRY_PERIOD */
+
+/* The hash function used to assign a channel offset to a timeslot of the telemetry
+ * slotframe. All senders sharing a timeslot use the same channel offset, so that
+ * their receivers hear them all */
+#ifdef ORCHESTRA_CONF_TELEMETRY_CHANNEL_OFFSET_HASH
+#define ORCHESTRA_TELEMETRY_CHANNEL_OFFSET_HASH   ORCHESTRA_CONF_TELEMETRY_CHANNEL_OFFSET_HASH
+#else /* ORCHESTRA_CONF_TELEMETRY_CHANNEL_OFFSET_HASH */
+#define ORCHESTRA_TELEMETRY_CHANNEL_OFFSET_HASH(timeslot) ((timeslot) * 7)
+#endif /* ORCHESTRA_CONF_TELEMETRY_CHANNEL_OFFSET_HASH */
+
+/* Channel offsets for the telemetry rule, default: same as the unicast rules */
+#ifdef ORCHESTRA_CONF_TELEMETRY_MIN_CHANNEL_OFFSET
+#define ORCHESTRA_TELEMETRY_MIN_CHANNEL_OFFSET    ORCHESTRA_CONF_TELEMETRY_MIN_CHANNEL_OFFSET
+#else
+#define ORCHESTRA_TELEMETRY_MIN_CHANNEL_OFFSET    ORCHESTRA_UNICAST_MIN_CHANNEL_OFFSET
+#endif
+
+#ifdef ORCHESTRA_CONF_TELEMETRY_MAX_CHANNEL_OFFSET
+#define ORCHESTRA_TELEMETRY_MAX_CHANNEL_OFFSET    ORCHESTRA_CONF_TELEMETRY_MAX_CHANNEL_OFFSET
+#else
+#define ORCHESTRA_TELEMETRY_MAX_CHANNEL_OFFSET    ORCHESTRA_UNICAST_MAX_CHANNEL_OFFSET
+#endif
+
+/* Load-adaptive slotframe lengths, enabled with TSCH_CONF_WITH_SCHEDULE_LEVEL.
+ * The root picks a level from its queue occupancy and advertises it in EBs;
+ * all slotframes but the EB one are ORCHESTRA_*_PERIOD * 2^level long */
+
+/* The maximum level, i.e. slotframes up to 2^ORCHESTRA_ADAPTIVE_MAX_LEVEL
+ * times longer than configured */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_MAX_LEVEL
+#define ORCHESTRA_ADAPTIVE_MAX_LEVEL              ORCHESTRA_CONF_ADAPTIVE_MAX_LEVEL
+#else
+#define ORCHESTRA_ADAPTIVE_MAX_LEVEL              2
+#endif
+
+/* The period at which the root samples its queue occupancy */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_SAMPLE_PERIOD
+#define ORCHESTRA_ADAPTIVE_SAMPLE_PERIOD          ORCHESTRA_CONF_ADAPTIVE_SAMPLE_PERIOD
+#else
+#define ORCHESTRA_ADAPTIVE_SAMPLE_PERIOD          (CLOCK_SECOND)
+#endif
+
+/* Average queue occupancy, in percent of QUEUEBUF_NUM, above which the
+ * root moves to a lower level (shorter slotframes) */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_HIGH_OCCUPANCY
+#define ORCHESTRA_ADAPTIVE_HIGH_OCCUPANCY         ORCHESTRA_CONF_ADAPTIVE_HIGH_OCCUPANCY
+#else
+#define ORCHESTRA_ADAPTIVE_HIGH_OCCUPANCY         25
+#endif
+
+/* Average queue occupancy, in percent of QUEUEBUF_NUM, below which the
+ * root moves to a higher level (longer slotframes), after
+ * ORCHESTRA_ADAPTIVE_IDLE_SAMPLES consecutive samples */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_LOW_OCCUPANCY
+#define ORCHESTRA_ADAPTIVE_LOW_OCCUPANCY          ORCHESTRA_CONF_ADAPTIVE_LOW_OCCUPANCY
+#else
+#define ORCHESTRA_ADAPTIVE_LOW_OCCUPANCY          5
+#endif
+
+#ifdef ORCHESTRA_CONF_ADAPTIVE_IDLE_SAMPLES
+#define ORCHESTRA_ADAPTIVE_IDLE_SAMPLES           ORCHESTRA_CONF_ADAPTIVE_IDLE_SAMPLES
+#else
+#define ORCHESTRA_ADAPTIVE_IDLE_SAMPLES           60
+#endif
+
+/* The time between a level change at the root and the switch, leaving
+ * time for the EBs to carry the new level down the network */
+#ifdef ORCHESTRA_CONF_ADAPTIVE_SWITCH_DELAY
+#define ORCHESTRA_ADAPTIVE_SWITCH_DELAY           ORCHESTRA_CONF_ADAPTIVE_SWITCH_DELAY
+#else
+#define ORCHESTRA_ADAPTIVE_SWITCH_DELAY           (4 * TSCH_MAX_EB_PERIOD)
+#endif
+
 #endif /* ORCHESTRA_CONF_H_ */
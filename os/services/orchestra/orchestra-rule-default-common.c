@@ -85,4 +85,5 @@ struct orchestra_rule default_common = {
   NULL,
   "default common",
   ORCHESTRA_COMMON_SHARED_PERIOD,
+  PACKETBUF_TRAFFIC_CLASS_DEFAULT,
 };
@@ -151,4 +151,5 @@ struct orchestra_rule eb_per_time_source = {
   NULL,
   "EB per time source",
   ORCHESTRA_EBSF_PERIOD,
+  PACKETBUF_TRAFFIC_CLASS_DEFAULT,
 };
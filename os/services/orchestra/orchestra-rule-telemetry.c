@@ -0,0 +1,126 @@
+/**
+ * \addtogroup orchestra
+ * @{
+ */
+/**
+ * \file
+ *         Orchestra: a low-priority sender-based slotframe for telemetry.
+ *         Packets of the telemetry traffic class (PACKETBUF_ATTR_TRAFFIC_CLASS)
+ *         to a neighbor are sent in the timeslot of the sender, on a channel
+ *         offset derived from the timeslot. Nodes listen in the timeslots of
+ *         all their IPv6 neighbors. List this rule last in ORCHESTRA_RULES so
+ *         that its cells yield to those of all other rules.
+ */
+
+#include "contiki.h"
+#include "orchestra.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "net/packetbuf.h"
+
+static uint16_t slotframe_handle = 0;
+static struct tsch_slotframe *sf_telemetry;
+
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get_node_timeslot(const linkaddr_t *addr)
+{
+  if(addr != NULL && ORCHESTRA_TELEMETRY_PERIOD > 0) {
+    return ORCHESTRA_LINKADDR_HASH(addr) % ORCHESTRA_TELEMETRY_PERIOD;
+  } else {
+    return 0xffff;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get_timeslot_channel_offset(uint16_t timeslot)
+{
+  return ORCHESTRA_TELEMETRY_CHANNEL_OFFSET_HASH(timeslot)
+    % (ORCHESTRA_TELEMETRY_MAX_CHANNEL_OFFSET - ORCHESTRA_TELEMETRY_MIN_CHANNEL_OFFSET + 1)
+    + ORCHESTRA_TELEMETRY_MIN_CHANNEL_OFFSET;
+}
+/*---------------------------------------------------------------------------*/
+/* Install, update or remove the link of a timeslot: Tx if it is our own
+ * timeslot, Rx if a neighbor uses it */
+static void
+update_link(uint16_t timeslot)
+{
+  uint8_t link_options = 0;
+  uip_ds6_nbr_t *nbr;
+  struct tsch_link *l;
+
+  if(sf_telemetry == NULL || timeslot == 0xffff) {
+    return;
+  }
+
+  if(timeslot == get_node_timeslot(&linkaddr_node_addr)) {
+    link_options |= LINK_OPTION_TX | LINK_OPTION_SHARED;
+  }
+  for(nbr = uip_ds6_nbr_head(); nbr != NULL; nbr = uip_ds6_nbr_next(nbr)) {
+    if(timeslot == get_node_timeslot((const linkaddr_t *)uip_ds6_nbr_get_ll(nbr))) {
+      link_options |= LINK_OPTION_RX;
+      break;
+    }
+  }
+
+  l = tsch_schedule_get_link_by_timeslot(sf_telemetry, timeslot);
+  if(link_options == 0) {
+    if(l != NULL) {
+      tsch_schedule_remove_link(sf_telemetry, l);
+    }
+  } else if(l == NULL || l->link_options != link_options) {
+    tsch_schedule_add_link(sf_telemetry, link_options, LINK_TYPE_NORMAL, &tsch_broadcast_address,
+                           timeslot, get_timeslot_channel_offset(timeslot), 1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_updated(const linkaddr_t *linkaddr, uint8_t is_added)
+{
+  update_link(get_node_timeslot(linkaddr));
+}
+/*---------------------------------------------------------------------------*/
+static int
+select_packet(uint16_t *slotframe, uint16_t *timeslot, uint16_t *channel_offset)
+{
+  /* Select unicast data packets to IPv6 neighbors, which listen to us */
+  const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  if(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) == FRAME802154_DATAFRAME
+     && !linkaddr_cmp(dest, &linkaddr_null)
+     && uip_ds6_nbr_ll_lookup((const uip_lladdr_t *)dest) != NULL) {
+    uint16_t local_timeslot = get_node_timeslot(&linkaddr_node_addr);
+    if(slotframe != NULL) {
+      *slotframe = slotframe_handle;
+    }
+    if(timeslot != NULL) {
+      *timeslot = local_timeslot;
+    }
+    if(channel_offset != NULL) {
+      *channel_offset = get_timeslot_channel_offset(local_timeslot);
+    }
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(uint16_t sf_handle)
+{
+  slotframe_handle = sf_handle;
+  /* Slotframe for telemetry */
+  sf_telemetry = tsch_schedule_add_slotframe(slotframe_handle, ORCHESTRA_TELEMETRY_PERIOD);
+  update_link(get_node_timeslot(&linkaddr_node_addr));
+}
+/*---------------------------------------------------------------------------*/
+struct orchestra_rule telemetry_per_sender = {
+  init,
+  NULL,
+  select_packet,
+  NULL,
+  NULL,
+  neighbor_updated,
+  NULL,
+  "telemetry per sender",
+  ORCHESTRA_TELEMETRY_PERIOD,
+  PACKETBUF_TRAFFIC_CLASS_TELEMETRY,
+};
+/** @} */
@@ -220,6 +220,7 @@ struct orchestra_rule unicast_per_neighbor_link_based = {
   NULL,
   "unicast per neighbor link based",
   ORCHESTRA_UNICAST_PERIOD,
+  PACKETBUF_TRAFFIC_CLASS_DEFAULT,
 };
 
 #endif /* UIP_MAX_ROUTES */
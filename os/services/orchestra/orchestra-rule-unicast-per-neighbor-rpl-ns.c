@@ -167,4 +167,5 @@ struct orchestra_rule unicast_per_neighbor_rpl_ns = {
   NULL,
   "unicast per neighbor non-storing",
   ORCHESTRA_UNICAST_PERIOD,
+  PACKETBUF_TRAFFIC_CLASS_DEFAULT,
 };
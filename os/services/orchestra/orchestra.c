@@ -39,8 +39,10 @@
 #include "contiki.h"
 #include "orchestra.h"
 #include "net/packetbuf.h"
+#include "net/queuebuf.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/routing/routing.h"
+#include <inttypes.h>
 #if ROUTING_CONF_RPL_LITE
 #include "net/routing/rpl-lite/rpl.h"
 #elif ROUTING_CONF_RPL_CLASSIC
@@ -66,6 +68,24 @@ int orchestra_parent_knows_us = 0;
 const struct orchestra_rule *all_rules[] = ORCHESTRA_RULES;
 #define NUM_RULES (sizeof(all_rules) / sizeof(struct orchestra_rule *))
 
+#if TSCH_WITH_SCHEDULE_LEVEL
+/* The level the slotframe lengths are scaled with */
+static uint8_t current_level;
+/* Fires after the ASN from which the next level applies. TSCH switches the
+ * slotframe lengths at that very ASN; the timer then commits the level */
+static struct ctimer switch_timer;
+/* Root only: periodic sampling of the queue occupancy */
+static struct ctimer sample_timer;
+/* Root only: average queue occupancy, in percent of QUEUEBUF_NUM */
+static uint8_t avg_occupancy;
+/* Root only: number of consecutive samples with a low occupancy */
+static uint16_t idle_samples;
+
+/* EWMA (exponential moving average) used to average the queue occupancy */
+#define ADAPTIVE_EWMA_SCALE 100
+#define ADAPTIVE_EWMA_ALPHA  20
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+
 /*---------------------------------------------------------------------------*/
 static void
 orchestra_packet_received(void)
@@ -135,17 +155,33 @@ orchestra_callback_packet_ready(void)
    * overrides per-link value, allowing to implement multi-channel Orchestra. */
   uint16_t channel_offset = 0xffff;
   int matched_rule = -1;
+  uint8_t traffic_class = packetbuf_attr(PACKETBUF_ATTR_TRAFFIC_CLASS);
 
-  /* Loop over all rules until finding one able to handle the packet */
-  for(i = 0; i < NUM_RULES; i++) {
-    if(all_rules[i]->select_packet != NULL) {
-      if(all_rules[i]->select_packet(&slotframe, &timeslot, &channel_offset)) {
+  /* First try the rules dedicated to the traffic class of the packet, if any */
+  if(traffic_class != PACKETBUF_TRAFFIC_CLASS_DEFAULT) {
+    for(i = 0; i < NUM_RULES; i++) {
+      if(all_rules[i]->traffic_class == traffic_class
+         && all_rules[i]->select_packet != NULL
+         && all_rules[i]->select_packet(&slotframe, &timeslot, &channel_offset)) {
         matched_rule = i;
         break;
       }
     }
   }
 
+  /* Otherwise, loop over all general rules until finding one able to handle the packet */
+  if(matched_rule == -1) {
+    for(i = 0; i < NUM_RULES; i++) {
+      if(all_rules[i]->traffic_class == PACKETBUF_TRAFFIC_CLASS_DEFAULT
+         && all_rules[i]->select_packet != NULL) {
+        if(all_rules[i]->select_packet(&slotframe, &timeslot, &channel_offset)) {
+          matched_rule = i;
+          break;
+        }
+      }
+    }
+  }
+
 #if TSCH_WITH_LINK_SELECTOR
   packetbuf_set_attr(PACKETBUF_ATTR_TSCH_SLOTFRAME, slotframe);
   packetbuf_set_attr(PACKETBUF_ATTR_TSCH_TIMESLOT, timeslot);
@@ -186,6 +222,186 @@ orchestra_callback_root_node_updated(const linkaddr_t *root, uint8_t is_added)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if TSCH_WITH_SCHEDULE_LEVEL
+/* Scaled lengths stay below 0x8000, so that TSCH can switch between any two
+ * of them at a given ASN */
+#define MAX_SCALED_SLOTFRAME_SIZE 0x7fff
+
+/* Is a rule's slotframe scaled with the level? */
+static int
+is_scaled(int i)
+{
+  /* Keep the EB period, so that joining nodes find the network as fast */
+  return all_rules[i] != &eb_per_time_source && all_rules[i]->slotframe_size > 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Do all scaled slotframes fit at a given level? */
+static int
+level_fits(uint8_t level)
+{
+  int i;
+  for(i = 0; i < NUM_RULES; i++) {
+    if(is_scaled(i)
+       && ((uint32_t)all_rules[i]->slotframe_size << level) > MAX_SCALED_SLOTFRAME_SIZE) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Resize all slotframes but the EB one to their configured length times
+ * 2^level: from a given ASN on, or right away if asn is NULL. Changes
+ * nothing and returns 0 if the level does not fit */
+static int
+apply_schedule_level(uint8_t level, const struct tsch_asn_t *asn)
+{
+  int i;
+
+  if(!level_fits(level)) {
+    LOG_ERR("Schedule level %u does not fit, staying at level %u\n",
+            level, current_level);
+    return 0;
+  }
+  for(i = 0; i < NUM_RULES; i++) {
+    uint16_t size = all_rules[i]->slotframe_size << level;
+    struct tsch_slotframe *sf;
+    if(!is_scaled(i)) {
+      continue;
+    }
+    /* All links are within the configured length: they keep their timeslot,
+     * and occur once every 2^level configured slotframes */
+    sf = tsch_schedule_get_slotframe_by_handle(i);
+    if(sf != NULL
+       && !(asn != NULL ? tsch_schedule_set_slotframe_size_at(sf, size, asn)
+            : tsch_schedule_set_slotframe_size(sf, size))) {
+      LOG_WARN("Failed to resize slotframe %u\n", i);
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Switch to a level right away */
+static void
+set_schedule_level(uint8_t level)
+{
+  if(level != current_level) {
+    LOG_INFO("Switching from schedule level %u to %u\n", current_level, level);
+    if(apply_schedule_level(level, NULL)) {
+      current_level = level;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Convert a number of slots to clock ticks, rounded up */
+static clock_time_t
+slots_to_clock(uint32_t slots)
+{
+  uint64_t us = (uint64_t)slots * tsch_timing_us[tsch_ts_timeslot_length];
+  return (clock_time_t)((us * CLOCK_SECOND + 999999) / 1000000);
+}
+/*---------------------------------------------------------------------------*/
+/* Apply the level in use at the current ASN, and wait for the next switch */
+static void
+update_schedule_level(void *ptr)
+{
+  struct tsch_schedule_level sl;
+  int32_t slots_to_switch;
+
+  if(!tsch_get_schedule_level(&sl)) {
+    return;
+  }
+  slots_to_switch = (int32_t)TSCH_ASN_DIFF(sl.switch_asn, tsch_current_asn);
+  if(slots_to_switch > 0) {
+    set_schedule_level(sl.level);
+    if(sl.next_level != current_level) {
+      LOG_INFO("Schedule level %u from asn-%x.%"PRIx32"\n", sl.next_level,
+               sl.switch_asn.ms1b, sl.switch_asn.ls4b);
+      apply_schedule_level(sl.next_level, &sl.switch_asn);
+    }
+    ctimer_set(&switch_timer, slots_to_clock(slots_to_switch), update_schedule_level, NULL);
+  } else {
+    ctimer_stop(&switch_timer);
+    set_schedule_level(sl.next_level);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Root only: pick the schedule level from the queue occupancy. A high
+ * occupancy calls for shorter slotframes, a low one for longer slotframes */
+static void
+sample_queue_occupancy(void *ptr)
+{
+  struct tsch_schedule_level sl;
+  uint8_t occupancy;
+  uint8_t level;
+
+  ctimer_reset(&sample_timer);
+  if(!tsch_is_coordinator || !tsch_is_associated) {
+    return;
+  }
+  if(!tsch_get_schedule_level(&sl)) {
+    /* Start advertising the level in use */
+    sl.level = current_level;
+    sl.next_level = current_level;
+    sl.switch_asn = tsch_current_asn;
+    tsch_set_schedule_level(&sl);
+  }
+
+  occupancy = MIN(100, 100 * tsch_queue_global_packet_count() / QUEUEBUF_NUM);
+  avg_occupancy = ((uint16_t)avg_occupancy * (ADAPTIVE_EWMA_SCALE - ADAPTIVE_EWMA_ALPHA)
+                   + (uint16_t)occupancy * ADAPTIVE_EWMA_ALPHA) / ADAPTIVE_EWMA_SCALE;
+
+  if((int32_t)TSCH_ASN_DIFF(sl.switch_asn, tsch_current_asn) > 0) {
+    /* Wait for the pending switch */
+    return;
+  }
+
+  level = sl.next_level;
+  if(avg_occupancy >= ORCHESTRA_ADAPTIVE_HIGH_OCCUPANCY) {
+    idle_samples = 0;
+    if(level > 0) {
+      level--;
+    }
+  } else if(avg_occupancy <= ORCHESTRA_ADAPTIVE_LOW_OCCUPANCY) {
+    if(idle_samples < ORCHESTRA_ADAPTIVE_IDLE_SAMPLES) {
+      idle_samples++;
+    }
+    if(idle_samples >= ORCHESTRA_ADAPTIVE_IDLE_SAMPLES
+       && level < ORCHESTRA_ADAPTIVE_MAX_LEVEL && level_fits(level + 1)) {
+      level++;
+    }
+  } else {
+    idle_samples = 0;
+  }
+
+  if(level != sl.next_level) {
+    uint32_t switch_delay = (uint32_t)((uint64_t)ORCHESTRA_ADAPTIVE_SWITCH_DELAY * 1000000
+                                       / CLOCK_SECOND / tsch_timing_us[tsch_ts_timeslot_length]);
+    idle_samples = 0;
+    sl.level = sl.next_level;
+    sl.next_level = level;
+    sl.switch_asn = tsch_current_asn;
+    TSCH_ASN_INC(sl.switch_asn, switch_delay);
+    LOG_INFO("Queue occupancy %u%%, schedule level %u -> %u at asn-%x.%"PRIx32"\n",
+             avg_occupancy, sl.level, sl.next_level,
+             sl.switch_asn.ms1b, sl.switch_asn.ls4b);
+    tsch_set_schedule_level(&sl);
+    update_schedule_level(NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+orchestra_callback_schedule_level_updated(void)
+{
+  update_schedule_level(NULL);
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+orchestra_get_schedule_level(void)
+{
+  return current_level;
+}
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+/*---------------------------------------------------------------------------*/
 void
 orchestra_init(void)
 {
@@ -201,5 +417,9 @@ orchestra_init(void)
       all_rules[i]->init(i);
     }
   }
+#if TSCH_WITH_SCHEDULE_LEVEL
+  current_level = 0;
+  ctimer_set(&sample_timer, ORCHESTRA_ADAPTIVE_SAMPLE_PERIOD, sample_queue_occupancy, NULL);
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
   LOG_INFO("Initialization done\n");
 }
@@ -39,6 +39,7 @@
 #define ORCHESTRA_H_
 
 #include "net/mac/tsch/tsch.h"
+#include "net/packetbuf.h"
 #include "orchestra-conf.h"
 
 /* The structure of an Orchestra rule */
@@ -52,6 +53,9 @@ struct orchestra_rule {
   void (* root_node_updated)(const linkaddr_t *addr, uint8_t is_added);
   const char *const name;
   const int16_t slotframe_size;
+  /* The traffic class (PACKETBUF_TRAFFIC_CLASS_*) the rule is dedicated to.
+   * Dedicated rules only select packets of their class, before any other rule */
+  const uint8_t traffic_class;
 };
 
 extern struct orchestra_rule eb_per_time_source;
@@ -60,6 +64,7 @@ extern struct orchestra_rule unicast_per_neighbor_rpl_ns;
 extern struct orchestra_rule unicast_per_neighbor_link_based;
 extern struct orchestra_rule special_for_root;
 extern struct orchestra_rule default_common;
+extern struct orchestra_rule telemetry_per_sender;
 
 extern linkaddr_t orchestra_parent_linkaddr;
 extern int orchestra_parent_knows_us;
@@ -83,4 +88,11 @@ void orchestra_callback_root_node_updated(const linkaddr_t *root, uint8_t is_add
 /* Set with #define NETSTACK_CONF_DS6_NEIGHBOR_UPDATED_CALLBACK orchestra_callback_neighbor_updated */
 void orchestra_callback_neighbor_updated(const linkaddr_t *, uint8_t is_added);
 
+#if TSCH_WITH_SCHEDULE_LEVEL
+/* Set with #define TSCH_CALLBACK_SCHEDULE_LEVEL_UPDATED orchestra_callback_schedule_level_updated */
+void orchestra_callback_schedule_level_updated(void);
+/* Returns the level the slotframe lengths are currently scaled with */
+uint8_t orchestra_get_schedule_level(void);
+#endif /* TSCH_WITH_SCHEDULE_LEVEL */
+
 #endif /* ORCHESTRA_H_ */
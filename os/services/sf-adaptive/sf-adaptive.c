@@ -0,0 +1,861 @@
+/**
+ * \addtogroup sixtop
+ * @{
+ */
+/**
+ * \file
+ *         Traffic-adaptive 6top Scheduling Function.
+ *
+ *         Every SF_ADAPTIVE_PERIOD, the number of unicast transmission
+ *         attempts towards each neighbor (all kinds of links, including
+ *         telemetry bursts) plus its current queue backlog is compared to the
+ *         capacity of the Tx cells negotiated with it. Cells are added as soon
+ *         as the demand exceeds the capacity, and deleted one at a time when
+ *         the demand has stayed below the capacity minus SF_ADAPTIVE_HYSTERESIS
+ *         cells for SF_ADAPTIVE_DELETE_PERIODS periods. When the bandwidth
+ *         is right, the Tx cell with the lowest PDR is relocated if it
+ *         performs much worse than its siblings. 6P transactions are 2-step;
+ *         the responder picks cells among the candidates proposed by the
+ *         initiator.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/nbr-table.h"
+#include "net/mac/tsch/tsch.h"
+#include "net/mac/tsch/sixtop/sixtop.h"
+#include "net/mac/tsch/sixtop/sixp.h"
+#include "net/mac/tsch/sixtop/sixp-pkt.h"
+#include "net/mac/tsch/sixtop/sixp-trans.h"
+#include "sf-adaptive.h"
+
+#if !TSCH_WITH_SIXTOP
+#error "sf-adaptive: this module requires 6top. Set TSCH_CONF_WITH_SIXTOP to 1."
+#endif
+
+#if SF_ADAPTIVE_WITH_RELOCATE && !TSCH_STATS_PER_CELL
+#error "sf-adaptive: relocation requires per-cell statistics. Set TSCH_STATS_CONF_PER_CELL to 1."
+#endif
+
+/* Log configuration */
+#include "sys/log.h"
+#define LOG_MODULE "6top"
+#define LOG_LEVEL LOG_LEVEL_6TOP
+
+/* Max number of cells in a cell list: the cells to add, plus candidates */
+#define MAX_CELL_LIST_LEN (SF_ADAPTIVE_MAX_CELLS_PER_REQUEST + SF_ADAPTIVE_EXTRA_CANDIDATES)
+/* Size of the fixed part of a request (metadata, cell options, num cells) */
+#define REQ_HEADER_LEN 4
+/* Max number of periods to back off after failed transactions */
+#define MAX_BACKOFF_PERIODS 16
+
+/* A cell, as carried in 6P cell lists */
+struct sf_adaptive_cell {
+  uint16_t timeslot;
+  uint16_t channel_offset;
+};
+
+/* Per-neighbor state */
+struct sf_adaptive_nbr {
+  /* tsch_neighbor counters at the end of the previous period */
+  uint16_t last_tx_attempts;
+  /* The Tx cell being deleted or relocated, if any */
+  struct sf_adaptive_cell pending;
+  uint8_t is_initialized;
+  /* Consecutive periods with a low load */
+  uint8_t low_load_periods;
+  /* Consecutive failed transactions, and periods left to back off */
+  uint8_t failures;
+  uint8_t backoff_periods;
+  /* Responder: the cell list of our response, kept until its sent
+   * callback, and the cells a RELOCATE response frees once sent. 6P runs
+   * one transaction at a time with a given peer */
+  uint8_t res_cells[MAX_CELL_LIST_LEN * sizeof(sixp_pkt_cell_t)];
+  uint16_t res_len;
+  struct sf_adaptive_cell res_relocated[MAX_CELL_LIST_LEN];
+};
+
+NBR_TABLE(struct sf_adaptive_nbr, sf_adaptive_nbrs);
+
+static uint8_t is_initialized;
+
+/* Request body, copied to the packet buffer when the request is sent */
+static uint8_t req_storage[REQ_HEADER_LEN + 2 * MAX_CELL_LIST_LEN * sizeof(sixp_pkt_cell_t)];
+
+PROCESS(sf_adaptive_process, "SF adaptive");
+
+/*---------------------------------------------------------------------------*/
+static void
+write_cell(uint8_t *buf, const struct sf_adaptive_cell *cell)
+{
+  buf[0] = cell->timeslot & 0xff;
+  buf[1] = cell->timeslot >> 8;
+  buf[2] = cell->channel_offset & 0xff;
+  buf[3] = cell->channel_offset >> 8;
+}
+/*---------------------------------------------------------------------------*/
+static void
+read_cell(const uint8_t *buf, struct sf_adaptive_cell *cell)
+{
+  cell->timeslot = buf[0] + (buf[1] << 8);
+  cell->channel_offset = buf[2] + (buf[3] << 8);
+}
+/*---------------------------------------------------------------------------*/
+static struct tsch_slotframe *
+get_slotframe(void)
+{
+  struct tsch_slotframe *sf;
+  sf = tsch_schedule_get_slotframe_by_handle(SF_ADAPTIVE_SLOTFRAME_HANDLE);
+  if(sf == NULL) {
+    sf = tsch_schedule_add_slotframe(SF_ADAPTIVE_SLOTFRAME_HANDLE,
+                                     SF_ADAPTIVE_SLOTFRAME_LENGTH);
+  }
+  return sf;
+}
+/*---------------------------------------------------------------------------*/
+static struct sf_adaptive_nbr *
+get_nbr(const linkaddr_t *addr)
+{
+  struct sf_adaptive_nbr *nbr;
+  nbr = nbr_table_get_from_lladdr(sf_adaptive_nbrs, addr);
+  if(nbr == NULL) {
+    nbr = nbr_table_add_lladdr(sf_adaptive_nbrs, addr, NBR_TABLE_REASON_SIXTOP, NULL);
+    if(nbr != NULL) {
+      memset(nbr, 0, sizeof(struct sf_adaptive_nbr));
+    }
+  }
+  return nbr;
+}
+/*---------------------------------------------------------------------------*/
+static struct tsch_link *
+find_link(struct tsch_slotframe *sf, const linkaddr_t *addr,
+          uint8_t link_options, const struct sf_adaptive_cell *cell)
+{
+  struct tsch_link *l;
+  l = tsch_schedule_get_link_by_timeslot(sf, cell->timeslot);
+  if(l != NULL
+     && l->channel_offset == cell->channel_offset
+     && (l->link_options & link_options)
+     && linkaddr_cmp(&l->addr, addr)) {
+    return l;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+count_cells(struct tsch_slotframe *sf, const linkaddr_t *addr, uint8_t link_options)
+{
+  struct tsch_link *l;
+  int count = 0;
+  for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+    if((l->link_options & link_options) && linkaddr_cmp(&l->addr, addr)) {
+      count++;
+    }
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove all cells shared with a neighbor, or with all neighbors if NULL */
+static void
+remove_cells(const linkaddr_t *addr)
+{
+  struct tsch_slotframe *sf;
+  struct tsch_link *l;
+  struct tsch_link *next;
+
+  sf = tsch_schedule_get_slotframe_by_handle(SF_ADAPTIVE_SLOTFRAME_HANDLE);
+  if(sf == NULL) {
+    return;
+  }
+  for(l = list_head(sf->links_list); l != NULL; l = next) {
+    next = list_item_next(l);
+    if(addr == NULL || linkaddr_cmp(&l->addr, addr)) {
+      tsch_schedule_remove_link(sf, l);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Fill a cell list with distinct timeslots free in our schedule */
+static int
+pick_candidates(struct tsch_slotframe *sf, uint8_t *buf, int num_cells)
+{
+  struct sf_adaptive_cell cell;
+  int count = 0;
+  int tries;
+  int i;
+
+  for(tries = 0; count < num_cells && tries < 4 * SF_ADAPTIVE_SLOTFRAME_LENGTH; tries++) {
+    /* Keep timeslot 0 clear: it overlaps the minimal cell whenever
+     * the slotframe lengths are multiple of each other */
+    cell.timeslot = 1 + random_rand() % (SF_ADAPTIVE_SLOTFRAME_LENGTH - 1);
+    cell.channel_offset = random_rand() % SF_ADAPTIVE_NUM_CHANNEL_OFFSETS;
+    if(tsch_schedule_get_link_by_timeslot(sf, cell.timeslot) != NULL) {
+      continue;
+    }
+    for(i = 0; i < count; i++) {
+      if(buf[i * sizeof(sixp_pkt_cell_t)] == (cell.timeslot & 0xff)
+         && buf[i * sizeof(sixp_pkt_cell_t) + 1] == (cell.timeslot >> 8)) {
+        break;
+      }
+    }
+    if(i == count) {
+      write_cell(buf + count * sizeof(sixp_pkt_cell_t), &cell);
+      count++;
+    }
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+/* Add the cells of a list to our schedule */
+static void
+add_cells(struct tsch_slotframe *sf, const linkaddr_t *addr, uint8_t link_options,
+          const uint8_t *cell_list, uint16_t cell_list_len)
+{
+  struct sf_adaptive_cell cell;
+  uint16_t i;
+
+  for(i = 0; i + sizeof(sixp_pkt_cell_t) <= cell_list_len; i += sizeof(sixp_pkt_cell_t)) {
+    read_cell(cell_list + i, &cell);
+    if(tsch_schedule_add_link(sf, link_options, LINK_TYPE_NORMAL, addr,
+                              cell.timeslot, cell.channel_offset, 1) != NULL) {
+      LOG_INFO("SF adaptive: added %s cell [%u, %u] with ",
+               (link_options & LINK_OPTION_TX) ? "Tx" : "Rx",
+               cell.timeslot, cell.channel_offset);
+      LOG_INFO_LLADDR(addr);
+      LOG_INFO_("\n");
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Remove the cells of a list from our schedule */
+static void
+delete_cells(struct tsch_slotframe *sf, const linkaddr_t *addr, uint8_t link_options,
+             const uint8_t *cell_list, uint16_t cell_list_len)
+{
+  struct sf_adaptive_cell cell;
+  struct tsch_link *l;
+  uint16_t i;
+
+  for(i = 0; i + sizeof(sixp_pkt_cell_t) <= cell_list_len; i += sizeof(sixp_pkt_cell_t)) {
+    read_cell(cell_list + i, &cell);
+    if((l = find_link(sf, addr, link_options, &cell)) != NULL) {
+      tsch_schedule_remove_link(sf, l);
+      LOG_INFO("SF adaptive: deleted cell [%u, %u] with ",
+               cell.timeslot, cell.channel_offset);
+      LOG_INFO_LLADDR(addr);
+      LOG_INFO_("\n");
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+transaction_failed(const linkaddr_t *peer_addr)
+{
+  struct sf_adaptive_nbr *nbr = nbr_table_get_from_lladdr(sf_adaptive_nbrs, peer_addr);
+  if(nbr != NULL) {
+    if(nbr->failures < 8) {
+      nbr->failures++;
+    }
+    /* Exponential backoff, randomized to desynchronize competing peers */
+    nbr->backoff_periods = MIN(MAX_BACKOFF_PERIODS,
+                               1 + random_rand() % (1 << nbr->failures));
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Send an ADD or DELETE request carrying the given cell list */
+static int
+send_request(sixp_pkt_cmd_t cmd, const linkaddr_t *peer_addr, uint8_t num_cells,
+             const uint8_t *cell_list, uint16_t cell_list_len)
+{
+  sixp_pkt_code_t code = (sixp_pkt_code_t)(uint8_t)cmd;
+
+  memset(req_storage, 0, sizeof(req_storage));
+  if(sixp_pkt_set_cell_options(SIXP_PKT_TYPE_REQUEST, code,
+                               SIXP_PKT_CELL_OPTION_TX,
+                               req_storage, sizeof(req_storage)) != 0 ||
+     sixp_pkt_set_num_cells(SIXP_PKT_TYPE_REQUEST, code, num_cells,
+                            req_storage, sizeof(req_storage)) != 0 ||
+     sixp_pkt_set_cell_list(SIXP_PKT_TYPE_REQUEST, code,
+                            cell_list, cell_list_len, 0,
+                            req_storage, sizeof(req_storage)) != 0) {
+    return -1;
+  }
+  return sixp_output(SIXP_PKT_TYPE_REQUEST, code, SF_ADAPTIVE_SFID,
+                     req_storage, REQ_HEADER_LEN + cell_list_len,
+                     peer_addr, NULL, NULL, 0);
+}
+/*---------------------------------------------------------------------------*/
+static int
+add_tx_cells(struct tsch_slotframe *sf, const linkaddr_t *peer_addr, uint8_t num_cells)
+{
+  uint8_t cell_list[MAX_CELL_LIST_LEN * sizeof(sixp_pkt_cell_t)];
+  int num_candidates;
+
+  num_candidates = pick_candidates(sf, cell_list, num_cells + SF_ADAPTIVE_EXTRA_CANDIDATES);
+  if(num_candidates < num_cells) {
+    LOG_WARN("SF adaptive: no room for %u more cells\n", num_cells);
+    return -1;
+  }
+  LOG_INFO("SF adaptive: requesting %u cells to ", num_cells);
+  LOG_INFO_LLADDR(peer_addr);
+  LOG_INFO_("\n");
+  return send_request(SIXP_PKT_CMD_ADD, peer_addr, num_cells,
+                      cell_list, num_candidates * sizeof(sixp_pkt_cell_t));
+}
+/*---------------------------------------------------------------------------*/
+static int
+delete_tx_cell(struct tsch_slotframe *sf, const linkaddr_t *peer_addr,
+               struct sf_adaptive_nbr *nbr)
+{
+  uint8_t cell_list[sizeof(sixp_pkt_cell_t)];
+  struct sf_adaptive_cell cell;
+  struct tsch_link *l;
+
+  for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+    if((l->link_options & LINK_OPTION_TX) && linkaddr_cmp(&l->addr, peer_addr)) {
+      break;
+    }
+  }
+  if(l == NULL) {
+    return -1;
+  }
+  cell.timeslot = l->timeslot;
+  cell.channel_offset = l->channel_offset;
+  write_cell(cell_list, &cell);
+  nbr->pending = cell;
+  LOG_INFO("SF adaptive: deleting cell [%u, %u] with ",
+           cell.timeslot, cell.channel_offset);
+  LOG_INFO_LLADDR(peer_addr);
+  LOG_INFO_("\n");
+  return send_request(SIXP_PKT_CMD_DELETE, peer_addr, 1,
+                      cell_list, sizeof(cell_list));
+}
+/*---------------------------------------------------------------------------*/
+int
+sf_adaptive_get_num_tx_cells(const linkaddr_t *peer_addr)
+{
+  struct tsch_slotframe *sf;
+  sf = tsch_schedule_get_slotframe_by_handle(SF_ADAPTIVE_SLOTFRAME_HANDLE);
+  return sf == NULL ? 0 : count_cells(sf, peer_addr, LINK_OPTION_TX);
+}
+/*---------------------------------------------------------------------------*/
+int
+sf_adaptive_relocate(const linkaddr_t *peer_addr,
+                     uint16_t timeslot, uint16_t channel_offset)
+{
+  const sixp_pkt_code_t code = (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_RELOCATE;
+  uint8_t cell_list[(1 + 1 + SF_ADAPTIVE_EXTRA_CANDIDATES) * sizeof(sixp_pkt_cell_t)];
+  struct sf_adaptive_nbr *nbr;
+  struct tsch_slotframe *sf;
+  struct sf_adaptive_cell cell;
+  int num_candidates;
+
+  sf = tsch_schedule_get_slotframe_by_handle(SF_ADAPTIVE_SLOTFRAME_HANDLE);
+  cell.timeslot = timeslot;
+  cell.channel_offset = channel_offset;
+  if(sf == NULL || find_link(sf, peer_addr, LINK_OPTION_TX, &cell) == NULL
+     || sixp_trans_find(peer_addr) != NULL
+     || (nbr = get_nbr(peer_addr)) == NULL) {
+    return -1;
+  }
+
+  write_cell(cell_list, &cell);
+  num_candidates = pick_candidates(sf, cell_list + sizeof(sixp_pkt_cell_t),
+                                   1 + SF_ADAPTIVE_EXTRA_CANDIDATES);
+  if(num_candidates == 0) {
+    return -1;
+  }
+
+  memset(req_storage, 0, sizeof(req_storage));
+  if(sixp_pkt_set_cell_options(SIXP_PKT_TYPE_REQUEST, code,
+                               SIXP_PKT_CELL_OPTION_TX,
+                               req_storage, sizeof(req_storage)) != 0 ||
+     sixp_pkt_set_num_cells(SIXP_PKT_TYPE_REQUEST, code, 1,
+                            req_storage, sizeof(req_storage)) != 0 ||
+     sixp_pkt_set_rel_cell_list(SIXP_PKT_TYPE_REQUEST, code,
+                                cell_list, sizeof(sixp_pkt_cell_t), 0,
+                                req_storage, sizeof(req_storage)) != 0 ||
+     sixp_pkt_set_cand_cell_list(SIXP_PKT_TYPE_REQUEST, code,
+                                 cell_list + sizeof(sixp_pkt_cell_t),
+                                 num_candidates * sizeof(sixp_pkt_cell_t), 0,
+                                 req_storage, sizeof(req_storage)) != 0) {
+    return -1;
+  }
+
+  LOG_INFO("SF adaptive: relocating cell [%u, %u] with ", timeslot, channel_offset);
+  LOG_INFO_LLADDR(peer_addr);
+  LOG_INFO_("\n");
+  nbr->pending = cell;
+  return sixp_output(SIXP_PKT_TYPE_REQUEST, code, SF_ADAPTIVE_SFID,
+                     req_storage,
+                     REQ_HEADER_LEN + (1 + num_candidates) * sizeof(sixp_pkt_cell_t),
+                     peer_addr, NULL, NULL, 0);
+}
+/*---------------------------------------------------------------------------*/
+/* Responder: the neighbor whose response was sent, unless its entry was
+ * removed or reused since */
+static struct sf_adaptive_nbr *
+get_responder_nbr(const void *arg, const linkaddr_t *dest_addr)
+{
+  struct sf_adaptive_nbr *nbr;
+  nbr = nbr_table_get_from_lladdr(sf_adaptive_nbrs, dest_addr);
+  return nbr != NULL && arg == nbr->res_cells ? nbr : NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Responder: the response to an ADD was sent, install the Rx cells */
+static void
+add_response_sent(void *arg, uint16_t arg_len, const linkaddr_t *dest_addr,
+                  sixp_output_status_t status)
+{
+  struct tsch_slotframe *sf = get_slotframe();
+  if(status == SIXP_OUTPUT_STATUS_SUCCESS && sf != NULL
+     && get_responder_nbr(arg, dest_addr) != NULL) {
+    add_cells(sf, dest_addr, LINK_OPTION_RX, arg, arg_len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Responder: the response to a DELETE was sent, remove the Rx cells */
+static void
+delete_response_sent(void *arg, uint16_t arg_len, const linkaddr_t *dest_addr,
+                     sixp_output_status_t status)
+{
+  struct tsch_slotframe *sf = get_slotframe();
+  if(status == SIXP_OUTPUT_STATUS_SUCCESS && sf != NULL
+     && get_responder_nbr(arg, dest_addr) != NULL) {
+    delete_cells(sf, dest_addr, LINK_OPTION_RX, arg, arg_len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Responder: the response to a RELOCATE was sent, move the Rx cells */
+static void
+relocate_response_sent(void *arg, uint16_t arg_len, const linkaddr_t *dest_addr,
+                       sixp_output_status_t status)
+{
+  struct tsch_slotframe *sf = get_slotframe();
+  struct sf_adaptive_nbr *nbr = get_responder_nbr(arg, dest_addr);
+  uint8_t cell_list[sizeof(sixp_pkt_cell_t)];
+  uint16_t i;
+
+  if(status == SIXP_OUTPUT_STATUS_SUCCESS && sf != NULL && nbr != NULL) {
+    for(i = 0; i < arg_len / sizeof(sixp_pkt_cell_t); i++) {
+      write_cell(cell_list, &nbr->res_relocated[i]);
+      delete_cells(sf, dest_addr, LINK_OPTION_RX, cell_list, sizeof(cell_list));
+    }
+    add_cells(sf, dest_addr, LINK_OPTION_RX, arg, arg_len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Responder: the response to a CLEAR was sent, remove all cells */
+static void
+clear_response_sent(void *arg, uint16_t arg_len, const linkaddr_t *dest_addr,
+                    sixp_output_status_t status)
+{
+  remove_cells(dest_addr);
+}
+/*---------------------------------------------------------------------------*/
+/* Responder: select up to num_cells cells free in our schedule */
+static void
+select_cells(struct tsch_slotframe *sf, struct sf_adaptive_nbr *nbr,
+             uint8_t num_cells, const uint8_t *cand_list, uint16_t cand_list_len)
+{
+  struct sf_adaptive_cell cell;
+  uint16_t i;
+
+  nbr->res_len = 0;
+  for(i = 0; i + sizeof(sixp_pkt_cell_t) <= cand_list_len
+      && nbr->res_len < num_cells * sizeof(sixp_pkt_cell_t)
+      && nbr->res_len < sizeof(nbr->res_cells); i += sizeof(sixp_pkt_cell_t)) {
+    read_cell(cand_list + i, &cell);
+    if(cell.timeslot < SF_ADAPTIVE_SLOTFRAME_LENGTH
+       && tsch_schedule_get_link_by_timeslot(sf, cell.timeslot) == NULL) {
+      memcpy(nbr->res_cells + nbr->res_len, cand_list + i, sizeof(sixp_pkt_cell_t));
+      nbr->res_len += sizeof(sixp_pkt_cell_t);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Send a response carrying the cell list of the neighbor, if any */
+static void
+send_response(sixp_pkt_rc_t rc, sixp_sent_callback_t func,
+              const linkaddr_t *peer_addr, struct sf_adaptive_nbr *nbr)
+{
+  /* 6P takes no body rather than an empty one */
+  uint8_t *body = nbr != NULL && nbr->res_len > 0 ? nbr->res_cells : NULL;
+  uint16_t body_len = body != NULL ? nbr->res_len : 0;
+
+  sixp_output(SIXP_PKT_TYPE_RESPONSE, (sixp_pkt_code_t)(uint8_t)rc,
+              SF_ADAPTIVE_SFID, body, body_len, peer_addr,
+              func, nbr != NULL ? nbr->res_cells : NULL, body_len);
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_input(sixp_pkt_cmd_t cmd, const uint8_t *body, uint16_t body_len,
+              const linkaddr_t *peer_addr)
+{
+  const sixp_pkt_code_t code = (sixp_pkt_code_t)(uint8_t)cmd;
+  struct tsch_slotframe *sf;
+  sixp_pkt_cell_options_t cell_options;
+  sixp_pkt_num_cells_t num_cells;
+  const uint8_t *cell_list;
+  sixp_pkt_offset_t cell_list_len;
+  const uint8_t *cand_list;
+  sixp_pkt_offset_t cand_list_len;
+  struct sf_adaptive_nbr *nbr;
+  uint16_t i;
+
+  sf = get_slotframe();
+  nbr = get_nbr(peer_addr);
+  if(sf == NULL || nbr == NULL) {
+    send_response(SIXP_PKT_RC_ERR, NULL, peer_addr, NULL);
+    return;
+  }
+  nbr->res_len = 0;
+
+  switch(cmd) {
+  case SIXP_PKT_CMD_ADD:
+  case SIXP_PKT_CMD_DELETE:
+    if(sixp_pkt_get_cell_options(SIXP_PKT_TYPE_REQUEST, code, &cell_options,
+                                 body, body_len) != 0 ||
+       sixp_pkt_get_num_cells(SIXP_PKT_TYPE_REQUEST, code, &num_cells,
+                              body, body_len) != 0 ||
+       sixp_pkt_get_cell_list(SIXP_PKT_TYPE_REQUEST, code, &cell_list,
+                              &cell_list_len, body, body_len) != 0) {
+      LOG_ERR("SF adaptive: malformed request\n");
+      send_response(SIXP_PKT_RC_ERR, NULL, peer_addr, nbr);
+      return;
+    }
+    /* We only manage Tx cells of the initiator */
+    if(cell_options != SIXP_PKT_CELL_OPTION_TX) {
+      send_response(SIXP_PKT_RC_ERR, NULL, peer_addr, nbr);
+      return;
+    }
+    if(cmd == SIXP_PKT_CMD_ADD) {
+      select_cells(sf, nbr, num_cells, cell_list, cell_list_len);
+      send_response(SIXP_PKT_RC_SUCCESS, add_response_sent, peer_addr, nbr);
+    } else {
+      /* Respond with the cells we actually have */
+      for(i = 0; i + sizeof(sixp_pkt_cell_t) <= cell_list_len
+          && nbr->res_len < sizeof(nbr->res_cells); i += sizeof(sixp_pkt_cell_t)) {
+        struct sf_adaptive_cell cell;
+        read_cell(cell_list + i, &cell);
+        if(find_link(sf, peer_addr, LINK_OPTION_RX, &cell) != NULL) {
+          memcpy(nbr->res_cells + nbr->res_len, cell_list + i, sizeof(sixp_pkt_cell_t));
+          nbr->res_len += sizeof(sixp_pkt_cell_t);
+        }
+      }
+      send_response(nbr->res_len > 0 ? SIXP_PKT_RC_SUCCESS : SIXP_PKT_RC_ERR_CELLLIST,
+                    delete_response_sent, peer_addr, nbr);
+    }
+    break;
+  case SIXP_PKT_CMD_RELOCATE:
+    if(sixp_pkt_get_num_cells(SIXP_PKT_TYPE_REQUEST, code, &num_cells,
+                              body, body_len) != 0 ||
+       sixp_pkt_get_rel_cell_list(SIXP_PKT_TYPE_REQUEST, code, &cell_list,
+                                  &cell_list_len, body, body_len) != 0 ||
+       sixp_pkt_get_cand_cell_list(SIXP_PKT_TYPE_REQUEST, code, &cand_list,
+                                   &cand_list_len, body, body_len) != 0) {
+      LOG_ERR("SF adaptive: malformed request\n");
+      send_response(SIXP_PKT_RC_ERR, NULL, peer_addr, nbr);
+      return;
+    }
+    /* All cells to relocate must be in our schedule */
+    if(num_cells == 0 || num_cells > MAX_CELL_LIST_LEN
+       || cell_list_len < num_cells * sizeof(sixp_pkt_cell_t)) {
+      send_response(SIXP_PKT_RC_ERR, NULL, peer_addr, nbr);
+      return;
+    }
+    for(i = 0; i < num_cells; i++) {
+      read_cell(cell_list + i * sizeof(sixp_pkt_cell_t), &nbr->res_relocated[i]);
+      if(find_link(sf, peer_addr, LINK_OPTION_RX, &nbr->res_relocated[i]) == NULL) {
+        send_response(SIXP_PKT_RC_ERR_CELLLIST, NULL, peer_addr, nbr);
+        return;
+      }
+    }
+    /* The first relocated cells are moved to the selected candidates */
+    select_cells(sf, nbr, num_cells, cand_list, cand_list_len);
+    send_response(SIXP_PKT_RC_SUCCESS, relocate_response_sent, peer_addr, nbr);
+    break;
+  case SIXP_PKT_CMD_CLEAR:
+    send_response(SIXP_PKT_RC_SUCCESS, clear_response_sent, peer_addr, nbr);
+    break;
+  default:
+    send_response(SIXP_PKT_RC_ERR, NULL, peer_addr, nbr);
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_input(sixp_pkt_rc_t rc, const uint8_t *body, uint16_t body_len,
+               const linkaddr_t *peer_addr)
+{
+  struct tsch_slotframe *sf;
+  struct sf_adaptive_nbr *nbr;
+  sixp_trans_t *trans;
+  sixp_pkt_cmd_t cmd;
+  const uint8_t *cell_list;
+  sixp_pkt_offset_t cell_list_len;
+  uint8_t pending[sizeof(sixp_pkt_cell_t)];
+
+  if((trans = sixp_trans_find(peer_addr)) == NULL) {
+    return;
+  }
+  cmd = sixp_trans_get_cmd(trans);
+  nbr = get_nbr(peer_addr);
+  sf = get_slotframe();
+  if(sf == NULL || nbr == NULL) {
+    return;
+  }
+
+  if(rc != SIXP_PKT_RC_SUCCESS) {
+    LOG_WARN("SF adaptive: command %u failed with rc %u\n", cmd, rc);
+    if(cmd == SIXP_PKT_CMD_DELETE && rc == SIXP_PKT_RC_ERR_CELLLIST) {
+      /* The peer does not have the cell: drop it as well */
+      write_cell(pending, &nbr->pending);
+      delete_cells(sf, peer_addr, LINK_OPTION_TX, pending, sizeof(pending));
+    } else {
+      transaction_failed(peer_addr);
+    }
+    return;
+  }
+
+  nbr->failures = 0;
+  if(cmd == SIXP_PKT_CMD_CLEAR) {
+    remove_cells(peer_addr);
+    return;
+  }
+  if(sixp_pkt_get_cell_list(SIXP_PKT_TYPE_RESPONSE,
+                            (sixp_pkt_code_t)(uint8_t)SIXP_PKT_RC_SUCCESS,
+                            &cell_list, &cell_list_len, body, body_len) != 0) {
+    /* An empty cell list */
+    cell_list = NULL;
+    cell_list_len = 0;
+  }
+
+  switch(cmd) {
+  case SIXP_PKT_CMD_ADD:
+    if(cell_list_len == 0) {
+      /* The peer had no room for any of our candidates */
+      transaction_failed(peer_addr);
+    } else {
+      add_cells(sf, peer_addr, LINK_OPTION_TX, cell_list, cell_list_len);
+    }
+    break;
+  case SIXP_PKT_CMD_DELETE:
+    delete_cells(sf, peer_addr, LINK_OPTION_TX, cell_list, cell_list_len);
+    break;
+  case SIXP_PKT_CMD_RELOCATE:
+    if(cell_list_len > 0) {
+      write_cell(pending, &nbr->pending);
+      delete_cells(sf, peer_addr, LINK_OPTION_TX, pending, sizeof(pending));
+      add_cells(sf, peer_addr, LINK_OPTION_TX, cell_list, sizeof(sixp_pkt_cell_t));
+    }
+    break;
+  default:
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_handler(sixp_pkt_type_t type, sixp_pkt_code_t code,
+              const uint8_t *body, uint16_t body_len, const linkaddr_t *src_addr)
+{
+  if(type == SIXP_PKT_TYPE_REQUEST) {
+    request_input(code.cmd, body, body_len, src_addr);
+  } else if(type == SIXP_PKT_TYPE_RESPONSE) {
+    response_input(code.rc, body, body_len, src_addr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+timeout_handler(sixp_pkt_cmd_t cmd, const linkaddr_t *peer_addr)
+{
+  LOG_WARN("SF adaptive: command %u timed out with ", cmd);
+  LOG_WARN_LLADDR(peer_addr);
+  LOG_WARN_("\n");
+  transaction_failed(peer_addr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+error_handler(sixp_error_t err, sixp_pkt_cmd_t cmd, uint8_t seqno,
+              const linkaddr_t *peer_addr)
+{
+  if(err == SIXP_ERROR_SCHEDULE_INCONSISTENCY) {
+    /* Start over with this peer */
+    LOG_WARN("SF adaptive: schedule inconsistency with ");
+    LOG_WARN_LLADDR(peer_addr);
+    LOG_WARN_("\n");
+    remove_cells(peer_addr);
+    transaction_failed(peer_addr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if SF_ADAPTIVE_WITH_RELOCATE
+/* Relocate the Tx cell with the lowest PDR if it is well below the PDR of the
+ * best sibling cell to the same neighbor. With the same link quality on all
+ * cells, such a difference points to collisions, e.g. with hidden terminals */
+static int
+relocate_worst_cell(struct tsch_slotframe *sf, const linkaddr_t *addr)
+{
+  const struct tsch_cell_stats *stats;
+  struct tsch_link *l;
+  struct tsch_link *worst = NULL;
+  unsigned worst_pdr = 100;
+  unsigned best_pdr = 0;
+  unsigned pdr;
+
+  for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+    if((l->link_options & LINK_OPTION_TX) && linkaddr_cmp(&l->addr, addr)
+       && (stats = tsch_stats_get_cell(l)) != NULL
+       && stats->tx_attempts >= SF_ADAPTIVE_RELOCATE_MIN_ATTEMPTS) {
+      pdr = 100 * stats->tx_acked / stats->tx_attempts;
+      if(worst == NULL || pdr < worst_pdr) {
+        worst = l;
+        worst_pdr = pdr;
+      }
+      best_pdr = MAX(best_pdr, pdr);
+    }
+  }
+
+  if(worst != NULL
+     && worst_pdr * 100 < best_pdr * SF_ADAPTIVE_RELOCATE_PDR_THRESHOLD) {
+    LOG_INFO("SF adaptive: cell [%u, %u] PDR %u%%, best sibling %u%%\n",
+             worst->timeslot, worst->channel_offset, worst_pdr, best_pdr);
+    return sf_adaptive_relocate(addr, worst->timeslot, worst->channel_offset);
+  }
+  return -1;
+}
+#endif /* SF_ADAPTIVE_WITH_RELOCATE */
+/*---------------------------------------------------------------------------*/
+/* Adapt the cells shared with a neighbor to the traffic of the last period */
+static void
+adapt_nbr(struct tsch_slotframe *sf, struct tsch_neighbor *n)
+{
+  const linkaddr_t *addr = tsch_queue_get_nbr_address(n);
+  struct sf_adaptive_nbr *nbr;
+  uint16_t attempts;
+  uint32_t slots_per_period;
+  uint32_t demand;
+  int num_cells;
+  int required;
+
+  if(addr == NULL || (nbr = get_nbr(addr)) == NULL) {
+    return;
+  }
+
+  attempts = n->tx_attempts - nbr->last_tx_attempts;
+  nbr->last_tx_attempts = n->tx_attempts;
+  if(!nbr->is_initialized) {
+    /* The counters only make sense from the next period on */
+    nbr->is_initialized = 1;
+    return;
+  }
+  if(nbr->backoff_periods > 0) {
+    nbr->backoff_periods--;
+    return;
+  }
+  if(sixp_trans_find(addr) != NULL) {
+    return;
+  }
+
+  /* Demand: what was sent in the last period, plus what is still queued.
+   * Required cells: number of cells per slotframe to serve the demand
+   * within a period, rounded up */
+  num_cells = count_cells(sf, addr, LINK_OPTION_TX);
+  slots_per_period = (uint32_t)SF_ADAPTIVE_PERIOD * TSCH_SLOTS_PER_SECOND / CLOCK_SECOND;
+  demand = attempts + tsch_queue_nbr_packet_count(n);
+  required = (demand * SF_ADAPTIVE_SLOTFRAME_LENGTH + slots_per_period - 1) / slots_per_period;
+  required = MAX(required, SF_ADAPTIVE_MIN_CELLS);
+
+  LOG_DBG("SF adaptive: nbr ");
+  LOG_DBG_LLADDR(addr);
+  LOG_DBG_(" attempts %u, cells %d, required %d\n",
+           attempts, num_cells, required);
+
+  if(required > num_cells && num_cells < SF_ADAPTIVE_MAX_CELLS) {
+    nbr->low_load_periods = 0;
+    add_tx_cells(sf, addr, MIN(MIN(required - num_cells, SF_ADAPTIVE_MAX_CELLS_PER_REQUEST),
+                               SF_ADAPTIVE_MAX_CELLS - num_cells));
+    return;
+  } else if(num_cells > SF_ADAPTIVE_MIN_CELLS
+            && required + SF_ADAPTIVE_HYSTERESIS < num_cells) {
+    if(++nbr->low_load_periods >= SF_ADAPTIVE_DELETE_PERIODS) {
+      nbr->low_load_periods = 0;
+      delete_tx_cell(sf, addr, nbr);
+      return;
+    }
+  } else {
+    nbr->low_load_periods = 0;
+  }
+
+#if SF_ADAPTIVE_WITH_RELOCATE
+  /* No bandwidth change needed: fix collisions, if any */
+  relocate_worst_cell(sf, addr);
+#endif /* SF_ADAPTIVE_WITH_RELOCATE */
+}
+/*---------------------------------------------------------------------------*/
+static void
+housekeeping(void)
+{
+  struct tsch_slotframe *sf;
+  struct tsch_neighbor *n;
+  struct sf_adaptive_nbr *nbr;
+  struct sf_adaptive_nbr *next;
+
+  if(!tsch_is_associated) {
+    /* Our cells and counters are meaningless after leaving the network */
+    remove_cells(NULL);
+    for(nbr = nbr_table_head(sf_adaptive_nbrs); nbr != NULL; nbr = next) {
+      next = nbr_table_next(sf_adaptive_nbrs, nbr);
+      nbr_table_remove(sf_adaptive_nbrs, nbr);
+    }
+    return;
+  }
+  if(tsch_is_locked() || (sf = get_slotframe()) == NULL) {
+    return;
+  }
+  for(n = tsch_queue_first_nbr(); n != NULL; n = tsch_queue_next_nbr(n)) {
+    if(!n->is_broadcast) {
+      adapt_nbr(sf, n);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sf_adaptive_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  etimer_set(&et, SF_ADAPTIVE_PERIOD);
+  while(1) {
+    PROCESS_YIELD_UNTIL(etimer_expired(&et));
+    /* Randomize the period to spread 6P transactions */
+    etimer_set(&et, SF_ADAPTIVE_PERIOD - SF_ADAPTIVE_PERIOD / 8
+               + random_rand() % (SF_ADAPTIVE_PERIOD / 4 + 1));
+    housekeeping();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  /* sixtop_add_sf() may call us more than once */
+  if(!is_initialized) {
+    is_initialized = 1;
+    nbr_table_register(sf_adaptive_nbrs, NULL);
+    process_start(&sf_adaptive_process, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+const sixtop_sf_t sf_adaptive_driver = {
+  SF_ADAPTIVE_SFID,
+  SF_ADAPTIVE_TIMEOUT,
+  init,
+  input_handler,
+  timeout_handler,
+  error_handler,
+};
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,151 @@
+/**
+ * \addtogroup sixtop
+ * @{
+ */
+/**
+ * \file
+ *         Traffic-adaptive 6top Scheduling Function. Negotiates dedicated Tx
+ *         cells with every neighbor we send unicast traffic to, and adds,
+ *         deletes or relocates cells so that the bandwidth tracks the load.
+ */
+
+#ifndef SF_ADAPTIVE_H_
+#define SF_ADAPTIVE_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+#include "net/mac/tsch/tsch.h"
+#include "net/mac/tsch/sixtop/sixtop.h"
+
+/* Scheduling Function Identifier, in the unmanaged range */
+#ifdef SF_ADAPTIVE_CONF_SFID
+#define SF_ADAPTIVE_SFID SF_ADAPTIVE_CONF_SFID
+#else
+#define SF_ADAPTIVE_SFID 0xf1
+#endif
+
+/* Handle of the slotframe holding the negotiated cells. Must not be used by
+ * any other slotframe (e.g. of Orchestra rules) */
+#ifdef SF_ADAPTIVE_CONF_SLOTFRAME_HANDLE
+#define SF_ADAPTIVE_SLOTFRAME_HANDLE SF_ADAPTIVE_CONF_SLOTFRAME_HANDLE
+#else
+#define SF_ADAPTIVE_SLOTFRAME_HANDLE 5
+#endif
+
+/* Length of the slotframe holding the negotiated cells */
+#ifdef SF_ADAPTIVE_CONF_SLOTFRAME_LENGTH
+#define SF_ADAPTIVE_SLOTFRAME_LENGTH SF_ADAPTIVE_CONF_SLOTFRAME_LENGTH
+#else
+#define SF_ADAPTIVE_SLOTFRAME_LENGTH 101
+#endif
+
+/* Number of channel offsets used for the negotiated cells */
+#ifdef SF_ADAPTIVE_CONF_NUM_CHANNEL_OFFSETS
+#define SF_ADAPTIVE_NUM_CHANNEL_OFFSETS SF_ADAPTIVE_CONF_NUM_CHANNEL_OFFSETS
+#else
+#define SF_ADAPTIVE_NUM_CHANNEL_OFFSETS 16
+#endif
+
+/* Period at which the load towards every neighbor is measured */
+#ifdef SF_ADAPTIVE_CONF_PERIOD
+#define SF_ADAPTIVE_PERIOD SF_ADAPTIVE_CONF_PERIOD
+#else
+#define SF_ADAPTIVE_PERIOD (8 * CLOCK_SECOND)
+#endif
+
+/* Min and max number of Tx cells per neighbor */
+#ifdef SF_ADAPTIVE_CONF_MIN_CELLS
+#define SF_ADAPTIVE_MIN_CELLS SF_ADAPTIVE_CONF_MIN_CELLS
+#else
+#define SF_ADAPTIVE_MIN_CELLS 0
+#endif
+
+#ifdef SF_ADAPTIVE_CONF_MAX_CELLS
+#define SF_ADAPTIVE_MAX_CELLS SF_ADAPTIVE_CONF_MAX_CELLS
+#else
+#define SF_ADAPTIVE_MAX_CELLS 8
+#endif
+
+/* Max number of cells added in a single 6P ADD request */
+#ifdef SF_ADAPTIVE_CONF_MAX_CELLS_PER_REQUEST
+#define SF_ADAPTIVE_MAX_CELLS_PER_REQUEST SF_ADAPTIVE_CONF_MAX_CELLS_PER_REQUEST
+#else
+#define SF_ADAPTIVE_MAX_CELLS_PER_REQUEST 3
+#endif
+
+/* Number of candidate cells proposed in addition to the ones requested */
+#ifdef SF_ADAPTIVE_CONF_EXTRA_CANDIDATES
+#define SF_ADAPTIVE_EXTRA_CANDIDATES SF_ADAPTIVE_CONF_EXTRA_CANDIDATES
+#else
+#define SF_ADAPTIVE_EXTRA_CANDIDATES 2
+#endif
+
+/* Hysteresis: a cell is deleted only when the load fits in this many cells
+ * less than currently allocated... */
+#ifdef SF_ADAPTIVE_CONF_HYSTERESIS
+#define SF_ADAPTIVE_HYSTERESIS SF_ADAPTIVE_CONF_HYSTERESIS
+#else
+#define SF_ADAPTIVE_HYSTERESIS 1
+#endif
+
+/* ...for this many consecutive periods */
+#ifdef SF_ADAPTIVE_CONF_DELETE_PERIODS
+#define SF_ADAPTIVE_DELETE_PERIODS SF_ADAPTIVE_CONF_DELETE_PERIODS
+#else
+#define SF_ADAPTIVE_DELETE_PERIODS 3
+#endif
+
+/* Relocate Tx cells whose PDR is low compared to their siblings, based on the
+ * per-cell statistics of TSCH */
+#ifdef SF_ADAPTIVE_CONF_WITH_RELOCATE
+#define SF_ADAPTIVE_WITH_RELOCATE SF_ADAPTIVE_CONF_WITH_RELOCATE
+#else
+#define SF_ADAPTIVE_WITH_RELOCATE TSCH_STATS_PER_CELL
+#endif
+
+/* Min number of transmission attempts in a cell before its PDR is trusted */
+#ifdef SF_ADAPTIVE_CONF_RELOCATE_MIN_ATTEMPTS
+#define SF_ADAPTIVE_RELOCATE_MIN_ATTEMPTS SF_ADAPTIVE_CONF_RELOCATE_MIN_ATTEMPTS
+#else
+#define SF_ADAPTIVE_RELOCATE_MIN_ATTEMPTS 16
+#endif
+
+/* A cell is relocated when its PDR is below this percentage of the PDR of the
+ * best Tx cell to the same neighbor */
+#ifdef SF_ADAPTIVE_CONF_RELOCATE_PDR_THRESHOLD
+#define SF_ADAPTIVE_RELOCATE_PDR_THRESHOLD SF_ADAPTIVE_CONF_RELOCATE_PDR_THRESHOLD
+#else
+#define SF_ADAPTIVE_RELOCATE_PDR_THRESHOLD 50
+#endif
+
+/* 6P transaction timeout */
+#ifdef SF_ADAPTIVE_CONF_TIMEOUT
+#define SF_ADAPTIVE_TIMEOUT SF_ADAPTIVE_CONF_TIMEOUT
+#else
+#define SF_ADAPTIVE_TIMEOUT (10 * CLOCK_SECOND)
+#endif
+
+/**
+ * \brief The Scheduling Function driver, to install with sixtop_add_sf()
+ */
+extern const sixtop_sf_t sf_adaptive_driver;
+
+/**
+ * \brief Get the number of Tx cells negotiated with a neighbor
+ * \param peer_addr The address of the neighbor
+ * \return The number of Tx cells
+ */
+int sf_adaptive_get_num_tx_cells(const linkaddr_t *peer_addr);
+
+/**
+ * \brief Move a Tx cell to another timeslot and channel offset (6P RELOCATE)
+ * \param peer_addr The address of the neighbor
+ * \param timeslot The timeslot of the cell to relocate
+ * \param channel_offset The channel offset of the cell to relocate
+ * \return 0 if a RELOCATE request was sent, -1 otherwise
+ */
+int sf_adaptive_relocate(const linkaddr_t *peer_addr,
+                         uint16_t timeslot, uint16_t channel_offset);
+
+#endif /* SF_ADAPTIVE_H_ */
+/** @} */
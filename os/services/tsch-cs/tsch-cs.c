@@ -46,6 +46,18 @@
 #error tsch-cs requires periodic RSSI sampling. Please enable TSCH_STATS_CONF_SAMPLE_NOISE_RSSI.
 #endif /* ! TSCH_STATS_SAMPLE_NOISE_RSSI */
 
+#if TSCH_CS_NETWORK_WIDE
+#if ! TSCH_WITH_CHANNEL_MAP
+#error network-wide tsch-cs requires the TSCH channel map. Please enable TSCH_CONF_WITH_CHANNEL_MAP.
+#endif /* ! TSCH_WITH_CHANNEL_MAP */
+#if ! TSCH_STATS_CHANNEL_TX
+#error network-wide tsch-cs requires per-channel Tx stats. Please enable TSCH_STATS_CONF_CHANNEL_TX.
+#endif /* ! TSCH_STATS_CHANNEL_TX */
+#if TSCH_STATS_FIRST_CHANNEL != TSCH_CHANNEL_MAP_FIRST_CHANNEL
+#error network-wide tsch-cs requires TSCH_STATS_FIRST_CHANNEL == TSCH_CHANNEL_MAP_FIRST_CHANNEL
+#endif
+#endif /* TSCH_CS_NETWORK_WIDE */
+
 /* Log configuration */
 #include "sys/log.h"
 #define LOG_MODULE "TSCH CS"
@@ -81,6 +93,18 @@ static tsch_cs_bitmap_t tsch_cs_initial_bitmap;
 /* The bitmap with the current channels */
 static tsch_cs_bitmap_t tsch_cs_current_bitmap;
 
+#if TSCH_CS_NETWORK_WIDE
+/* EWMA of the RSSI of the INT records received on each channel, in the
+ * internal TSCH stats representation, and the number of records */
+static tsch_stat_t tsch_cs_int_rssi[TSCH_STATS_NUM_CHANNELS];
+static uint8_t tsch_cs_int_rssi_samples[TSCH_STATS_NUM_CHANNELS];
+
+/* Time (in seconds) when channels were taken off the blacklist. Their ACK
+ * and INT stats are stale, so only noise is accounted for during
+ * TSCH_CS_LEARNING_PERIOD_SEC */
+static uint32_t tsch_cs_allowed_since[TSCH_STATS_NUM_CHANNELS];
+#endif /* TSCH_CS_NETWORK_WIDE */
+
 /* structure for sorting */
 struct tsch_cs_quality {
   /* channel number */
@@ -197,6 +221,188 @@ tsch_cs_select_replacement(uint8_t old_channel, tsch_stat_t old_ewma,
   return 0xff;
 }
 /*---------------------------------------------------------------------------*/
+#if TSCH_CS_NETWORK_WIDE
+void
+tsch_cs_int_telemetry_input(uint8_t channel, int8_t rssi)
+{
+  uint8_t index;
+  tsch_stat_t value;
+
+  /* The records converge at the coordinator; a zero RSSI means no sample */
+  if(!tsch_is_coordinator || rssi >= 0
+     || channel < TSCH_STATS_FIRST_CHANNEL
+     || channel >= TSCH_STATS_FIRST_CHANNEL + TSCH_STATS_NUM_CHANNELS) {
+    return;
+  }
+
+  index = tsch_stats_channel_to_index(channel);
+  value = TSCH_STATS_TRANSFORM(rssi, TSCH_STATS_RSSI_SCALING_FACTOR);
+  if(tsch_cs_int_rssi_samples[index] == 0) {
+    tsch_cs_int_rssi[index] = value;
+  } else {
+    TSCH_STATS_EWMA_UPDATE(tsch_cs_int_rssi[index], value);
+  }
+  if(tsch_cs_int_rssi_samples[index] < 0xff) {
+    tsch_cs_int_rssi_samples[index]++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Is a channel of the hopping sequence bad for the network? `rssi_sum` and
+ * `rssi_count` cover the INT RSSI of all channels in use */
+static bool
+tsch_cs_network_is_bad(uint8_t index, tsch_stat_t best_tx_success,
+                       uint32_t rssi_sum, uint8_t rssi_count, uint32_t now)
+{
+  /* Busy at the coordinator */
+  if(tsch_stats.channel_free_ewma[index] < TSCH_CS_FREE_THRESHOLD) {
+    return true;
+  }
+
+  if(tsch_cs_allowed_since[index] != 0
+     && tsch_cs_allowed_since[index] + TSCH_CS_LEARNING_PERIOD_SEC > now) {
+    /* Recently allowed back, wait for fresh stats */
+    return false;
+  }
+
+  /* Poor ACK ratio compared with the best channel */
+  if((uint32_t)tsch_stats.channel_tx_success_ewma[index] * 100
+     < (uint32_t)best_tx_success * TSCH_CS_TX_SUCCESS_RATIO) {
+    return true;
+  }
+
+  /* Weak receptions along the paths compared with the other channels. The
+   * internal representation of RSSI grows as the RSSI gets lower */
+  if(tsch_cs_int_rssi_samples[index] >= TSCH_CS_MIN_RSSI_SAMPLES && rssi_count > 1) {
+    uint32_t others = (rssi_sum - tsch_cs_int_rssi[index]) / (rssi_count - 1);
+    if(tsch_cs_int_rssi[index]
+       > others + TSCH_CS_RSSI_MARGIN * -TSCH_STATS_RSSI_SCALING_FACTOR) {
+      return true;
+    }
+  }
+
+  return false;
+}
+/*---------------------------------------------------------------------------*/
+static void
+tsch_cs_network_allow(uint8_t index, uint32_t now)
+{
+  tsch_cs_allowed_since[index] = now;
+  tsch_cs_int_rssi_samples[index] = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Build the blacklist at the coordinator and announce it in EBs */
+static bool
+tsch_cs_network_process(void)
+{
+  static uint32_t last_time_evaluated;
+  uint32_t now = clock_seconds();
+  struct tsch_channel_map cm;
+  tsch_cs_bitmap_t in_sequence;
+  tsch_cs_bitmap_t active;
+  tsch_cs_bitmap_t blacklist;
+  tsch_stat_t best_tx_success = 0;
+  uint32_t rssi_sum = 0;
+  uint8_t rssi_count = 0;
+  uint8_t num_in_sequence = 0;
+  uint8_t num_allowed = 0;
+  int i;
+
+  if(!tsch_is_coordinator || !tsch_is_associated
+     || now < TSCH_CS_LEARNING_PERIOD_SEC) {
+    return false;
+  }
+  if(last_time_evaluated != 0
+     && last_time_evaluated + TSCH_CS_NETWORK_PERIOD_SEC > now) {
+    return false;
+  }
+  last_time_evaluated = now;
+
+  if(tsch_get_channel_map(&cm)
+     && (int32_t)TSCH_ASN_DIFF(tsch_current_asn, cm.switch_asn) < 0) {
+    /* The previous change is still pending */
+    return false;
+  }
+
+  in_sequence = tsch_cs_bitmap_calc();
+  active = tsch_get_channel_blacklist(&tsch_current_asn);
+
+  /* The reference values, from the channels in use */
+  for(i = 0; i < TSCH_STATS_NUM_CHANNELS; ++i) {
+    uint8_t channel = tsch_stats_index_to_channel(i);
+    if(tsch_cs_bitmap_contains(in_sequence, channel)
+       && !tsch_cs_bitmap_contains(active, channel)) {
+      best_tx_success = MAX(best_tx_success, tsch_stats.channel_tx_success_ewma[i]);
+      if(tsch_cs_int_rssi_samples[i] >= TSCH_CS_MIN_RSSI_SAMPLES) {
+        rssi_sum += tsch_cs_int_rssi[i];
+        rssi_count++;
+      }
+    }
+  }
+
+  blacklist = 0;
+  for(i = 0; i < TSCH_STATS_NUM_CHANNELS; ++i) {
+    uint8_t channel = tsch_stats_index_to_channel(i);
+    bool is_bad;
+    if(!tsch_cs_bitmap_contains(in_sequence, channel)) {
+      continue;
+    }
+    num_in_sequence++;
+    is_bad = tsch_cs_network_is_bad(i, best_tx_success, rssi_sum, rssi_count, now);
+    if(tsch_cs_bitmap_contains(active, channel)) {
+      /* Keep it for at least TSCH_CS_BLACKLIST_DURATION_SEC. After that,
+       * only noise can be judged, as the network no longer uses it */
+      if(tsch_cs_busy_since[i] + TSCH_CS_BLACKLIST_DURATION_SEC > now
+         || tsch_stats.channel_free_ewma[i] < TSCH_CS_FREE_THRESHOLD) {
+        blacklist = tsch_cs_bitmap_set(blacklist, channel);
+      } else {
+        tsch_cs_network_allow(i, now);
+        num_allowed++;
+      }
+    } else if(is_bad) {
+      LOG_INFO("ch %u: bad, free %u tx %u int rssi %d (%u samples)\n", channel,
+               tsch_stats.channel_free_ewma[i],
+               tsch_stats.channel_tx_success_ewma[i],
+               tsch_cs_int_rssi[i] / TSCH_STATS_RSSI_SCALING_FACTOR,
+               tsch_cs_int_rssi_samples[i]);
+      tsch_cs_busy_since[i] = now;
+      blacklist = tsch_cs_bitmap_set(blacklist, channel);
+    } else {
+      num_allowed++;
+    }
+  }
+
+  /* Leave enough channels, picking back the ones with the best ACK ratio */
+  while(num_allowed < MIN(TSCH_CS_MIN_CHANNELS, num_in_sequence)) {
+    int best = -1;
+    for(i = 0; i < TSCH_STATS_NUM_CHANNELS; ++i) {
+      if(tsch_cs_bitmap_contains(blacklist, tsch_stats_index_to_channel(i))
+         && (best < 0 || tsch_stats.channel_tx_success_ewma[i]
+             > tsch_stats.channel_tx_success_ewma[best])) {
+        best = i;
+      }
+    }
+    blacklist &= ~tsch_cs_bitmap_set(0, tsch_stats_index_to_channel(best));
+    tsch_cs_network_allow(best, now);
+    num_allowed++;
+  }
+
+  if(blacklist == active) {
+    LOG_DBG("cs: no changes\n");
+    return false;
+  }
+
+  cm.blacklist = active;
+  cm.next_blacklist = blacklist;
+  cm.switch_asn = tsch_current_asn;
+  TSCH_ASN_INC(cm.switch_asn, TSCH_CS_SWITCH_DELAY_SEC * 1000000ul
+               / tsch_timing_us[tsch_ts_timeslot_length]);
+  LOG_INFO("cs: blacklist %04x -> %04x at asn-%x.%lx\n",
+           active, blacklist, cm.switch_asn.ms1b, (unsigned long)cm.switch_asn.ls4b);
+  /* When TSCH is busy, the next run computes the change again */
+  return tsch_set_channel_map(&cm) != 0;
+}
+#endif /* TSCH_CS_NETWORK_WIDE */
+/*---------------------------------------------------------------------------*/
 bool
 tsch_cs_process(void)
 {
@@ -208,6 +414,11 @@ tsch_cs_process(void)
   uint8_t is_in_sequence[TSCH_STATS_NUM_CHANNELS];
   static uint32_t last_time_changed;
 
+#if TSCH_CS_NETWORK_WIDE
+  /* The hopping sequence stays; the coordinator distributes a blacklist */
+  return tsch_cs_network_process();
+#endif /* TSCH_CS_NETWORK_WIDE */
+
   if(!recaculation_requested) {
     /* nothing to do */
     return false;
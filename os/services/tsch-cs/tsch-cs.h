@@ -50,6 +50,68 @@
 
 #define TSCH_CS_LEARNING_PERIOD_SEC 30
 
+/*
+ * Network-wide mode: instead of rewriting the hopping sequence from its own
+ * noise samples, the PAN coordinator builds a channel quality map of the
+ * whole network and distributes a channel blacklist in EBs
+ * (TSCH_CONF_WITH_CHANNEL_MAP), which all nodes apply in sync at an
+ * announced ASN. The map combines:
+ * - the coordinator's noise samples (TSCH_STATS_CONF_SAMPLE_NOISE_RSSI);
+ * - the coordinator's per-channel unicast ACK ratio (TSCH_STATS_CONF_CHANNEL_TX);
+ * - the per-hop channel and RSSI of INT records reaching the coordinator,
+ *   through TSCH_CALLBACK_INT_TELEMETRY_INPUT.
+ */
+#ifdef TSCH_CS_CONF_NETWORK_WIDE
+#define TSCH_CS_NETWORK_WIDE TSCH_CS_CONF_NETWORK_WIDE
+#else
+#define TSCH_CS_NETWORK_WIDE 0
+#endif
+
+/* Network-wide mode: the period of the channel quality evaluation */
+#ifdef TSCH_CS_CONF_NETWORK_PERIOD_SEC
+#define TSCH_CS_NETWORK_PERIOD_SEC TSCH_CS_CONF_NETWORK_PERIOD_SEC
+#else
+#define TSCH_CS_NETWORK_PERIOD_SEC 5
+#endif
+
+/* Network-wide mode: the delay between the announcement of a new blacklist
+ * and its use. Must leave time for EBs to reach all nodes */
+#ifdef TSCH_CS_CONF_SWITCH_DELAY_SEC
+#define TSCH_CS_SWITCH_DELAY_SEC TSCH_CS_CONF_SWITCH_DELAY_SEC
+#else
+#define TSCH_CS_SWITCH_DELAY_SEC 10
+#endif
+
+/* Network-wide mode: a channel is bad if its ACK ratio is below this
+ * percentage of the best channel's */
+#ifdef TSCH_CS_CONF_TX_SUCCESS_RATIO
+#define TSCH_CS_TX_SUCCESS_RATIO TSCH_CS_CONF_TX_SUCCESS_RATIO
+#else
+#define TSCH_CS_TX_SUCCESS_RATIO 70
+#endif
+
+/* Network-wide mode: a channel is bad if its INT RSSI is this many dB below
+ * the average of the other channels */
+#ifdef TSCH_CS_CONF_RSSI_MARGIN
+#define TSCH_CS_RSSI_MARGIN TSCH_CS_CONF_RSSI_MARGIN
+#else
+#define TSCH_CS_RSSI_MARGIN 10
+#endif
+
+/* Network-wide mode: the number of INT records needed to judge a channel */
+#ifdef TSCH_CS_CONF_MIN_RSSI_SAMPLES
+#define TSCH_CS_MIN_RSSI_SAMPLES TSCH_CS_CONF_MIN_RSSI_SAMPLES
+#else
+#define TSCH_CS_MIN_RSSI_SAMPLES 4
+#endif
+
+/* Network-wide mode: the minimal number of channels left in use */
+#ifdef TSCH_CS_CONF_MIN_CHANNELS
+#define TSCH_CS_MIN_CHANNELS TSCH_CS_CONF_MIN_CHANNELS
+#else
+#define TSCH_CS_MIN_CHANNELS 2
+#endif
+
 /**
  * \brief Initializes the TSCH hopping sequence selection module.
  */
@@ -68,6 +130,14 @@ void tsch_cs_channel_stats_updated(uint8_t updated_channel, uint16_t old_busynes
  */
 bool tsch_cs_process(void);
 
+/**
+ * \brief Account for an INT record, in network-wide mode. Ignored except at
+ * the PAN coordinator.
+ * \param channel The channel of the hop
+ * \param rssi    The RSSI of the hop
+ */
+void tsch_cs_int_telemetry_input(uint8_t channel, int8_t rssi);
+
 
 /* A bit corresponds to a channel; `uint16_t` value is OK for up to 16 channels. */
 typedef uint16_t tsch_cs_bitmap_t;
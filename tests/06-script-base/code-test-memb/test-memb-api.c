@@ -79,6 +79,10 @@ main(void)
       printf("test failed: %p returned memb_alloc() is invalid\n",
              memb_block_p);
       return -1;
+    } else if((ret = memb_index(&memb_pool, memb_block_p)) != i) {
+      printf("test failed: memb_index() returns %d for %p, "
+             "which should be %d\n", ret, memb_block_p, i);
+      return -1;
     } else if((ret = memb_numfree(&memb_pool)) != NUM_MEMB_BLOCKS - i - 1) {
       printf("test failed: memb_numfree() returns an invalid value %d, "
              "which should be %d\n", ret, NUM_MEMB_BLOCKS - i - 1);
@@ -90,6 +94,15 @@ main(void)
     memb_block_list[i] = memb_block_p;
   }
 
+  /* addresses which are not the beginning of a block have no index */
+  if(memb_index(&memb_pool, ONE_BYTE_OFF_ADDR(memb_block_list[0])) != -1 ||
+     memb_index(&memb_pool, memb_block_list[NUM_MEMB_BLOCKS - 1] + 1) != -1) {
+    printf("test failed: memb_index() accepts an invalid address\n");
+    return -1;
+  } else {
+    printf("- memb_index is OK: reject invalid addresses\n");
+  }
+
   /* try to allocate another memory block, which should fail */
   if((memb_block_p = (test_struct_t *)memb_alloc(&memb_pool)) != NULL) {
     printf("test failed: memb_alloc() allocates more memory than defined\n");
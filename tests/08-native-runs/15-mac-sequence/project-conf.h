@@ -0,0 +1,10 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* A neighbor table of embedded size, instead of the native default */
+#define NBR_TABLE_CONF_MAX_NEIGHBORS 16
+
+/* Short enough for the test to check the age-out */
+#define NETSTACK_CONF_MAC_SEQNO_MAX_AGE (CLOCK_SECOND / 2)
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,126 @@
+/**
+ * \file
+ *         Duplicate detection of mac-sequence.c with many senders.
+ */
+
+#include "contiki.h"
+#include "unit-test.h"
+#include "net/packetbuf.h"
+#include "net/mac/mac-sequence.h"
+#include "net/nbr-table.h"
+#include <stdio.h>
+#include <string.h>
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+/* As many senders as neighbors */
+#define NUM_SENDERS NBR_TABLE_MAX_NEIGHBORS
+#define NUM_ROUNDS 8
+
+/*---------------------------------------------------------------------------*/
+static void
+set_frame(int sender, uint8_t seqno)
+{
+  linkaddr_t addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.u8[0] = 0x02;
+  addr.u8[LINKADDR_SIZE - 2] = sender >> 8;
+  addr.u8[LINKADDR_SIZE - 1] = sender;
+  packetbuf_clear();
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &addr);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, seqno);
+}
+/*---------------------------------------------------------------------------*/
+/* Every sender sends a frame, then all of them retransmit it */
+static void
+send_round(int round, unsigned *false_duplicates, unsigned *leaked_duplicates)
+{
+  int i;
+
+  for(i = 0; i < NUM_SENDERS; i++) {
+    set_frame(i, round + i);
+    if(mac_sequence_is_duplicate()) {
+      (*false_duplicates)++;
+    } else {
+      mac_sequence_register_seqno();
+    }
+  }
+  for(i = 0; i < NUM_SENDERS; i++) {
+    set_frame(i, round + i);
+    if(!mac_sequence_is_duplicate()) {
+      (*leaked_duplicates)++;
+      mac_sequence_register_seqno();
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(mac_sequence_many_senders,
+                   "Duplicates of many senders are detected");
+UNIT_TEST(mac_sequence_many_senders)
+{
+  unsigned false_duplicates = 0;
+  unsigned leaked_duplicates = 0;
+  int round;
+
+  UNIT_TEST_BEGIN();
+
+  for(round = 0; round < NUM_ROUNDS; round++) {
+    send_round(round, &false_duplicates, &leaked_duplicates);
+  }
+  printf("false duplicates %u, leaked duplicates %u\n",
+         false_duplicates, leaked_duplicates);
+  UNIT_TEST_ASSERT(false_duplicates == 0);
+  UNIT_TEST_ASSERT(leaked_duplicates == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(mac_sequence_age_out,
+                   "Sequence numbers age out");
+UNIT_TEST(mac_sequence_age_out)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  /* All senders sent their last frame more than the max age ago */
+  for(i = 0; i < NUM_SENDERS; i++) {
+    set_frame(i, NUM_ROUNDS - 1 + i);
+    UNIT_TEST_ASSERT(!mac_sequence_is_duplicate());
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  mac_sequence_init();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(mac_sequence_many_senders);
+
+  etimer_set(&et, NETSTACK_CONF_MAC_SEQNO_MAX_AGE + CLOCK_SECOND / 4);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  UNIT_TEST_RUN(mac_sequence_age_out);
+
+  if(!UNIT_TEST_PASSED(mac_sequence_many_senders)
+      || !UNIT_TEST_PASSED(mac_sequence_age_out)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,8 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* Most queuebufs are swapped to CFS */
+#define QUEUEBUF_CONF_NUM 24
+#define QUEUEBUFRAM_CONF_NUM 4
+
+#endif /* PROJECT_CONF_H_ */
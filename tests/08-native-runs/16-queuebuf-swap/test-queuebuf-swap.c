@@ -0,0 +1,263 @@
+/**
+ * \file
+ *         Queuebufs swapped to CFS keep their content.
+ */
+
+#include "contiki.h"
+#include "unit-test.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "lib/random.h"
+#include "cfs/cfs.h"
+#include <stdio.h>
+#include <string.h>
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+/* Enough to go through all swap files several times */
+#define NUM_ITERATIONS 20000
+/* Ids of full-size packets */
+#define FULL_SIZE 0x8000
+/* Enough full-size records to fill all swap files */
+#define MAX_FULL_UPDATES 4096
+
+static struct queuebuf *bufs[QUEUEBUF_NUM];
+static uint16_t ids[QUEUEBUF_NUM];
+
+/*---------------------------------------------------------------------------*/
+static int
+packet_len(uint16_t id)
+{
+  if(id & FULL_SIZE) {
+    return PACKETBUF_SIZE;
+  }
+  return 1 + (id * 37) % PACKETBUF_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_packet(uint16_t id)
+{
+  linkaddr_t addr;
+  uint8_t *data;
+  int i;
+
+  packetbuf_clear();
+  data = packetbuf_dataptr();
+  for(i = 0; i < packet_len(id); i++) {
+    data[i] = id * 7 + i;
+  }
+  packetbuf_set_datalen(packet_len(id));
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, id);
+  memset(&addr, 0, sizeof(addr));
+  addr.u8[0] = id >> 8;
+  addr.u8[1] = id;
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &addr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_packet(struct queuebuf *b, uint16_t id)
+{
+  uint8_t *data;
+  int i;
+
+  if(queuebuf_datalen(b) != packet_len(id)
+     || queuebuf_attr(b, PACKETBUF_ATTR_MAC_SEQNO) != id
+     || queuebuf_addr(b, PACKETBUF_ADDR_RECEIVER)->u8[1] != (id & 0xff)) {
+    return 0;
+  }
+  queuebuf_to_packetbuf(b);
+  if(packetbuf_datalen() != packet_len(id)
+     || packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO) != id) {
+    return 0;
+  }
+  data = packetbuf_dataptr();
+  for(i = 0; i < packet_len(id); i++) {
+    if(data[i] != (uint8_t)(id * 7 + i)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(queuebuf_swap_fill,
+                   "All queuebufs can be used");
+UNIT_TEST(queuebuf_swap_fill)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  for(i = 0; i < QUEUEBUF_NUM; i++) {
+    set_packet(i);
+    bufs[i] = queuebuf_new_from_packetbuf();
+    UNIT_TEST_ASSERT(bufs[i] != NULL);
+  }
+  set_packet(i);
+  UNIT_TEST_ASSERT(queuebuf_new_from_packetbuf() == NULL);
+
+  for(i = QUEUEBUF_NUM - 1; i >= 0; i--) {
+    UNIT_TEST_ASSERT(check_packet(bufs[i], i));
+  }
+  for(i = 0; i < QUEUEBUF_NUM; i++) {
+    queuebuf_free(bufs[i]);
+    bufs[i] = NULL;
+  }
+  UNIT_TEST_ASSERT(queuebuf_numfree() == QUEUEBUF_NUM);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(queuebuf_swap_churn,
+                   "Swapped queuebufs survive allocations, updates and frees");
+UNIT_TEST(queuebuf_swap_churn)
+{
+  unsigned errors = 0;
+  unsigned alloc_failures = 0;
+  uint16_t n;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  for(n = 0; n < NUM_ITERATIONS; n++) {
+    i = random_rand() % QUEUEBUF_NUM;
+    if(bufs[i] == NULL) {
+      set_packet(n);
+      bufs[i] = queuebuf_new_from_packetbuf();
+      ids[i] = n;
+      if(bufs[i] == NULL) {
+        alloc_failures++;
+      }
+    } else if(n % 8 == 0) {
+      /* Update the packet */
+      set_packet(n);
+      queuebuf_update_from_packetbuf(bufs[i]);
+      ids[i] = n;
+    } else if(n % 8 == 1) {
+      queuebuf_swap_in(bufs[i]);
+    } else {
+      if(!check_packet(bufs[i], ids[i])) {
+        errors++;
+      }
+      queuebuf_free(bufs[i]);
+      bufs[i] = NULL;
+    }
+  }
+  for(i = 0; i < QUEUEBUF_NUM; i++) {
+    if(bufs[i] != NULL) {
+      if(!check_packet(bufs[i], ids[i])) {
+        errors++;
+      }
+      queuebuf_free(bufs[i]);
+      bufs[i] = NULL;
+    }
+  }
+  printf("errors %u, allocation failures %u\n", errors, alloc_failures);
+  UNIT_TEST_ASSERT(errors == 0);
+  UNIT_TEST_ASSERT(alloc_failures == 0);
+  UNIT_TEST_ASSERT(queuebuf_numfree() == QUEUEBUF_NUM);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(queuebuf_swap_full,
+                   "Updates of swapped queuebufs survive a full swap");
+UNIT_TEST(queuebuf_swap_full)
+{
+  struct queuebuf *pinned;
+  struct queuebuf *updated;
+  uint16_t id;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  /* Use up the RAM, so that the next queuebufs are swapped */
+  for(i = 0; i < QUEUEBUFRAM_NUM; i++) {
+    set_packet(i);
+    bufs[i] = queuebuf_new_from_packetbuf();
+    UNIT_TEST_ASSERT(bufs[i] != NULL);
+  }
+  set_packet(100);
+  pinned = queuebuf_new_from_packetbuf();
+  UNIT_TEST_ASSERT(pinned != NULL);
+  set_packet(101);
+  updated = queuebuf_new_from_packetbuf();
+  UNIT_TEST_ASSERT(updated != NULL);
+
+  /* Update until the log wraps around to the file of the pinned queuebuf:
+     the swap is full and the update is lost */
+  id = 101;
+  for(i = 0; i < MAX_FULL_UPDATES; i++) {
+    set_packet(FULL_SIZE | i);
+    queuebuf_update_from_packetbuf(updated);
+    if(!check_packet(updated, FULL_SIZE | i)) {
+      break;
+    }
+    id = FULL_SIZE | i;
+  }
+  UNIT_TEST_ASSERT(i < MAX_FULL_UPDATES);
+  UNIT_TEST_ASSERT(check_packet(updated, id));
+  UNIT_TEST_ASSERT(check_packet(pinned, 100));
+
+  /* With some RAM, the update moves the queuebuf out of the swap */
+  queuebuf_free(bufs[0]);
+  bufs[0] = NULL;
+  set_packet(102);
+  queuebuf_update_from_packetbuf(updated);
+  UNIT_TEST_ASSERT(check_packet(updated, 102));
+
+  /* Once the pinned queuebuf is freed, the swap is usable again */
+  queuebuf_free(pinned);
+  set_packet(103);
+  bufs[0] = queuebuf_new_from_packetbuf();
+  UNIT_TEST_ASSERT(bufs[0] != NULL);
+  UNIT_TEST_ASSERT(check_packet(bufs[0], 103));
+  UNIT_TEST_ASSERT(check_packet(updated, 102));
+  for(i = 1; i < QUEUEBUFRAM_NUM; i++) {
+    UNIT_TEST_ASSERT(check_packet(bufs[i], i));
+  }
+
+  queuebuf_free(updated);
+  for(i = 0; i < QUEUEBUFRAM_NUM; i++) {
+    queuebuf_free(bufs[i]);
+    bufs[i] = NULL;
+  }
+  UNIT_TEST_ASSERT(queuebuf_numfree() == QUEUEBUF_NUM);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(queuebuf_swap_fill);
+  UNIT_TEST_RUN(queuebuf_swap_churn);
+  UNIT_TEST_RUN(queuebuf_swap_full);
+
+  /* Let the swap renew its files, then remove them */
+  etimer_set(&et, CLOCK_SECOND / 10);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  cfs_remove("a");
+  cfs_remove("b");
+  cfs_remove("c");
+  cfs_remove("d");
+
+  if(!UNIT_TEST_PASSED(queuebuf_swap_fill)
+      || !UNIT_TEST_PASSED(queuebuf_swap_churn)
+      || !UNIT_TEST_PASSED(queuebuf_swap_full)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
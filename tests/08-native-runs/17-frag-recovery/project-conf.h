@@ -0,0 +1,15 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* 6LoWPAN over a loopback MAC layer that loses frames on purpose */
+#define NETSTACK_CONF_NETWORK sicslowpan_driver
+#define NETSTACK_CONF_MAC loopback_mac_driver
+
+#define SICSLOWPAN_CONF_FRAG_RECOVERY 1
+#define SICSLOWPAN_CONF_SFR_ACK_TIMEOUT (CLOCK_SECOND / 4)
+#define SICSLOWPAN_CONF_SFR_MAX_RETRIES 3
+
+/* Room for all the fragments of a datagram */
+#define QUEUEBUF_CONF_NUM 16
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,296 @@
+/**
+ * \file
+ *         Selective fragment recovery (RFC 8931) of sicslowpan.c, over a
+ *         loopback MAC layer that loses fragments and RFRAG-ACKs.
+ */
+
+#include "contiki.h"
+#include "unit-test.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/tcpip.h"
+#include "net/ipv6/sicslowpan.h"
+#include <stdio.h>
+#include <string.h>
+
+PROCESS(test_process, "test");
+PROCESS(loopback_process, "loopback");
+AUTOSTART_PROCESSES(&test_process);
+
+#define MAX_PAYLOAD 100
+#define MAX_FRAMES 40
+#define PAYLOAD_LEN 600
+
+/* Longer than the sender takes to give up */
+#define SCENARIO_DURATION (CLOCK_SECOND * 3)
+
+enum {
+  LOSSLESS,
+  LOST_FRAGMENTS,
+  LOST_LAST_FRAGMENT,
+  LOST_ACK,
+  ALL_LOST,
+  LOSSLESS_AGAIN,
+  NUM_SCENARIOS
+};
+
+struct scenario_result {
+  unsigned fragments;
+  unsigned acks;
+  unsigned delivered;
+  unsigned corrupted;
+};
+
+static struct scenario_result results[NUM_SCENARIOS];
+static struct scenario_result *current;
+
+/* The losses of the current scenario */
+static uint32_t drop_seqs;
+static uint8_t drop_last;
+static uint8_t drop_all;
+static unsigned acks_to_drop;
+
+/* Frames on their way back to us */
+static struct {
+  uint8_t data[MAX_PAYLOAD];
+  uint8_t len;
+} frames[MAX_FRAMES];
+static int frames_head;
+static int frames_count;
+
+static linkaddr_t peer;
+static uint8_t datagram[UIP_IPH_LEN + UIP_UDPH_LEN + PAYLOAD_LEN];
+
+/*---------------------------------------------------------------------------*/
+static void
+loopback_send(mac_callback_t sent, void *ptr)
+{
+  const uint8_t *data = packetbuf_dataptr();
+  int len = packetbuf_datalen();
+  int dropped = 0;
+
+  if((data[0] & SICSLOWPAN_DISPATCH_RFRAG_MASK) == SICSLOWPAN_DISPATCH_RFRAG) {
+    uint8_t seq = (data[2] >> 2) & 0x1f;
+    uint32_t bit = 1UL << seq;
+    current->fragments++;
+    if(drop_all || (drop_seqs & bit)) {
+      drop_seqs &= ~bit;
+      dropped = 1;
+    } else if(drop_last && (data[2] & 0x80)) {
+      drop_last = 0;
+      dropped = 1;
+    }
+  } else if((data[0] & SICSLOWPAN_DISPATCH_RFRAG_MASK) == SICSLOWPAN_DISPATCH_RFRAG_ACK) {
+    current->acks++;
+    if(acks_to_drop > 0) {
+      acks_to_drop--;
+      dropped = 1;
+    }
+  } else {
+    dropped = 1;
+  }
+
+  if(!dropped && len <= MAX_PAYLOAD && frames_count < MAX_FRAMES) {
+    int i = (frames_head + frames_count) % MAX_FRAMES;
+    memcpy(frames[i].data, data, len);
+    frames[i].len = len;
+    frames_count++;
+    process_poll(&loopback_process);
+  }
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+loopback_init(void)
+{
+  process_start(&loopback_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static int
+loopback_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+loopback_max_payload(void)
+{
+  return MAX_PAYLOAD;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver loopback_mac_driver = {
+  "loopback",
+  loopback_init,
+  loopback_send,
+  NULL,
+  loopback_on,
+  loopback_on,
+  loopback_max_payload,
+};
+/*---------------------------------------------------------------------------*/
+/* Frames come back as if the peer sent them to us */
+PROCESS_THREAD(loopback_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    while(frames_count > 0) {
+      packetbuf_clear();
+      memcpy(packetbuf_dataptr(), frames[frames_head].data, frames[frames_head].len);
+      packetbuf_set_datalen(frames[frames_head].len);
+      packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &peer);
+      packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+      frames_head = (frames_head + 1) % MAX_FRAMES;
+      frames_count--;
+      NETSTACK_NETWORK.input();
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+sniffer_input(void)
+{
+  current->delivered++;
+  if(uip_len != sizeof(datagram) || memcmp(uip_buf, datagram, sizeof(datagram))) {
+    current->corrupted++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sniffer_output(int mac_status)
+{
+}
+NETSTACK_SNIFFER(sniffer, sniffer_input, sniffer_output);
+/*---------------------------------------------------------------------------*/
+static void
+init_datagram(void)
+{
+  struct uip_ip_hdr *ip = (struct uip_ip_hdr *)datagram;
+  struct uip_udp_hdr *udp = (struct uip_udp_hdr *)&datagram[UIP_IPH_LEN];
+  int i;
+
+  ip->vtc = 0x60;
+  ip->len[0] = (UIP_UDPH_LEN + PAYLOAD_LEN) >> 8;
+  ip->len[1] = (UIP_UDPH_LEN + PAYLOAD_LEN) & 0xff;
+  ip->proto = UIP_PROTO_UDP;
+  ip->ttl = 64;
+  uip_ip6addr(&ip->srcipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 1);
+  uip_ip6addr(&ip->destipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 2);
+  udp->srcport = UIP_HTONS(5678);
+  udp->destport = UIP_HTONS(8765);
+  udp->udplen = UIP_HTONS(UIP_UDPH_LEN + PAYLOAD_LEN);
+  udp->udpchksum = UIP_HTONS(0x1234);
+  for(i = 0; i < PAYLOAD_LEN; i++) {
+    datagram[UIP_IPH_LEN + UIP_UDPH_LEN + i] = i * 7;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_datagram(void)
+{
+  memcpy(uip_buf, datagram, sizeof(datagram));
+  uip_len = sizeof(datagram);
+  tcpip_output((const uip_lladdr_t *)&peer);
+  uipbuf_clear();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(frag_recovery_lossless,
+                   "A datagram is sent once without losses");
+UNIT_TEST(frag_recovery_lossless)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(results[LOSSLESS].fragments > 1);
+  UNIT_TEST_ASSERT(results[LOSSLESS].acks == 1);
+  UNIT_TEST_ASSERT(results[LOSSLESS].delivered == 1);
+  UNIT_TEST_ASSERT(results[LOSSLESS].corrupted == 0);
+  /* The sender released the datagram */
+  UNIT_TEST_ASSERT(results[LOSSLESS_AGAIN].fragments == results[LOSSLESS].fragments);
+  UNIT_TEST_ASSERT(results[LOSSLESS_AGAIN].delivered == 1);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(frag_recovery_losses,
+                   "Only lost fragments are sent again");
+UNIT_TEST(frag_recovery_losses)
+{
+  unsigned count = results[LOSSLESS].fragments;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(results[LOST_FRAGMENTS].fragments == count + 2);
+  UNIT_TEST_ASSERT(results[LOST_FRAGMENTS].acks == 2);
+  UNIT_TEST_ASSERT(results[LOST_FRAGMENTS].delivered == 1);
+  UNIT_TEST_ASSERT(results[LOST_FRAGMENTS].corrupted == 0);
+
+  /* The sender times out and requests an RFRAG-ACK again */
+  UNIT_TEST_ASSERT(results[LOST_LAST_FRAGMENT].fragments == count + 1);
+  UNIT_TEST_ASSERT(results[LOST_LAST_FRAGMENT].delivered == 1);
+  UNIT_TEST_ASSERT(results[LOST_LAST_FRAGMENT].corrupted == 0);
+
+  /* The receiver acknowledges the datagram again, but delivers it once */
+  UNIT_TEST_ASSERT(results[LOST_ACK].fragments == count + 1);
+  UNIT_TEST_ASSERT(results[LOST_ACK].acks == 2);
+  UNIT_TEST_ASSERT(results[LOST_ACK].delivered == 1);
+  UNIT_TEST_ASSERT(results[LOST_ACK].corrupted == 0);
+
+  /* The sender gives up */
+  UNIT_TEST_ASSERT(results[ALL_LOST].fragments
+                   == count + SICSLOWPAN_CONF_SFR_MAX_RETRIES);
+  UNIT_TEST_ASSERT(results[ALL_LOST].delivered == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static struct etimer et;
+  static int i;
+
+  PROCESS_BEGIN();
+
+  linkaddr_copy(&peer, &linkaddr_node_addr);
+  peer.u8[LINKADDR_SIZE - 1] ^= 1;
+  init_datagram();
+  netstack_sniffer_add(&sniffer);
+
+  for(i = 0; i < NUM_SCENARIOS; i++) {
+    current = &results[i];
+    /* The first fragment comes last */
+    drop_seqs = i == LOST_FRAGMENTS ? (1UL << 0) | (1UL << 3) : 0;
+    drop_last = i == LOST_LAST_FRAGMENT;
+    drop_all = i == ALL_LOST;
+    acks_to_drop = i == LOST_ACK;
+
+    send_datagram();
+    etimer_set(&et, SCENARIO_DURATION);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+    printf("scenario %d: fragments %u, acks %u, delivered %u, corrupted %u\n",
+           i, current->fragments, current->acks, current->delivered,
+           current->corrupted);
+  }
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(frag_recovery_lossless);
+  UNIT_TEST_RUN(frag_recovery_losses);
+
+  if(!UNIT_TEST_PASSED(frag_recovery_lossless) ||
+     !UNIT_TEST_PASSED(frag_recovery_losses)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
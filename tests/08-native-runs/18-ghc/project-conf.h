@@ -0,0 +1,13 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* 6LoWPAN over a loopback MAC layer */
+#define NETSTACK_CONF_NETWORK sicslowpan_driver
+#define NETSTACK_CONF_MAC loopback_mac_driver
+
+#define SICSLOWPAN_CONF_GHC 1
+
+/* Room for all the fragments of a datagram */
+#define QUEUEBUF_CONF_NUM 16
+
+#endif /* PROJECT_CONF_H_ */
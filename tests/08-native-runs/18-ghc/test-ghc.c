@@ -0,0 +1,318 @@
+/**
+ * \file
+ *         Generic header compression (RFC 7400) of the UDP payloads in
+ *         sicslowpan.c, over a loopback MAC layer.
+ */
+
+#include "contiki.h"
+#include "unit-test.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/tcpip.h"
+#include "net/ipv6/sicslowpan.h"
+#include <stdio.h>
+#include <string.h>
+
+PROCESS(test_process, "test");
+PROCESS(loopback_process, "loopback");
+AUTOSTART_PROCESSES(&test_process);
+
+#define MAX_PAYLOAD 100
+#define MAX_FRAMES 16
+#define MAX_DATAGRAM 400
+
+enum {
+  TELEMETRY,
+  RANDOM,
+  NUM_PAYLOADS
+};
+
+enum {
+  NOT_CAPABLE,
+  CAPABLE,
+  LEARNT,
+  NUM_SCENARIOS
+};
+
+struct send_result {
+  unsigned frames;
+  unsigned bytes;
+  unsigned delivered;
+  unsigned corrupted;
+};
+
+static struct send_result results[NUM_SCENARIOS][NUM_PAYLOADS];
+static struct send_result replayed;
+static struct send_result *current;
+
+/* Frames on their way back to us */
+static struct {
+  uint8_t data[MAX_PAYLOAD];
+  uint8_t len;
+} frames[MAX_FRAMES];
+static int frames_head;
+static int frames_count;
+
+/* A GHC frame of the peer, to learn its capability from */
+static uint8_t ghc_frame[MAX_PAYLOAD];
+static uint8_t ghc_frame_len;
+
+static linkaddr_t peer;
+static uint8_t datagram[MAX_DATAGRAM];
+static uint16_t datagram_len;
+
+/*---------------------------------------------------------------------------*/
+static void
+loopback_send(mac_callback_t sent, void *ptr)
+{
+  int len = packetbuf_datalen();
+
+  current->frames++;
+  current->bytes += len;
+  if(len <= MAX_PAYLOAD && frames_count < MAX_FRAMES) {
+    int i = (frames_head + frames_count) % MAX_FRAMES;
+    memcpy(frames[i].data, packetbuf_dataptr(), len);
+    frames[i].len = len;
+    frames_count++;
+    process_poll(&loopback_process);
+  }
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+loopback_init(void)
+{
+  process_start(&loopback_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static int
+loopback_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+loopback_max_payload(void)
+{
+  return MAX_PAYLOAD;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver loopback_mac_driver = {
+  "loopback",
+  loopback_init,
+  loopback_send,
+  NULL,
+  loopback_on,
+  loopback_on,
+  loopback_max_payload,
+};
+/*---------------------------------------------------------------------------*/
+static void
+input_frame(const uint8_t *data, uint8_t len)
+{
+  packetbuf_clear();
+  memcpy(packetbuf_dataptr(), data, len);
+  packetbuf_set_datalen(len);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &peer);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+/* Frames come back as if the peer sent them to us */
+PROCESS_THREAD(loopback_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    while(frames_count > 0) {
+      input_frame(frames[frames_head].data, frames[frames_head].len);
+      frames_head = (frames_head + 1) % MAX_FRAMES;
+      frames_count--;
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+sniffer_input(void)
+{
+  current->delivered++;
+  if(uip_len != datagram_len || memcmp(uip_buf, datagram, datagram_len)) {
+    current->corrupted++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sniffer_output(int mac_status)
+{
+}
+NETSTACK_SNIFFER(sniffer, sniffer_input, sniffer_output);
+/*---------------------------------------------------------------------------*/
+static void
+init_datagram(int payload)
+{
+  struct uip_ip_hdr *ip = (struct uip_ip_hdr *)datagram;
+  struct uip_udp_hdr *udp = (struct uip_udp_hdr *)&datagram[UIP_IPH_LEN];
+  uint8_t *p = &datagram[UIP_IPH_LEN + UIP_UDPH_LEN];
+  uint16_t payload_len;
+  uint32_t seed = 12345;
+  int i;
+
+  if(payload == TELEMETRY) {
+    /* A CoAP response with a SenML payload */
+    static const uint8_t coap_hdr[] = { 0x64, 0x45, 0x13, 0xfd, 0xd0, 0xe2,
+                                        0x4d, 0xac, 0xff };
+    memcpy(p, coap_hdr, sizeof(coap_hdr));
+    payload_len = sizeof(coap_hdr);
+    payload_len += sprintf((char *)p + payload_len, "[{\"bn\":\"dev1/\"}");
+    for(i = 0; i < 8; i++) {
+      payload_len += sprintf((char *)p + payload_len,
+                             ",{\"n\":\"temp\",\"v\":21.%d}", 5 + i % 2);
+    }
+    payload_len += sprintf((char *)p + payload_len, "]");
+  } else {
+    payload_len = 60;
+    for(i = 0; i < payload_len; i++) {
+      seed = seed * 1103515245 + 12345;
+      p[i] = seed >> 16;
+    }
+  }
+
+  memset(datagram, 0, UIP_IPH_LEN + UIP_UDPH_LEN);
+  ip->vtc = 0x60;
+  ip->len[0] = (UIP_UDPH_LEN + payload_len) >> 8;
+  ip->len[1] = (UIP_UDPH_LEN + payload_len) & 0xff;
+  ip->proto = UIP_PROTO_UDP;
+  ip->ttl = 64;
+  uip_ip6addr(&ip->srcipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 1);
+  uip_ip6addr(&ip->destipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 2);
+  udp->srcport = UIP_HTONS(5683);
+  udp->destport = UIP_HTONS(5683);
+  udp->udplen = UIP_HTONS(UIP_UDPH_LEN + payload_len);
+  udp->udpchksum = UIP_HTONS(0x1234);
+  datagram_len = UIP_IPH_LEN + UIP_UDPH_LEN + payload_len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_datagram(void)
+{
+  memcpy(uip_buf, datagram, datagram_len);
+  uip_len = datagram_len;
+  tcpip_output((const uip_lladdr_t *)&peer);
+  uipbuf_clear();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(ghc_telemetry,
+                   "Telemetry fits a single frame with GHC");
+UNIT_TEST(ghc_telemetry)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(datagram_len > 2 * MAX_PAYLOAD);
+  /* Fragmented without GHC */
+  UNIT_TEST_ASSERT(results[NOT_CAPABLE][TELEMETRY].frames > 1);
+  UNIT_TEST_ASSERT(results[NOT_CAPABLE][TELEMETRY].delivered == 1);
+  UNIT_TEST_ASSERT(results[NOT_CAPABLE][TELEMETRY].corrupted == 0);
+  /* A single frame with GHC */
+  UNIT_TEST_ASSERT(results[CAPABLE][TELEMETRY].frames == 1);
+  UNIT_TEST_ASSERT(results[CAPABLE][TELEMETRY].delivered == 1);
+  UNIT_TEST_ASSERT(results[CAPABLE][TELEMETRY].corrupted == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(ghc_incompressible,
+                   "Incompressible payloads are sent as is");
+UNIT_TEST(ghc_incompressible)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(results[CAPABLE][RANDOM].frames == 1);
+  UNIT_TEST_ASSERT(results[CAPABLE][RANDOM].bytes
+                   == results[NOT_CAPABLE][RANDOM].bytes);
+  UNIT_TEST_ASSERT(results[CAPABLE][RANDOM].delivered == 1);
+  UNIT_TEST_ASSERT(results[CAPABLE][RANDOM].corrupted == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(ghc_learnt,
+                   "A neighbor sending GHC is known to support it");
+UNIT_TEST(ghc_learnt)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(ghc_frame_len > 0);
+  UNIT_TEST_ASSERT(replayed.delivered == 1);
+  UNIT_TEST_ASSERT(replayed.corrupted == 0);
+  UNIT_TEST_ASSERT(results[LEARNT][TELEMETRY].frames == 1);
+  UNIT_TEST_ASSERT(results[LEARNT][TELEMETRY].delivered == 1);
+  UNIT_TEST_ASSERT(results[LEARNT][TELEMETRY].corrupted == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static struct etimer et;
+  static int scenario;
+  static int payload;
+
+  PROCESS_BEGIN();
+
+  linkaddr_copy(&peer, &linkaddr_node_addr);
+  peer.u8[LINKADDR_SIZE - 1] ^= 1;
+  netstack_sniffer_add(&sniffer);
+
+  for(scenario = 0; scenario < NUM_SCENARIOS; scenario++) {
+    if(scenario == CAPABLE) {
+      sicslowpan_ghc_set_capable(&peer, 1);
+    } else if(scenario == LEARNT) {
+      /* Forget, then receive a GHC frame from the peer */
+      sicslowpan_ghc_set_capable(&peer, 0);
+      current = &replayed;
+      init_datagram(TELEMETRY);
+      input_frame(ghc_frame, ghc_frame_len);
+    }
+    for(payload = 0; payload < NUM_PAYLOADS; payload++) {
+      current = &results[scenario][payload];
+      init_datagram(payload);
+      send_datagram();
+      if(scenario == CAPABLE && payload == TELEMETRY
+         && frames_count == 1) {
+        ghc_frame_len = frames[frames_head].len;
+        memcpy(ghc_frame, frames[frames_head].data, ghc_frame_len);
+      }
+      etimer_set(&et, CLOCK_SECOND / 10);
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+      printf("scenario %d, payload %d: frames %u, bytes %u, delivered %u, corrupted %u\n",
+             scenario, payload, current->frames, current->bytes,
+             current->delivered, current->corrupted);
+    }
+  }
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  init_datagram(TELEMETRY);
+  UNIT_TEST_RUN(ghc_telemetry);
+  UNIT_TEST_RUN(ghc_incompressible);
+  UNIT_TEST_RUN(ghc_learnt);
+
+  if(!UNIT_TEST_PASSED(ghc_telemetry) ||
+     !UNIT_TEST_PASSED(ghc_incompressible) ||
+     !UNIT_TEST_PASSED(ghc_learnt)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,3 @@
+#!/bin/sh -e
+
+./run-one.sh 19-ds6-nbr
@@ -0,0 +1,8 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define NBR_TABLE_CONF_MAX_NEIGHBORS 16
+#define NBR_TABLE_CONF_LLADDR_HASH 1
+#define UIP_DS6_NBR_CONF_IPADDR_HASH 1
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,210 @@
+/**
+ * \file
+ *         Hashed lookups of the IPv6 neighbor cache (uip-ds6-nbr.c) by IPv6
+ *         and link-layer address, across additions, removals, link-layer
+ *         address updates and evictions.
+ */
+
+#include "contiki.h"
+#include "unit-test.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include <stdio.h>
+#include <string.h>
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+/* More than the neighbor table holds */
+#define NUM_ADDRS (2 * NBR_TABLE_MAX_NEIGHBORS)
+
+/*---------------------------------------------------------------------------*/
+static void
+make_ipaddr(uip_ipaddr_t *ipaddr, int i)
+{
+  uip_ip6addr(ipaddr, 0xfe80, 0, 0, 0, 0x0212, 0x4b00, 0x0600, 0x1000 + i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_lladdr(uip_lladdr_t *lladdr, int i)
+{
+  memset(lladdr, 0, sizeof(*lladdr));
+  lladdr->addr[0] = 0x00;
+  lladdr->addr[1] = 0x12;
+  lladdr->addr[UIP_LLADDR_LEN - 2] = 0x10;
+  lladdr->addr[UIP_LLADDR_LEN - 1] = i;
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_nbr_t *
+add(int ip, int ll)
+{
+  uip_ipaddr_t ipaddr;
+  uip_lladdr_t lladdr;
+
+  make_ipaddr(&ipaddr, ip);
+  make_lladdr(&lladdr, ll);
+  return uip_ds6_nbr_add(&ipaddr, &lladdr, 0, NBR_REACHABLE,
+                         NBR_TABLE_REASON_IPV6_ND, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_nbr_t *
+lookup(int ip)
+{
+  uip_ipaddr_t ipaddr;
+
+  make_ipaddr(&ipaddr, ip);
+  return uip_ds6_nbr_lookup(&ipaddr);
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_nbr_t *
+ll_lookup(int ll)
+{
+  uip_lladdr_t lladdr;
+
+  make_lladdr(&lladdr, ll);
+  return uip_ds6_nbr_ll_lookup(&lladdr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+in_cache(const uip_ds6_nbr_t *nbr)
+{
+  uip_ds6_nbr_t *n;
+
+  for(n = uip_ds6_nbr_head(); n != NULL; n = uip_ds6_nbr_next(n)) {
+    if(n == nbr) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Checks that both lookups find exactly the entries of the cache */
+static int
+is_consistent(void)
+{
+  uip_ds6_nbr_t *nbr;
+  int found = 0;
+  int i;
+
+  for(nbr = uip_ds6_nbr_head(); nbr != NULL; nbr = uip_ds6_nbr_next(nbr)) {
+    if(uip_ds6_nbr_lookup(&nbr->ipaddr) != nbr
+       || uip_ds6_nbr_ll_lookup(uip_ds6_nbr_get_ll(nbr)) != nbr) {
+      return 0;
+    }
+  }
+  for(i = 0; i < NUM_ADDRS; i++) {
+    nbr = lookup(i);
+    if(nbr != NULL) {
+      if(!in_cache(nbr)) {
+        return 0;
+      }
+      found++;
+    }
+    nbr = ll_lookup(i);
+    if(nbr != NULL && !in_cache(nbr)) {
+      return 0;
+    }
+  }
+  return found == uip_ds6_nbr_num();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(ds6_nbr_add_rm, "Lookups after additions and removals");
+UNIT_TEST(ds6_nbr_add_rm)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS / 2; i++) {
+    UNIT_TEST_ASSERT(add(i, i) != NULL);
+  }
+  UNIT_TEST_ASSERT(uip_ds6_nbr_num() == NBR_TABLE_MAX_NEIGHBORS / 2);
+  for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS / 2; i++) {
+    UNIT_TEST_ASSERT(lookup(i) != NULL);
+    UNIT_TEST_ASSERT(lookup(i) == ll_lookup(i));
+  }
+  UNIT_TEST_ASSERT(lookup(NUM_ADDRS - 1) == NULL);
+  UNIT_TEST_ASSERT(ll_lookup(NUM_ADDRS - 1) == NULL);
+  UNIT_TEST_ASSERT(is_consistent());
+
+  for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS / 2; i += 3) {
+    UNIT_TEST_ASSERT(uip_ds6_nbr_rm(lookup(i)));
+    UNIT_TEST_ASSERT(lookup(i) == NULL);
+    UNIT_TEST_ASSERT(ll_lookup(i) == NULL);
+  }
+  UNIT_TEST_ASSERT(lookup(1) != NULL);
+  UNIT_TEST_ASSERT(is_consistent());
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(ds6_nbr_update, "Lookups after address changes");
+UNIT_TEST(ds6_nbr_update)
+{
+  uip_ds6_nbr_t *nbr;
+  uip_lladdr_t lladdr;
+
+  UNIT_TEST_BEGIN();
+
+  /* A new IPv6 address for link-layer address 1 */
+  UNIT_TEST_ASSERT(add(NUM_ADDRS - 1, 1) != NULL);
+  UNIT_TEST_ASSERT(lookup(NUM_ADDRS - 1) == ll_lookup(1));
+  UNIT_TEST_ASSERT(is_consistent());
+
+  /* A new link-layer address for IPv6 address 2 */
+  nbr = lookup(2);
+  make_lladdr(&lladdr, NUM_ADDRS - 2);
+  UNIT_TEST_ASSERT(uip_ds6_nbr_update_ll(&nbr, &lladdr) == 0);
+  UNIT_TEST_ASSERT(lookup(2) == nbr);
+  UNIT_TEST_ASSERT(ll_lookup(NUM_ADDRS - 2) == nbr);
+  UNIT_TEST_ASSERT(ll_lookup(2) == NULL);
+  UNIT_TEST_ASSERT(is_consistent());
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(ds6_nbr_evict, "Lookups after evictions");
+UNIT_TEST(ds6_nbr_evict)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  for(i = NBR_TABLE_MAX_NEIGHBORS / 2; i < NUM_ADDRS - 2; i++) {
+    UNIT_TEST_ASSERT(add(i, i) != NULL);
+    UNIT_TEST_ASSERT(lookup(i) == ll_lookup(i));
+    UNIT_TEST_ASSERT(is_consistent());
+  }
+  UNIT_TEST_ASSERT(uip_ds6_nbr_num() <= NBR_TABLE_MAX_NEIGHBORS);
+
+  nbr_table_clear();
+  UNIT_TEST_ASSERT(uip_ds6_nbr_num() == 0);
+  UNIT_TEST_ASSERT(is_consistent());
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(ds6_nbr_add_rm);
+  UNIT_TEST_RUN(ds6_nbr_update);
+  UNIT_TEST_RUN(ds6_nbr_evict);
+
+  if(!UNIT_TEST_PASSED(ds6_nbr_add_rm) ||
+     !UNIT_TEST_PASSED(ds6_nbr_update) ||
+     !UNIT_TEST_PASSED(ds6_nbr_evict)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,9 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define UIP_CONF_MAX_ROUTES 64
+#define UIP_DS6_ROUTE_CONF_TRIE 1
+/* Evict the least recently used route when full */
+#define UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED 1
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,231 @@
+/**
+ * \file
+ *         Longest-prefix match of the routing table (uip-ds6-route.c) with
+ *         its radix trie index, against a scan of all routes, as routes
+ *         are added, replaced, evicted and removed.
+ */
+
+#include "contiki.h"
+#include "unit-test.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include <stdio.h>
+#include <string.h>
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+#define NUM_NEXTHOPS 4
+#define NUM_OPERATIONS 4000
+#define NUM_LOOKUPS 32
+
+static uip_ipaddr_t nexthops[NUM_NEXTHOPS];
+static uint32_t seed = 1;
+static unsigned mismatches;
+static unsigned lookups;
+
+/*---------------------------------------------------------------------------*/
+static unsigned
+rand_below(unsigned n)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) % n;
+}
+/*---------------------------------------------------------------------------*/
+/* Addresses close enough to each other for their prefixes to overlap */
+static void
+random_addr(uip_ipaddr_t *addr)
+{
+  uip_ip6addr(addr, 0xfd00, 0, 0, rand_below(8), 0, 0,
+              rand_below(2) << 12, rand_below(256));
+}
+/*---------------------------------------------------------------------------*/
+static int
+prefix_match(const uip_ipaddr_t *addr1, const uip_ipaddr_t *addr2, int length)
+{
+  int i;
+
+  for(i = 0; i < length; i++) {
+    int bit = 7 - (i & 7);
+    if(((addr1->u8[i >> 3] ^ addr2->u8[i >> 3]) >> bit) & 1) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* The longest match, by scanning all routes */
+static uip_ds6_route_t *
+scan_lookup(const uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+  uip_ds6_route_t *found = NULL;
+
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    if((found == NULL || r->length > found->length)
+       && prefix_match(addr, &r->ipaddr, r->length)) {
+      found = r;
+    }
+  }
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_lookup(const uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *expected = scan_lookup(addr);
+  uip_ds6_route_t *found = uip_ds6_route_lookup(addr);
+
+  lookups++;
+  /* Routes to the same prefix are equivalent */
+  if(expected == NULL ? found != NULL
+     : found == NULL || found->length != expected->length
+       || !prefix_match(&found->ipaddr, &expected->ipaddr, expected->length)) {
+    mismatches++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_lookups(void)
+{
+  static uip_ipaddr_t route_addrs[UIP_DS6_ROUTE_NB];
+  uip_ipaddr_t addr;
+  uip_ds6_route_t *r;
+  int num;
+  int i;
+
+  for(i = 0; i < NUM_LOOKUPS; i++) {
+    random_addr(&addr);
+    check_lookup(&addr);
+    /* Again, from the cache */
+    check_lookup(&addr);
+  }
+  /* Lookups reorder the routes */
+  num = 0;
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    uip_ipaddr_copy(&route_addrs[num++], &r->ipaddr);
+  }
+  for(i = 0; i < num; i++) {
+    check_lookup(&route_addrs[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(ds6_route_trie, "Longest-prefix match with the trie");
+UNIT_TEST(ds6_route_trie)
+{
+  static const uint8_t lengths[] = { 0, 16, 48, 60, 64, 100, 120 };
+  uip_ipaddr_t addr;
+  uip_ds6_route_t *r;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&nexthops[0]) == NULL);
+
+  for(i = 0; i < NUM_OPERATIONS; i++) {
+    if(rand_below(4) > 0) {
+      /* Mostly host routes, as in storing mode */
+      random_addr(&addr);
+      uip_ds6_route_add(&addr, rand_below(8) > 0
+                        ? 128 : lengths[rand_below(sizeof(lengths))],
+                        &nexthops[rand_below(NUM_NEXTHOPS)]);
+    } else if(uip_ds6_route_num_routes() > 0) {
+      int n = rand_below(uip_ds6_route_num_routes());
+      for(r = uip_ds6_route_head(); n > 0; r = uip_ds6_route_next(r)) {
+        n--;
+      }
+      /* Its lookup is cached, then the route removed */
+      uip_ipaddr_copy(&addr, &r->ipaddr);
+      check_lookup(&addr);
+      uip_ds6_route_rm(r);
+      check_lookup(&addr);
+    }
+    if(i % 8 == 0) {
+      check_lookups();
+    }
+    if(i == NUM_OPERATIONS / 2) {
+      /* All routes of a next hop at once */
+      uip_ds6_route_rm_by_nexthop(&nexthops[0]);
+      check_lookups();
+    }
+  }
+  printf("%u lookups, %u mismatches, %d routes\n", lookups, mismatches,
+         uip_ds6_route_num_routes());
+  UNIT_TEST_ASSERT(mismatches == 0);
+
+  /* Down to no route at all */
+  while((r = uip_ds6_route_head()) != NULL) {
+    uip_ds6_route_rm(r);
+    check_lookups();
+  }
+  UNIT_TEST_ASSERT(mismatches == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(ds6_route_evict, "Eviction of the least recently used");
+UNIT_TEST(ds6_route_evict)
+{
+  uip_ipaddr_t addr;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == 0);
+  for(i = 0; i < UIP_DS6_ROUTE_NB; i++) {
+    uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, 0, 0x100 + i);
+    UNIT_TEST_ASSERT(uip_ds6_route_add(&addr, 128, &nexthops[0]) != NULL);
+  }
+  /* All but the second route used since added */
+  for(i = 0; i < UIP_DS6_ROUTE_NB; i++) {
+    if(i != 1) {
+      uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, 0, 0x100 + i);
+      UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) != NULL);
+    }
+  }
+  uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, 0, 0x100 + UIP_DS6_ROUTE_NB);
+  UNIT_TEST_ASSERT(uip_ds6_route_add(&addr, 128, &nexthops[1]) != NULL);
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == UIP_DS6_ROUTE_NB);
+
+  uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, 0, 0x101);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == NULL);
+  uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, 0, 0x100);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) != NULL);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  uip_lladdr_t lladdr;
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < NUM_NEXTHOPS; i++) {
+    memset(&lladdr, 0, sizeof(lladdr));
+    lladdr.addr[UIP_LLADDR_LEN - 1] = i + 1;
+    uip_ip6addr(&nexthops[i], 0xfe80, 0, 0, 0, 0, 0, 0, i + 1);
+    uip_ds6_nbr_add(&nexthops[i], &lladdr, 1, NBR_REACHABLE,
+                    NBR_TABLE_REASON_IPV6_ND, NULL);
+  }
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(ds6_route_trie);
+  UNIT_TEST_RUN(ds6_route_evict);
+
+  if(!UNIT_TEST_PASSED(ds6_route_trie) ||
+     !UNIT_TEST_PASSED(ds6_route_evict)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,10 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* 6LoWPAN over a MAC layer that captures the frames sent */
+#define NETSTACK_CONF_NETWORK sicslowpan_driver
+#define NETSTACK_CONF_MAC capture_mac_driver
+
+#define SICSLOWPAN_CONF_FRAG_FORWARDING 1
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,305 @@
+/**
+ * \file
+ *         Fragment forwarding (RFC 8930) and reassembly of sicslowpan.c,
+ *         with fragments received out of order.
+ */
+
+#include "contiki.h"
+#include "unit-test.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "net/ipv6/tcpip.h"
+#include "net/ipv6/sicslowpan.h"
+#include <stdio.h>
+#include <string.h>
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+#define MAX_PAYLOAD 100
+#define MAX_FRAMES 16
+#define PAYLOAD_LEN 600
+
+#define IS_FRAG1(f) (((f)->data[0] & 0xf8) == SICSLOWPAN_DISPATCH_FRAG1)
+#define IS_FRAGN(f) (((f)->data[0] & 0xf8) == SICSLOWPAN_DISPATCH_FRAGN)
+#define FRAG_TAG(f) (((f)->data[2] << 8) | (f)->data[3])
+
+struct frame {
+  uint8_t data[MAX_PAYLOAD];
+  uint8_t len;
+};
+
+/* The fragments of the datagram, as the previous hop sends them */
+static struct frame in[MAX_FRAMES];
+static int in_count;
+/* The fragments we send */
+static struct frame out[MAX_FRAMES];
+static int out_count;
+static struct frame *capture;
+static int *capture_count;
+
+static linkaddr_t prev_hop;
+static linkaddr_t next_hop;
+static uip_ipaddr_t next_hop_ipaddr;
+static uint8_t datagram[UIP_IPH_LEN + UIP_UDPH_LEN + PAYLOAD_LEN];
+static unsigned delivered;
+static unsigned corrupted;
+
+/*---------------------------------------------------------------------------*/
+static void
+capture_send(mac_callback_t sent, void *ptr)
+{
+  const uint8_t *data = packetbuf_dataptr();
+  int len = packetbuf_datalen();
+
+  /* Only keep fragments, not the ICMP errors of the reassembled datagram */
+  if((data[0] & 0xf8) == SICSLOWPAN_DISPATCH_FRAG1
+     || (data[0] & 0xf8) == SICSLOWPAN_DISPATCH_FRAGN) {
+    if(len <= MAX_PAYLOAD && *capture_count < MAX_FRAMES) {
+      memcpy(capture[*capture_count].data, data, len);
+      capture[*capture_count].len = len;
+      (*capture_count)++;
+    }
+  }
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+capture_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+capture_max_payload(void)
+{
+  return MAX_PAYLOAD;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver capture_mac_driver = {
+  "capture",
+  capture_init,
+  capture_send,
+  NULL,
+  capture_on,
+  capture_on,
+  capture_max_payload,
+};
+/*---------------------------------------------------------------------------*/
+static void
+sniffer_input(void)
+{
+  delivered++;
+  if(uip_len != sizeof(datagram) || memcmp(uip_buf, datagram, sizeof(datagram))) {
+    corrupted++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sniffer_output(int mac_status)
+{
+}
+NETSTACK_SNIFFER(sniffer, sniffer_input, sniffer_output);
+/*---------------------------------------------------------------------------*/
+/* Fragment a datagram to dest, as the previous hop does */
+static void
+make_fragments(const uip_ipaddr_t *dest)
+{
+  struct uip_ip_hdr *ip = (struct uip_ip_hdr *)datagram;
+  struct uip_udp_hdr *udp = (struct uip_udp_hdr *)&datagram[UIP_IPH_LEN];
+  int i;
+
+  ip->vtc = 0x60;
+  ip->len[0] = (UIP_UDPH_LEN + PAYLOAD_LEN) >> 8;
+  ip->len[1] = (UIP_UDPH_LEN + PAYLOAD_LEN) & 0xff;
+  ip->proto = UIP_PROTO_UDP;
+  ip->ttl = 64;
+  uip_ip6addr(&ip->srcipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 1);
+  uip_ipaddr_copy(&ip->destipaddr, dest);
+  udp->srcport = UIP_HTONS(5678);
+  udp->destport = UIP_HTONS(8765);
+  udp->udplen = UIP_HTONS(UIP_UDPH_LEN + PAYLOAD_LEN);
+  udp->udpchksum = UIP_HTONS(0x1234);
+  for(i = 0; i < PAYLOAD_LEN; i++) {
+    datagram[UIP_IPH_LEN + UIP_UDPH_LEN + i] = i * 7;
+  }
+
+  capture = in;
+  capture_count = &in_count;
+  in_count = 0;
+  memcpy(uip_buf, datagram, sizeof(datagram));
+  uip_len = sizeof(datagram);
+  tcpip_output((const uip_lladdr_t *)&next_hop);
+  uipbuf_clear();
+
+  capture = out;
+  capture_count = &out_count;
+  out_count = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Receive a fragment from the previous hop */
+static void
+receive(int i)
+{
+  packetbuf_clear();
+  memcpy(packetbuf_dataptr(), in[i].data, in[i].len);
+  packetbuf_set_datalen(in[i].len);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &prev_hop);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+/* Was the fragment in[i] forwarded as is, with the tag of the next hop? */
+static int
+is_forwarded(int i)
+{
+  int j;
+  for(j = 0; j < out_count; j++) {
+    if(IS_FRAGN(&out[j]) && out[j].len == in[i].len
+       && FRAG_TAG(&out[j]) == FRAG_TAG(&out[0])
+       && !memcmp(out[j].data + 4, in[i].data + 4, in[i].len - 4)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(frag_reassembly_out_of_order,
+                   "A datagram is reassembled whatever the order of its fragments");
+UNIT_TEST(frag_reassembly_out_of_order)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  make_fragments(&uip_ds6_get_link_local(-1)->ipaddr);
+  UNIT_TEST_ASSERT(in_count > 3);
+  UNIT_TEST_ASSERT(IS_FRAG1(&in[0]));
+
+  /* The last fragment first, the first fragment in the middle */
+  receive(in_count - 1);
+  for(i = 1; i < in_count - 1; i++) {
+    receive(i);
+    if(i == 1) {
+      receive(0);
+    }
+  }
+  UNIT_TEST_ASSERT(delivered == 1);
+  UNIT_TEST_ASSERT(corrupted == 0);
+  UNIT_TEST_ASSERT(out_count == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(frag_forwarding_out_of_order,
+                   "All fragments are forwarded whatever their order");
+UNIT_TEST(frag_forwarding_out_of_order)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  delivered = 0;
+  make_fragments(&next_hop_ipaddr);
+  UNIT_TEST_ASSERT(in_count > 3);
+
+  /* A fragment before the first one, then the last one before the others */
+  receive(1);
+  UNIT_TEST_ASSERT(out_count == 0);
+  receive(0);
+  UNIT_TEST_ASSERT(out_count == 2);
+  UNIT_TEST_ASSERT(IS_FRAG1(&out[0]));
+  UNIT_TEST_ASSERT(FRAG_TAG(&out[0]) != FRAG_TAG(&in[0]));
+  receive(in_count - 1);
+  for(i = 2; i < in_count - 1; i++) {
+    receive(i);
+  }
+  UNIT_TEST_ASSERT(out_count == in_count);
+  for(i = 1; i < in_count; i++) {
+    UNIT_TEST_ASSERT(is_forwarded(i));
+  }
+  UNIT_TEST_ASSERT(delivered == 0);
+
+  /* The VRB entry was freed with the last byte of the datagram */
+  receive(2);
+  UNIT_TEST_ASSERT(out_count == in_count);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(frag_forwarding_duplicates,
+                   "Duplicate fragments do not complete a datagram early");
+UNIT_TEST(frag_forwarding_duplicates)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  delivered = 0;
+  make_fragments(&next_hop_ipaddr);
+  UNIT_TEST_ASSERT(in_count > 3);
+
+  /* A duplicate first fragment does not set up another VRB entry */
+  receive(0);
+  UNIT_TEST_ASSERT(out_count == 1);
+  receive(0);
+  UNIT_TEST_ASSERT(out_count == 1);
+
+  /* Every fragment but the last one twice */
+  for(i = 1; i < in_count - 1; i++) {
+    receive(i);
+    receive(i);
+  }
+  receive(in_count - 1);
+  UNIT_TEST_ASSERT(out_count == 2 * in_count - 2);
+  UNIT_TEST_ASSERT(is_forwarded(in_count - 1));
+  UNIT_TEST_ASSERT(delivered == 0);
+
+  /* The VRB entry was freed with the last byte of the datagram */
+  receive(in_count - 1);
+  UNIT_TEST_ASSERT(out_count == 2 * in_count - 2);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  linkaddr_copy(&prev_hop, &linkaddr_node_addr);
+  prev_hop.u8[LINKADDR_SIZE - 1] ^= 1;
+  linkaddr_copy(&next_hop, &linkaddr_node_addr);
+  next_hop.u8[LINKADDR_SIZE - 1] ^= 2;
+  uip_ip6addr(&next_hop_ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 2);
+  uip_ds6_nbr_add(&next_hop_ipaddr, (const uip_lladdr_t *)&next_hop,
+                  0, NBR_REACHABLE, NBR_TABLE_REASON_UNDEFINED, NULL);
+  netstack_sniffer_add(&sniffer);
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(frag_reassembly_out_of_order);
+  UNIT_TEST_RUN(frag_forwarding_out_of_order);
+  UNIT_TEST_RUN(frag_forwarding_duplicates);
+
+  if(!UNIT_TEST_PASSED(frag_reassembly_out_of_order) ||
+     !UNIT_TEST_PASSED(frag_forwarding_out_of_order) ||
+     !UNIT_TEST_PASSED(frag_forwarding_duplicates)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
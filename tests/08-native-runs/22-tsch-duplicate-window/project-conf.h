@@ -0,0 +1,8 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define TSCH_CONF_WITH_DUPLICATE_WINDOW 1
+/* Short enough for the test to check the age-out */
+#define TSCH_CONF_DUPLICATE_WINDOW_MAX_AGE (CLOCK_SECOND / 2)
+
+#endif /* PROJECT_CONF_H_ */
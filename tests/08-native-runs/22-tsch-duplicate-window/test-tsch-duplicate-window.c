@@ -0,0 +1,137 @@
+/**
+ * \file
+ *         Duplicate detection of TSCH with a window per sender.
+ */
+
+#include "contiki.h"
+#include "unit-test.h"
+#include "net/packetbuf.h"
+#include "net/mac/tsch/tsch.h"
+#include <stdio.h>
+#include <string.h>
+
+PROCESS(test_process, "test");
+AUTOSTART_PROCESSES(&test_process);
+
+/* More senders than the former table of 8 windows */
+#define NUM_SENDERS 32
+#define NUM_ROUNDS 8
+
+/*---------------------------------------------------------------------------*/
+static int
+is_duplicate(int sender, uint8_t seqno)
+{
+  linkaddr_t addr;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.u8[0] = 0x02;
+  addr.u8[LINKADDR_SIZE - 2] = sender >> 8;
+  addr.u8[LINKADDR_SIZE - 1] = sender;
+  packetbuf_clear();
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &addr);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, seqno);
+  return tsch_duplicate_window_check();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(duplicate_window_many_senders,
+                   "Duplicates of many senders are detected");
+UNIT_TEST(duplicate_window_many_senders)
+{
+  unsigned false_duplicates = 0;
+  unsigned leaked_duplicates = 0;
+  int round;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  /* Every sender sends a frame, then all of them retransmit it */
+  for(round = 0; round < NUM_ROUNDS; round++) {
+    for(i = 0; i < NUM_SENDERS; i++) {
+      false_duplicates += is_duplicate(i, round + i);
+    }
+    for(i = 0; i < NUM_SENDERS; i++) {
+      leaked_duplicates += !is_duplicate(i, round + i);
+    }
+  }
+  printf("false duplicates %u, leaked duplicates %u\n",
+         false_duplicates, leaked_duplicates);
+  UNIT_TEST_ASSERT(false_duplicates == 0);
+  UNIT_TEST_ASSERT(leaked_duplicates == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(duplicate_window_late,
+                   "Late frames within the window are detected once");
+UNIT_TEST(duplicate_window_late)
+{
+  int sender = NUM_SENDERS;
+
+  UNIT_TEST_BEGIN();
+
+  /* 254, 255, 0, 1 then 5: 2 to 4 were missed */
+  UNIT_TEST_ASSERT(!is_duplicate(sender, 254));
+  UNIT_TEST_ASSERT(!is_duplicate(sender, 255));
+  UNIT_TEST_ASSERT(!is_duplicate(sender, 0));
+  UNIT_TEST_ASSERT(!is_duplicate(sender, 1));
+  UNIT_TEST_ASSERT(!is_duplicate(sender, 5));
+  /* A late retransmission of a received frame */
+  UNIT_TEST_ASSERT(is_duplicate(sender, 255));
+  /* A late frame that was missed, then its retransmission */
+  UNIT_TEST_ASSERT(!is_duplicate(sender, 3));
+  UNIT_TEST_ASSERT(is_duplicate(sender, 3));
+  UNIT_TEST_ASSERT(is_duplicate(sender, 5));
+  /* Far behind the window: a restarted sender */
+  UNIT_TEST_ASSERT(!is_duplicate(sender, 5 - TSCH_DUPLICATE_WINDOW_SIZE - 10));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(duplicate_window_age_out,
+                   "Windows age out");
+UNIT_TEST(duplicate_window_age_out)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  /* All senders sent their last frame more than the max age ago */
+  for(i = 0; i < NUM_SENDERS; i++) {
+    UNIT_TEST_ASSERT(!is_duplicate(i, NUM_ROUNDS - 1 + i));
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  tsch_duplicate_window_init();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(duplicate_window_many_senders);
+  UNIT_TEST_RUN(duplicate_window_late);
+
+  etimer_set(&et, TSCH_DUPLICATE_WINDOW_MAX_AGE + CLOCK_SECOND / 4);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  UNIT_TEST_RUN(duplicate_window_age_out);
+
+  if(!UNIT_TEST_PASSED(duplicate_window_many_senders)
+      || !UNIT_TEST_PASSED(duplicate_window_late)
+      || !UNIT_TEST_PASSED(duplicate_window_age_out)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,14 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define UNIT_TEST_PRINT_FUNCTION test_print_report
+
+#define TSCH_CONF_AUTOSTART 1
+
+/* Number of packets sent back-to-back by the test */
+#define BURST_NUM_PACKETS 6
+
+#define TSCH_CONF_BURST_MAX_LEN 8
+#define QUEUEBUF_CONF_NUM 16
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/mac/tsch/tsch.h"
+#include "sys/node-id.h"
+
+#include "unit-test/unit-test.h"
+#include "common.h"
+
+PROCESS(test_process, "TSCH burst test");
+AUTOSTART_PROCESSES(&test_process);
+
+/* Slotframe with a link right after the minimal cell */
+#define BUSY_SLOTFRAME_HANDLE 1
+
+/* Neighbor of test_nbr_limit, never heard from */
+static linkaddr_t idle_nbr_addr = {{ 0x42 }};
+
+static linkaddr_t time_source_addr;
+static unsigned packets_sent;
+static unsigned packets_sent_ok;
+static struct tsch_asn_t start_asn;
+static struct tsch_asn_t end_asn;
+
+/* Number of timeslots to send all packets, in every test case */
+static int32_t burst_span;
+static int32_t limited_span;
+static int32_t busy_span;
+static int busy_slot_is_free;
+static int free_slot_is_free;
+
+/*---------------------------------------------------------------------------*/
+static void
+packet_sent(void *ptr, int status, int transmissions)
+{
+  packets_sent++;
+  if(status == MAC_TX_OK) {
+    packets_sent_ok++;
+  }
+  if(packets_sent == BURST_NUM_PACKETS) {
+    end_asn = tsch_current_asn;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Queue packets to the time source, all at once */
+static void
+send_packets(void)
+{
+  static const char payload[] = "burst";
+  int i;
+
+  packets_sent = 0;
+  packets_sent_ok = 0;
+  start_asn = tsch_current_asn;
+  for(i = 0; i < BURST_NUM_PACKETS; i++) {
+    packetbuf_clear();
+    memcpy(packetbuf_dataptr(), payload, sizeof(payload));
+    packetbuf_set_datalen(sizeof(payload));
+    packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &time_source_addr);
+    NETSTACK_MAC.send(packet_sent, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_burst,
+                   "queued packets are sent back-to-back");
+UNIT_TEST(test_burst)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(packets_sent_ok == BURST_NUM_PACKETS);
+  /* Without bursts, one packet per slotframe */
+  UNIT_TEST_ASSERT(burst_span < 3 * TSCH_SCHEDULE_DEFAULT_LENGTH);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_free_slot,
+                   "a burst does not continue into a scheduled timeslot");
+UNIT_TEST(test_free_slot)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(!busy_slot_is_free);
+  UNIT_TEST_ASSERT(free_slot_is_free);
+  UNIT_TEST_ASSERT(busy_span >= (BURST_NUM_PACKETS - 1) * TSCH_SCHEDULE_DEFAULT_LENGTH);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_nbr_limit,
+                   "the burst length of a neighbor is kept while idle");
+UNIT_TEST(test_nbr_limit)
+{
+  struct tsch_neighbor *n;
+
+  UNIT_TEST_BEGIN();
+
+  /* A burst length of 1 means no burst */
+  UNIT_TEST_ASSERT(limited_span >= (BURST_NUM_PACKETS - 1) * TSCH_SCHEDULE_DEFAULT_LENGTH);
+
+  UNIT_TEST_ASSERT(tsch_queue_set_nbr_burst_max_len(&idle_nbr_addr, 2) == 1);
+  tsch_queue_free_unused_neighbors();
+  n = tsch_queue_get_nbr(&idle_nbr_addr);
+  UNIT_TEST_ASSERT(n != NULL);
+  UNIT_TEST_ASSERT(n->burst_max_len == 2);
+
+  /* Back to the default, the neighbor is freed */
+  UNIT_TEST_ASSERT(tsch_queue_set_nbr_burst_max_len(&idle_nbr_addr, TSCH_BURST_MAX_LEN) == 1);
+  tsch_queue_free_unused_neighbors();
+  UNIT_TEST_ASSERT(tsch_queue_get_nbr(&idle_nbr_addr) == NULL);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static struct etimer et;
+  struct tsch_slotframe *sf;
+  struct tsch_asn_divisor_t div;
+  struct tsch_asn_t asn;
+
+  PROCESS_BEGIN();
+
+  if(node_id == 1) {
+    /* The receiver */
+    tsch_set_coordinator(1);
+    printf("=check-me= DONE\n");
+    PROCESS_EXIT();
+  }
+
+  etimer_set(&et, CLOCK_SECOND);
+  while(tsch_is_associated == 0 || tsch_queue_get_time_source() == NULL) {
+    PROCESS_YIELD_UNTIL(etimer_expired(&et));
+    etimer_reset(&et);
+  }
+  linkaddr_copy(&time_source_addr,
+                tsch_queue_get_nbr_address(tsch_queue_get_time_source()));
+
+  /* Bursts with the default length */
+  send_packets();
+  while(packets_sent < BURST_NUM_PACKETS) {
+    etimer_set(&et, CLOCK_SECOND / 10);
+    PROCESS_YIELD_UNTIL(etimer_expired(&et));
+  }
+  burst_span = TSCH_ASN_DIFF(end_asn, start_asn);
+
+  /* No burst to a neighbor with a burst length of 1 */
+  tsch_queue_set_nbr_burst_max_len(&time_source_addr, 1);
+  send_packets();
+  while(packets_sent < BURST_NUM_PACKETS) {
+    etimer_set(&et, CLOCK_SECOND / 10);
+    PROCESS_YIELD_UNTIL(etimer_expired(&et));
+  }
+  limited_span = TSCH_ASN_DIFF(end_asn, start_asn);
+  tsch_queue_set_nbr_burst_max_len(&time_source_addr, TSCH_BURST_MAX_LEN);
+
+  /* No burst when the timeslot after the minimal cell is scheduled */
+  sf = tsch_schedule_add_slotframe(BUSY_SLOTFRAME_HANDLE, TSCH_SCHEDULE_DEFAULT_LENGTH);
+  tsch_schedule_add_link(sf, LINK_OPTION_RX, LINK_TYPE_NORMAL,
+                         &tsch_broadcast_address, 1, 0, 0);
+  TSCH_ASN_DIVISOR_INIT(div, TSCH_SCHEDULE_DEFAULT_LENGTH);
+  asn = tsch_current_asn;
+  TSCH_ASN_INC(asn, TSCH_SCHEDULE_DEFAULT_LENGTH + 1 - TSCH_ASN_MOD(asn, div));
+  busy_slot_is_free = tsch_schedule_is_slot_free(&asn);
+  TSCH_ASN_INC(asn, 1);
+  free_slot_is_free = tsch_schedule_is_slot_free(&asn);
+  send_packets();
+  while(packets_sent < BURST_NUM_PACKETS) {
+    etimer_set(&et, CLOCK_SECOND / 10);
+    PROCESS_YIELD_UNTIL(etimer_expired(&et));
+  }
+  busy_span = TSCH_ASN_DIFF(end_asn, start_asn);
+  tsch_schedule_remove_slotframe(sf);
+
+  printf("spans: burst %ld, limited %ld, busy %ld\n",
+         (long)burst_span, (long)limited_span, (long)busy_span);
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(test_burst);
+  UNIT_TEST_RUN(test_free_slot);
+  UNIT_TEST_RUN(test_nbr_limit);
+
+  printf("=check-me= DONE\n");
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,15 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define UNIT_TEST_PRINT_FUNCTION test_print_report
+
+#define TSCH_CONF_AUTOSTART 1
+
+/* Length of the slotframe mutated by the test */
+#define CHURN_SLOTFRAME_LENGTH 5
+
+/* Just enough links for the minimal schedule and a full churn slotframe:
+ * removed links must be reclaimed for the test to add new ones */
+#define TSCH_SCHEDULE_CONF_MAX_LINKS (CHURN_SLOTFRAME_LENGTH + 1)
+
+#endif /* PROJECT_CONF_H_ */
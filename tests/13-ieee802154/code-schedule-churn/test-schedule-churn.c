@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "net/mac/tsch/tsch.h"
+
+#include "unit-test/unit-test.h"
+#include "common.h"
+
+PROCESS(test_process, "TSCH schedule churn test");
+AUTOSTART_PROCESSES(&test_process);
+
+#define CHURN_SLOTFRAME_HANDLE  1
+/* Number of rounds of schedule updates */
+#define CHURN_ROUNDS            500
+/* Number of schedule updates per round */
+#define CHURN_UPDATES_PER_ROUND 8
+
+static unsigned add_failures;
+static unsigned invalid_schedules;
+static unsigned packets_sent;
+static unsigned packets_sent_ok;
+
+/*---------------------------------------------------------------------------*/
+static void
+packet_sent(void *ptr, int status, int transmissions)
+{
+  packets_sent++;
+  if(status == MAC_TX_OK) {
+    packets_sent_ok++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_broadcast(void)
+{
+  static const char payload[] = "churn";
+  packetbuf_clear();
+  memcpy(packetbuf_dataptr(), payload, sizeof(payload));
+  packetbuf_set_datalen(sizeof(payload));
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_null);
+  NETSTACK_MAC.send(packet_sent, NULL);
+}
+/*---------------------------------------------------------------------------*/
+/* Apply one random update to the churn slotframe: add or replace a link,
+ * remove a link, or remove the whole slotframe */
+static void
+update_schedule(void)
+{
+  struct tsch_slotframe *sf;
+  uint16_t timeslot = random_rand() % CHURN_SLOTFRAME_LENGTH;
+
+  sf = tsch_schedule_get_slotframe_by_handle(CHURN_SLOTFRAME_HANDLE);
+  if(sf == NULL) {
+    sf = tsch_schedule_add_slotframe(CHURN_SLOTFRAME_HANDLE, CHURN_SLOTFRAME_LENGTH);
+    if(sf == NULL) {
+      add_failures++;
+      return;
+    }
+  }
+
+  switch(random_rand() % 8) {
+  case 0:
+    tsch_schedule_remove_slotframe(sf);
+    break;
+  case 1:
+  case 2:
+  case 3:
+    tsch_schedule_remove_link_by_offsets(sf, timeslot, 0);
+    break;
+  default:
+    if(tsch_schedule_add_link(sf, LINK_OPTION_TX | LINK_OPTION_RX | LINK_OPTION_SHARED,
+                              LINK_TYPE_NORMAL, &tsch_broadcast_address,
+                              timeslot, 0, 1) == NULL) {
+      add_failures++;
+    }
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Check that there is at most one link per timeslot in the churn slotframe */
+static int
+is_schedule_valid(void)
+{
+  struct tsch_slotframe *sf;
+  struct tsch_link *l;
+  uint8_t used[CHURN_SLOTFRAME_LENGTH];
+
+  sf = tsch_schedule_get_slotframe_by_handle(CHURN_SLOTFRAME_HANDLE);
+  if(sf == NULL) {
+    return 1;
+  }
+  memset(used, 0, sizeof(used));
+  for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+    if(l->timeslot >= CHURN_SLOTFRAME_LENGTH || used[l->timeslot]) {
+      return 0;
+    }
+    used[l->timeslot] = 1;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_churn,
+                   "schedule updates never fail while slot operation runs");
+UNIT_TEST(test_churn)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(add_failures == 0);
+  UNIT_TEST_ASSERT(invalid_schedules == 0);
+  /* Traffic kept flowing in the minimal schedule */
+  UNIT_TEST_ASSERT(packets_sent > 0);
+  UNIT_TEST_ASSERT(packets_sent_ok == packets_sent);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_reclaim,
+                   "all removed links are eventually reclaimed");
+UNIT_TEST(test_reclaim)
+{
+  struct tsch_slotframe *sf;
+  uint16_t timeslot;
+
+  UNIT_TEST_BEGIN();
+
+  sf = tsch_schedule_get_slotframe_by_handle(CHURN_SLOTFRAME_HANDLE);
+  if(sf != NULL) {
+    UNIT_TEST_ASSERT(tsch_schedule_remove_slotframe(sf) == 1);
+  }
+  sf = tsch_schedule_add_slotframe(CHURN_SLOTFRAME_HANDLE, CHURN_SLOTFRAME_LENGTH);
+  UNIT_TEST_ASSERT(sf != NULL);
+
+  /* The link pool has room for exactly a full slotframe */
+  for(timeslot = 0; timeslot < CHURN_SLOTFRAME_LENGTH; timeslot++) {
+    UNIT_TEST_ASSERT(tsch_schedule_add_link(sf, LINK_OPTION_RX, LINK_TYPE_NORMAL,
+                                            &tsch_broadcast_address,
+                                            timeslot, 0, 0) != NULL);
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static struct etimer et;
+  static int round;
+  int i;
+
+  PROCESS_BEGIN();
+
+  tsch_set_coordinator(1);
+
+  etimer_set(&et, CLOCK_SECOND);
+  while(tsch_is_associated == 0) {
+    PROCESS_YIELD_UNTIL(etimer_expired(&et));
+    etimer_reset(&et);
+  }
+
+  /* Update the schedule at random points of slot operation,
+   * with broadcast traffic flowing in the minimal schedule */
+  for(round = 0; round < CHURN_ROUNDS; round++) {
+    if(tsch_queue_global_packet_count() < QUEUEBUF_NUM / 2) {
+      send_broadcast();
+    }
+    for(i = 0; i < CHURN_UPDATES_PER_ROUND; i++) {
+      update_schedule();
+    }
+    if(!is_schedule_valid()) {
+      invalid_schedules++;
+    }
+    etimer_set(&et, 1 + random_rand() % (CLOCK_SECOND / 50));
+    PROCESS_YIELD_UNTIL(etimer_expired(&et));
+  }
+
+  /* Let the queue drain */
+  etimer_set(&et, CLOCK_SECOND);
+  PROCESS_YIELD_UNTIL(etimer_expired(&et));
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(test_churn);
+  UNIT_TEST_RUN(test_reclaim);
+
+  printf("=check-me= DONE\n");
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
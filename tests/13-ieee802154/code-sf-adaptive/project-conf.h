@@ -0,0 +1,15 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define UNIT_TEST_PRINT_FUNCTION test_print_report
+
+#define TSCH_CONF_AUTOSTART 1
+#define TSCH_CONF_WITH_SIXTOP 1
+
+#define QUEUEBUF_CONF_NUM 16
+
+/* Short periods and slotframe, for the test to last a few minutes */
+#define SF_ADAPTIVE_CONF_PERIOD (2 * CLOCK_SECOND)
+#define SF_ADAPTIVE_CONF_SLOTFRAME_LENGTH 11
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/mac/tsch/tsch.h"
+#include "net/mac/tsch/sixtop/sixtop.h"
+#include "sf-adaptive.h"
+#include "sys/node-id.h"
+
+#include "unit-test/unit-test.h"
+#include "common.h"
+
+PROCESS(test_process, "SF adaptive test");
+AUTOSTART_PROCESSES(&test_process);
+
+/* Number of periods with a high load */
+#define LOAD_PERIODS 8
+/* Packets kept in queue during the high load */
+#define LOAD_BACKLOG 4
+/* Max time for the cells to be deleted once idle */
+#define IDLE_DURATION (120 * CLOCK_SECOND)
+/* Min time between two deletions: SF_ADAPTIVE_DELETE_PERIODS periods,
+ * each randomized by up to 1/8 */
+#define MIN_DELETE_INTERVAL \
+  ((SF_ADAPTIVE_DELETE_PERIODS - 1) * SF_ADAPTIVE_PERIOD)
+
+static linkaddr_t time_source_addr;
+
+static int peak_cells;
+static int final_cells;
+static unsigned early_deletions;
+static unsigned multiple_deletions;
+static unsigned idle_additions;
+
+/*---------------------------------------------------------------------------*/
+static void
+send_packet(void)
+{
+  static const char payload[] = "load";
+  packetbuf_clear();
+  memcpy(packetbuf_dataptr(), payload, sizeof(payload));
+  packetbuf_set_datalen(sizeof(payload));
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &time_source_addr);
+  NETSTACK_MAC.send(NULL, NULL);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_add,
+                   "cells are added under load");
+UNIT_TEST(test_add)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(peak_cells > SF_ADAPTIVE_HYSTERESIS);
+  UNIT_TEST_ASSERT(peak_cells <= SF_ADAPTIVE_MAX_CELLS);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_delete,
+                   "idle cells are deleted one at a time, with hysteresis");
+UNIT_TEST(test_delete)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(idle_additions == 0);
+  UNIT_TEST_ASSERT(multiple_deletions == 0);
+  UNIT_TEST_ASSERT(early_deletions == 0);
+  /* The last cells fit within the hysteresis */
+  UNIT_TEST_ASSERT(final_cells == MAX(SF_ADAPTIVE_MIN_CELLS, SF_ADAPTIVE_HYSTERESIS));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static struct etimer et;
+  static struct timer phase;
+  static clock_time_t last_change;
+  static int cells;
+  int new_cells;
+
+  PROCESS_BEGIN();
+
+  sixtop_add_sf(&sf_adaptive_driver);
+
+  if(node_id == 1) {
+    /* The responder */
+    tsch_set_coordinator(1);
+    printf("=check-me= DONE\n");
+    PROCESS_EXIT();
+  }
+
+  etimer_set(&et, CLOCK_SECOND);
+  while(tsch_is_associated == 0 || tsch_queue_get_time_source() == NULL) {
+    PROCESS_YIELD_UNTIL(etimer_expired(&et));
+    etimer_reset(&et);
+  }
+  linkaddr_copy(&time_source_addr,
+                tsch_queue_get_nbr_address(tsch_queue_get_time_source()));
+
+  /* High load: keep a backlog towards the time source */
+  timer_set(&phase, LOAD_PERIODS * SF_ADAPTIVE_PERIOD);
+  while(!timer_expired(&phase)) {
+    struct tsch_neighbor *n = tsch_queue_get_time_source();
+    while(n != NULL && tsch_queue_nbr_packet_count(n) < LOAD_BACKLOG) {
+      send_packet();
+    }
+    peak_cells = MAX(peak_cells, sf_adaptive_get_num_tx_cells(&time_source_addr));
+    etimer_set(&et, CLOCK_SECOND / 32);
+    PROCESS_YIELD_UNTIL(etimer_expired(&et));
+  }
+
+  /* Idle: watch the cells being deleted */
+  cells = sf_adaptive_get_num_tx_cells(&time_source_addr);
+  last_change = clock_time();
+  timer_set(&phase, IDLE_DURATION);
+  while(!timer_expired(&phase)) {
+    etimer_set(&et, SF_ADAPTIVE_PERIOD / 8);
+    PROCESS_YIELD_UNTIL(etimer_expired(&et));
+    new_cells = sf_adaptive_get_num_tx_cells(&time_source_addr);
+    if(new_cells > cells) {
+      idle_additions++;
+    } else if(new_cells < cells) {
+      if(new_cells < cells - 1) {
+        multiple_deletions++;
+      }
+      if(clock_time() - last_change < MIN_DELETE_INTERVAL) {
+        early_deletions++;
+      }
+      last_change = clock_time();
+    }
+    cells = new_cells;
+  }
+  final_cells = cells;
+
+  printf("cells: peak %d, final %d\n", peak_cells, final_cells);
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(test_add);
+  UNIT_TEST_RUN(test_delete);
+
+  printf("=check-me= DONE\n");
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/